@@ -148,6 +148,7 @@ endif()
 if(UNIX)
 	cmake_push_check_state()
 	list(APPEND CMAKE_REQUIRED_DEFINITIONS -D_GNU_SOURCE)
+	check_symbol_exists("fallocate"     "fcntl.h"    HAVE_FALLOCATE)
 	check_symbol_exists("memmem"        "string.h"   HAVE_MEMMEM)
 	check_symbol_exists("memrchr"       "string.h"   HAVE_MEMRCHR)
 	check_symbol_exists("strchrnul"     "string.h"   HAVE_STRCHRNUL)
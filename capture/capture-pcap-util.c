@@ -629,7 +629,7 @@ copy_timestamp_cb(const void *data, void *user_data _U_)
 	return ret;
 }
 
-static if_capabilities_t *
+if_capabilities_t *
 if_capabilities_copy(const if_capabilities_t *caps)
 {
 	if (caps == NULL) return NULL;
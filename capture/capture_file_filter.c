@@ -0,0 +1,262 @@
+/* capture_file_filter.c
+ * Capture (BPF) filters for packets read from capture files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <config.h>
+#define WS_LOG_DOMAIN LOG_DOMAIN_CAPTURE
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <ws_attributes.h>
+#include <wiretap/pcap-encap.h>
+#include <wsutil/wmem/wmem_strutl.h>
+#include <wsutil/wslog.h>
+
+#include <capture/capture_file_filter.h>
+
+#ifdef HAVE_LIBPCAP
+
+#include <pcap/pcap.h>
+
+#ifdef _WIN32
+#include <capture/capture-wpcap.h>
+#endif
+
+/* The filter compiled for one link-layer type. */
+typedef struct {
+    int                 encap;
+    bool                compiled;       /**< false if it couldn't be */
+    char               *error;          /**< Why it couldn't be */
+    struct bpf_program  fcode;
+} cff_program;
+
+struct _capture_file_filter {
+    char       *text;
+    bool        optimize;
+    GArray     *programs;               /**< cff_program, one per encap seen */
+    unsigned    last;                   /**< Index of the last one used */
+};
+
+capture_file_filter *
+capture_file_filter_new(const char *text, bool optimize, char **err_msg)
+{
+    capture_file_filter *cff;
+
+#ifdef _WIN32
+    if (!has_npcap) {
+        load_wpcap();
+    }
+    if (!has_npcap) {
+        *err_msg = g_strdup("Capture filters can't be used, because Npcap isn't installed");
+        return NULL;
+    }
+#endif
+
+    cff = g_new0(capture_file_filter, 1);
+    cff->text = g_strdup(text);
+    cff->optimize = optimize;
+    cff->programs = g_array_new(false, false, sizeof(cff_program));
+    *err_msg = NULL;
+    return cff;
+}
+
+/*
+ * pcap_open_dead() takes a DLT_ value, but wiretap gives us the LINKTYPE_
+ * value written in capture files.  They're the same except for the few
+ * types whose DLT_ values differ between platforms, which got LINKTYPE_
+ * values of their own; map those back to this platform's DLT_ values,
+ * as libpcap does when it reads a pcap file.
+ */
+static int
+cff_linktype_to_dlt(int linktype)
+{
+    switch (linktype) {
+
+#ifdef DLT_ATM_RFC1483
+    case 100:   /* LINKTYPE_ATM_RFC1483 */
+        return DLT_ATM_RFC1483;
+#endif
+#ifdef DLT_RAW
+    case 101:   /* LINKTYPE_RAW */
+        return DLT_RAW;
+#endif
+#ifdef DLT_SLIP_BSDOS
+    case 102:   /* LINKTYPE_SLIP_BSDOS */
+        return DLT_SLIP_BSDOS;
+#endif
+#ifdef DLT_PPP_BSDOS
+    case 103:   /* LINKTYPE_PPP_BSDOS */
+        return DLT_PPP_BSDOS;
+#endif
+#ifdef DLT_C_HDLC
+    case 104:   /* LINKTYPE_C_HDLC */
+        return DLT_C_HDLC;
+#endif
+#ifdef DLT_ATM_CLIP
+    case 106:   /* LINKTYPE_ATM_CLIP */
+        return DLT_ATM_CLIP;
+#endif
+#ifdef DLT_PFLOG
+    case 117:   /* LINKTYPE_PFLOG */
+        return DLT_PFLOG;
+#endif
+#ifdef DLT_PFSYNC
+    case 246:   /* LINKTYPE_PFSYNC */
+        return DLT_PFSYNC;
+#endif
+    }
+    return linktype;
+}
+
+static cff_program *
+cff_get_program(capture_file_filter *cff, int encap, bool *added)
+{
+    cff_program  prog;
+    int          linktype;
+    pcap_t      *pd;
+
+    *added = false;
+    if (cff->last < cff->programs->len) {
+        cff_program *last = &g_array_index(cff->programs, cff_program, cff->last);
+
+        if (last->encap == encap) {
+            return last;
+        }
+    }
+    for (unsigned i = 0; i < cff->programs->len; i++) {
+        if (g_array_index(cff->programs, cff_program, i).encap == encap) {
+            cff->last = i;
+            return &g_array_index(cff->programs, cff_program, i);
+        }
+    }
+
+    memset(&prog, 0, sizeof prog);
+    prog.encap = encap;
+    linktype = wtap_wtap_encap_to_pcap_encap(encap);
+    if (linktype == -1) {
+        prog.error = ws_strdup_printf("Capture filters can't be applied to %s packets",
+                                      wtap_encap_description(encap));
+    } else if (wtap_encap_requires_phdr(encap)) {
+        /* Wiretap has moved the pseudo-header out of the packet data,
+           so the filter's offsets would be wrong. */
+        prog.error = ws_strdup_printf("Capture filters can't be applied to %s packets read from a file",
+                                      wtap_encap_description(encap));
+    } else {
+        pd = pcap_open_dead(cff_linktype_to_dlt(linktype), WTAP_MAX_PACKET_SIZE_STANDARD);
+        if (pd == NULL) {
+            prog.error = g_strdup("Can't create a pcap handle to compile the capture filter");
+        } else {
+#ifdef PCAP_NETMASK_UNKNOWN
+            if (pcap_compile(pd, &prog.fcode, cff->text, cff->optimize, PCAP_NETMASK_UNKNOWN) == -1) {
+#else
+            if (pcap_compile(pd, &prog.fcode, cff->text, cff->optimize, 0) == -1) {
+#endif
+                prog.error = ws_strdup_printf("Invalid capture filter \"%s\" for %s packets: %s",
+                                              cff->text, wtap_encap_description(encap),
+                                              pcap_geterr(pd));
+            } else {
+                prog.compiled = true;
+            }
+            pcap_close(pd);
+        }
+    }
+
+    g_array_append_val(cff->programs, prog);
+    cff->last = cff->programs->len - 1;
+    *added = true;
+    return &g_array_index(cff->programs, cff_program, cff->last);
+}
+
+bool
+capture_file_filter_compile(capture_file_filter *cff, int encap, char **err_msg)
+{
+    cff_program *prog;
+    bool         added;
+
+    prog = cff_get_program(cff, encap, &added);
+    if (!prog->compiled) {
+        *err_msg = g_strdup(prog->error);
+        return false;
+    }
+    return true;
+}
+
+bool
+capture_file_filter_apply(capture_file_filter *cff, const wtap_rec *rec)
+{
+    cff_program        *prog;
+    bool                added;
+    struct pcap_pkthdr  hdr;
+
+    if (rec->rec_type != REC_TYPE_PACKET) {
+        return true;
+    }
+
+    prog = cff_get_program(cff, rec->rec_header.packet_header.pkt_encap, &added);
+    if (!prog->compiled) {
+        if (added) {
+            ws_warning("%s; they will be dropped", prog->error);
+        }
+        return false;
+    }
+
+    memset(&hdr, 0, sizeof hdr);
+    hdr.caplen = rec->rec_header.packet_header.caplen;
+    hdr.len = rec->rec_header.packet_header.len;
+    return pcap_offline_filter(&prog->fcode, &hdr, ws_buffer_start_ptr(&rec->data)) != 0;
+}
+
+void
+capture_file_filter_free(capture_file_filter *cff)
+{
+    if (cff == NULL) {
+        return;
+    }
+    for (unsigned i = 0; i < cff->programs->len; i++) {
+        cff_program *prog = &g_array_index(cff->programs, cff_program, i);
+
+        if (prog->compiled) {
+            pcap_freecode(&prog->fcode);
+        }
+        g_free(prog->error);
+    }
+    g_array_free(cff->programs, true);
+    g_free(cff->text);
+    g_free(cff);
+}
+
+#else /* HAVE_LIBPCAP */
+
+capture_file_filter *
+capture_file_filter_new(const char *text _U_, bool optimize _U_, char **err_msg)
+{
+    *err_msg = g_strdup("Capture filters can't be used, because this program was built without libpcap");
+    return NULL;
+}
+
+bool
+capture_file_filter_compile(capture_file_filter *cff _U_, int encap _U_, char **err_msg _U_)
+{
+    return false;
+}
+
+bool
+capture_file_filter_apply(capture_file_filter *cff _U_, const wtap_rec *rec _U_)
+{
+    return true;
+}
+
+void
+capture_file_filter_free(capture_file_filter *cff _U_)
+{
+}
+
+#endif /* HAVE_LIBPCAP */
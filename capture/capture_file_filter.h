@@ -0,0 +1,79 @@
+/* capture_file_filter.h
+ * Capture (BPF) filters for packets read from capture files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+
+/** @file
+ *
+ *  Capture filters for capture files.
+ *
+ *  A capture filter is compiled with libpcap for each link-layer type
+ *  found in the file, the first time a packet with that type is seen,
+ *  and run on the raw packet data of each record read, before any
+ *  dissection. Records other than packets always pass.
+ *
+ *  Packets of a link-layer type that has no pcap equivalent, that needs
+ *  a pseudo-header that wiretap has taken out of the packet data, or for
+ *  which the filter doesn't compile, don't pass.
+ */
+
+#ifndef __CAPTURE_FILE_FILTER_H__
+#define __CAPTURE_FILE_FILTER_H__
+
+#include <stdbool.h>
+
+#include <wiretap/wtap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef struct _capture_file_filter capture_file_filter;
+
+/** Create a capture filter for packets read from capture files.
+ *
+ * @param text The filter, in pcap-filter(7) syntax.
+ * @param optimize true to have libpcap optimize the compiled filters.
+ * @param err_msg Set to an error message, to be g_free()d, on failure.
+ * @return The filter, or NULL if capture filters aren't available.
+ */
+capture_file_filter *capture_file_filter_new(const char *text, bool optimize,
+                                             char **err_msg);
+
+/** Compile a capture filter for a WTAP_ENCAP_ type, so that errors can
+ *  be reported before reading starts. Packets of other types are compiled
+ *  for as they're seen.
+ *
+ * @param cff The filter.
+ * @param encap The WTAP_ENCAP_ type.
+ * @param err_msg Set to an error message, to be g_free()d, on failure.
+ * @return true if the filter can be applied to packets of that type.
+ */
+bool capture_file_filter_compile(capture_file_filter *cff, int encap,
+                                 char **err_msg);
+
+/** Run a capture filter on a record.
+ *
+ * @param cff The filter.
+ * @param rec The record, as read by wtap_read().
+ * @return true if the record passes the filter.
+ */
+bool capture_file_filter_apply(capture_file_filter *cff, const wtap_rec *rec);
+
+/** Free a capture filter.
+ *
+ * @param cff The filter; may be NULL.
+ */
+void capture_file_filter_free(capture_file_filter *cff);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAPTURE_FILE_FILTER_H__ */
@@ -318,6 +318,90 @@ deserialize_interface_list(char *data, int *err, char **err_str)
     return if_list;
 }
 
+/*
+ * The interface list kept up to date by the interface statistics process,
+ * with the capabilities of each interface when not in monitor mode. It's
+ * parsed once each time the process sends a new one, rather than on every
+ * lookup; lookups can come from any thread, so the mutex protects it.
+ */
+static GMutex   service_cache_mutex;
+static GList   *service_cache;
+static bool     service_cache_valid;    /* false if there's no such process */
+static unsigned service_cache_serial;   /* of the list that was parsed */
+static bool     service_cache_parsed;   /* false until it first is */
+
+/* Bring the parsed list up to date; call with service_cache_mutex held. */
+static void
+update_service_cache(void)
+{
+    char *data;
+    int   err = 0;
+
+    if (service_cache_parsed && service_cache_serial == sync_interface_service_get_serial()) {
+        return;
+    }
+    free_interface_list(service_cache);
+    service_cache = NULL;
+    data = sync_interface_service_get_list(&service_cache_serial);
+    service_cache_valid = (data != NULL);
+    if (data != NULL) {
+        service_cache = deserialize_interface_list(data, &err, NULL);
+    }
+    service_cache_parsed = true;
+}
+
+/*
+ * A copy of the interface list kept up to date by the interface statistics
+ * process; false if no such process is running.
+ */
+static bool
+service_interface_list(GList **if_list)
+{
+    bool valid;
+
+    g_mutex_lock(&service_cache_mutex);
+    update_service_cache();
+    valid = service_cache_valid;
+    *if_list = valid ? interface_list_copy(service_cache) : NULL;
+    g_mutex_unlock(&service_cache_mutex);
+    return valid;
+}
+
+/*
+ * A copy of the capabilities of an interface, when not in monitor mode,
+ * from the interface statistics process; NULL if it doesn't have them.
+ */
+static if_capabilities_t *
+service_if_capabilities(const char *ifname)
+{
+    if_info_t         *if_info;
+    if_capabilities_t *caps = NULL;
+
+    g_mutex_lock(&service_cache_mutex);
+    update_service_cache();
+    for (GList *if_entry = service_cache; if_entry != NULL; if_entry = g_list_next(if_entry)) {
+        if_info = (if_info_t *)if_entry->data;
+        if (strcmp(if_info->name, ifname) == 0) {
+            caps = if_capabilities_copy(if_info->caps);
+            break;
+        }
+    }
+    g_mutex_unlock(&service_cache_mutex);
+    return caps;
+}
+
+if_capabilities_t *
+capture_get_service_if_capabilities(const char *ifname)
+{
+    if_capabilities_t *caps = service_if_capabilities(ifname);
+
+    if (caps != NULL && caps->primary_msg) {
+        free_if_capabilities(caps);
+        caps = NULL;
+    }
+    return caps;
+}
+
 /**
  * Fetch the interface list from a child process (dumpcap).
  *
@@ -336,8 +420,14 @@ capture_interface_list(int *err, char **err_str, void (*update_cb)(void))
         *err_str = NULL;
     }
 
-    /* Try to get the local interface list */
-    ret = sync_interface_list_open(&data, &primary_msg, &secondary_msg, update_cb);
+    /* Try to get the local interface list, from the statistics process
+       if it's keeping it */
+    if (service_interface_list(&if_list)) {
+        ret = 0;
+        data = NULL;
+    } else {
+        ret = sync_interface_list_open(&data, &primary_msg, &secondary_msg, update_cb);
+    }
     if (ret != 0) {
         ws_info("sync_interface_list_open() failed. %s (%s)",
                   primary_msg ? primary_msg : "no message",
@@ -359,7 +449,9 @@ capture_interface_list(int *err, char **err_str, void (*update_cb)(void))
         return if_list;
     }
 
-    if_list = deserialize_interface_list(data, err, err_str);
+    if (data != NULL) {
+        if_list = deserialize_interface_list(data, err, err_str);
+    }
 
 #ifdef HAVE_PCAP_REMOTE
     /* Add the remote interface list */
@@ -397,6 +489,24 @@ capture_get_if_capabilities(const char *ifname, bool monitor_mode,
         return caps;
     }
 
+    if (!monitor_mode && auth_string == NULL) {
+        caps = service_if_capabilities(ifname);
+        if (caps != NULL) {
+            if (caps->primary_msg) {
+                if (err_primary_msg) {
+                    *err_primary_msg = caps->primary_msg;
+                    caps->primary_msg = NULL;
+                }
+                if (caps->secondary_msg && err_secondary_msg) {
+                    *err_secondary_msg = g_strdup(caps->secondary_msg);
+                }
+                free_if_capabilities(caps);
+                caps = NULL;
+            }
+            return caps;
+        }
+    }
+
     /* Try to get our interface list */
     iface_mon_enable(false);
     err = sync_if_capabilities_open(ifname, monitor_mode, auth_string, &data,
@@ -496,6 +606,10 @@ capture_get_if_list_capabilities(GList *if_cap_queries,
         query = (if_cap_query_t *)li->data;
         /* see if the interface is from extcap */
         caps = extcap_get_if_dlts(query->name, NULL);
+        /* or if the statistics process already has its capabilities */
+        if (caps == NULL && !query->monitor_mode && query->auth_username == NULL) {
+            caps = service_if_capabilities(query->name);
+        }
         /* if the extcap interface generated an error, it was from extcap */
         if (caps != NULL) {
             g_hash_table_replace(caps_hash, g_strdup(query->name), caps);
@@ -503,7 +617,6 @@ capture_get_if_list_capabilities(GList *if_cap_queries,
             local_queries = g_list_prepend(local_queries, query);
         }
     }
-
     if (local_queries == NULL)
         return caps_hash;
 
@@ -199,6 +199,16 @@ capture_get_if_capabilities(const char *devname, bool monitor_mode,
                             char **err_primary_msg, char **err_secondary_msg,
                             void (*update_cb)(void));
 
+/**
+ * Get the linktype list for the specified interface, when not in monitor
+ * mode, from the interface statistics process, without running dumpcap.
+ *
+ * @return The capabilities, to be freed with free_if_capabilities(); NULL
+ *         if that process isn't running, or doesn't have them.
+ */
+extern if_capabilities_t *
+capture_get_service_if_capabilities(const char *devname);
+
 /**
  * Fetch the linktype list for the specified interface from a child process.
  */
@@ -214,6 +224,14 @@ capture_get_if_list_capabilities(GList *if_cap_queries,
  */
 void free_if_capabilities(if_capabilities_t *caps);
 
+/**
+ * @brief Deep copy interface capabilities.
+ *
+ * @param caps Pointer to the if_capabilities_t structure to copy, or NULL.
+ * @return A new if_capabilities_t structure, or NULL if @p caps is NULL.
+ */
+if_capabilities_t *if_capabilities_copy(const if_capabilities_t *caps);
+
 #ifdef HAVE_PCAP_REMOTE
 void add_interface_to_remote_list(if_info_t *if_info);
 
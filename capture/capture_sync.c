@@ -117,6 +117,22 @@ static int sync_pipe_wait_for_child(ws_process_id fork_child, char **msgp);
 
 static void (*fetch_dumpcap_pid)(ws_process_id);
 
+/*
+ * A statistics process started with the interface list (see
+ * sync_interface_stats_open()) runs dumpcap as a service: it keeps the
+ * list, with each interface's capabilities, up to date, and sends it
+ * again over the sync pipe when interfaces are added or removed. We keep
+ * its sync pipe open and the latest list it sent, so that the interface
+ * list and capabilities can be had without running dumpcap again. The
+ * pipe is only used by the thread running the statistics process; the
+ * mutex protects the list, which other threads read.
+ */
+static GMutex service_mutex;
+static GIOChannel *service_message_io;
+static ws_process_id service_fork_child = WS_INVALID_PID;
+static char *service_if_list;
+static unsigned service_if_list_serial;  /* changed whenever the list is */
+
 void
 capture_session_init(capture_session *cap_session, capture_file *cf,
                      new_file_fn new_file, new_packets_fn new_packets,
@@ -1611,6 +1627,10 @@ sync_interface_stats_open(int *data_read_fd, ws_process_id *fork_child, char **d
 
     ws_debug("sync_interface_stats_open");
 
+    if (data) {
+        *data = NULL;
+    }
+
     argv = init_pipe_args(&argc);
 
     if (!argv) {
@@ -1622,10 +1642,13 @@ sync_interface_stats_open(int *data_read_fd, ws_process_id *fork_child, char **d
     /* Ask for the interface statistics */
     argv = sync_pipe_add_arg(argv, &argc, "-S");
 
-    /* If requested, ask for the interface list and capabilities. */
+    /* If requested, ask for the interface list and capabilities, and
+       have dumpcap keep them up to date. */
     if (data) {
         argv = sync_pipe_add_arg(argv, &argc, "-D");
         argv = sync_pipe_add_arg(argv, &argc, "-L");
+        argv = sync_pipe_add_arg(argv, &argc, "--list-time-stamp-types");
+        argv = sync_pipe_add_arg(argv, &argc, "--service");
     }
 
 #ifndef DEBUG_CHILD
@@ -1789,8 +1812,22 @@ sync_interface_stats_open(int *data_read_fd, ws_process_id *fork_child, char **d
             break;
 
         case SP_SUCCESS:
-            /* Close the message pipe. */
-            g_io_channel_unref(message_read_io);
+            if (data) {
+                /* Keep the message pipe, for updates to the list. */
+                g_mutex_lock(&service_mutex);
+                if (service_message_io != NULL) {
+                    g_io_channel_unref(service_message_io);
+                }
+                service_message_io = message_read_io;
+                service_fork_child = *fork_child;
+                g_free(service_if_list);
+                service_if_list = g_strdup(*data);
+                service_if_list_serial++;
+                g_mutex_unlock(&service_mutex);
+            } else {
+                /* Close the message pipe. */
+                g_io_channel_unref(message_read_io);
+            }
             break;
 
         default:
@@ -1820,10 +1857,112 @@ sync_interface_stats_open(int *data_read_fd, ws_process_id *fork_child, char **d
     return ret;
 }
 
+/*
+ * Read any interface lists the statistics process has sent since we last
+ * looked, so that it's never left blocked on a full sync pipe. This is
+ * called regularly by whoever runs the statistics process, on the thread
+ * that opened it; only that thread touches the pipe, and the lock is only
+ * held to update the list, so sync_interface_service_get_list() never
+ * waits for a read.
+ */
+bool
+sync_interface_service_drain(void)
+{
+    char *buffer;
+    char indicator;
+    ssize_t nread;
+    char *msg = NULL;
+    bool changed = false;
+
+    if (service_message_io == NULL) {
+        return false;
+    }
+
+    buffer = g_malloc(PIPE_BUF_SIZE + 1);
+    while (ws_pipe_data_available(g_io_channel_unix_get_fd(service_message_io))) {
+        /* This only blocks if dumpcap is part way through a message. */
+        nread = sync_pipe_read_block(service_message_io, &indicator, SP_MAX_MSG_LEN,
+                                     buffer, &msg);
+        if (nread <= 0) {
+            /* It's gone; don't trust the list any more. */
+            ws_info("Interface service stopped: %s", msg ? msg : "EOF");
+            g_free(msg);
+            g_io_channel_unref(service_message_io);
+            g_mutex_lock(&service_mutex);
+            service_message_io = NULL;
+            g_free(service_if_list);
+            service_if_list = NULL;
+            service_if_list_serial++;
+            g_mutex_unlock(&service_mutex);
+            changed = true;
+            break;
+        }
+        if (indicator == SP_IFACE_LIST) {
+            g_mutex_lock(&service_mutex);
+            g_free(service_if_list);
+            service_if_list = g_strdup(buffer);
+            service_if_list_serial++;
+            g_mutex_unlock(&service_mutex);
+            changed = true;
+        } else if (indicator == SP_LOG_MSG) {
+            sync_pipe_handle_log_msg(buffer);
+        }
+    }
+    g_free(buffer);
+    return changed;
+}
+
+/*
+ * Get the latest interface list from the statistics process, if one is
+ * running as a service; NULL otherwise. The list is in the format of
+ * "dumpcap -D -L -Z", with capabilities, and must be g_free()d.
+ */
+char *
+sync_interface_service_get_list(unsigned *serial)
+{
+    char *if_list;
+
+    g_mutex_lock(&service_mutex);
+    if_list = g_strdup(service_if_list);
+    if (serial != NULL) {
+        *serial = service_if_list_serial;
+    }
+    g_mutex_unlock(&service_mutex);
+    return if_list;
+}
+
+/*
+ * Get a number that changes whenever the list from the statistics process
+ * does, so that anyone keeping a parsed copy knows when to redo it.
+ */
+unsigned
+sync_interface_service_get_serial(void)
+{
+    unsigned serial;
+
+    g_mutex_lock(&service_mutex);
+    serial = service_if_list_serial;
+    g_mutex_unlock(&service_mutex);
+    return serial;
+}
+
 /* Close down the stats process */
 int
 sync_interface_stats_close(int *read_fd, ws_process_id *fork_child, char **msg)
 {
+    g_mutex_lock(&service_mutex);
+    if (*fork_child == service_fork_child) {
+        if (service_message_io != NULL) {
+            g_io_channel_unref(service_message_io);
+            service_message_io = NULL;
+        }
+        service_fork_child = WS_INVALID_PID;
+        g_free(service_if_list);
+        service_if_list = NULL;
+        service_if_list_serial++;
+    }
+    g_mutex_unlock(&service_mutex);
+
 #ifdef _WIN32
     CloseHandle(dummy_signal_pipe);
     dummy_signal_pipe = NULL;
@@ -187,6 +187,48 @@ sync_if_list_capabilities_open(GList *ifqueries,
 extern int
 sync_interface_stats_open(int *read_fd, ws_process_id *fork_child, char **data, char **msg, void (*update_cb)(void));
 
+/**
+ * @brief Read the interface list updates sent by the statistics process.
+ *
+ * If an interface statistics stream was opened with @p data, this must be
+ * called regularly, from the thread that opened it, while it runs, so that
+ * the dumpcap process behind it doesn't block sending updates.
+ *
+ * @return true if the list changed, false otherwise.
+ */
+extern bool
+sync_interface_service_drain(void);
+
+/**
+ * @brief Get the interface list kept up to date by the statistics process.
+ *
+ * If an interface statistics stream was opened with @p data, the dumpcap
+ * process behind it keeps the interface list, with the capabilities of
+ * each interface, up to date, so that it needn't be run again to get them.
+ *
+ * This doesn't read from the process; it returns the list as of the last
+ * call to sync_interface_service_drain().
+ *
+ * @param serial If not NULL, set to the serial number of the list, as
+ *               returned by sync_interface_service_get_serial().
+ * @return The latest list, in the format of "dumpcap -D -L", to be
+ *         g_free()d; NULL if no such process is running.
+ */
+extern char *
+sync_interface_service_get_list(unsigned *serial);
+
+/**
+ * @brief Get the serial number of the interface list kept by the
+ * statistics process.
+ *
+ * It changes whenever the list does, including when the process stops, so
+ * that a parsed copy of the list need only be redone when it changes.
+ *
+ * @return The serial number of the list.
+ */
+extern unsigned
+sync_interface_service_get_serial(void);
+
 /**
  * @brief Close an interface statistics stream previously opened with dumpcap.
  *
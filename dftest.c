@@ -58,6 +58,7 @@ static int opt_optimize = 1;
 static int opt_show_types;
 static int opt_dump_refs;
 static int opt_dump_macros;
+static int opt_frame_range;
 
 static int64_t elapsed_expand;
 static int64_t elapsed_compile;
@@ -119,6 +120,7 @@ print_usage(void)
      * print empty reference vectors. */
     fprintf(fp, "      --refs          dump some runtime data structures\n");
     fprintf(fp, "      --file <path>   read filters line-by-line from a file (use '-' for stdin)\n");
+    fprintf(fp, "      --frame-range   print the bounds on frame number, time and length\n");
     fprintf(fp, "  -h, --help          display this help and exit\n");
     fprintf(fp, "  -v, --version       print version\n");
     fprintf(fp, "\n");
@@ -151,6 +153,32 @@ print_macros(void)
     printf("\n");
 }
 
+static void
+print_frame_range(dfilter_t *df)
+{
+    dfilter_frame_range_t range;
+
+    if (!dfilter_get_frame_range(df, &range)) {
+        printf("Frame range: (none)\n\n");
+        return;
+    }
+
+    printf("Frame range:\n");
+    if (range.number_min != 0)
+        printf(" frame.number >= %u\n", range.number_min);
+    if (range.number_max != UINT32_MAX)
+        printf(" frame.number <= %u\n", range.number_max);
+    if (!nstime_is_unset(&range.time_min))
+        printf(" frame.time >= %"PRId64".%09d\n", (int64_t)range.time_min.secs, range.time_min.nsecs);
+    if (!nstime_is_unset(&range.time_max))
+        printf(" frame.time <= %"PRId64".%09d\n", (int64_t)range.time_max.secs, range.time_max.nsecs);
+    if (range.len_min != 0)
+        printf(" frame.len >= %u\n", range.len_min);
+    if (range.len_max != UINT32_MAX)
+        printf(" frame.len <= %u\n", range.len_max);
+    printf("\n");
+}
+
 static void
 print_warnings(dfilter_t *df)
 {
@@ -289,6 +317,9 @@ test_filter(const char *text)
     if (opt_syntax_tree)
         print_syntax_tree(df);
 
+    if (opt_frame_range)
+        print_frame_range(df);
+
     uint16_t dump_flags = 0;
     if (opt_show_types)
         dump_flags |= DF_DUMP_SHOW_FTYPE;
@@ -337,6 +368,7 @@ main(int argc, char **argv)
         { "types",    ws_no_argument,   0, 2000 },
         { "refs",     ws_no_argument,   0, 3000 },
         { "file",     ws_required_argument, 0, 4000 },
+        { "frame-range", ws_no_argument, 0, 5000 },
         LONGOPT_WSLOG
         { NULL,       0,                0,  0   }
     };
@@ -458,6 +490,9 @@ main(int argc, char **argv)
             case 4000:
                 path = ws_optarg;
                 break;
+            case 5000:
+                opt_frame_range = 1;
+                break;
             case 'v':
                 show_version();
                 return EXIT_SUCCESS;
@@ -40,6 +40,13 @@
 #include <wsutil/wslog.h>
 #include <wsutil/file_util.h>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/if_packet.h>
+#endif
+
 #ifdef HAVE_LIBCAP
 # include <sys/prctl.h>
 # include <sys/capability.h>
@@ -55,6 +62,7 @@
 #endif /* _WIN32 */
 
 #include "writecap/pcapio.h"
+#include "writecap/flow_index.h"
 
 #ifndef _WIN32
 #include <sys/un.h>
@@ -118,12 +126,54 @@ FILE *debug_log;   /* for logging debug messages to  */
 #include <stdarg.h> /* va_copy */
 #endif
 
-static GAsyncQueue *pcap_queue;
-static int64_t pcap_queue_bytes;
-static int64_t pcap_queue_packets;
 static int64_t pcap_queue_byte_limit;
 static int64_t pcap_queue_packet_limit;
 
+/* Packets read per pcap_dispatch() call, and per wakeup, when capturing
+   with threads. */
+static int32_t dispatch_batch_size = 64;
+static int32_t dispatch_budget = 1024;
+static bool dispatch_stats;
+
+/* Size of the buffer in which blocks are assembled before being written
+   to the capture file; large enough to make each write worth a system call
+   at high packet rates. */
+#define CAPTURE_WRITE_BUFFER_SIZE   (1024 * 1024)
+
+/* Reserve disk space for each ring buffer file when opening it. */
+static bool preallocate_files;
+
+/* Write a flow index next to each capture file; the index of the current
+   file is built as its packets are written. */
+static bool flow_index_on;
+static flow_index *capture_flow_index;
+
+/* With -S -D, keep running as a helper for our parent: keep the interface
+   list and their capabilities up to date, and send the list again when
+   interfaces come or go, querying only the new ones. */
+static bool interface_service;
+#define SERVICE_REFRESH_INTERVAL    5       /* seconds between interface list checks */
+
+/* Getting an interface's capabilities opens and activates a pcap handle
+   for it. On Linux each handle is a socket of its own, sharing no state
+   with the others, so several interfaces can be queried at once; we don't
+   count on that elsewhere (cloned BPF devices, Npcap's driver), and query
+   them one at a time. */
+#ifdef __linux__
+#define IF_CAPS_QUERY_THREADS       16      /* devices opened at once for capabilities */
+#else
+#define IF_CAPS_QUERY_THREADS       1
+#endif
+
+#ifdef PACKET_FANOUT
+/* Number of pcap handles, and capture threads, per network interface;
+   the kernel spreads the interface's packets over them by flow. */
+static int32_t fanout_queues = 1;
+#endif
+/* With --fanout-files, each capture thread writes the packets it reads to
+   a file of its own instead of queueing them for the main thread. */
+static bool fanout_files;
+
 static bool capture_child; /* false: standalone call, true: this is an Wireshark capture child */
 static const char *report_capture_filename; /* capture child file name */
 static char* app_flavor_name = "wireshark";
@@ -346,7 +396,15 @@ typedef struct _capture_src {
     bool                         pcap_err;
     unsigned                     interface_id;
     unsigned                     idb_id;                 /**< If from_pcapng is false, the output IDB interface ID. Otherwise the mapping in src_iface_to_global is used. */
+    unsigned                     fanout_queue;           /**< With --fanout, which of the interface's handles this is; 0 otherwise */
     GThread                     *tid;
+    struct _capture_queue       *queue;                  /**< Packets read by this source's thread, waiting to be written */
+    struct _capture_shard       *shard;                  /**< With --fanout-files, the file this source's thread writes to */
+    bool                         dispatch_batched;       /**< true if reading batches with a non-blocking pcap_h */
+    uint64_t                     dispatch_calls;         /**< pcap_dispatch() calls that returned packets, for --dispatch-stats */
+    uint64_t                     dispatch_packets;
+    uint64_t                     dispatch_usecs;
+    uint64_t                     dispatch_max_usecs;
     int                          snaplen;
     int                          linktype;
     bool                         ts_nsec;                /**< true if we're using nanosecond precision. */
@@ -390,6 +448,26 @@ typedef struct _saved_idb {
     unsigned idb_len;
 } saved_idb_t;
 
+/*
+ * With --fanout-files, the file a capture source's thread writes its
+ * packets to. Only that thread writes to it while capturing, and it
+ * switches to the next file itself with a ring buffer; the main thread
+ * only reads packets_written, to keep count.
+ */
+typedef struct _capture_shard {
+    ws_cwstream *pdh;
+    char        *basename;            /**< The -w name with the source's number added */
+    char        *filename;            /**< The file being written */
+    uint64_t     bytes_written;       /**< To the file being written */
+    int          file_packets;        /**< Written to the file being written */
+    uint64_t     file_start;          /**< When the file being written was opened */
+    unsigned     file_num;            /**< With a ring buffer, number of the file being written */
+    GQueue      *old_files;           /**< With a ring buffer, names of the earlier files kept */
+    int          err;                 /**< if non-zero, error seen writing to the file */
+    int          packets_written;     /**< Updated atomically */
+    int          packets_counted;     /**< packets_written when the main thread last looked */
+} capture_shard;
+
 /*
  * Global capture loop state.
  */
@@ -420,14 +498,70 @@ typedef struct _loop_data {
     int      interval_s;
 } loop_data;
 
-typedef struct _pcap_queue_element {
-    capture_src        *pcap_src;
+/*
+ * When capturing with threads, each capture source has its own queue of
+ * packets (or pcapng blocks) waiting to be written. The source's read
+ * thread is the only producer and the main thread is the only consumer,
+ * so the queue needs no lock: each side only writes its own indices and
+ * reads the other side's with atomic operations.
+ *
+ * A queue is a ring of fixed size slots holding the headers, plus a ring
+ * of bytes holding the data, both allocated up front. Slots are filled
+ * without being made visible to the consumer and are published in
+ * batches.
+ */
+typedef struct _capture_queue_slot {
     union {
-        struct pcap_pkthdr  phdr;
+        struct pcap_pkthdr     phdr;
         pcapng_block_header_t  bh;
     } u;
-    uint8_t             *pd;
-} pcap_queue_element;
+    uint64_t            ts;             /**< Time stamp in nanoseconds, used to merge the queues */
+    uint32_t            data_pos;       /**< Position of the data in the byte ring */
+    uint32_t            data_len;
+} capture_queue_slot;
+
+typedef struct _capture_queue {
+    capture_queue_slot *slots;
+    uint8_t            *data;
+    unsigned            slot_mask;      /**< Number of slots - 1; the number of slots is a power of 2 */
+    uint32_t            data_size;      /**< Size of the byte ring; a power of 2 */
+    unsigned            packet_limit;   /**< This queue's share of pcap_queue_packet_limit */
+    uint32_t            byte_limit;     /**< This queue's share of pcap_queue_byte_limit */
+    void               *mem;
+    size_t              mem_size;
+    bool                mem_mapped;
+
+    /* Written by the consumer only. */
+    int                 head;           /**< Next slot to write out */
+    int                 data_read;      /**< Byte ring position up to which data has been written out */
+    int                 bytes_out;      /**< Packet bytes written out, modulo 2^32 */
+    unsigned            tail_seen;      /**< Last value of tail read by the consumer */
+
+    /* Keep the producer's fields away from the consumer's cache line. */
+    uint8_t             pad[64];
+
+    /* Written by the producer only. */
+    int                 tail;           /**< Slots before this one have been published */
+    unsigned            fill;           /**< Slots before this one have been filled */
+    uint32_t            data_write;     /**< Byte ring position of the next packet's data */
+    uint32_t            bytes_in;       /**< Packet bytes queued, modulo 2^32 */
+    unsigned            head_seen;      /**< Last value of head read by the producer */
+    uint32_t            data_read_seen; /**< Last value of data_read read by the producer */
+    uint32_t            bytes_out_seen; /**< Last value of bytes_out read by the producer */
+    unsigned            batch_queued;   /**< Packets queued since the last batch was published */
+    unsigned            batch_dropped;  /**< Packets dropped since the last batch was published */
+} capture_queue;
+
+/* Number of packets queued before they're made visible to the writer. */
+#define CAPTURE_QUEUE_PUBLISH_BATCH 64
+
+/* Maximum number of packets written out per pass of the capture loop. */
+#define CAPTURE_QUEUE_WRITE_BATCH   256
+
+/* The writer sleeps on this when all the queues are empty. */
+static GMutex capture_queue_mutex;
+static GCond  capture_queue_cond;
+static int    capture_queue_writer_waiting;
 
 /*
  * This needs to be static, so that the SIGINT handler can clear the "go"
@@ -435,6 +569,8 @@ typedef struct _pcap_queue_element {
  */
 static loop_data   global_ld;
 
+static void capture_queue_publish(capture_src *pcap_src);
+
 /*
  * Timeout, in milliseconds, for reads from the stream of captured packets
  * from a capture device.
@@ -483,6 +619,8 @@ static void capture_loop_queue_packet_cb(uint8_t *pcap_src_p, const struct pcap_
                                          const uint8_t *pd);
 static void capture_loop_write_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t *bh, uint8_t *pd);
 static void capture_loop_queue_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t *bh, uint8_t *pd);
+static void capture_loop_write_shard_packet_cb(uint8_t *pcap_src_p, const struct pcap_pkthdr *phdr,
+                                               const uint8_t *pd);
 static void capture_loop_get_errmsg(char *errmsg, size_t errmsglen,
                                     char *secondary_errmsg,
                                     size_t secondary_errmsglen,
@@ -540,6 +678,8 @@ print_usage(FILE *output)
     fprintf(output, "                           set channel on wifi interface\n");
     fprintf(output, "  -S                       print statistics for each interface once per second\n");
     fprintf(output, "  -M                       for -D, -L, and -S, produce machine-readable output\n");
+    fprintf(output, "  --service                with -S and -D, keep running, and send the interface\n");
+    fprintf(output, "                           list again whenever interfaces are added or removed\n");
     fprintf(output, "\n");
 #ifdef HAVE_PCAP_REMOTE
     fprintf(output, "RPCAP options:\n");
@@ -572,6 +712,10 @@ print_usage(FILE *output)
     fprintf(output, "                                          an exact multiple of NUM secs\n");
     fprintf(output, "                          printname:FILE - print filename to FILE when written\n");
     fprintf(output, "                                           (can use 'stdout' or 'stderr')\n");
+    fprintf(output, "  --preallocate            with -b filesize, reserve disk space for each file\n");
+    fprintf(output, "                           when it is opened\n");
+    fprintf(output, "  --flow-index             write an index of the flows in each capture file\n");
+    fprintf(output, "                           to a file with the same name plus \"%s\"\n", FLOW_INDEX_EXTENSION);
     fprintf(output, "  -F                       output file type (default: pcapng)\n");
     fprintf(output, "                           an empty \"-F\" option will list the file types\n");
     fprintf(output, "  -n                       use pcapng format instead of pcap (default)\n");
@@ -592,6 +736,20 @@ print_usage(FILE *output)
     fprintf(output, "  -C <byte_limit>          maximum number of bytes used for buffering packets\n");
     fprintf(output, "                           within dumpcap\n");
     fprintf(output, "  -t                       use a separate thread per interface\n");
+    fprintf(output, "  --dispatch-batch <count> with -t, maximum packets read per call into libpcap\n");
+    fprintf(output, "                           (default: 64)\n");
+    fprintf(output, "  --dispatch-budget <count>\n");
+    fprintf(output, "                           with -t, maximum packets read per wakeup\n");
+    fprintf(output, "                           (default: 1024)\n");
+    fprintf(output, "  --dispatch-stats         with -t, report packets per call into libpcap and\n");
+    fprintf(output, "                           the time taken per batch when the capture stops\n");
+#ifdef PACKET_FANOUT
+    fprintf(output, "  --fanout <count>         open <count> handles per network interface, with a\n");
+    fprintf(output, "                           thread each, and spread packets over them by flow\n");
+    fprintf(output, "                           (implies -t)\n");
+    fprintf(output, "  --fanout-files           with --fanout, have each handle's thread write its\n");
+    fprintf(output, "                           packets to a file of its own, named after the -w file\n");
+#endif
     fprintf(output, "  -q                       don't report packet capture counts\n");
     fprintf(output, "  -Q                       suppress all non-error status messages to stderr\n");
     fprintf(output, "  --application-flavor <flavor>\n");
@@ -1067,70 +1225,284 @@ print_machine_readable_if_capabilities(json_dumper *dumper, if_capabilities_t *c
     }
 }
 
+typedef struct {
+    interface_options      *interface_opts;
+    if_capabilities_t      *caps;
+    cap_device_open_status  open_status;
+    char                   *open_status_str;
+} if_caps_query_t;
+
+/* Remote devices are queried one at a time even when local ones aren't,
+   as each query is a connection made through libpcap's rpcap code. */
+static GMutex if_caps_remote_mutex;
+
+static void
+if_caps_query_run(void *data, void *user_data _U_)
+{
+    if_caps_query_t *query = (if_caps_query_t *)data;
+    bool             remote = strncmp(query->interface_opts->name, "rpcap://", 8) == 0;
+
+    if (remote) {
+        g_mutex_lock(&if_caps_remote_mutex);
+    }
+    query->open_status = CAP_DEVICE_OPEN_NO_ERR;
+    query->caps = get_if_capabilities(query->interface_opts, &query->open_status,
+                                      &query->open_status_str);
+    if (remote) {
+        g_mutex_unlock(&if_caps_remote_mutex);
+    }
+}
+
+/*
+ * Get the capabilities of each interface in the list that doesn't have
+ * them yet, for the machine-readable interface list. Opening a device
+ * can take a while and there may be hundreds of them, so, where it's
+ * safe, several are queried at once. If a query fails, the capabilities
+ * hold the error.
+ */
+static void
+get_if_list_capabilities(GList *if_list)
+{
+    GPtrArray   *queries = g_ptr_array_new();
+    GThreadPool *pool = NULL;
+    if_info_t   *if_info;
+    if_caps_query_t *query;
+
+    for (GList *if_entry = if_list; if_entry != NULL; if_entry = g_list_next(if_entry)) {
+        if_info = (if_info_t *)if_entry->data;
+        if (if_info->caps != NULL) {
+            continue;
+        }
+        query = g_new0(if_caps_query_t, 1);
+        /*
+         * XXX - If on the command line we had the options -i <interface> -I,
+         * we should retrieve the link-types for the interface in monitor mode.
+         * We've already copied that information to global_capture_opts, but
+         * the below statement wipes it away.
+         */
+        query->interface_opts = interface_opts_from_if_info(&global_capture_opts, if_info);
+        g_ptr_array_add(queries, query);
+    }
+
+    if (queries->len > 1 && IF_CAPS_QUERY_THREADS > 1) {
+        pool = g_thread_pool_new(if_caps_query_run, NULL,
+                                 (int)MIN(queries->len, IF_CAPS_QUERY_THREADS),
+                                 false, NULL);
+    }
+    for (unsigned i = 0; i < queries->len; i++) {
+        query = (if_caps_query_t *)g_ptr_array_index(queries, i);
+        if (pool == NULL || !g_thread_pool_push(pool, query, NULL)) {
+            if_caps_query_run(query, NULL);
+        }
+    }
+    if (pool != NULL) {
+        /* Wait for the queries to finish. */
+        g_thread_pool_free(pool, false, true);
+    }
+
+    /* The queries are in the same order as the interfaces without caps. */
+    unsigned i = 0;
+    for (GList *if_entry = if_list; if_entry != NULL; if_entry = g_list_next(if_entry)) {
+        if_info = (if_info_t *)if_entry->data;
+        if (if_info->caps != NULL) {
+            continue;
+        }
+        query = (if_caps_query_t *)g_ptr_array_index(queries, i++);
+        if_info->caps = query->caps;
+        if (if_info->caps == NULL) {
+            if_info->caps = g_new0(if_capabilities_t, 1);
+            if_info->caps->primary_msg = query->open_status_str;
+            if_info->caps->secondary_msg = get_pcap_failure_secondary_error_message(query->open_status, query->open_status_str);
+        }
+        if_info->caps->status = query->open_status;
+        interface_opts_free(query->interface_opts);
+        g_free(query->interface_opts);
+        g_free(query);
+    }
+    g_ptr_array_free(queries, true);
+}
+
 typedef struct {
     char *name;
     pcap_t *pch;
 } if_stat_t;
 
-/* Print the number of packets captured for each interface until we're killed. */
-static int
-print_statistics_loop(bool machine_readable)
+/* Open an interface to get statistics for it; NULL if it can't be. */
+static if_stat_t *
+if_stat_open(const char *name)
+{
+    if_stat_t   *if_stat;
+    pcap_t      *pch;
+    char        errbuf[PCAP_ERRBUF_SIZE];
+
+#ifdef __linux__
+    /* On Linux nf* interfaces don't collect stats properly and don't allows multiple
+     * connections. We avoid collecting stats on them.
+     */
+    if (!strncmp(name, "nf", 2)) {
+        ws_debug("Skipping interface %s for stats", name);
+        return NULL;
+    }
+#endif
+
+#ifdef HAVE_PCAP_OPEN
+    /*
+     * If we're opening a remote device, use pcap_open(); that's currently
+     * the only open routine that supports remote devices.
+     */
+    if (strncmp(name, "rpcap://", 8) == 0)
+        pch = pcap_open(name, MIN_PACKET_SIZE, 0, 0, NULL, errbuf);
+    else
+#endif
+    pch = pcap_open_live(name, MIN_PACKET_SIZE, 0, 0, errbuf);
+
+    if (pch == NULL) {
+        return NULL;
+    }
+    if_stat = g_new(if_stat_t, 1);
+    if_stat->name = g_strdup(name);
+    if_stat->pch = pch;
+    return if_stat;
+}
+
+static void
+if_stat_close(void *data)
+{
+    if_stat_t *if_stat = (if_stat_t *)data;
+
+    pcap_close(if_stat->pch);
+    g_free(if_stat->name);
+    g_free(if_stat);
+}
+
+static bool
+if_list_has_name(GList *if_list, const char *name)
+{
+    for (GList *if_entry = if_list; if_entry != NULL; if_entry = g_list_next(if_entry)) {
+        if (strcmp(((if_info_t *)if_entry->data)->name, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * For --service: get the interface list again, and if interfaces have been
+ * added or removed, get the capabilities of the new ones, send the new list
+ * to our parent, and start or stop getting statistics for them. Returns the
+ * list to use from now on.
+ */
+static GList *
+service_refresh_interfaces(GList *if_list, GList **stat_list, int caps_queries)
 {
-    GList       *if_list, *if_entry, *stat_list = NULL, *stat_entry;
+    GList       *new_list;
     if_info_t   *if_info;
     if_stat_t   *if_stat;
     int         err;
     char        *err_str;
-    pcap_t      *pch;
-    char        errbuf[PCAP_ERRBUF_SIZE];
-    struct pcap_stat ps;
+    bool        changed;
+
+    new_list = global_capture_opts.get_iface_list(&err, &err_str);
+    if (new_list == NULL && err != 0) {
+        /* Keep what we had; perhaps it'll work next time. */
+        ws_info("Getting the interface list failed: %s", err_str);
+        g_free(err_str);
+        return if_list;
+    }
+
+    changed = g_list_length(new_list) != g_list_length(if_list);
+    for (GList *if_entry = new_list; if_entry != NULL && !changed; if_entry = g_list_next(if_entry)) {
+        changed = !if_list_has_name(if_list, ((if_info_t *)if_entry->data)->name);
+    }
+    if (!changed) {
+        free_interface_list(new_list);
+        return if_list;
+    }
 
-    if_list = global_capture_opts.get_iface_list(&err, &err_str);
-    if (if_list == NULL) {
-        if (err == 0) {
-            cmdarg_err("There are no interfaces on which a capture can be done");
-            err = WS_EXIT_NO_INTERFACES;
+    /* Move the capabilities we already have over to the new list. */
+    for (GList *if_entry = new_list; if_entry != NULL; if_entry = g_list_next(if_entry)) {
+        if_info = (if_info_t *)if_entry->data;
+        for (GList *old_entry = if_list; old_entry != NULL; old_entry = g_list_next(old_entry)) {
+            if_info_t *old_info = (if_info_t *)old_entry->data;
+
+            if (strcmp(old_info->name, if_info->name) == 0) {
+                if_info->caps = old_info->caps;
+                old_info->caps = NULL;
+                break;
+            }
         }
-        else {
-            cmdarg_err("%s", err_str);
-            g_free(err_str);
+    }
+    free_interface_list(if_list);
+    if (caps_queries) {
+        get_if_list_capabilities(new_list);
+    }
+    print_machine_readable_interfaces(new_list, caps_queries, true);
+
+    for (GList *stat_entry = *stat_list; stat_entry != NULL; ) {
+        GList *next = g_list_next(stat_entry);
+
+        if_stat = (if_stat_t *)stat_entry->data;
+        if (!if_list_has_name(new_list, if_stat->name)) {
+            if_stat_close(if_stat);
+            *stat_list = g_list_delete_link(*stat_list, stat_entry);
         }
-        return err;
+        stat_entry = next;
     }
+    for (GList *if_entry = new_list; if_entry != NULL; if_entry = g_list_next(if_entry)) {
+        bool have_stat = false;
 
-    for (if_entry = g_list_first(if_list); if_entry != NULL; if_entry = g_list_next(if_entry)) {
         if_info = (if_info_t *)if_entry->data;
+        for (GList *stat_entry = *stat_list; stat_entry != NULL && !have_stat; stat_entry = g_list_next(stat_entry)) {
+            have_stat = strcmp(((if_stat_t *)stat_entry->data)->name, if_info->name) == 0;
+        }
+        if (!have_stat && (if_stat = if_stat_open(if_info->name)) != NULL) {
+            *stat_list = g_list_append(*stat_list, if_stat);
+        }
+    }
+    return new_list;
+}
 
-#ifdef __linux__
-        /* On Linux nf* interfaces don't collect stats properly and don't allows multiple
-         * connections. We avoid collecting stats on them.
-         */
-        if (!strncmp(if_info->name, "nf", 2)) {
-            ws_debug("Skipping interface %s for stats", if_info->name);
-            continue;
+/*
+ * Print the number of packets captured for each interface until we're killed.
+ * With --service, if_list is the interface list already sent to our parent,
+ * which is checked for changes every SERVICE_REFRESH_INTERVAL seconds.
+ */
+static int
+print_statistics_loop(bool machine_readable, GList *if_list, int caps_queries)
+{
+    GList       *if_entry, *stat_list = NULL, *stat_entry;
+    if_info_t   *if_info;
+    if_stat_t   *if_stat;
+    int         err;
+    char        *err_str;
+    struct pcap_stat ps;
+    unsigned    ticks = 0;
+
+    if (!interface_service) {
+        if_list = global_capture_opts.get_iface_list(&err, &err_str);
+        if (if_list == NULL) {
+            if (err == 0) {
+                cmdarg_err("There are no interfaces on which a capture can be done");
+                err = WS_EXIT_NO_INTERFACES;
+            }
+            else {
+                cmdarg_err("%s", err_str);
+                g_free(err_str);
+            }
+            return err;
         }
-#endif
+    }
 
-#ifdef HAVE_PCAP_OPEN
-	/*
-	 * If we're opening a remote device, use pcap_open(); that's currently
-	 * the only open routine that supports remote devices.
-	 */
-        if (strncmp(if_info->name, "rpcap://", 8) == 0)
-            pch = pcap_open(if_info->name, MIN_PACKET_SIZE, 0, 0, NULL, errbuf);
-        else
-#endif
-        pch = pcap_open_live(if_info->name, MIN_PACKET_SIZE, 0, 0, errbuf);
+    for (if_entry = g_list_first(if_list); if_entry != NULL; if_entry = g_list_next(if_entry)) {
+        if_info = (if_info_t *)if_entry->data;
 
-        if (pch) {
-            if_stat = g_new(if_stat_t, 1);
-            if_stat->name = g_strdup(if_info->name);
-            if_stat->pch = pch;
+        if_stat = if_stat_open(if_info->name);
+        if (if_stat) {
             stat_list = g_list_append(stat_list, if_stat);
         }
     }
 
-    if (!stat_list) {
+    if (!stat_list && !interface_service) {
         cmdarg_err("There are no interfaces on which statistics can be collected");
         return WS_EXIT_NO_INTERFACES;
     }
@@ -1170,16 +1542,13 @@ print_statistics_loop(bool machine_readable)
 #else
         sleep(1);
 #endif
+        if (interface_service && ++ticks % SERVICE_REFRESH_INTERVAL == 0) {
+            if_list = service_refresh_interfaces(if_list, &stat_list, caps_queries);
+        }
     }
 
     /* XXX - Not reached.  Should we look for 'q' in stdin? */
-    for (stat_entry = g_list_first(stat_list); stat_entry != NULL; stat_entry = g_list_next(stat_entry)) {
-        if_stat = (if_stat_t *)stat_entry->data;
-        pcap_close(if_stat->pch);
-        g_free(if_stat->name);
-        g_free(if_stat);
-    }
-    g_list_free(stat_list);
+    g_list_free_full(stat_list, if_stat_close);
     free_interface_list(if_list);
 
     return 0;
@@ -3046,6 +3415,155 @@ pcapng_pipe_dispatch(capture_src *pcap_src, char *errmsg, size_t errmsgl)
     return -1;
 }
 
+/* Allocate a capture source for the interface with the given index and
+ * add it to global_ld.pcaps. */
+static capture_src *
+capture_src_new(unsigned interface_id)
+{
+    capture_src *pcap_src;
+
+    pcap_src = g_new0(capture_src, 1);
+#ifdef MUST_DO_SELECT
+    pcap_src->pcap_fd = -1;
+#endif
+    pcap_src->interface_id = interface_id;
+    pcap_src->linktype = -1;
+#ifdef _WIN32
+    pcap_src->cap_pipe_h = INVALID_HANDLE_VALUE;
+#endif
+    pcap_src->cap_pipe_fd = -1;
+    pcap_src->cap_pipe_dispatch = pcap_pipe_dispatch;
+    pcap_src->cap_pipe_state = STATE_EXPECT_REC_HDR;
+    pcap_src->cap_pipe_err = PIPOK;
+#ifdef _WIN32
+    pcap_src->cap_pipe_read_mtx = g_new(GMutex, 1);
+    g_mutex_init(pcap_src->cap_pipe_read_mtx);
+    pcap_src->cap_pipe_pending_q = g_async_queue_new();
+    pcap_src->cap_pipe_done_q = g_async_queue_new();
+#endif
+    g_array_append_val(global_ld.pcaps, pcap_src);
+    return pcap_src;
+}
+
+#ifdef PACKET_FANOUT
+/*
+ * Put a pcap handle's packet socket into a fanout group, so that the
+ * kernel hands each packet received on the interface to only one of
+ * the sockets in the group, picked by a hash of the packet's flow; all
+ * the packets of a flow thus go to the same socket, and thread, and
+ * stay in order.
+ *
+ * If *group_id is -1, a new group is created, with an ID picked by the
+ * kernel if possible, and *group_id is set to its ID.
+ */
+static bool
+capture_loop_join_fanout(capture_src *pcap_src, int *group_id,
+                         char *errmsg, size_t errmsg_len)
+{
+    int      fd = pcap_fileno(pcap_src->pcap_h);
+    uint32_t fanout_arg;
+
+    if (*group_id == -1) {
+#ifdef PACKET_FANOUT_FLAG_UNIQUEID
+        socklen_t optlen = sizeof fanout_arg;
+
+        fanout_arg = (uint32_t)(PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG |
+                                PACKET_FANOUT_FLAG_UNIQUEID) << 16;
+        if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &fanout_arg, sizeof fanout_arg) == 0 &&
+            getsockopt(fd, SOL_PACKET, PACKET_FANOUT, &fanout_arg, &optlen) == 0) {
+            *group_id = (int)(fanout_arg & 0xffff);
+            return true;
+        }
+        if (errno != EINVAL) {
+            snprintf(errmsg, errmsg_len,
+                     "Couldn't create a packet fanout group: %s.", g_strerror(errno));
+            return false;
+        }
+        /* Older kernel; pick an ID ourselves. */
+#endif
+        *group_id = (getpid() + pcap_src->interface_id) & 0xffff;
+    }
+    fanout_arg = (uint32_t)*group_id |
+                 (uint32_t)(PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG) << 16;
+    if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &fanout_arg, sizeof fanout_arg) == -1) {
+        snprintf(errmsg, errmsg_len,
+                 "Couldn't join packet fanout group %d: %s.", *group_id, g_strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+/*
+ * With --fanout, open the extra pcap handles for each network interface
+ * we've opened; pipes are left alone. The handles share the interface's
+ * IDB, so the output file looks as if it had been captured with one
+ * handle; the writer merges the packets from the handles' queues by time
+ * stamp.
+ */
+static bool
+capture_loop_open_fanout(capture_options *capture_opts,
+                         char *errmsg, size_t errmsg_len,
+                         char *secondary_errmsg, size_t secondary_errmsg_len)
+{
+    cap_device_open_status open_status;
+    char                open_status_str[PCAP_ERRBUF_SIZE];
+    interface_options  *interface_opts;
+    capture_src        *pcap_src;
+    capture_src        *queue_src;
+    unsigned            i;
+    unsigned            queue;
+    int                 group_id;
+
+    for (i = 0; i < capture_opts->ifaces->len; i++) {
+        interface_opts = &g_array_index(capture_opts->ifaces, interface_options, i);
+        pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+        if (pcap_src->pcap_h == NULL) {
+            continue;
+        }
+
+        group_id = -1;
+        if (!capture_loop_join_fanout(pcap_src, &group_id, errmsg, errmsg_len)) {
+            return false;
+        }
+        ws_debug("%s: interface %u in packet fanout group %d",
+                 G_STRFUNC, i, group_id);
+
+        for (queue = 1; queue < (unsigned)fanout_queues; queue++) {
+            queue_src = capture_src_new(i);
+            queue_src->fanout_queue = queue;
+            queue_src->idb_id = pcap_src->idb_id;
+            queue_src->pcap_h = open_capture_device(capture_opts, interface_opts,
+                CAP_READ_TIMEOUT, &open_status, &open_status_str);
+            if (queue_src->pcap_h == NULL) {
+                get_capture_device_open_failure_messages(open_status,
+                                                         open_status_str,
+                                                         interface_opts->name,
+                                                         errmsg,
+                                                         errmsg_len,
+                                                         secondary_errmsg,
+                                                         secondary_errmsg_len);
+                return false;
+            }
+            queue_src->ts_nsec = have_high_resolution_timestamp(queue_src->pcap_h);
+            if (!set_pcap_datalink(queue_src->pcap_h, interface_opts->linktype,
+                                   interface_opts->name,
+                                   errmsg, errmsg_len,
+                                   secondary_errmsg, secondary_errmsg_len)) {
+                return false;
+            }
+            queue_src->linktype = pcap_src->linktype;
+#ifdef MUST_DO_SELECT
+            queue_src->pcap_fd = pcap_get_selectable_fd(queue_src->pcap_h);
+#endif
+            if (!capture_loop_join_fanout(queue_src, &group_id, errmsg, errmsg_len)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+#endif /* PACKET_FANOUT */
+
 /** Open the capture input sources; each one is either a pcap device,
  *  a capture pipe, or a capture socket.
  *  Returns true if it succeeds, false otherwise. */
@@ -3083,32 +3601,7 @@ capture_loop_open_input(capture_options *capture_opts,
     unsigned pcapng_src_count = 0;
     for (i = 0; i < capture_opts->ifaces->len; i++) {
         interface_opts = &g_array_index(capture_opts->ifaces, interface_options, i);
-        pcap_src = g_new0(capture_src, 1);
-        if (pcap_src == NULL) {
-            snprintf(errmsg, errmsg_len,
-                   "Could not allocate memory.");
-            return false;
-        }
-
-#ifdef MUST_DO_SELECT
-        pcap_src->pcap_fd = -1;
-#endif
-        pcap_src->interface_id = i;
-        pcap_src->linktype = -1;
-#ifdef _WIN32
-        pcap_src->cap_pipe_h = INVALID_HANDLE_VALUE;
-#endif
-        pcap_src->cap_pipe_fd = -1;
-        pcap_src->cap_pipe_dispatch = pcap_pipe_dispatch;
-        pcap_src->cap_pipe_state = STATE_EXPECT_REC_HDR;
-        pcap_src->cap_pipe_err = PIPOK;
-#ifdef _WIN32
-        pcap_src->cap_pipe_read_mtx = g_new(GMutex, 1);
-        g_mutex_init(pcap_src->cap_pipe_read_mtx);
-        pcap_src->cap_pipe_pending_q = g_async_queue_new();
-        pcap_src->cap_pipe_done_q = g_async_queue_new();
-#endif
-        g_array_append_val(global_ld.pcaps, pcap_src);
+        pcap_src = capture_src_new(i);
 
         ws_debug("capture_loop_open_input : %s", interface_opts->name);
         pcap_src->pcap_h = open_capture_device(capture_opts, interface_opts,
@@ -3237,6 +3730,15 @@ capture_loop_open_input(capture_options *capture_opts,
         }
     }
 
+#ifdef PACKET_FANOUT
+    /* This has to be done before we give up our privileges. */
+    if (fanout_queues > 1 &&
+        !capture_loop_open_fanout(capture_opts, errmsg, errmsg_len,
+                                  secondary_errmsg, secondary_errmsg_len)) {
+        return false;
+    }
+#endif
+
     /*
      * Are we capturing from one source that is providing pcapng
      * information?
@@ -3488,6 +3990,11 @@ capture_loop_init_output(capture_options *capture_opts, char *errmsg, int errmsg
     } else {
         global_ld.pdh = ws_cwstream_fdopen(global_ld.save_file_fd, ws_name_to_compression_type(capture_opts->compress_type), &err);
     }
+    if (global_ld.pdh != NULL &&
+        !ws_cwstream_set_buffer_size(global_ld.pdh, CAPTURE_WRITE_BUFFER_SIZE, &err)) {
+        ws_cwstream_close_after_error(global_ld.pdh);
+        global_ld.pdh = NULL;
+    }
     if (global_ld.pdh == NULL) {
         /* We couldn't set up to write to the capture file. */
         /* XXX - use cf_open_error_message from ui/capture.c instead? */
@@ -3541,6 +4048,61 @@ capture_loop_init_output(capture_options *capture_opts, char *errmsg, int errmsg
     return true;
 }
 
+/*
+ * Get the counts for an interface, summed over its pcap handles if it's
+ * captured with more than one (see --fanout). stats is set to the sum
+ * of the pcap_stats() of the handles; if report_queues is set, the
+ * counts for each handle are reported as well.
+ *
+ * Returns false if there are no pcap statistics, either because the
+ * interface is a pipe or because pcap_stats() failed.
+ */
+static bool
+capture_loop_get_interface_stats(unsigned interface_id, char *name,
+                                 bool report_queues, struct pcap_stat *stats,
+                                 uint32_t *received, uint32_t *dropped,
+                                 uint32_t *flushed, char **err_str)
+{
+    bool stats_known = false;
+
+    memset(stats, 0, sizeof *stats);
+    *received = *dropped = *flushed = 0;
+    *err_str = NULL;
+    for (unsigned i = 0; i < global_ld.pcaps->len; i++) {
+        capture_src     *pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+        struct pcap_stat queue_stats = { 0 };
+
+        if (pcap_src->interface_id != interface_id) {
+            continue;
+        }
+        *received += pcap_src->received;
+        *dropped += pcap_src->dropped;
+        *flushed += pcap_src->flushed;
+        if (pcap_src->pcap_h == NULL) {
+            ws_assert(pcap_src->from_cap_pipe);
+            continue;
+        }
+        if (pcap_stats(pcap_src->pcap_h, &queue_stats) < 0) {
+            *err_str = pcap_geterr(pcap_src->pcap_h);
+            memset(stats, 0, sizeof *stats);
+            return false;
+        }
+        stats_known = true;
+        stats->ps_recv += queue_stats.ps_recv;
+        stats->ps_drop += queue_stats.ps_drop;
+        stats->ps_ifdrop += queue_stats.ps_ifdrop;
+        if (report_queues) {
+            char *queue_name = ws_strdup_printf("%s (queue %u)", name, pcap_src->fanout_queue);
+
+            report_packet_drops(pcap_src->received, queue_stats.ps_drop,
+                                pcap_src->dropped, pcap_src->flushed,
+                                queue_stats.ps_ifdrop, queue_name);
+            g_free(queue_name);
+        }
+    }
+    return stats_known;
+}
+
 static bool
 capture_loop_finish_output(capture_options *capture_opts)
 {
@@ -3558,13 +4120,17 @@ capture_loop_finish_output(capture_options *capture_opts)
                 capture_src *pcap_src;
 
                 pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
-                if (!pcap_src->from_cap_pipe) {
+                if (!pcap_src->from_cap_pipe && pcap_src->fanout_queue == 0) {
                     uint64_t isb_ifrecv, isb_ifdrop;
                     struct pcap_stat stats;
-
-                    if (pcap_stats(pcap_src->pcap_h, &stats) >= 0) {
-                        isb_ifrecv = pcap_src->received;
-                        isb_ifdrop = stats.ps_drop + pcap_src->dropped + pcap_src->flushed;
+                    uint32_t received, dropped, flushed;
+                    char *err_str;
+
+                    if (capture_loop_get_interface_stats(pcap_src->interface_id, NULL, false,
+                                                         &stats, &received, &dropped,
+                                                         &flushed, &err_str)) {
+                        isb_ifrecv = received;
+                        isb_ifdrop = stats.ps_drop + dropped + flushed;
                     } else {
                         isb_ifrecv = UINT64_MAX;
                         isb_ifdrop = UINT64_MAX;
@@ -3586,18 +4152,490 @@ capture_loop_finish_output(capture_options *capture_opts)
     return true;
 }
 
-static bool
-capture_loop_close_output(capture_options *capture_opts, int *err_close)
+/* write out the flow index of the capture file we're done with, if
+   we're building one; a failure isn't fatal, as the capture file is fine */
+static void
+capture_loop_write_flow_index(const char *save_file)
 {
-    ws_debug("capture_loop_close_output");
+    char *index_file;
+    int   err;
 
-    if (capture_opts->multi_files_on) {
-        return ringbuf_libpcap_dump_close(&capture_opts->save_file, err_close);
-    } else {
-        return ws_cwstream_close(global_ld.pdh, err_close);
+    if (capture_flow_index == NULL || save_file == NULL)
+        return;
+
+    index_file = flow_index_filename(save_file);
+    if (!flow_index_write(capture_flow_index, index_file, &err)) {
+        char *msg = ws_strdup_printf("The flow index \"%s\" could not be written: %s.",
+                                     index_file, g_strerror(err));
+        report_capture_warning(msg, "");
+        g_free(msg);
     }
+    g_free(index_file);
 }
 
+static bool
+capture_loop_close_output(capture_options *capture_opts, int *err_close)
+{
+    bool close_ok;
+
+    ws_debug("capture_loop_close_output");
+
+    if (capture_opts->multi_files_on) {
+        close_ok = ringbuf_libpcap_dump_close(&capture_opts->save_file, err_close);
+    } else {
+        close_ok = ws_cwstream_close(global_ld.pdh, err_close);
+    }
+    capture_loop_write_flow_index(capture_opts->save_file);
+    return close_ok;
+}
+
+/* The file capture source number index writes to with --fanout-files:
+   the -w file name, with "_<index>" added before its extension. */
+static char *
+capture_loop_shard_filename(const char *save_file, unsigned index)
+{
+    const char *basename, *ext;
+
+    basename = strrchr(save_file, G_DIR_SEPARATOR);
+    basename = (basename != NULL) ? basename + 1 : save_file;
+    ext = strchr(basename, '.');
+    if (ext == NULL || ext == basename) {
+        ext = basename + strlen(basename);
+    }
+    return ws_strdup_printf("%.*s_%02u%s", (int)(ext - save_file), save_file, index, ext);
+}
+
+/* With a ring buffer, the name of a file of a capture source's
+   --fanout-files output: the source's file name with the file number
+   and the time added before its extension, as ringbuffer.c does. */
+static char *
+capture_loop_shard_ring_filename(const capture_options *capture_opts, const capture_shard *shard)
+{
+    const char *basename, *ext;
+    char        filenum[5+1];
+    char        timestr[14+1];
+    time_t      current_time;
+    struct tm   tm_buf, *tm;
+
+    basename = strrchr(shard->basename, G_DIR_SEPARATOR);
+    basename = (basename != NULL) ? basename + 1 : shard->basename;
+    ext = strchr(basename, '.');
+    if (ext == NULL || ext == basename) {
+        ext = basename + strlen(basename);
+    }
+
+    current_time = time(NULL);
+    snprintf(filenum, sizeof(filenum), "%05u", shard->file_num % RINGBUFFER_MAX_NUM_FILES);
+    tm = ws_localtime_r(&current_time, &tm_buf);
+    if (tm != NULL)
+        strftime(timestr, sizeof(timestr), "%Y%m%d%H%M%S", tm);
+    else
+        (void) g_strlcpy(timestr, "196912312359", sizeof(timestr)); /* second before the Epoch */
+    if (capture_opts->has_nametimenum) {
+        return ws_strdup_printf("%.*s_%s_%s%s", (int)(ext - shard->basename), shard->basename,
+                                timestr, filenum, ext);
+    }
+    return ws_strdup_printf("%.*s_%s_%s%s", (int)(ext - shard->basename), shard->basename,
+                            filenum, timestr, ext);
+}
+
+/* Packets the capture threads may write between them with --fanout-files,
+   if -c or -a packets was given, and the number they've written so far. */
+static int shard_packet_limit;
+static int shard_packets_total;
+
+/* What goes in the SHB of every --fanout-files file. */
+static char *shard_os_info;
+static char *shard_cpu_info;
+
+/* The capture threads report their new files one at a time. */
+static GMutex shard_report_mutex;
+
+/* Open the next file of a capture source's --fanout-files output and
+   write its header, with the source's interface as the only one in the
+   file. Returns false, with *err set, on failure; shard->pdh is NULL if
+   the file couldn't be opened. */
+static bool
+capture_loop_open_shard_file(capture_options *capture_opts, capture_src *pcap_src, int *err)
+{
+    capture_shard     *shard = pcap_src->shard;
+    interface_options *interface_opts;
+    int                fd;
+
+    interface_opts = &g_array_index(capture_opts->ifaces, interface_options, pcap_src->interface_id);
+    g_free(shard->filename);
+    if (capture_opts->multi_files_on) {
+        shard->file_num++;
+        shard->filename = capture_loop_shard_ring_filename(capture_opts, shard);
+    } else {
+        shard->filename = g_strdup(shard->basename);
+    }
+    shard->bytes_written = 0;
+    shard->file_packets = 0;
+    shard->file_start = create_timestamp();
+    *err = 0;
+
+    fd = ws_open(shard->filename, O_WRONLY|O_BINARY|O_TRUNC|O_CREAT,
+                 (capture_opts->group_read_access) ? 0640 : 0600);
+    if (fd == -1) {
+        *err = errno;
+        return false;
+    }
+    shard->pdh = ws_cwstream_fdopen(fd, ws_name_to_compression_type(capture_opts->compress_type), err);
+    if (shard->pdh == NULL) {
+        ws_close(fd);
+        return false;
+    }
+    if (!ws_cwstream_set_buffer_size(shard->pdh, CAPTURE_WRITE_BUFFER_SIZE, err)) {
+        return false;
+    }
+    if (capture_opts->use_pcapng) {
+        return pcapng_write_section_header_block(shard->pdh,
+                                                 capture_comments,
+                                                 shard_cpu_info,
+                                                 shard_os_info,
+                                                 get_appname_and_version(),
+                                                 -1,
+                                                 &shard->bytes_written,
+                                                 err) &&
+               pcapng_write_interface_description_block(shard->pdh,
+                                                        NULL,
+                                                        (interface_opts->ifname != NULL) ? interface_opts->ifname : interface_opts->name,
+                                                        interface_opts->descr,
+                                                        interface_opts->cfilter,
+                                                        shard_os_info,
+                                                        interface_opts->hardware,
+                                                        pcap_src->linktype,
+                                                        pcap_src->snaplen,
+                                                        &shard->bytes_written,
+                                                        0,
+                                                        pcap_src->ts_nsec ? 9 : 6,
+                                                        err);
+    }
+    return libpcap_write_file_header(shard->pdh, pcap_src->linktype, pcap_src->snaplen,
+                                     pcap_src->ts_nsec, &shard->bytes_written, err);
+}
+
+/* Write out the statistics of a capture source to the --fanout-files file
+   being written, if there's been no error, and close it. Returns false,
+   with *err set, on failure; *is_close is set if that was closing it. */
+static bool
+capture_loop_close_shard_file(capture_options *capture_opts, capture_src *pcap_src,
+                              int *err, bool *is_close)
+{
+    capture_shard   *shard = pcap_src->shard;
+    struct pcap_stat stats;
+    uint64_t         isb_ifrecv, isb_ifdrop;
+
+    *err = shard->err;
+    *is_close = false;
+    if (shard->pdh == NULL) {
+        return *err == 0;
+    }
+    if (*err == 0 && capture_opts->use_pcapng) {
+        if (pcap_stats(pcap_src->pcap_h, &stats) >= 0) {
+            isb_ifrecv = pcap_src->received;
+            isb_ifdrop = stats.ps_drop + pcap_src->dropped + pcap_src->flushed;
+        } else {
+            isb_ifrecv = UINT64_MAX;
+            isb_ifdrop = UINT64_MAX;
+        }
+        pcapng_write_interface_statistics_block(shard->pdh,
+                                                0,
+                                                &shard->bytes_written,
+                                                "Counters provided by dumpcap",
+                                                shard->file_start,
+                                                create_timestamp(),
+                                                isb_ifrecv,
+                                                isb_ifdrop,
+                                                err);
+    }
+    if (*err == 0) {
+        *is_close = !ws_cwstream_close(shard->pdh, err);
+    } else {
+        ws_cwstream_close_after_error(shard->pdh);
+    }
+    shard->pdh = NULL;
+    return *err == 0;
+}
+
+/* With a ring buffer, switch a capture source's --fanout-files output to
+   its next file, removing the oldest if there are now more than -b files
+   allows (called in the source's thread). Returns false, with shard->err
+   set, on failure. */
+static bool
+capture_loop_switch_shard_file(capture_options *capture_opts, capture_src *pcap_src)
+{
+    capture_shard *shard = pcap_src->shard;
+    int            err;
+    bool           is_close;
+
+    if (!capture_loop_close_shard_file(capture_opts, pcap_src, &err, &is_close)) {
+        shard->err = err;
+        return false;
+    }
+    g_queue_push_tail(shard->old_files, shard->filename);
+    shard->filename = NULL;
+    if (capture_opts->has_ring_num_files && capture_opts->ring_num_files > 0) {
+        while (g_queue_get_length(shard->old_files) >= capture_opts->ring_num_files) {
+            char *old_file = (char *)g_queue_pop_head(shard->old_files);
+
+            ws_unlink(old_file);
+            g_free(old_file);
+        }
+    }
+    if (!capture_loop_open_shard_file(capture_opts, pcap_src, &err)) {
+        shard->err = err;
+        return false;
+    }
+    g_mutex_lock(&shard_report_mutex);
+    report_new_capture_file(shard->filename);
+    g_mutex_unlock(&shard_report_mutex);
+    return true;
+}
+
+/* Whether a capture source's --fanout-files file is done, under the -b
+   filesize, duration and packets or -a filesize conditions. */
+static bool
+capture_loop_shard_file_full(const capture_options *capture_opts, const capture_shard *shard)
+{
+    if (capture_opts->has_autostop_filesize && capture_opts->autostop_filesize > 0 &&
+        shard->bytes_written / 1000 >= capture_opts->autostop_filesize) {
+        return true;
+    }
+    if (!capture_opts->multi_files_on) {
+        return false;
+    }
+    if (capture_opts->has_file_packets && shard->file_packets >= capture_opts->file_packets) {
+        return true;
+    }
+    if (capture_opts->has_file_duration &&
+        (double)(create_timestamp() - shard->file_start) / 1000000 >= capture_opts->file_duration) {
+        return true;
+    }
+    return false;
+}
+
+/* With --fanout-files, open a file for each capture source and write its
+   header, with the source's interface as the only one in the file. */
+static bool
+capture_loop_open_shards(capture_options *capture_opts, char *errmsg, int errmsg_len)
+{
+    GString *os_info_str = g_string_new("");
+    GString *cpu_info_str = g_string_new("");
+    bool     successful = true;
+
+    get_os_version_info(os_info_str);
+    get_cpu_info(cpu_info_str);
+    shard_os_info = g_string_free(os_info_str, FALSE);
+    shard_cpu_info = g_string_free(cpu_info_str, FALSE);
+
+    shard_packets_total = 0;
+    shard_packet_limit = 0;
+    if (capture_opts->has_autostop_packets) {
+        shard_packet_limit = capture_opts->autostop_packets;
+    }
+    if (capture_opts->has_autostop_written_packets &&
+        (shard_packet_limit == 0 || capture_opts->autostop_written_packets < shard_packet_limit)) {
+        shard_packet_limit = capture_opts->autostop_written_packets;
+    }
+
+    for (unsigned i = 0; successful && i < global_ld.pcaps->len; i++) {
+        capture_src   *pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+        capture_shard *shard;
+        int            err;
+
+        if (pcap_src->from_cap_pipe) {
+            snprintf(errmsg, errmsg_len,
+                     "--fanout-files can only be used when capturing on network interfaces.");
+            successful = false;
+            break;
+        }
+        shard = g_new0(capture_shard, 1);
+        shard->basename = capture_loop_shard_filename(capture_opts->save_file, i);
+        shard->old_files = g_queue_new();
+        pcap_src->shard = shard;
+        pcap_src->snaplen = pcap_snapshot(pcap_src->pcap_h);
+
+        successful = capture_loop_open_shard_file(capture_opts, pcap_src, &err);
+        if (!successful) {
+            if (shard->pdh == NULL) {
+                snprintf(errmsg, errmsg_len,
+                         "The file to which the capture would be saved (\"%s\") "
+                         "could not be opened: %s.", shard->filename,
+                         err <= 0 ? "Unknown error" : g_strerror(err));
+            } else {
+                snprintf(errmsg, errmsg_len,
+                         "The file to which the capture would be saved (\"%s\") "
+                         "could not be written to: %s.", shard->filename,
+                         err < 0 ? "Unknown error" : g_strerror(err));
+            }
+        }
+    }
+
+    if (successful) {
+        for (unsigned i = 0; i < global_ld.pcaps->len; i++) {
+            capture_src *pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+
+            report_new_capture_file(pcap_src->shard->filename);
+        }
+    }
+    return successful;
+}
+
+/* Free a capture source's --fanout-files state, and the strings that go
+   in the SHBs once the last is gone. */
+static void
+capture_loop_free_shard(capture_src *pcap_src)
+{
+    capture_shard *shard = pcap_src->shard;
+
+    g_queue_free_full(shard->old_files, g_free);
+    g_free(shard->basename);
+    g_free(shard->filename);
+    g_free(shard);
+    pcap_src->shard = NULL;
+}
+
+static void
+capture_loop_free_shard_info(void)
+{
+    g_free(shard_os_info);
+    shard_os_info = NULL;
+    g_free(shard_cpu_info);
+    shard_cpu_info = NULL;
+}
+
+/* With --fanout-files, count the packets the capture threads have written
+   since we last looked. Returns that number. */
+static int
+capture_loop_count_shard_packets(void)
+{
+    int new_packets = 0;
+
+    for (unsigned i = 0; i < global_ld.pcaps->len; i++) {
+        capture_shard *shard = g_array_index(global_ld.pcaps, capture_src *, i)->shard;
+        int            written = g_atomic_int_get(&shard->packets_written);
+
+        new_packets += written - shard->packets_counted;
+        shard->packets_counted = written;
+    }
+    global_ld.packets_captured += new_packets;
+    global_ld.packets_written += new_packets;
+    global_ld.inpkts_to_sync_pipe += new_packets;
+    return new_packets;
+}
+
+/* With --fanout-files, write out the statistics of each capture source to
+   its file and close it. Reports any error; returns false if there was one. */
+static bool
+capture_loop_close_shards(capture_options *capture_opts)
+{
+    char     errmsg[MSG_MAX_LENGTH+1];
+    char     secondary_errmsg[MSG_MAX_LENGTH+1];
+    bool     ok = true;
+
+    for (unsigned i = 0; i < global_ld.pcaps->len; i++) {
+        capture_src     *pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+        int              err;
+        bool             is_close;
+
+        if (pcap_src->shard == NULL) {
+            continue;
+        }
+        if (!capture_loop_close_shard_file(capture_opts, pcap_src, &err, &is_close)) {
+            capture_loop_get_errmsg(errmsg, sizeof(errmsg), secondary_errmsg,
+                                    sizeof(secondary_errmsg),
+                                    pcap_src->shard->filename, err, is_close);
+            report_capture_error(errmsg, secondary_errmsg);
+            ok = false;
+        }
+        capture_loop_free_shard(pcap_src);
+    }
+    capture_loop_free_shard_info();
+    return ok;
+}
+
+/* With --fanout-files, close and remove the files of a capture that
+   couldn't be started. */
+static void
+capture_loop_discard_shards(void)
+{
+    for (unsigned i = 0; i < global_ld.pcaps->len; i++) {
+        capture_src   *pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+        capture_shard *shard = pcap_src->shard;
+
+        if (shard == NULL) {
+            continue;
+        }
+        if (shard->pdh != NULL) {
+            ws_cwstream_close_after_error(shard->pdh);
+        }
+        if (shard->filename != NULL) {
+            ws_unlink(shard->filename);
+        }
+        capture_loop_free_shard(pcap_src);
+    }
+    capture_loop_free_shard_info();
+}
+
+/* The pcap_dispatch() callback for the packets of a capture source. */
+static pcap_handler
+capture_loop_packet_cb(const capture_src *pcap_src)
+{
+    if (pcap_src->shard != NULL) {
+        return capture_loop_write_shard_packet_cb;
+    }
+    return use_threads ? capture_loop_queue_packet_cb : capture_loop_write_packet_cb;
+}
+
+#ifdef MUST_DO_SELECT
+/*
+ * Read packets that select() says are waiting on a capture source's pcap_t,
+ * in batches of up to dispatch_batch_size packets, until there are none
+ * left, dispatch_budget packets have been read or we're told to stop.
+ *
+ * Only used with threads, with the pcap_t in non-blocking mode so that
+ * pcap_dispatch() returns at once once there's nothing more to read;
+ * capture_loop_stop() can still interrupt a batch with pcap_breakloop().
+ * Each batch is handed to the writer as soon as it has been read.
+ *
+ * Returns the number of packets read, or the error from pcap_dispatch().
+ */
+static int
+capture_loop_dispatch_batched(capture_src *pcap_src)
+{
+    int     total = 0;
+    int     inpkts;
+    int64_t start_time = 0;
+    int64_t usecs;
+
+    do {
+        if (dispatch_stats) {
+            start_time = g_get_monotonic_time();
+        }
+        inpkts = pcap_dispatch(pcap_src->pcap_h, dispatch_batch_size,
+                               capture_loop_packet_cb(pcap_src), (uint8_t *)pcap_src);
+        if (inpkts <= 0) {
+            break;
+        }
+        total += inpkts;
+        capture_queue_publish(pcap_src);
+        if (dispatch_stats) {
+            usecs = g_get_monotonic_time() - start_time;
+            pcap_src->dispatch_calls++;
+            pcap_src->dispatch_packets += inpkts;
+            pcap_src->dispatch_usecs += usecs;
+            if ((uint64_t)usecs > pcap_src->dispatch_max_usecs) {
+                pcap_src->dispatch_max_usecs = usecs;
+            }
+        }
+    } while (total < dispatch_budget && global_ld.go);
+
+    return inpkts < 0 ? inpkts : total;
+}
+#endif /* MUST_DO_SELECT */
+
 /* dispatch incoming packets (pcap or capture pipe)
  *
  * Waits for incoming packets to be available, and calls pcap_dispatch()
@@ -3685,10 +4723,10 @@ capture_loop_dispatch(char *errmsg, int errmsg_len, capture_src *pcap_src)
                  *
                  * XXX - we *do* have pcap_breakloop().
                  */
-                if (use_threads) {
-                    inpkts = pcap_dispatch(pcap_src->pcap_h, 1, capture_loop_queue_packet_cb, (uint8_t *)pcap_src);
+                if (pcap_src->dispatch_batched) {
+                    inpkts = capture_loop_dispatch_batched(pcap_src);
                 } else {
-                    inpkts = pcap_dispatch(pcap_src->pcap_h, 1, capture_loop_write_packet_cb, (uint8_t *)pcap_src);
+                    inpkts = pcap_dispatch(pcap_src->pcap_h, 1, capture_loop_packet_cb(pcap_src), (uint8_t *)pcap_src);
                 }
                 if (inpkts < 0) {
                     if (inpkts != PCAP_ERROR_BREAK) {
@@ -3720,17 +4758,9 @@ capture_loop_dispatch(char *errmsg, int errmsg_len, capture_src *pcap_src)
              * after processing packets.  We therefore process only one packet
              * at a time, so that we can check the pipe after every packet.
              */
-            if (use_threads) {
-                inpkts = pcap_dispatch(pcap_src->pcap_h, 1, capture_loop_queue_packet_cb, (uint8_t *)pcap_src);
-            } else {
-                inpkts = pcap_dispatch(pcap_src->pcap_h, 1, capture_loop_write_packet_cb, (uint8_t *)pcap_src);
-            }
+            inpkts = pcap_dispatch(pcap_src->pcap_h, 1, capture_loop_packet_cb(pcap_src), (uint8_t *)pcap_src);
 #else
-            if (use_threads) {
-                inpkts = pcap_dispatch(pcap_src->pcap_h, -1, capture_loop_queue_packet_cb, (uint8_t *)pcap_src);
-            } else {
-                inpkts = pcap_dispatch(pcap_src->pcap_h, -1, capture_loop_write_packet_cb, (uint8_t *)pcap_src);
-            }
+            inpkts = pcap_dispatch(pcap_src->pcap_h, -1, capture_loop_packet_cb(pcap_src), (uint8_t *)pcap_src);
 #endif
             if (inpkts < 0) {
                 if (inpkts != PCAP_ERROR_BREAK) {
@@ -3821,6 +4851,9 @@ capture_loop_open_output(capture_options *capture_opts, int *save_file_fd,
         else {
             if (capture_opts->multi_files_on) {
                 /* ringbuffer is enabled */
+                if (preallocate_files && capture_opts->has_autostop_filesize) {
+                    ringbuf_set_preallocate((uint64_t)capture_opts->autostop_filesize * 1000);
+                }
                 *save_file_fd = ringbuf_init(capfile_name,
                                              (capture_opts->has_ring_num_files) ? capture_opts->ring_num_files : 0,
                                              capture_opts->group_read_access,
@@ -3991,13 +5024,17 @@ do_file_switch_or_stop(capture_options *capture_opts)
         }
 
         /* Switch to the next ringbuffer file */
+        capture_loop_write_flow_index(capture_opts->save_file);
         if (ringbuf_switch_file(&global_ld.pdh, &capture_opts->save_file,
                                 &global_ld.save_file_fd, &global_ld.err)) {
 
             /* File switch succeeded: reset the conditions */
             global_ld.bytes_written = 0;
             global_ld.packets_written = 0;
-            if (capture_opts->use_pcapng) {
+            if (!ws_cwstream_set_buffer_size(global_ld.pdh, CAPTURE_WRITE_BUFFER_SIZE,
+                                             &global_ld.err)) {
+                successful = false;
+            } else if (capture_opts->use_pcapng) {
                 successful = capture_loop_init_pcapng_output(capture_opts, &global_ld.err);
             } else {
                 capture_src *pcap_src;
@@ -4038,6 +5075,248 @@ do_file_switch_or_stop(capture_options *capture_opts)
     return true;
 }
 
+/* Largest share of the byte limit a single queue gets; also the limit
+   when only a packet limit is given and that times the snapshot length
+   is more. */
+#define CAPTURE_QUEUE_MAX_BYTES     (1U << 28)
+/* Largest number of slots a single queue gets. */
+#define CAPTURE_QUEUE_MAX_SLOTS     (1U << 20)
+
+static uint32_t
+capture_queue_round_up(uint64_t n)
+{
+    uint32_t size = 1;
+
+    while (size < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+/* Create the queue for a capture source. The queue byte and packet
+   limits are shared evenly between the capture sources. */
+static capture_queue *
+capture_queue_new(capture_src *pcap_src, unsigned num_srcs)
+{
+    capture_queue *queue = g_new0(capture_queue, 1);
+    uint64_t byte_limit, packet_limit, max_len;
+    size_t   slots_size;
+
+    max_len = MAX((unsigned)MAX(pcap_src->snaplen, 0), pcap_src->cap_pipe_max_pkt_size);
+    max_len = MAX(max_len, WTAP_MAX_PACKET_SIZE_STANDARD);
+
+    packet_limit = (uint64_t)(pcap_queue_packet_limit + num_srcs - 1) / num_srcs;
+    if (packet_limit > CAPTURE_QUEUE_MAX_SLOTS) {
+        packet_limit = CAPTURE_QUEUE_MAX_SLOTS;
+    }
+    byte_limit = (uint64_t)(pcap_queue_byte_limit + num_srcs - 1) / num_srcs;
+    if (byte_limit == 0) {
+        /* Only a packet limit; that many packets of the largest size
+           is all the queue can ever hold. */
+        byte_limit = MIN(packet_limit * max_len, CAPTURE_QUEUE_MAX_BYTES);
+    } else if (byte_limit > CAPTURE_QUEUE_MAX_BYTES) {
+        ws_warning("Interface %u: using a buffer limit of %u bytes rather than %" PRIu64 ", the most a single interface can use.",
+                   pcap_src->interface_id, CAPTURE_QUEUE_MAX_BYTES, byte_limit);
+        byte_limit = CAPTURE_QUEUE_MAX_BYTES;
+    }
+    if (packet_limit == 0) {
+        /* Enough slots for the byte limit's worth of small packets. */
+        packet_limit = MAX(byte_limit / 64, 1);
+    }
+    queue->byte_limit = (uint32_t)byte_limit;
+    queue->packet_limit = (unsigned)packet_limit;
+
+    /* A packet is queued as long as the queue holds less than the byte
+       limit, so leave room for one more of the largest packet, plus what
+       may be skipped at the end of the ring to keep it contiguous. */
+    max_len += 4096;
+    queue->data_size = capture_queue_round_up(byte_limit + 2 * max_len);
+    queue->slot_mask = capture_queue_round_up(packet_limit) - 1;
+    slots_size = ((size_t)queue->slot_mask + 1) * sizeof(capture_queue_slot);
+
+    queue->mem_size = queue->data_size + slots_size;
+#ifdef __linux__
+    queue->mem = mmap(NULL, queue->mem_size, PROT_READ|PROT_WRITE,
+                      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (queue->mem != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+        /* Every packet is copied in and out of here; huge pages, if
+           we get them, save a lot of TLB misses doing that. */
+        madvise(queue->mem, queue->mem_size, MADV_HUGEPAGE);
+#endif
+        queue->mem_mapped = true;
+    } else {
+        queue->mem = NULL;
+    }
+#endif
+    if (queue->mem == NULL) {
+        queue->mem = g_malloc(queue->mem_size);
+    }
+    queue->data = (uint8_t *)queue->mem;
+    queue->slots = (capture_queue_slot *)(queue->data + queue->data_size);
+
+    return queue;
+}
+
+static void
+capture_queue_free(capture_queue *queue)
+{
+#ifdef __linux__
+    if (queue->mem_mapped) {
+        munmap(queue->mem, queue->mem_size);
+        queue->mem = NULL;
+    }
+#endif
+    g_free(queue->mem);
+    g_free(queue);
+}
+
+static bool
+capture_queue_has_room(const capture_queue *queue, uint32_t pos, uint32_t len)
+{
+    return queue->fill - queue->head_seen < queue->packet_limit &&
+           queue->bytes_in - queue->bytes_out_seen < queue->byte_limit &&
+           pos + len - queue->data_read_seen <= queue->data_size;
+}
+
+/* Make the packets queued by a capture source visible to the writer,
+   and wake it up if it's waiting for some. Called by the source's
+   thread after each batch of packets. */
+static void
+capture_queue_publish(capture_src *pcap_src)
+{
+    capture_queue *queue = pcap_src->queue;
+
+    /* Sources writing their own files (--fanout-files) have no queue. */
+    if (queue == NULL ||
+        (queue->batch_queued == 0 && queue->batch_dropped == 0)) {
+        return;
+    }
+    if (queue->batch_queued > 0) {
+        g_atomic_int_set(&queue->tail, (int)queue->fill);
+        if (g_atomic_int_get(&capture_queue_writer_waiting)) {
+            g_mutex_lock(&capture_queue_mutex);
+            g_cond_signal(&capture_queue_cond);
+            g_mutex_unlock(&capture_queue_mutex);
+        }
+    }
+    ws_debug("Queued %u and dropped %u packets captured on interface %u.",
+             queue->batch_queued, queue->batch_dropped, pcap_src->interface_id);
+    queue->batch_queued = 0;
+    queue->batch_dropped = 0;
+}
+
+/* Get a slot, and room for len bytes of data, to queue a packet in.
+   Returns NULL, and counts the packet as dropped, if the queue is full. */
+static capture_queue_slot *
+capture_queue_reserve(capture_src *pcap_src, uint32_t len)
+{
+    capture_queue      *queue = pcap_src->queue;
+    capture_queue_slot *slot;
+    uint32_t            pos, phys;
+
+    if (len > queue->data_size / 2) {
+        /* Would never fit. */
+        ws_warning("Dropped a packet of length %u captured on interface %u, too large to queue.",
+                   len, pcap_src->interface_id);
+        pcap_src->dropped++;
+        queue->batch_dropped++;
+        return NULL;
+    }
+
+    /* Keep the data contiguous; skip what's left at the end of the ring
+       if it won't fit there. */
+    pos = queue->data_write;
+    phys = pos & (queue->data_size - 1);
+    if (phys + len > queue->data_size) {
+        pos += queue->data_size - phys;
+    }
+
+    if (!capture_queue_has_room(queue, pos, len)) {
+        /* Let the writer catch up on what we have, and look again at
+           how far it has got. */
+        capture_queue_publish(pcap_src);
+        queue->head_seen = (unsigned)g_atomic_int_get(&queue->head);
+        queue->data_read_seen = (uint32_t)g_atomic_int_get(&queue->data_read);
+        queue->bytes_out_seen = (uint32_t)g_atomic_int_get(&queue->bytes_out);
+        if (!capture_queue_has_room(queue, pos, len)) {
+            pcap_src->dropped++;
+            queue->batch_dropped++;
+            return NULL;
+        }
+    }
+
+    slot = &queue->slots[queue->fill & queue->slot_mask];
+    slot->data_pos = pos;
+    slot->data_len = len;
+    return slot;
+}
+
+static uint8_t *
+capture_queue_slot_data(const capture_queue *queue, const capture_queue_slot *slot)
+{
+    return queue->data + (slot->data_pos & (queue->data_size - 1));
+}
+
+/* Add a packet whose slot has been filled in to the current batch. */
+static void
+capture_queue_commit(capture_src *pcap_src, const capture_queue_slot *slot)
+{
+    capture_queue *queue = pcap_src->queue;
+
+    queue->data_write = slot->data_pos + slot->data_len;
+    queue->bytes_in += slot->data_len;
+    queue->fill++;
+    pcap_src->received++;
+    if (++queue->batch_queued >= CAPTURE_QUEUE_PUBLISH_BATCH) {
+        capture_queue_publish(pcap_src);
+    }
+}
+
+/* Find the capture source whose oldest queued packet has the earliest
+   time stamp, or NULL if all the queues are empty. */
+static capture_src *
+capture_queue_next_src(void)
+{
+    capture_src *best_src = NULL;
+    uint64_t     best_ts = 0;
+
+    for (unsigned i = 0; i < global_ld.pcaps->len; i++) {
+        capture_src   *pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+        capture_queue *queue = pcap_src->queue;
+        unsigned       head = (unsigned)queue->head;
+        uint64_t       ts;
+
+        if (head == queue->tail_seen) {
+            queue->tail_seen = (unsigned)g_atomic_int_get(&queue->tail);
+            if (head == queue->tail_seen) {
+                continue;
+            }
+        }
+        ts = queue->slots[head & queue->slot_mask].ts;
+        if (best_src == NULL || ts < best_ts) {
+            best_src = pcap_src;
+            best_ts = ts;
+        }
+    }
+    return best_src;
+}
+
+/* Wait, for at most WRITER_THREAD_TIMEOUT, for packets to be queued. */
+static void
+capture_queue_wait(void)
+{
+    int64_t end_time = g_get_monotonic_time() + WRITER_THREAD_TIMEOUT;
+
+    g_mutex_lock(&capture_queue_mutex);
+    g_atomic_int_set(&capture_queue_writer_waiting, 1);
+    if (capture_queue_next_src() == NULL) {
+        g_cond_wait_until(&capture_queue_cond, &capture_queue_mutex, end_time);
+    }
+    g_atomic_int_set(&capture_queue_writer_waiting, 0);
+    g_mutex_unlock(&capture_queue_mutex);
+}
+
 /* Runs in a per-capture-source thread, receiving packets from the
    capture source and pushing them onto the end of the packet queue. */
 static void *
@@ -4052,6 +5331,7 @@ pcap_read_handler(void* arg)
     while (global_ld.go && pcap_src->cap_pipe_err == PIPOK) {
         /* dispatch incoming packets */
         capture_loop_dispatch(errmsg, sizeof(errmsg), pcap_src);
+        capture_queue_publish(pcap_src);
     }
 
     ws_info("Stopped thread for interface %d.", pcap_src->interface_id);
@@ -4059,45 +5339,38 @@ pcap_read_handler(void* arg)
     return (NULL);
 }
 
-/* Try to pop an item off the head of the packet queue and if it exists,
-   write it */
-static bool
-capture_loop_dequeue_packet(void) {
-    pcap_queue_element *queue_element;
-
-    g_async_queue_lock(pcap_queue);
-    queue_element = (pcap_queue_element *)g_async_queue_timeout_pop_unlocked(pcap_queue, WRITER_THREAD_TIMEOUT);
-    if (queue_element) {
-        if (queue_element->pcap_src->from_pcapng) {
-            pcap_queue_bytes -= queue_element->u.bh.block_total_length;
-        } else {
-            pcap_queue_bytes -= queue_element->u.phdr.caplen;
-        }
-        pcap_queue_packets -= 1;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (queue_element) {
-        if (queue_element->pcap_src->from_pcapng) {
-            ws_info("Dequeued a block of type 0x%08x of length %d captured on interface %d.",
-                  queue_element->u.bh.block_type, queue_element->u.bh.block_total_length,
-                  queue_element->pcap_src->interface_id);
+/* Write out up to CAPTURE_QUEUE_WRITE_BATCH queued packets, merging the
+   queues of the capture sources in time stamp order. Returns the number
+   of packets written. */
+static unsigned
+capture_loop_dequeue_packets(void)
+{
+    unsigned written;
 
-            capture_loop_write_pcapng_cb(queue_element->pcap_src,
-                                        &queue_element->u.bh,
-                                        queue_element->pd);
-        } else {
-            ws_info("Dequeued a packet of length %d captured on interface %d.",
-                queue_element->u.phdr.caplen, queue_element->pcap_src->interface_id);
+    for (written = 0; written < CAPTURE_QUEUE_WRITE_BATCH; written++) {
+        capture_src        *pcap_src = capture_queue_next_src();
+        capture_queue      *queue;
+        capture_queue_slot *slot;
+        unsigned            head;
 
-            capture_loop_write_packet_cb((uint8_t *) queue_element->pcap_src,
-                                        &queue_element->u.phdr,
-                                        queue_element->pd);
+        if (pcap_src == NULL) {
+            break;
         }
-        g_free(queue_element->pd);
-        g_free(queue_element);
-        return true;
+        queue = pcap_src->queue;
+        head = (unsigned)queue->head;
+        slot = &queue->slots[head & queue->slot_mask];
+        if (pcap_src->from_pcapng) {
+            capture_loop_write_pcapng_cb(pcap_src, &slot->u.bh,
+                                         capture_queue_slot_data(queue, slot));
+        } else {
+            capture_loop_write_packet_cb((uint8_t *) pcap_src, &slot->u.phdr,
+                                         capture_queue_slot_data(queue, slot));
+        }
+        g_atomic_int_set(&queue->bytes_out, (int)((uint32_t)queue->bytes_out + slot->data_len));
+        g_atomic_int_set(&queue->data_read, (int)(slot->data_pos + slot->data_len));
+        g_atomic_int_set(&queue->head, (int)(head + 1));
     }
-    return false;
+    return written;
 }
 
 /*
@@ -4182,9 +5455,9 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
                                  secondary_errmsg, sizeof(secondary_errmsg))) {
         goto error;
     }
-    for (i = 0; i < capture_opts->ifaces->len; i++) {
+    for (i = 0; i < global_ld.pcaps->len; i++) {
         pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
-        interface_opts = &g_array_index(capture_opts->ifaces, interface_options, i);
+        interface_opts = &g_array_index(capture_opts->ifaces, interface_options, pcap_src->interface_id);
         /* init the input filter from the network interface (capture pipe will do nothing) */
         /*
          * When remote capturing WinPCap crashes when the capture filter
@@ -4201,7 +5474,7 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
 
         case INITFILTER_BAD_FILTER:
             cfilter_error = true;
-            error_index = i;
+            error_index = pcap_src->interface_id;
             snprintf(errmsg, sizeof(errmsg), "%s", pcap_geterr(pcap_src->pcap_h));
             goto error;
 
@@ -4214,8 +5487,13 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
     }
 
     /* If we're supposed to write to a capture file, open it for output
-       (temporary/specified name/ringbuffer) */
-    if (capture_opts->saving_to_file) {
+       (temporary/specified name/ringbuffer), or, with --fanout-files,
+       open one for each capture source */
+    if (capture_opts->saving_to_file && fanout_files) {
+        if (!capture_loop_open_shards(capture_opts, errmsg, sizeof(errmsg))) {
+            goto error;
+        }
+    } else if (capture_opts->saving_to_file) {
         if (!capture_loop_open_output(capture_opts, &global_ld.save_file_fd,
                                       errmsg, sizeof(errmsg))) {
             goto error;
@@ -4226,6 +5504,10 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
             goto error;
         }
 
+        if (flow_index_on && !capture_opts->output_to_pipe) {
+            capture_flow_index = flow_index_new();
+        }
+
         /* XXX - capture SIGTERM and close the capture, in case we're on a
            Linux 2.0[.x] system and you have to explicitly close the capture
            stream in order to turn promiscuous mode off?  We need to do that
@@ -4262,7 +5544,8 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
         autostop_duration_timer = g_timer_new();
     }
 
-    if (capture_opts->multi_files_on) {
+    /* With --fanout-files each capture thread switches its own files. */
+    if (capture_opts->multi_files_on && !fanout_files) {
         if (capture_opts->has_file_duration) {
             global_ld.file_duration_timer = g_timer_new();
         }
@@ -4283,9 +5566,27 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
     if (use_threads) {
         /* Start threads, one per capture device, to queue incoming packets
            for writing. */
-        pcap_queue = g_async_queue_new();
-        pcap_queue_bytes = 0;
-        pcap_queue_packets = 0;
+        for (i = 0; i < global_ld.pcaps->len; i++) {
+            pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+            if (pcap_src->shard == NULL) {
+                pcap_src->queue = capture_queue_new(pcap_src, global_ld.pcaps->len);
+            }
+#ifdef MUST_DO_SELECT
+            if (pcap_src->pcap_h != NULL && pcap_src->pcap_fd != -1) {
+                char nonblock_errbuf[PCAP_ERRBUF_SIZE];
+
+                /* Read in batches rather than a packet at a time; that
+                   needs reads not to block once we've drained what
+                   select() said was there. */
+                if (pcap_setnonblock(pcap_src->pcap_h, 1, nonblock_errbuf) == 0) {
+                    pcap_src->dispatch_batched = true;
+                } else {
+                    ws_warning("Couldn't put interface %u in non-blocking mode, reading a packet at a time: %s",
+                               pcap_src->interface_id, nonblock_errbuf);
+                }
+            }
+#endif
+        }
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
             /* XXX - Add an interface name here? */
@@ -4293,15 +5594,19 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
         }
     }
     while (global_ld.go) {
-        if (use_threads) {
-            /* Write out the packet at the head of the queue of received
-               packets. */
-            bool dequeued = capture_loop_dequeue_packet();
-
-            if (dequeued) {
-                inpkts = 1;
-            } else {
-                inpkts = 0;
+        if (fanout_files) {
+            /* The capture threads write out their own packets; just
+               keep count of them. */
+            g_usleep(WRITER_THREAD_TIMEOUT);
+            inpkts = capture_loop_count_shard_packets();
+        } else if (use_threads) {
+            /* Write out the packets at the heads of the queues of
+               received packets, waiting a bit for some if there are
+               none. */
+            inpkts = (int)capture_loop_dequeue_packets();
+            if (inpkts == 0) {
+                capture_queue_wait();
+                inpkts = (int)capture_loop_dequeue_packets();
             }
         } else {
             /* Dispatch incoming packets and write them out. */
@@ -4368,10 +5673,15 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
                 *stats_known = true;
             }
 #endif
-            /* Let the parent process know. */
+            /* Let the parent process know.  The capture file is how the
+               packets get to the parent, which reads them back with
+               wiretap; handing them over through shared memory as well
+               would only help if the parent dissected them from there. */
             if (global_ld.inpkts_to_sync_pipe) {
                 /* do sync here */
-                ws_cwstream_flush(global_ld.pdh, NULL);
+                if (global_ld.pdh != NULL) {
+                    ws_cwstream_flush(global_ld.pdh, NULL);
+                }
 
                 /* Send our parent a message saying we've written out
                    "global_ld.inpkts_to_sync_pipe" packets to the capture file. */
@@ -4412,14 +5722,30 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
             ws_info("Waiting for thread of interface %u...", pcap_src->interface_id);
             g_thread_join(pcap_src->tid);
             ws_info("Thread of interface %u terminated.", pcap_src->interface_id);
+            if (dispatch_stats && pcap_src->dispatch_calls > 0) {
+                ws_message("Interface %u: %" PRIu64 " packets in %" PRIu64 " reads, "
+                           "%.1f packets per read, %.1f us per read (max %" PRIu64 " us)",
+                           pcap_src->interface_id, pcap_src->dispatch_packets,
+                           pcap_src->dispatch_calls,
+                           (double)pcap_src->dispatch_packets / pcap_src->dispatch_calls,
+                           (double)pcap_src->dispatch_usecs / pcap_src->dispatch_calls,
+                           pcap_src->dispatch_max_usecs);
+            }
         }
-        while (1) {
-            bool dequeued = capture_loop_dequeue_packet();
-            if (!dequeued) {
-                break;
+        if (fanout_files) {
+            capture_loop_count_shard_packets();
+        } else {
+            while (capture_loop_dequeue_packets() > 0) {
+                if (capture_opts->output_to_pipe) {
+                    ws_cwstream_flush(global_ld.pdh, NULL);
+                }
             }
-            if (capture_opts->output_to_pipe) {
-                ws_cwstream_flush(global_ld.pdh, NULL);
+        }
+        for (i = 0; i < global_ld.pcaps->len; i++) {
+            pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+            if (pcap_src->queue != NULL) {
+                capture_queue_free(pcap_src->queue);
+                pcap_src->queue = NULL;
             }
         }
     }
@@ -4432,7 +5758,7 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
         g_timer_destroy(autostop_duration_timer);
 
     /* did we have a pcap (input) error? */
-    for (i = 0; i < capture_opts->ifaces->len; i++) {
+    for (i = 0; i < global_ld.pcaps->len; i++) {
         pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
         if (pcap_src->pcap_err) {
             /* On Linux, if an interface goes down while you're capturing on it,
@@ -4467,7 +5793,7 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
             char *primary_msg;
             char *secondary_msg;
 
-            interface_opts = &g_array_index(capture_opts->ifaces, interface_options, i);
+            interface_opts = &g_array_index(capture_opts->ifaces, interface_options, pcap_src->interface_id);
             cap_err_str = pcap_geterr(pcap_src->pcap_h);
             if (strcmp(cap_err_str, "The interface went down") == 0 ||
                 strcmp(cap_err_str, "recvfrom: Network is down") == 0) {
@@ -4549,12 +5875,16 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
         }
     }
     /* did we have an output error while capturing? */
-    if (global_ld.err == 0) {
+    if (fanout_files) {
+        /* finish writing and close the capture sources' files; errors
+           are reported for each of them */
+        write_ok = capture_loop_close_shards(capture_opts);
+    } else if (global_ld.err == 0) {
         /* finish writing the output file */
         write_ok = capture_loop_finish_output(capture_opts);
     } else
         write_ok = false;
-    if (!write_ok) {
+    if (!write_ok && !fanout_files) {
         capture_loop_get_errmsg(errmsg, sizeof(errmsg), secondary_errmsg,
                                 sizeof(secondary_errmsg),
                                 capture_opts->save_file, global_ld.err, false);
@@ -4562,11 +5892,13 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
         write_ok = false;
     }
 
-    if (capture_opts->saving_to_file) {
+    if (capture_opts->saving_to_file && !fanout_files) {
         /* close the output file */
         close_ok = capture_loop_close_output(capture_opts, &err_close);
     } else
         close_ok = true;
+    flow_index_free(capture_flow_index);
+    capture_flow_index = NULL;
 
     /* there might be packets not yet notified to the parent */
     /* (do this after closing the file, so all packets are already flushed) */
@@ -4596,29 +5928,33 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
 
     report_capture_count(!really_quiet);
 
-    /* get packet drop statistics from pcap */
+    /* get packet drop statistics from pcap; with --fanout, for each of
+       an interface's handles, and then for the interface as a whole */
     for (i = 0; i < capture_opts->ifaces->len; i++) {
         uint32_t received;
-        uint32_t pcap_dropped = 0;
+        uint32_t dropped;
+        uint32_t flushed;
+        char    *err_str;
+        bool     report_queues = false;
 
-        pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
         interface_opts = &g_array_index(capture_opts->ifaces, interface_options, i);
-        received = pcap_src->received;
-        if (pcap_src->pcap_h != NULL) {
-            ws_assert(!pcap_src->from_cap_pipe);
-            /* Get the capture statistics, so we know how many packets were dropped. */
-            if (pcap_stats(pcap_src->pcap_h, stats) >= 0) {
-                *stats_known = true;
-                /* Let the parent process know. */
-                pcap_dropped += stats->ps_drop;
-            } else {
-                snprintf(errmsg, sizeof(errmsg),
-                           "Can't get packet-drop statistics: %s",
-                           pcap_geterr(pcap_src->pcap_h));
-                report_capture_error(errmsg, please_report_bug());
-            }
+#ifdef PACKET_FANOUT
+        /* A capture parent only knows about interfaces. */
+        report_queues = fanout_queues > 1 && !capture_child;
+#endif
+        /* Get the capture statistics, so we know how many packets were dropped. */
+        if (capture_loop_get_interface_stats(i, interface_opts->display_name,
+                                             report_queues, stats, &received,
+                                             &dropped, &flushed, &err_str)) {
+            *stats_known = true;
+        } else if (err_str != NULL) {
+            snprintf(errmsg, sizeof(errmsg),
+                       "Can't get packet-drop statistics: %s",
+                       err_str);
+            report_capture_error(errmsg, please_report_bug());
         }
-        report_packet_drops(received, pcap_dropped, pcap_src->dropped, pcap_src->flushed, stats->ps_ifdrop, interface_opts->display_name);
+        /* Let the parent process know. */
+        report_packet_drops(received, stats->ps_drop, dropped, flushed, stats->ps_ifdrop, interface_opts->display_name);
     }
 
     /* close the input file (pcap or capture pipe) */
@@ -4630,7 +5966,9 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
     return write_ok && close_ok;
 
 error:
-    if (capture_opts->multi_files_on) {
+    if (fanout_files) {
+        capture_loop_discard_shards();
+    } else if (capture_opts->multi_files_on) {
         /* cleanup ringbuffer */
         ringbuf_error_cleanup();
     } else {
@@ -4646,6 +5984,8 @@ error:
             ws_unlink(capture_opts->save_file);
         }
     }
+    flow_index_free(capture_flow_index);
+    capture_flow_index = NULL;
     if (cfilter_error)
         report_cfilter_error(capture_opts, error_index, errmsg);
     else
@@ -4886,6 +6226,13 @@ capture_loop_write_packet_cb(uint8_t *pcap_src_p, const struct pcap_pkthdr *phdr
         } else {
             ws_debug("Wrote a pcap packet of length %d captured on interface %u.",
                    phdr->caplen, pcap_src->interface_id);
+            if (capture_flow_index != NULL) {
+                flow_index_add_packet(capture_flow_index, pcap_src->linktype,
+                                      (uint64_t)phdr->ts.tv_sec * 1000000000 +
+                                      (uint64_t)phdr->ts.tv_usec * (pcap_src->ts_nsec ? 1 : 1000),
+                                      phdr->caplen, phdr->len, pd,
+                                      (uint32_t)global_ld.packets_written + 1);
+            }
             capture_loop_wrote_one_packet(pcap_src);
         }
     }
@@ -4897,8 +6244,7 @@ capture_loop_queue_packet_cb(uint8_t *pcap_src_p, const struct pcap_pkthdr *phdr
                              const uint8_t *pd)
 {
     capture_src        *pcap_src = (capture_src *) (void *) pcap_src_p;
-    pcap_queue_element *queue_element;
-    bool                limit_reached;
+    capture_queue_slot *slot;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4908,54 +6254,22 @@ capture_loop_queue_packet_cb(uint8_t *pcap_src_p, const struct pcap_pkthdr *phdr
         return;
     }
 
-    queue_element = g_new(pcap_queue_element, 1);
-    if (queue_element == NULL) {
-       pcap_src->dropped++;
-       return;
-    }
-    queue_element->pcap_src = pcap_src;
-    queue_element->u.phdr = *phdr;
-    queue_element->pd = (uint8_t *)g_malloc(phdr->caplen);
-    if (queue_element->pd == NULL) {
-        pcap_src->dropped++;
-        g_free(queue_element);
+    slot = capture_queue_reserve(pcap_src, phdr->caplen);
+    if (slot == NULL) {
         return;
     }
-    memcpy(queue_element->pd, pd, phdr->caplen);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = false;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += phdr->caplen;
-        pcap_queue_packets += 1;
-    } else {
-        limit_reached = true;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
-        pcap_src->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
-        ws_info("Dropped a packet of length %d captured on interface %u.",
-              phdr->caplen, pcap_src->interface_id);
-    } else {
-        pcap_src->received++;
-        ws_info("Queued a packet of length %d captured on interface %u.",
-              phdr->caplen, pcap_src->interface_id);
-    }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    ws_info("Queue size is now %" PRId64 " bytes (%" PRId64 " packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+    slot->u.phdr = *phdr;
+    slot->ts = (uint64_t)phdr->ts.tv_sec * 1000000000 +
+               (uint64_t)phdr->ts.tv_usec * (pcap_src->ts_nsec ? 1 : 1000);
+    memcpy(capture_queue_slot_data(pcap_src->queue, slot), pd, phdr->caplen);
+    capture_queue_commit(pcap_src, slot);
 }
 
 /* one pcapng block was captured, queue it */
 static void
 capture_loop_queue_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t *bh, uint8_t *pd)
 {
-    pcap_queue_element *queue_element;
-    bool                limit_reached;
+    capture_queue_slot *slot;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4965,46 +6279,89 @@ capture_loop_queue_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t
         return;
     }
 
-    queue_element = g_new(pcap_queue_element, 1);
-    if (queue_element == NULL) {
-       pcap_src->dropped++;
-       return;
+    slot = capture_queue_reserve(pcap_src, bh->block_total_length);
+    if (slot == NULL) {
+        return;
     }
-    queue_element->pcap_src = pcap_src;
-    queue_element->u.bh = *bh;
-    queue_element->pd = (uint8_t *)g_malloc(bh->block_total_length);
-    if (queue_element->pd == NULL) {
-        pcap_src->dropped++;
-        g_free(queue_element);
+    slot->u.bh = *bh;
+    /* Blocks are merged with the other sources' packets in the order
+       they arrived; their own time stamps depend on the interface's
+       time stamp resolution, if they have one at all. */
+    slot->ts = (uint64_t)g_get_real_time() * 1000;
+    memcpy(capture_queue_slot_data(pcap_src->queue, slot), pd, bh->block_total_length);
+    capture_queue_commit(pcap_src, slot);
+}
+
+/* one packet was captured with --fanout-files; write it to the source's
+   own file (called in the source's thread) */
+static void
+capture_loop_write_shard_packet_cb(uint8_t *pcap_src_p, const struct pcap_pkthdr *phdr,
+                                   const uint8_t *pd)
+{
+    capture_src   *pcap_src = (capture_src *) (void *) pcap_src_p;
+    capture_shard *shard = pcap_src->shard;
+    bool           successful;
+    int            err;
+
+    /* We may be called multiple times from pcap_dispatch(); if we've set
+       the "stop capturing" flag, ignore this packet, as we're not
+       supposed to be saving any more packets. */
+    if (!global_ld.go) {
+        pcap_src->flushed++;
         return;
     }
-    memcpy(queue_element->pd, pd, bh->block_total_length);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = false;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += bh->block_total_length;
-        pcap_queue_packets += 1;
+    /* check -c NUM and -a packets:NUM, over all the threads */
+    if (shard_packet_limit > 0) {
+        int total = g_atomic_int_add(&shard_packets_total, 1);
+
+        if (total >= shard_packet_limit) {
+            pcap_src->flushed++;
+            global_ld.go = false;
+            return;
+        }
+        if (total + 1 == shard_packet_limit) {
+            global_ld.go = false;
+        }
+    }
+
+    /* check -b filesize, duration and packets and -a filesize for this
+       source's file */
+    if (capture_loop_shard_file_full(&global_capture_opts, shard)) {
+        if (!global_capture_opts.multi_files_on ||
+            (global_capture_opts.has_autostop_files &&
+             shard->file_num >= (unsigned)global_capture_opts.autostop_files) ||
+            !capture_loop_switch_shard_file(&global_capture_opts, pcap_src)) {
+            pcap_src->flushed++;
+            global_ld.go = false;
+            return;
+        }
+    }
+
+    if (global_capture_opts.use_pcapng) {
+        successful = pcapng_write_enhanced_packet_block(shard->pdh,
+                                                        NULL,
+                                                        phdr->ts.tv_sec, (int32_t)phdr->ts.tv_usec,
+                                                        phdr->caplen, phdr->len,
+                                                        0,
+                                                        pcap_src->ts_nsec ? 1000000000 : 1000000,
+                                                        pd, 0,
+                                                        &shard->bytes_written, &err);
     } else {
-        limit_reached = true;
+        successful = libpcap_write_packet(shard->pdh,
+                                          phdr->ts.tv_sec, (int32_t)phdr->ts.tv_usec,
+                                          phdr->caplen, phdr->len,
+                                          pd,
+                                          &shard->bytes_written, &err);
     }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
+    if (!successful) {
+        shard->err = err;
         pcap_src->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
-        ws_info("Dropped a packet of length %d captured on interface %u.",
-              bh->block_total_length, pcap_src->interface_id);
-    } else {
-        pcap_src->received++;
-        ws_info("Queued a block of type 0x%08x of length %d captured on interface %u.",
-              bh->block_type, bh->block_total_length, pcap_src->interface_id);
+        global_ld.go = false;
+        return;
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    ws_info("Queue size is now %" PRId64 " bytes (%" PRId64 " packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+    pcap_src->received++;
+    shard->file_packets++;
+    g_atomic_int_inc(&shard->packets_written);
 }
 
 static int
@@ -5096,6 +6453,14 @@ gather_dumpcap_runtime_info(feature_list l)
 #ifdef _WIN32
 #define LONGOPT_SIGNAL_PIPE         LONGOPT_BASE_APPLICATION+5
 #endif
+#define LONGOPT_DISPATCH_BATCH      LONGOPT_BASE_APPLICATION+6
+#define LONGOPT_DISPATCH_BUDGET     LONGOPT_BASE_APPLICATION+7
+#define LONGOPT_DISPATCH_STATS      LONGOPT_BASE_APPLICATION+8
+#define LONGOPT_FANOUT              LONGOPT_BASE_APPLICATION+9
+#define LONGOPT_PREALLOCATE         LONGOPT_BASE_APPLICATION+10
+#define LONGOPT_FLOW_INDEX          LONGOPT_BASE_APPLICATION+11
+#define LONGOPT_SERVICE             LONGOPT_BASE_APPLICATION+12
+#define LONGOPT_FANOUT_FILES        LONGOPT_BASE_APPLICATION+13
 
 /* And now our feature presentation... [ fade to music ] */
 int
@@ -5112,6 +6477,16 @@ main(int argc, char *argv[])
         {"ifdescr", ws_required_argument, NULL, LONGOPT_IFDESCR},
         {"capture-comment", ws_required_argument, NULL, LONGOPT_CAPTURE_COMMENT},
         {"application-flavor", ws_required_argument, NULL, LONGOPT_APPLICATION_FLAVOR},
+        {"dispatch-batch", ws_required_argument, NULL, LONGOPT_DISPATCH_BATCH},
+        {"dispatch-budget", ws_required_argument, NULL, LONGOPT_DISPATCH_BUDGET},
+        {"dispatch-stats", ws_no_argument, NULL, LONGOPT_DISPATCH_STATS},
+#ifdef PACKET_FANOUT
+        {"fanout", ws_required_argument, NULL, LONGOPT_FANOUT},
+        {"fanout-files", ws_no_argument, NULL, LONGOPT_FANOUT_FILES},
+#endif
+        {"preallocate", ws_no_argument, NULL, LONGOPT_PREALLOCATE},
+        {"flow-index", ws_no_argument, NULL, LONGOPT_FLOW_INDEX},
+        {"service", ws_no_argument, NULL, LONGOPT_SERVICE},
 #ifdef _WIN32
         {"signal-pipe", ws_required_argument, NULL, LONGOPT_SIGNAL_PIPE},
 #endif
@@ -5645,6 +7020,46 @@ main(int argc, char *argv[])
             if (!get_positive_int64(ws_optarg, "packet_limit", &pcap_queue_packet_limit))
                 arg_error = true;
             break;
+        case LONGOPT_DISPATCH_BATCH:
+            if (!get_positive_int(ws_optarg, "dispatch batch size", &dispatch_batch_size))
+                arg_error = true;
+            break;
+        case LONGOPT_DISPATCH_BUDGET:
+            if (!get_positive_int(ws_optarg, "dispatch budget", &dispatch_budget))
+                arg_error = true;
+            break;
+        case LONGOPT_DISPATCH_STATS:
+            dispatch_stats = true;
+            break;
+        case LONGOPT_PREALLOCATE:
+            if (!ringbuf_can_preallocate()) {
+                cmdarg_err("--preallocate isn't supported on this platform");
+                arg_error = true;
+            }
+            preallocate_files = true;
+            break;
+        case LONGOPT_FLOW_INDEX:
+            flow_index_on = true;
+            break;
+        case LONGOPT_SERVICE:
+            interface_service = true;
+            break;
+#ifdef PACKET_FANOUT
+        case LONGOPT_FANOUT:
+            if (!get_positive_int(ws_optarg, "number of fanout queues", &fanout_queues)) {
+                arg_error = true;
+            } else if (fanout_queues > 256) {
+                /* The most members a fanout group can have on older kernels */
+                cmdarg_err("The number of fanout queues may not be more than 256");
+                arg_error = true;
+            } else if (fanout_queues > 1) {
+                use_threads = true;
+            }
+            break;
+        case LONGOPT_FANOUT_FILES:
+            fanout_files = true;
+            break;
+#endif
         default:
             /* wslog arguments are okay */
             if (ws_log_is_wslog_arg(opt))
@@ -5712,6 +7127,12 @@ main(int argc, char *argv[])
         return WS_EXIT_INVALID_OPTION;
     }
 
+    if (interface_service && (!list_interfaces || !print_statistics || !machine_readable)) {
+        cmdarg_err("--service requires -D, -S and -M.");
+        exit_main();
+        return WS_EXIT_INVALID_OPTION;
+    }
+
     if (run_once_args > 1) {
         cmdarg_err("Only one of -D, -L, -d, -k or -S may be supplied.");
         exit_main();
@@ -5768,6 +7189,32 @@ main(int argc, char *argv[])
                 return WS_EXIT_INVALID_OPTION;
             }
         }
+
+#ifdef PACKET_FANOUT
+        /* Each capture thread writes files of its own, named after the
+           -w file, and switches them itself; nothing else knows about
+           those files. */
+        if (fanout_files) {
+            const char *fanout_files_err = NULL;
+
+            if (fanout_queues <= 1) {
+                fanout_files_err = "--fanout-files requires --fanout with more than one handle.";
+            } else if (global_capture_opts.save_file == NULL || global_capture_opts.output_to_pipe) {
+                fanout_files_err = "--fanout-files requires -w with the name of a file.";
+            } else if (capture_child) {
+                fanout_files_err = "--fanout-files can't be used by a capture parent.";
+            } else if (global_capture_opts.has_file_interval || global_capture_opts.print_name_to != NULL) {
+                fanout_files_err = "--fanout-files can't be used with -b interval or -b printname.";
+            } else if (flow_index_on) {
+                fanout_files_err = "--fanout-files can't be used with --flow-index.";
+            }
+            if (fanout_files_err != NULL) {
+                cmdarg_err("%s", fanout_files_err);
+                exit_main();
+                return WS_EXIT_INVALID_OPTION;
+            }
+        }
+#endif
     }
 
     /*
@@ -5807,7 +7254,9 @@ main(int argc, char *argv[])
             capture_opts_print_interfaces(if_list);
         }
 
-        if (caps_queries) {
+        if (caps_queries && machine_readable) {
+            get_if_list_capabilities(if_list);
+        } else if (caps_queries) {
             if_info_t *if_info;
             interface_options *interface_opts;
             cap_device_open_status open_status;
@@ -5825,37 +7274,28 @@ main(int argc, char *argv[])
 
                 if_info->caps = get_if_capabilities(interface_opts, &open_status, &open_status_str);
 
-                if (!machine_readable) {
-                    if (if_info->caps == NULL) {
-                        cmdarg_err("The capabilities of the capture device "
-                                    "\"%s\" could not be obtained (%s).\n%s",
-                                    interface_opts->name, open_status_str,
-                                    get_pcap_failure_secondary_error_message(open_status, open_status_str));
-                        g_free(open_status_str);
-                        /* Break after one error, as when printing selected
-                         * interface capabilities. (XXX: We could print all
-                         * the primary status strings, and only the unique
-                         * set of secondary messages / suggestions; printing
-                         * the same long secondary error is a lot.)
-                         */
+                if (if_info->caps == NULL) {
+                    cmdarg_err("The capabilities of the capture device "
+                                "\"%s\" could not be obtained (%s).\n%s",
+                                interface_opts->name, open_status_str,
+                                get_pcap_failure_secondary_error_message(open_status, open_status_str));
+                    g_free(open_status_str);
+                    /* Break after one error, as when printing selected
+                     * interface capabilities. (XXX: We could print all
+                     * the primary status strings, and only the unique
+                     * set of secondary messages / suggestions; printing
+                     * the same long secondary error is a lot.)
+                     */
+                    interface_opts_free(interface_opts);
+                    g_free(interface_opts);
+                    break;
+                } else {
+                    status = capture_opts_print_if_capabilities(if_info->caps, interface_opts, caps_queries);
+                    if (status != 0) {
                         interface_opts_free(interface_opts);
                         g_free(interface_opts);
                         break;
-                    } else {
-                        status = capture_opts_print_if_capabilities(if_info->caps, interface_opts, caps_queries);
-                        if (status != 0) {
-                            interface_opts_free(interface_opts);
-                            g_free(interface_opts);
-                            break;
-                        }
                     }
-                } else {
-                    if (if_info->caps == NULL) {
-                        if_info->caps = g_new0(if_capabilities_t, 1);
-                        if_info->caps->primary_msg = open_status_str;
-                        if_info->caps->secondary_msg = get_pcap_failure_secondary_error_message(open_status, open_status_str);
-                    }
-                    if_info->caps->status = open_status;
                 }
 
                 interface_opts_free(interface_opts);
@@ -5866,6 +7306,12 @@ main(int argc, char *argv[])
         if (machine_readable) {
             status = print_machine_readable_interfaces(if_list, caps_queries, print_statistics);
         }
+        if (interface_service && status == 0) {
+            /* The service keeps the list, and the capabilities in it. */
+            status = print_statistics_loop(machine_readable, if_list, caps_queries);
+            exit_main();
+            return status;
+        }
         free_interface_list(if_list);
         if (!print_statistics) {
             exit_main();
@@ -5878,7 +7324,7 @@ main(int argc, char *argv[])
      * for all interfaces.
      */
     if (print_statistics) {
-        status = print_statistics_loop(machine_readable);
+        status = print_statistics_loop(machine_readable, NULL, 0);
         exit_main();
         return status;
     }
@@ -67,6 +67,7 @@
 #include <wiretap/wtap_opttypes.h>
 
 #include "ui/failure_message.h"
+#include "capture/capture_file_filter.h"
 
 #include "ringbuffer.h" /* For RINGBUFFER_MAX_NUM_FILES */
 
@@ -160,6 +161,8 @@ static bool                   dup_detect_by_time;
 static bool                   skip_radiotap;
 static bool                   discard_all_secrets;
 static bool                   discard_name_resolution;
+static bool                   write_time_index;
+static char                  *capture_filter;
 static bool                   discard_cap_comments;
 static bool                   set_unused;
 static bool                   discard_pkt_comments;
@@ -1090,6 +1093,14 @@ print_usage(FILE *output)
     fprintf(output, "                         Time format for -A/-B/-R options is\n");
     fprintf(output, "                         YYYY-MM-DDThh:mm:ss[.nnnnnnnnn][Z|+-hh:mm]\n");
     fprintf(output, "                         Unix epoch timestamps are also supported.\n");
+    fprintf(output, "                         With -A, if the input file has a time index and\n");
+    fprintf(output, "                         no packet numbers are given, the packets before the\n");
+    fprintf(output, "                         start time are skipped without being read.\n");
+    fprintf(output, "  --write-time-index     after reading the input file, write a time index for\n");
+    fprintf(output, "                         it to <infile>%s, for later use with -A.\n", WTAP_TIME_INDEX_EXTENSION);
+    fprintf(output, "  --capture-filter <capture filter>\n");
+    fprintf(output, "                         only read packets that match the given capture\n");
+    fprintf(output, "                         filter, in libpcap filter syntax.\n");
     fprintf(output, "\n");
     fprintf(output, "Duplicate packet removal:\n");
     fprintf(output, "  --novlan               remove vlan info from packets before checking for duplicates.\n");
@@ -1565,6 +1576,8 @@ main(int argc, char *argv[])
 #define LONGOPT_COMPRESS                 LONGOPT_BASE_APPLICATION+12
 #define LONGOPT_SCTP_SPLIT               LONGOPT_BASE_APPLICATION+13
 #define LONGOPT_DISCARD_NAME_RESOLUTION  LONGOPT_BASE_APPLICATION+14
+#define LONGOPT_WRITE_TIME_INDEX         LONGOPT_BASE_APPLICATION+15
+#define LONGOPT_CAPTURE_FILTER           LONGOPT_BASE_APPLICATION+16
 
     static const struct ws_option long_options[] = {
         {"novlan", ws_no_argument, NULL, LONGOPT_NO_VLAN},
@@ -1583,6 +1596,8 @@ main(int argc, char *argv[])
         {"extract-secrets", ws_no_argument, NULL, LONGOPT_EXTRACT_SECRETS},
         {"compress", ws_required_argument, NULL, LONGOPT_COMPRESS},
         {"sctp-split", ws_no_argument, NULL, LONGOPT_SCTP_SPLIT},
+        {"write-time-index", ws_no_argument, NULL, LONGOPT_WRITE_TIME_INDEX},
+        {"capture-filter", ws_required_argument, NULL, LONGOPT_CAPTURE_FILTER},
         LONGOPT_WSLOG
         {0, 0, 0, 0 }
     };
@@ -1604,6 +1619,7 @@ main(int argc, char *argv[])
     uint64_t      written_count      = 0;
     char         *filename           = NULL;
     bool          ts_okay;
+    capture_file_filter *read_cfilter = NULL;
     nstime_t      secs_per_block     = NSTIME_INIT_UNSET;
     int           block_cnt          = 0;
     nstime_t      block_next         = NSTIME_INIT_UNSET;
@@ -1824,6 +1840,15 @@ main(int argc, char *argv[])
             sctp_split = true;
             break;
 
+        case LONGOPT_WRITE_TIME_INDEX:
+            write_time_index = true;
+            break;
+
+        case LONGOPT_CAPTURE_FILTER:
+            g_free(capture_filter);
+            capture_filter = g_strdup(ws_optarg);
+            break;
+
         case 'a':
         {
             uint64_t frame_number;
@@ -2226,6 +2251,23 @@ main(int argc, char *argv[])
                 wtap_file_type_subtype_description(wtap_file_type_subtype(wth)));
     }
 
+    if (capture_filter != NULL) {
+        char *err_msg = NULL;
+        int file_encap = wtap_file_encap(wth);
+
+        read_cfilter = capture_file_filter_new(capture_filter, true, &err_msg);
+        if (read_cfilter != NULL && file_encap != WTAP_ENCAP_PER_PACKET &&
+            file_encap != WTAP_ENCAP_UNKNOWN) {
+            capture_file_filter_compile(read_cfilter, file_encap, &err_msg);
+        }
+        if (err_msg != NULL) {
+            cmdarg_err("%s", err_msg);
+            g_free(err_msg);
+            ret = WS_EXIT_INVALID_FILTER;
+            goto clean_exit;
+        }
+    }
+
     if (skip_radiotap) {
         if (ignored_bytes != 0) {
             cmdarg_err("can't skip radiotap headers and %d byte(s)", ignored_bytes);
@@ -2393,6 +2435,21 @@ main(int argc, char *argv[])
     /* Set up an array of all IDBs seen */
     idbs_seen = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
 
+    /*
+     * If we only want packets from a given time on, and don't care
+     * about packet numbers, skip as much of the file before then as
+     * its time index, if it has one, lets us.
+     */
+    if (have_starttime && max_selected == 0 &&
+        frames_user_comments == NULL && frames_replace_timestamp == NULL &&
+        !write_time_index) {
+        if (!wtap_seek_to_time(wth, &starttime, NULL, &read_err, &read_err_info)) {
+            report_cfile_read_failure(argv[ws_optind], read_err, read_err_info);
+            ret = WS_EXIT_INVALID_FILE;
+            goto clean_exit;
+        }
+    }
+
     /* Read all of the packets in turn */
     wtap_rec_init(&read_rec, DEFAULT_INIT_BUFFER_SIZE_2048);
     while (wtap_read(wth, &read_rec, &read_err, &read_err_info, &data_offset)) {
@@ -2560,6 +2617,16 @@ main(int argc, char *argv[])
             ts_okay = true;
         }
 
+        /*
+         * Packets that don't match the capture filter aren't written;
+         * they keep their numbers, so that packet numbers still refer
+         * to the input file.
+         */
+        if (ts_okay && read_cfilter != NULL &&
+            !capture_file_filter_apply(read_cfilter, &read_rec)) {
+            ts_okay = false;
+        }
+
         if (ts_okay && ((!selected(count) && !keep_em)
                         || (selected(count) && keep_em))) {
             /* Write the record, possibly after modifying it. */
@@ -2862,6 +2929,18 @@ main(int argc, char *argv[])
         /* Print a message noting that the read failed somewhere along the
          * line. */
         report_cfile_read_failure(argv[ws_optind], read_err, read_err_info);
+    } else if (write_time_index) {
+        int index_err;
+
+        if (!wtap_write_time_index(wth, &index_err)) {
+            if (index_err != 0) {
+                cmdarg_err("The time index for \"%s\" could not be written: %s.",
+                           argv[ws_optind], g_strerror(index_err));
+            } else {
+                cmdarg_err("A time index can't be written for \"%s\".",
+                           argv[ws_optind]);
+            }
+        }
     }
 
     if (!pdh) {
@@ -2946,6 +3025,8 @@ clean_exit:
     wtap_dump_params_cleanup(&params);
     if (wth != NULL)
         wtap_close(wth);
+    capture_file_filter_free(read_cfilter);
+    g_free(capture_filter);
     wtap_rec_cleanup(&read_rec);
     wtap_cleanup();
     free_progdirs();
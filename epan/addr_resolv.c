@@ -89,6 +89,7 @@
 #include <wsutil/file_util.h>
 #include <wsutil/pint.h>
 #include <wsutil/inet_cidr.h>
+#include <wsutil/prefix_table.h>
 
 #include <epan/strutil.h>
 #include <epan/to_str.h>
@@ -110,45 +111,7 @@
 #define ENAME_TACS      "tacs"
 
 #define HASHETHSIZE      2048
-#define HASHHOSTSIZE     2048
 #define HASHIPXNETSIZE    256
-#define SUBNETLENGTHSIZE   32  /*1-32 inc.*/
-#define SUBNETLENGTHSIZE_V6 128 /*1-128 inc.*/
-
-/* hash table used for IPv4 lookup */
-
-#define HASH_IPV4_ADDRESS(addr) (g_htonl(addr) & (HASHHOSTSIZE - 1))
-
-
-typedef struct sub_net_hashipv4 {
-    unsigned          addr;
-    /* XXX: No longer needed?*/
-    uint8_t           flags;          /* B0 dummy_entry, B1 resolve, B2 If the address is used in the trace */
-    struct sub_net_hashipv4   *next;
-    char              name[MAXNAMELEN];
-} sub_net_hashipv4_t;
-
-/* Array of entries of subnets of different lengths */
-typedef struct {
-    size_t       mask_length;      /*1-32*/
-    uint32_t     mask;             /* e.g. 255.255.255.*/
-    sub_net_hashipv4_t** subnet_addresses; /* Hash table of subnet addresses */
-} subnet_length_entry_t;
-
-
-/* IPv6 subnet lookup structures */
-typedef struct sub_net_hashipv6 {
-    uint8_t                   addr[16];   /* masked network address */
-    uint8_t                   flags;
-    struct sub_net_hashipv6  *next;
-    char                      name[MAXNAMELEN];
-} sub_net_hashipv6_t;
-
-typedef struct {
-    size_t               mask_length;       /* 1-128 */
-    uint8_t              mask[16];          /* byte mask */
-    sub_net_hashipv6_t **subnet_addresses;  /* hash table */
-} subnet_length_entry_v6_t;
 
 typedef struct {
     uint8_t     mask[16];
@@ -232,6 +195,9 @@ typedef struct _vlan
 
 static wmem_allocator_t *addr_resolv_scope;
 
+/* How long addr_resolv_init() took to read each table */
+static addr_resolv_init_times init_times;
+
 // Maps unsigned -> hashipxnet_t*
 static wmem_map_t *ipxnet_hash_table;
 static wmem_map_t *ipv4_hash_table;
@@ -270,16 +236,23 @@ static wmem_map_t *serv_port_custom_hashtable;
 // Maps enterprise-id -> enterprise-desc (only used for user additions)
 static GHashTable *enterprises_hashtable;
 
-static subnet_length_entry_t subnet_length_entries[SUBNETLENGTHSIZE]; /* Ordered array of entries */
-static bool have_subnet_entry;
-
-static subnet_length_entry_v6_t subnet_length_entries_v6[SUBNETLENGTHSIZE_V6]; /* IPv6 subnet entries */
-static bool have_subnet_entry_v6;
+/* Subnet names, by IPv4 or IPv6 prefix */
+static ws_prefix_table *subnets_v4;
+static ws_prefix_table *subnets_v6;
 
 static bool new_resolved_objects;
 
 static GPtrArray* extra_hosts_files;
 
+/*
+ * Results of reverse lookups made with c-ares, persisted in dns_cache_path
+ * across runs. Maps address -> name in addr_resolv_scope, or "" if the
+ * resolver said the address has no name.
+ */
+static char *dns_cache_path;
+static wmem_map_t *dns_cache_ipv4;
+static wmem_map_t *dns_cache_ipv6;
+
 static hashether_t *add_eth_name(const uint8_t *addr, const char *name, bool static_entry);
 static hasheui64_t *add_eui64_name(const uint8_t *addr, const char *name, bool static_entry);
 static void add_serv_port_cb(const uint32_t port, void *ptr);
@@ -490,6 +463,40 @@ dnsserver_uat_fld_port_chk_cb(void* r _U_, const char* p, unsigned len _U_, cons
     return true;
 }
 
+/* Note a reverse lookup result in the DNS cache, if we have one. Errors
+ * other than "no name" (timeouts, etc.) aren't cached. */
+static void
+dns_cache_record(int family, const void *addr, int status, const struct hostent *he)
+{
+    const char *name;
+
+    if (status == ARES_SUCCESS && he->h_name != NULL) {
+        name = he->h_name;
+    } else if (status == ARES_ENOTFOUND || status == ARES_ENODATA) {
+        name = "";
+    } else {
+        return;
+    }
+
+    switch (family) {
+        case AF_INET:
+            if (dns_cache_ipv4) {
+                wmem_map_insert(dns_cache_ipv4, GUINT_TO_POINTER(*(const uint32_t *)addr),
+                        wmem_strdup(addr_resolv_scope, name));
+            }
+            break;
+        case AF_INET6:
+            if (dns_cache_ipv6) {
+                ws_in6_addr *addr_key = wmem_new(addr_resolv_scope, ws_in6_addr);
+                memcpy(addr_key, addr, sizeof(ws_in6_addr));
+                wmem_map_insert(dns_cache_ipv6, addr_key, wmem_strdup(addr_resolv_scope, name));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
 static void
 c_ares_ghba_sync_cb(void *arg, int status, int timeouts _U_, struct hostent *he) {
     sync_dns_data_t *sdd = (sync_dns_data_t *)arg;
@@ -511,6 +518,7 @@ c_ares_ghba_sync_cb(void *arg, int status, int timeouts _U_, struct hostent *he)
         }
 
     }
+    dns_cache_record(sdd->family, &sdd->addr, status, he);
 
     /*
      * Let our caller know that this is complete.
@@ -1349,6 +1357,7 @@ c_ares_ghba_cb(void *arg, int status, int timeouts _U_, struct hostent *he) {
             }
         }
     }
+    dns_cache_record(caqm->family, &caqm->addr, status, he);
     wmem_free(addr_resolv_scope, caqm);
 }
 
@@ -2976,6 +2985,164 @@ add_hosts_file (const char *hosts_file)
     return true;
 }
 
+/*
+ * The DNS cache file has one address per line, followed by its name, or
+ * by nothing if the address has no name. '#' starts a comment.
+ */
+static void
+read_dns_cache_file(const char *path)
+{
+    FILE *cf;
+    char line[MAX_LINELEN];
+    char *cp, *name;
+    union {
+        uint32_t ip4_addr;
+        ws_in6_addr ip6_addr;
+    } host_addr;
+
+    if ((cf = ws_fopen(path, "r")) == NULL) {
+        if (errno != ENOENT) {
+            report_open_failure(path, errno, false);
+        }
+        return;
+    }
+
+    while (fgetline(line, sizeof(line), cf) >= 0) {
+        if ((cp = strchr(line, '#')))
+            *cp = '\0';
+
+        if ((cp = strtok(line, " \t")) == NULL)
+            continue; /* no tokens in the line */
+
+        name = strtok(NULL, " \t");
+
+        if (ws_inet_pton6(cp, &host_addr.ip6_addr)) {
+            hashipv6_t *tp;
+            ws_in6_addr *addr_key;
+
+            if (name) {
+                add_ipv6_name(&host_addr.ip6_addr, name, false);
+            }
+            tp = (hashipv6_t *)wmem_map_lookup(ipv6_hash_table, &host_addr.ip6_addr);
+            if (!tp) {
+                addr_key = wmem_new(addr_resolv_scope, ws_in6_addr);
+                tp = new_ipv6(&host_addr.ip6_addr);
+                memcpy(addr_key, &host_addr.ip6_addr, 16);
+                fill_dummy_ip6(tp);
+                wmem_map_insert(ipv6_hash_table, addr_key, tp);
+            }
+            /* Don't look it up again, whether or not it has a name. */
+            tp->flags |= TRIED_RESOLVE_ADDRESS;
+
+            addr_key = wmem_new(addr_resolv_scope, ws_in6_addr);
+            memcpy(addr_key, &host_addr.ip6_addr, 16);
+            wmem_map_insert(dns_cache_ipv6, addr_key, wmem_strdup(addr_resolv_scope, name ? name : ""));
+        } else if (ws_inet_pton4(cp, &host_addr.ip4_addr)) {
+            hashipv4_t *tp;
+
+            if (name) {
+                add_ipv4_name(host_addr.ip4_addr, name, false);
+            }
+            tp = (hashipv4_t *)wmem_map_lookup(ipv4_hash_table, GUINT_TO_POINTER(host_addr.ip4_addr));
+            if (!tp) {
+                tp = new_ipv4(host_addr.ip4_addr);
+                fill_dummy_ip4(host_addr.ip4_addr, tp);
+                wmem_map_insert(ipv4_hash_table, GUINT_TO_POINTER(host_addr.ip4_addr), tp);
+            }
+            /* Don't look it up again, whether or not it has a name. */
+            tp->flags |= TRIED_RESOLVE_ADDRESS;
+
+            wmem_map_insert(dns_cache_ipv4, GUINT_TO_POINTER(host_addr.ip4_addr),
+                    wmem_strdup(addr_resolv_scope, name ? name : ""));
+        }
+    }
+
+    fclose(cf);
+}
+
+void
+set_dns_cache_file(const char *path)
+{
+    g_free(dns_cache_path);
+    dns_cache_path = g_strdup(path);
+}
+
+static void
+write_dns_cache_ipv4(void *key, void *value, void *user_data)
+{
+    uint32_t addr = GPOINTER_TO_UINT(key);
+    char addr_str[WS_INET_ADDRSTRLEN];
+
+    ws_inet_ntop4(&addr, addr_str, sizeof(addr_str));
+    fprintf((FILE *)user_data, "%s%s%s\n", addr_str, *(const char *)value ? " " : "", (const char *)value);
+}
+
+static void
+write_dns_cache_ipv6(void *key, void *value, void *user_data)
+{
+    char addr_str[WS_INET6_ADDRSTRLEN];
+
+    ws_inet_ntop6(key, addr_str, sizeof(addr_str));
+    fprintf((FILE *)user_data, "%s%s%s\n", addr_str, *(const char *)value ? " " : "", (const char *)value);
+}
+
+bool
+write_dns_cache_file(void)
+{
+    FILE *cf;
+    char *tmp_path;
+    bool ok;
+
+    if (!dns_cache_path || !dns_cache_ipv4 || !dns_cache_ipv6)
+        return true;
+
+    /* Write a new file and rename it over the old one, so that a run that
+     * fails or is interrupted doesn't lose the cache. */
+    tmp_path = ws_strdup_printf("%s.tmp", dns_cache_path);
+    if ((cf = ws_fopen(tmp_path, "w")) == NULL) {
+        g_free(tmp_path);
+        return false;
+    }
+
+    fputs("# Reverse DNS lookup results, as \"address [name]\". An address\n"
+          "# without a name was looked up and has none.\n", cf);
+    wmem_map_foreach(dns_cache_ipv4, write_dns_cache_ipv4, cf);
+    wmem_map_foreach(dns_cache_ipv6, write_dns_cache_ipv6, cf);
+
+    ok = !ferror(cf);
+    if (fclose(cf) != 0) {
+        ok = false;
+    }
+    if (ok && ws_rename(tmp_path, dns_cache_path) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        int err = errno;
+        ws_unlink(tmp_path);
+        errno = err;
+    }
+    g_free(tmp_path);
+    return ok;
+}
+
+void
+prefetch_hostname(const address *addr)
+{
+    if (!gbl_resolv_flags.network_name || !gbl_resolv_flags.use_external_net_name_resolver)
+        return;
+
+    /* host_lookup() and host_lookup6() queue a request if the address
+     * hasn't been tried yet. */
+    if (addr->type == AT_IPv4 && addr->len == 4) {
+        uint32_t ip4_addr;
+
+        memcpy(&ip4_addr, addr->data, 4);
+        host_lookup(ip4_addr);
+    } else if (addr->type == AT_IPv6 && addr->len == 16) {
+        host_lookup6((const ws_in6_addr *)addr->data);
+    }
+}
+
 bool
 add_ip_name_from_string (const char *addr, const char *name)
 {
@@ -3090,19 +3257,36 @@ get_addrinfo_list(void)
     return &addrinfo_lists;
 }
 
+/* Compute a 16-byte subnet mask from a prefix length (1-128). */
+static void
+ipv6_get_subnet_mask(uint32_t mask_length, uint8_t mask[16])
+{
+    uint32_t full_bytes = mask_length / 8;
+    uint32_t remaining  = mask_length % 8;
+    memset(mask, 0, 16);
+    for (uint32_t i = 0; i < full_bytes; i++)
+        mask[i] = 0xff;
+    if (remaining > 0 && full_bytes < 16)
+        mask[full_bytes] = (uint8_t)(0xff << (8 - remaining));
+}
+
+static void subnet6_entry_set(const ws_in6_addr *subnet_addr, const uint32_t mask_length,
+                              const char *name);
+
 /* Read in a list of subnet definition - name pairs.
  * <line> = <comment> | <entry> | <whitespace>
  * <comment> = <whitespace>#<any>
  * <entry> = <subnet_definition> <whitespace> <subnet_name> [<comment>|<whitespace><any>]
- * <subnet_definition> = <ipv4_address> / <subnet_mask_length>
+ * <subnet_definition> = <ipv4_address> / <subnet_mask_length> |
+ *                       <ipv6_address> / <prefix_length>
  * <ipv4_address> is a full address; it will be masked to get the subnet-ID.
- * <subnet_mask_length> is a decimal 1-31
+ * <subnet_mask_length> is a decimal 1-32
+ * <ipv6_address> is a full address, masked in the same way.
+ * <prefix_length> is a decimal 1-128
  * <subnet_name> is a string containing no whitespace.
  * <whitespace> = (space | tab)+
  * Any malformed entries are ignored.
  * Any trailing data after the subnet_name is ignored.
- *
- * XXX Support IPv6
  */
 static bool
 read_subnets_file (const char *subnetspath)
@@ -3110,8 +3294,10 @@ read_subnets_file (const char *subnetspath)
     FILE *hf;
     char line[MAX_LINELEN];
     char *cp, *cp2;
-    uint32_t host_addr; /* IPv4 ONLY */
+    uint32_t host_addr;
+    ws_in6_addr host_addr6;
     uint8_t mask_length;
+    bool is_ipv6;
 
     if ((hf = ws_fopen(subnetspath, "r")) == NULL)
         return false;
@@ -3124,7 +3310,7 @@ read_subnets_file (const char *subnetspath)
             continue; /* no tokens in the line */
 
 
-        /* Expected format is <IP4 address>/<subnet length> */
+        /* Expected format is <IP address>/<subnet length> */
         cp2 = strchr(cp, '/');
         if (NULL == cp2) {
             /* No length */
@@ -3133,19 +3319,26 @@ read_subnets_file (const char *subnetspath)
         *cp2 = '\0'; /* Cut token */
         ++cp2    ;
 
-        /* Check if this is a valid IPv4 address */
-        if (!str_to_ip(cp, &host_addr)) {
+        /* Check if this is a valid IPv4 or IPv6 address */
+        if (str_to_ip(cp, &host_addr)) {
+            is_ipv6 = false;
+        } else if (ws_inet_pton6(cp, &host_addr6)) {
+            is_ipv6 = true;
+        } else {
             continue; /* no */
         }
 
-        if (!ws_strtou8(cp2, NULL, &mask_length) || mask_length == 0 || mask_length > 32) {
+        if (!ws_strtou8(cp2, NULL, &mask_length) || mask_length == 0 || mask_length > (is_ipv6 ? 128 : 32)) {
             continue; /* invalid mask length */
         }
 
         if ((cp = strtok(NULL, " \t")) == NULL)
             continue; /* no subnet name */
 
-        subnet_entry_set(host_addr, mask_length, cp);
+        if (is_ipv6)
+            subnet6_entry_set(&host_addr6, mask_length, cp);
+        else
+            subnet_entry_set(host_addr, mask_length, cp);
     }
 
     fclose(hf);
@@ -3156,41 +3349,17 @@ static subnet_entry_t
 subnet_lookup(const uint32_t addr)
 {
     subnet_entry_t subnet_entry;
-    uint32_t i;
-
-    /* Search mask lengths linearly, longest first */
-
-    i = SUBNETLENGTHSIZE;
-    while(have_subnet_entry && i > 0) {
-        uint32_t masked_addr;
-        subnet_length_entry_t* length_entry;
+    unsigned mask_length;
+    const char *name = NULL;
 
-        /* Note that we run from 31 (length 32)  to 0 (length 1)  */
-        --i;
-        ws_assert(i < SUBNETLENGTHSIZE);
+    if (subnets_v4 != NULL)
+        name = (const char *)ws_prefix_table_lookup(subnets_v4, (const uint8_t *)&addr, &mask_length);
 
-
-        length_entry = &subnet_length_entries[i];
-
-        if (NULL != length_entry->subnet_addresses) {
-            sub_net_hashipv4_t * tp;
-            uint32_t hash_idx;
-
-            masked_addr = addr & length_entry->mask;
-            hash_idx = HASH_IPV4_ADDRESS(masked_addr);
-
-            tp = length_entry->subnet_addresses[hash_idx];
-            while(tp != NULL && tp->addr != masked_addr) {
-                tp = tp->next;
-            }
-
-            if (NULL != tp) {
-                subnet_entry.mask = length_entry->mask;
-                subnet_entry.mask_length = i + 1; /* Length is offset + 1 */
-                subnet_entry.name = tp->name;
-                return subnet_entry;
-            }
-        }
+    if (name != NULL) {
+        subnet_entry.mask = g_htonl(ws_ipv4_get_subnet_mask(mask_length));
+        subnet_entry.mask_length = mask_length;
+        subnet_entry.name = name;
+        return subnet_entry;
     }
 
     subnet_entry.mask = 0;
@@ -3202,64 +3371,25 @@ subnet_lookup(const uint32_t addr)
 
 /* Add a subnet-definition - name pair to the set.
  * The definition is taken by masking the address passed in with the mask of the
- * given length.
+ * given length. If the subnet is already in the set, the first name is kept.
  */
 static void
 subnet_entry_set(uint32_t subnet_addr, const uint8_t mask_length, const char* name)
 {
-    subnet_length_entry_t* entry;
-    sub_net_hashipv4_t * tp;
-    size_t hash_idx;
-
     ws_assert(mask_length > 0 && mask_length <= 32);
 
-    entry = &subnet_length_entries[mask_length - 1];
-
-    subnet_addr &= entry->mask;
-
-    hash_idx = HASH_IPV4_ADDRESS(subnet_addr);
-
-    if (NULL == entry->subnet_addresses) {
-        entry->subnet_addresses = (sub_net_hashipv4_t**)wmem_alloc0(addr_resolv_scope, sizeof(sub_net_hashipv4_t*) * HASHHOSTSIZE);
-    }
-
-    if (NULL != (tp = entry->subnet_addresses[hash_idx])) {
-        sub_net_hashipv4_t * new_tp;
-
-        while (tp->next) {
-            if (tp->addr == subnet_addr) {
-                return; /* XXX provide warning that an address was repeated? */
-            } else {
-                tp = tp->next;
-            }
-        }
-
-        new_tp = wmem_new(addr_resolv_scope, sub_net_hashipv4_t);
-        tp->next = new_tp;
-        tp = new_tp;
-    } else {
-        tp = entry->subnet_addresses[hash_idx] = wmem_new(addr_resolv_scope, sub_net_hashipv4_t);
-    }
-
-    tp->next = NULL;
-    tp->addr = subnet_addr;
-    (void) g_strlcpy(tp->name, name, MAXNAMELEN); /* This is longer than subnet names can actually be */
-    have_subnet_entry = true;
+    ws_prefix_table_insert(subnets_v4, (const uint8_t *)&subnet_addr, mask_length,
+                           wmem_strndup(addr_resolv_scope, name, MAXNAMELEN - 1));
 }
 
 static void
 subnet_name_lookup_init(const char* app_env_var_prefix)
 {
     char* subnetspath;
-    uint32_t i;
 
-    for(i = 0; i < SUBNETLENGTHSIZE; ++i) {
-        uint32_t length = i + 1;
-
-        subnet_length_entries[i].subnet_addresses  = NULL;
-        subnet_length_entries[i].mask_length  = length;
-        subnet_length_entries[i].mask = g_htonl(ws_ipv4_get_subnet_mask(length));
-    }
+    /* The subnets files can have IPv6 entries as well. */
+    subnets_v4 = ws_prefix_table_new(4);
+    subnets_v6 = ws_prefix_table_new(16);
 
     /* Check profile directory before personal configuration */
     subnetspath = get_persconffile_path(ENAME_SUBNETS, true, app_env_var_prefix);
@@ -3288,96 +3418,31 @@ subnet_name_lookup_init(const char* app_env_var_prefix)
 
 /* IPv6 Subnet Name Resolution */
 
-/* Compute a 16-byte subnet mask from a prefix length (1-128). */
-static void
-ipv6_get_subnet_mask(uint32_t mask_length, uint8_t mask[16])
-{
-    uint32_t full_bytes = mask_length / 8;
-    uint32_t remaining  = mask_length % 8;
-    memset(mask, 0, 16);
-    for (uint32_t i = 0; i < full_bytes; i++)
-        mask[i] = 0xff;
-    if (remaining > 0 && full_bytes < 16)
-        mask[full_bytes] = (uint8_t)(0xff << (8 - remaining));
-}
-
 static void
 subnet6_entry_set(const ws_in6_addr *subnet_addr, const uint32_t mask_length,
                   const char *name)
 {
-    subnet_length_entry_v6_t *entry;
-    sub_net_hashipv6_t *tp;
-    uint8_t masked[16];
-    size_t hash_idx;
-
     ws_assert(mask_length > 0 && mask_length <= 128);
-    entry = &subnet_length_entries_v6[mask_length - 1];
 
-    for (int i = 0; i < 16; i++)
-        masked[i] = subnet_addr->bytes[i] & entry->mask[i];
-
-    hash_idx = ipv6_oat_hash(masked) & (HASHHOSTSIZE - 1);
-
-    if (entry->subnet_addresses == NULL)
-        entry->subnet_addresses = (sub_net_hashipv6_t **)wmem_alloc0(
-            addr_resolv_scope, sizeof(sub_net_hashipv6_t *) * HASHHOSTSIZE);
-
-    if ((tp = entry->subnet_addresses[hash_idx]) != NULL) {
-        sub_net_hashipv6_t *new_tp;
-        while (tp->next) {
-            if (memcmp(tp->addr, masked, 16) == 0)
-                return; /* duplicate */
-            tp = tp->next;
-        }
-        if (memcmp(tp->addr, masked, 16) == 0)
-            return; /* duplicate at tail */
-        new_tp = wmem_new(addr_resolv_scope, sub_net_hashipv6_t);
-        tp->next = new_tp;
-        tp = new_tp;
-    } else {
-        tp = entry->subnet_addresses[hash_idx] =
-            wmem_new(addr_resolv_scope, sub_net_hashipv6_t);
-    }
-
-    tp->next = NULL;
-    memcpy(tp->addr, masked, 16);
-    (void)g_strlcpy(tp->name, name, MAXNAMELEN);
-    have_subnet_entry_v6 = true;
+    ws_prefix_table_insert(subnets_v6, subnet_addr->bytes, mask_length,
+                           wmem_strndup(addr_resolv_scope, name, MAXNAMELEN - 1));
 }
 
 static subnet_entry_v6_t
 subnet6_lookup(const ws_in6_addr *addr)
 {
     subnet_entry_v6_t result;
-    uint32_t i = SUBNETLENGTHSIZE_V6;
-
-    while (have_subnet_entry_v6 && i > 0) {
-        subnet_length_entry_v6_t *length_entry;
-        uint8_t masked[16];
-        size_t hash_idx;
-        sub_net_hashipv6_t *tp;
-
-        --i;
-        length_entry = &subnet_length_entries_v6[i];
-
-        if (length_entry->subnet_addresses == NULL)
-            continue;
-
-        for (int b = 0; b < 16; b++)
-            masked[b] = addr->bytes[b] & length_entry->mask[b];
-
-        hash_idx = ipv6_oat_hash(masked) & (HASHHOSTSIZE - 1);
-        tp = length_entry->subnet_addresses[hash_idx];
+    unsigned mask_length;
+    const char *name = NULL;
 
-        while (tp != NULL && memcmp(tp->addr, masked, 16) != 0)
-            tp = tp->next;
+    if (subnets_v6 != NULL)
+        name = (const char *)ws_prefix_table_lookup(subnets_v6, addr->bytes, &mask_length);
 
-        if (tp != NULL) {
-            memcpy(result.mask, length_entry->mask, 16);
-            result.mask_length = i + 1;
-            result.name = tp->name;
-            return result;
-        }
+    if (name != NULL) {
+        ipv6_get_subnet_mask(mask_length, result.mask);
+        result.mask_length = mask_length;
+        result.name = name;
+        return result;
     }
 
     memset(result.mask, 0, 16);
@@ -3386,6 +3451,7 @@ subnet6_lookup(const ws_in6_addr *addr)
     return result;
 }
 
+/* The subnetsipv6 files have only IPv6 entries; see read_subnets_file(). */
 static bool
 read_subnets_ipv6_file(const char *subnetspath)
 {
@@ -3433,12 +3499,6 @@ subnet6_name_lookup_init(const char *app_env_var_prefix)
 {
     char *subnetspath;
 
-    for (uint32_t i = 0; i < SUBNETLENGTHSIZE_V6; ++i) {
-        subnet_length_entries_v6[i].subnet_addresses = NULL;
-        subnet_length_entries_v6[i].mask_length = i + 1;
-        ipv6_get_subnet_mask((uint32_t)(i + 1), subnet_length_entries_v6[i].mask);
-    }
-
     /* Check profile directory before personal configuration */
     subnetspath = get_persconffile_path(ENAME_SUBNETS_V6, true, app_env_var_prefix);
     if (!read_subnets_ipv6_file(subnetspath)) {
@@ -3458,6 +3518,10 @@ subnet6_name_lookup_init(const char *app_env_var_prefix)
     if (!read_subnets_ipv6_file(subnetspath) && errno != ENOENT)
         report_open_failure(subnetspath, errno, false);
     g_free(subnetspath);
+
+    /* Both subnets files have been read; index them for lookups. */
+    ws_prefix_table_build(subnets_v4);
+    ws_prefix_table_build(subnets_v6);
 }
 
 /* SS7 PC Name Resolution Portion */
@@ -4085,6 +4149,12 @@ host_name_lookup_init(const char* app_env_var_prefix)
     subnet_name_lookup_init(app_env_var_prefix);
     subnet6_name_lookup_init(app_env_var_prefix);
 
+    if (dns_cache_path) {
+        dns_cache_ipv4 = wmem_map_new(addr_resolv_scope, g_direct_hash, g_direct_equal);
+        dns_cache_ipv6 = wmem_map_new(addr_resolv_scope, ipv6_oat_hash, ipv6_equal);
+        read_dns_cache_file(dns_cache_path);
+    }
+
     add_manually_resolved();
 
     ss7pc_name_lookup_init(app_env_var_prefix);
@@ -4093,47 +4163,19 @@ host_name_lookup_init(const char* app_env_var_prefix)
 static void
 host_name_lookup_cleanup(void)
 {
-    uint32_t i, j;
-    sub_net_hashipv4_t *entry, *next_entry;
-
     _host_name_lookup_cleanup();
 
     ipxnet_hash_table = NULL;
     ipv4_hash_table = NULL;
     ipv6_hash_table = NULL;
     ss7pc_hash_table = NULL;
+    dns_cache_ipv4 = NULL;
+    dns_cache_ipv6 = NULL;
 
-    for(i = 0; i < SUBNETLENGTHSIZE; ++i) {
-        if (subnet_length_entries[i].subnet_addresses != NULL) {
-            for (j = 0; j < HASHHOSTSIZE; j++) {
-                for (entry = subnet_length_entries[i].subnet_addresses[j];
-                     entry != NULL; entry = next_entry) {
-                    next_entry = entry->next;
-                    wmem_free(addr_resolv_scope, entry);
-                }
-            }
-            wmem_free(addr_resolv_scope, subnet_length_entries[i].subnet_addresses);
-            subnet_length_entries[i].subnet_addresses = NULL;
-        }
-    }
-
-    have_subnet_entry = false;
-
-    for(i = 0; i < SUBNETLENGTHSIZE_V6; ++i) {
-        sub_net_hashipv6_t *entry6, *next_entry6;
-        if (subnet_length_entries_v6[i].subnet_addresses != NULL) {
-            for (j = 0; j < HASHHOSTSIZE; j++) {
-                for (entry6 = subnet_length_entries_v6[i].subnet_addresses[j];
-                     entry6 != NULL; entry6 = next_entry6) {
-                    next_entry6 = entry6->next;
-                    wmem_free(addr_resolv_scope, entry6);
-                }
-            }
-            wmem_free(addr_resolv_scope, subnet_length_entries_v6[i].subnet_addresses);
-            subnet_length_entries_v6[i].subnet_addresses = NULL;
-        }
-    }
-    have_subnet_entry_v6 = false;
+    ws_prefix_table_free(subnets_v4);
+    subnets_v4 = NULL;
+    ws_prefix_table_free(subnets_v6);
+    subnets_v6 = NULL;
 
     new_resolved_objects = false;
 }
@@ -4610,15 +4652,31 @@ get_ipv6_hash_table(void)
 void
 addr_resolv_init(const char* app_env_var_prefix)
 {
+    int64_t start;
+
     ws_assert(addr_resolv_scope == NULL);
     addr_resolv_scope = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
-    initialize_services(app_env_var_prefix);
-    initialize_ethers(app_env_var_prefix);
-    initialize_ipxnets(app_env_var_prefix);
-    initialize_vlans(app_env_var_prefix);
-    initialize_enterprises(app_env_var_prefix);
-    host_name_lookup_init(app_env_var_prefix);
-    initialize_tacs(app_env_var_prefix);
+
+#define TIME_INIT(field, init) \
+    start = g_get_monotonic_time(); \
+    init; \
+    init_times.field = g_get_monotonic_time() - start
+
+    TIME_INIT(services, initialize_services(app_env_var_prefix));
+    TIME_INIT(ethers, initialize_ethers(app_env_var_prefix));
+    TIME_INIT(ipxnets, initialize_ipxnets(app_env_var_prefix));
+    TIME_INIT(vlans, initialize_vlans(app_env_var_prefix));
+    TIME_INIT(enterprises, initialize_enterprises(app_env_var_prefix));
+    TIME_INIT(hosts, host_name_lookup_init(app_env_var_prefix));
+    TIME_INIT(tacs, initialize_tacs(app_env_var_prefix));
+
+#undef TIME_INIT
+}
+
+const addr_resolv_init_times *
+addr_resolv_get_init_times(void)
+{
+    return &init_times;
 }
 
 /* Clean up all the address resolution subsystems in this file */
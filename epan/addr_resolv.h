@@ -709,6 +709,42 @@ WS_DLL_PUBLIC void add_ipv6_name(const ws_in6_addr *addr, const char *name, cons
  */
 WS_DLL_PUBLIC bool add_hosts_file(const char *hosts_file);
 
+/**
+ * @brief Sets a file in which to keep reverse DNS lookup results across runs.
+ *
+ * The file is read each time `host_name_lookup_init()` is called. Addresses
+ * in it are not looked up again, including those recorded as having no
+ * name. Names in hosts files take precedence over names in the cache.
+ * Results of lookups made with the external resolver are added to the
+ * cache, which `write_dns_cache_file()` saves.
+ *
+ * @param path Path of the cache file, or NULL to stop using one.
+ */
+WS_DLL_PUBLIC void set_dns_cache_file(const char *path);
+
+/**
+ * @brief Saves the reverse DNS lookup results to the file set with
+ * `set_dns_cache_file()`.
+ *
+ * @return true on success or if there is no cache file; false, with errno
+ * set, if the file couldn't be written.
+ */
+WS_DLL_PUBLIC bool write_dns_cache_file(void);
+
+/**
+ * @brief Queues a reverse lookup of an IPv4 or IPv6 address.
+ *
+ * Does nothing unless network name resolution with the external resolver
+ * is enabled, or if the address has already been looked up. The lookup is
+ * made asynchronously, up to the configured number of concurrent requests,
+ * as `host_name_lookup_process()` is called. Used in the first pass of
+ * two-pass analysis so that the names the second pass needs are resolved
+ * concurrently, rather than one at a time.
+ *
+ * @param addr The address; other address types are ignored.
+ */
+WS_DLL_PUBLIC void prefetch_hostname(const address *addr);
+
 /**
  * @brief Adds a hostname mapping for a given IP address string.
  *
@@ -915,6 +951,28 @@ void host_name_lookup_reset(const char* app_env_var_prefix);
 WS_DLL_LOCAL
 void addr_resolv_init(const char* app_env_var_prefix);
 
+/**
+ * @brief Time spent reading each name resolution table by addr_resolv_init(),
+ * in microseconds.
+ */
+typedef struct {
+    int64_t services;       /**< services file */
+    int64_t ethers;         /**< ethers, manuf and wka files */
+    int64_t ipxnets;        /**< ipxnets file */
+    int64_t vlans;          /**< vlans file */
+    int64_t enterprises;    /**< enterprises file */
+    int64_t hosts;          /**< hosts, subnets and DNS cache files */
+    int64_t tacs;           /**< tacs file */
+} addr_resolv_init_times;
+
+/**
+ * @brief Get the time addr_resolv_init() spent on each table.
+ *
+ * @return The times, which are all zero before addr_resolv_init() is called.
+ */
+WS_DLL_PUBLIC
+const addr_resolv_init_times *addr_resolv_get_init_times(void);
+
 /**
  * @brief Cleans up the address resolution subsystem.
  *
@@ -210,6 +210,47 @@ static wmem_map_t *conversation_hashtable_err_pkts = NULL;
 
 static uint32_t new_index;
 
+/*
+ * Incremented whenever a conversation is added to or removed from one of
+ * the hash tables, which may change what a lookup finds; results in the
+ * per-packet memo from before that aren't used.
+ */
+static uint64_t conversation_generation;
+
+/*
+ * Memo of the results of find_conversation_pinfo() for the current packet,
+ * hung off pinfo->conv_memo. Dissectors at several layers (IP, TCP, TLS,
+ * HTTP, ...) look up the same conversations for each packet; after the
+ * first time, the result comes from here instead of from up to five hash
+ * table lookups. Only lookups by pinfo's own addresses and ports, with
+ * addresses that fit in an entry, are memoized.
+ */
+#define CONV_MEMO_ENTRIES   4
+#define CONV_MEMO_ADDR_LEN  16
+
+typedef struct {
+    int          type;
+    int          len;
+    uint8_t      data[CONV_MEMO_ADDR_LEN];
+} conv_memo_addr;
+
+typedef struct {
+    conv_memo_addr  src;
+    conv_memo_addr  dst;
+    uint32_t        srcport;
+    uint32_t        destport;
+    port_type       ptype;
+    unsigned        options;
+    uint64_t        generation;
+    conversation_t *conv;
+} conv_memo_entry;
+
+struct conversation_pinfo_memo {
+    conv_memo_entry entries[CONV_MEMO_ENTRIES];
+    unsigned        count;      /* entries in use */
+    unsigned        next;       /* entry to replace next */
+};
+
 /*
  * Placeholder for address-less conversations.
  */
@@ -437,77 +478,89 @@ conversation_create_from_template(conversation_t *conversation, const address *a
 }
 
 /*
- * Compute the hash value for two given element lists if the match
- * is to be exact.
+ * Hashing a conversation key: the elements' values are packed into a
+ * buffer and hashed together with wmem_strong_hash() (XXH3, if we have
+ * it), rather than a byte at a time. Every address/port key, including
+ * an IPv6 5-tuple (16+4+16+4+4 bytes), fits in the buffer; longer keys,
+ * made of strings or blobs, are hashed a buffer at a time.
  */
-/* https://web.archive.org/web/20070615045827/http://eternallyconfuzzled.com/tuts/algorithms/jsw_tut_hashing.aspx#existing
- * (formerly at http://eternallyconfuzzled.com/tuts/algorithms/jsw_tut_hashing.aspx#existing)
- * One-at-a-Time hash
+#define CONV_HASH_BUF_LEN 64
+
+typedef struct {
+    uint8_t  buf[CONV_HASH_BUF_LEN];
+    size_t   len;
+    unsigned hash_val;
+} conv_hash_state;
+
+static void
+conv_hash_flush(conv_hash_state *state)
+{
+    state->hash_val = state->hash_val * 31 + wmem_strong_hash(state->buf, state->len);
+    state->len = 0;
+}
+
+static inline void
+conv_hash_add(conv_hash_state *state, const void *data, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+    if (state->len + len > CONV_HASH_BUF_LEN) {
+        conv_hash_flush(state);
+        if (len > CONV_HASH_BUF_LEN) {
+            state->hash_val = state->hash_val * 31 + wmem_strong_hash((const uint8_t *)data, len);
+            return;
+        }
+    }
+    memcpy(state->buf + state->len, data, len);
+    state->len += len;
+}
+
+/*
+ * Compute the hash value for an element list if the match
+ * is to be exact.
  */
 static unsigned
 conversation_hash_element_list(const void *v)
 {
     const conversation_element_t *element = (const conversation_element_t*)v;
-    unsigned hash_val = 0;
+    conv_hash_state state;
 
+    state.len = 0;
+    state.hash_val = 0;
     for (;;) {
-        // XXX We could use a hash_arbitrary_bytes routine. Abuse add_address_to_hash in the mean time.
-        address tmp_addr;
         switch (element->type) {
         case CE_ADDRESS:
-            hash_val = add_address_to_hash(hash_val, &element->addr_val);
+            conv_hash_add(&state, element->addr_val.data, element->addr_val.len);
             break;
         case CE_PORT:
-            tmp_addr.len = (int) sizeof(element->port_val);
-            tmp_addr.data = &element->port_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            conv_hash_add(&state, &element->port_val, sizeof(element->port_val));
             break;
         case CE_STRING:
-            tmp_addr.len = (int) strlen(element->str_val);
-            tmp_addr.data = element->str_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            conv_hash_add(&state, element->str_val, strlen(element->str_val));
             break;
         case CE_UINT:
-            tmp_addr.len = (int) sizeof(element->uint_val);
-            tmp_addr.data = &element->uint_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            conv_hash_add(&state, &element->uint_val, sizeof(element->uint_val));
             break;
         case CE_UINT64:
-            tmp_addr.len = (int) sizeof(element->uint64_val);
-            tmp_addr.data = &element->uint64_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            conv_hash_add(&state, &element->uint64_val, sizeof(element->uint64_val));
             break;
         case CE_INT:
-            tmp_addr.len = (int) sizeof(element->int_val);
-            tmp_addr.data = &element->int_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            conv_hash_add(&state, &element->int_val, sizeof(element->int_val));
             break;
         case CE_INT64:
-            tmp_addr.len = (int) sizeof(element->int64_val);
-            tmp_addr.data = &element->int64_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            conv_hash_add(&state, &element->int64_val, sizeof(element->int64_val));
             break;
         case CE_BLOB:
-            tmp_addr.len = (int) element->blob.len;
-            tmp_addr.data = element->blob.val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
+            conv_hash_add(&state, element->blob.val, element->blob.len);
             break;
         case CE_CONVERSATION_TYPE:
-            tmp_addr.len = (int) sizeof(element->conversation_type_val);
-            tmp_addr.data = &element->conversation_type_val;
-            hash_val = add_address_to_hash(hash_val, &tmp_addr);
-            goto done;
-            break;
+            conv_hash_add(&state, &element->conversation_type_val, sizeof(element->conversation_type_val));
+            conv_hash_flush(&state);
+            return state.hash_val;
         }
         element++;
     }
-
-done:
-    hash_val += ( hash_val << 3 );
-    hash_val ^= ( hash_val >> 11 );
-    hash_val += ( hash_val << 15 );
-
-    return hash_val;
 }
 
 /*
@@ -804,6 +857,7 @@ conversation_epan_reset(void)
      * Start the conversation indices over at 0.
      */
     new_index = 0;
+    conversation_generation++;
 }
 
 /*
@@ -817,6 +871,7 @@ conversation_insert_into_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 {
     conversation_t *chain_head, *chain_tail, *cur, *prev;
 
+    conversation_generation++;
     chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
 
     if (NULL==chain_head) {
@@ -874,6 +929,7 @@ conversation_remove_from_hashtable(wmem_map_t *hashtable, conversation_t *conv)
 {
     conversation_t *chain_head, *cur, *prev;
 
+    conversation_generation++;
     chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
 
     if (conv == chain_head) {
@@ -3014,6 +3070,86 @@ find_conversation_strat_xtd(const packet_info *pinfo, const uint32_t frame_num,
   return conv;
 }
 
+static inline bool
+conv_memo_addr_equal(const conv_memo_addr *memo_addr, const address *addr)
+{
+    return memo_addr->type == addr->type && memo_addr->len == addr->len &&
+        (addr->len == 0 || memcmp(memo_addr->data, addr->data, addr->len) == 0);
+}
+
+static inline void
+conv_memo_addr_set(conv_memo_addr *memo_addr, const address *addr)
+{
+    memo_addr->type = addr->type;
+    memo_addr->len = addr->len;
+    if (addr->len > 0) {
+        memcpy(memo_addr->data, addr->data, addr->len);
+    }
+}
+
+/*
+ * Look up pinfo's addresses and ports in the memo; returns true, and sets
+ * *conv (possibly to NULL), if find_conversation() has already been
+ * called with them for this packet since the hash tables last changed.
+ */
+static bool
+conv_memo_lookup(const packet_info *pinfo, const unsigned options, conversation_t **conv)
+{
+    struct conversation_pinfo_memo *memo = pinfo->conv_memo;
+
+    if (memo == NULL) {
+        return false;
+    }
+    for (unsigned i = 0; i < memo->count; i++) {
+        conv_memo_entry *entry = &memo->entries[i];
+
+        if (entry->generation == conversation_generation &&
+                entry->srcport == pinfo->srcport && entry->destport == pinfo->destport &&
+                entry->ptype == pinfo->ptype && entry->options == options &&
+                conv_memo_addr_equal(&entry->src, &pinfo->src) &&
+                conv_memo_addr_equal(&entry->dst, &pinfo->dst)) {
+            *conv = entry->conv;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void
+conv_memo_store(const packet_info *pinfo, const unsigned options, conversation_t *conv)
+{
+    struct conversation_pinfo_memo *memo = pinfo->conv_memo;
+    conv_memo_entry *entry;
+
+    if (pinfo->src.len > CONV_MEMO_ADDR_LEN || pinfo->dst.len > CONV_MEMO_ADDR_LEN) {
+        return;
+    }
+    if (memo == NULL) {
+        /*
+         * The memo is a cache rather than dissection state, so fill it
+         * in even though we were handed a const packet_info.
+         */
+        memo = wmem_new(pinfo->pool, struct conversation_pinfo_memo);
+        memo->count = 0;
+        memo->next = 0;
+        ((packet_info *)pinfo)->conv_memo = memo;
+    }
+    entry = &memo->entries[memo->next];
+    memo->next = (memo->next + 1) % CONV_MEMO_ENTRIES;
+    if (memo->count < CONV_MEMO_ENTRIES) {
+        memo->count++;
+    }
+
+    conv_memo_addr_set(&entry->src, &pinfo->src);
+    conv_memo_addr_set(&entry->dst, &pinfo->dst);
+    entry->srcport = pinfo->srcport;
+    entry->destport = pinfo->destport;
+    entry->ptype = pinfo->ptype;
+    entry->options = options;
+    entry->generation = conversation_generation;
+    entry->conv = conv;
+}
+
 /**  A helper function that calls find_conversation() using data from pinfo
  *  The frame number and addresses are taken from pinfo.
  */
@@ -3051,6 +3187,8 @@ find_conversation_pinfo(const packet_info *pinfo, const unsigned options)
                 conv->last_frame = pinfo->num;
             }
         }
+    } else if (conv_memo_lookup(pinfo, options, &conv)) {
+        DPRINT(("found memoized conversation for frame #%u", pinfo->num));
     } else {
         if ((conv = find_conversation(pinfo->num, &pinfo->src, &pinfo->dst,
                         conversation_pt_to_conversation_type(pinfo->ptype), pinfo->srcport,
@@ -3061,6 +3199,7 @@ find_conversation_pinfo(const packet_info *pinfo, const unsigned options)
                 conv->last_frame = pinfo->num;
             }
         }
+        conv_memo_store(pinfo, options, conv);
     }
 
     DENDENT();
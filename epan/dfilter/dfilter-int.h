@@ -59,6 +59,8 @@ struct epan_dfilter {
     GSList      *function_stack;         /**< Stack for function arguments. */
     GSList      *set_stack;              /**< Stack for set operations. */
     ftenum_t     ret_type;               /**< The return type of the display filter evaluation. */
+    dfilter_frame_range_t frame_range;   /**< Bounds on the frames the filter can match. */
+    bool        has_frame_range;         /**< true if frame_range has any bounds. */
 };
 
 /**
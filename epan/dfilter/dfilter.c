@@ -14,6 +14,8 @@
 
 #include "dfilter-int.h"
 #include "syntax-tree.h"
+#include "sttype-field.h"
+#include "sttype-op.h"
 #include "gencode.h"
 #include "semcheck.h"
 #include "dfvm.h"
@@ -468,11 +470,158 @@ dfwork_parse(const char *expanded_text, dfsyntax_t *dfs)
 	return dfs->error == NULL;
 }
 
+/*
+ * Narrows a frame range with a comparison of frame.number, frame.time
+ * or frame.len with a constant; anything else is left alone. The time
+ * bounds are only ever made inclusive, which is good enough for skipping.
+ */
+static void
+frame_range_add_test(dfilter_frame_range_t *range, stnode_t *node)
+{
+	stnode_op_t	op;
+	stnode_t	*left, *right, *field, *value;
+	header_field_info *hfinfo;
+	fvalue_t	*fv;
+	uint32_t	*min, *max;
+	uint32_t	val;
+
+	sttype_oper_get(node, &op, &left, &right);
+	if (left == NULL || right == NULL)
+		return;
+
+	if (stnode_type_id(left) == STTYPE_FIELD && stnode_type_id(right) == STTYPE_FVALUE) {
+		field = left;
+		value = right;
+	}
+	else if (stnode_type_id(left) == STTYPE_FVALUE && stnode_type_id(right) == STTYPE_FIELD) {
+		/* Turn "x < field" into "field > x". */
+		field = right;
+		value = left;
+		switch (op) {
+			case STNODE_OP_GT:	op = STNODE_OP_LT; break;
+			case STNODE_OP_GE:	op = STNODE_OP_LE; break;
+			case STNODE_OP_LT:	op = STNODE_OP_GT; break;
+			case STNODE_OP_LE:	op = STNODE_OP_GE; break;
+			default:		break;
+		}
+	}
+	else {
+		return;
+	}
+
+	if (sttype_field_drange(field) != NULL || sttype_field_raw(field) ||
+			sttype_field_value_string(field))
+		return;
+
+	hfinfo = sttype_field_hfinfo(field);
+	fv = stnode_data(value);
+
+	if (strcmp(hfinfo->abbrev, "frame.time") == 0 ||
+			strcmp(hfinfo->abbrev, "frame.time_utc") == 0 ||
+			strcmp(hfinfo->abbrev, "frame.time_epoch") == 0) {
+		const nstime_t *ts;
+
+		if (fvalue_type_ftenum(fv) != FT_ABSOLUTE_TIME)
+			return;
+		ts = fvalue_get_time(fv);
+		if (op == STNODE_OP_GT || op == STNODE_OP_GE ||
+				op == STNODE_OP_ANY_EQ || op == STNODE_OP_ALL_EQ) {
+			if (nstime_is_unset(&range->time_min) || nstime_cmp(ts, &range->time_min) > 0)
+				range->time_min = *ts;
+		}
+		if (op == STNODE_OP_LT || op == STNODE_OP_LE ||
+				op == STNODE_OP_ANY_EQ || op == STNODE_OP_ALL_EQ) {
+			if (nstime_is_unset(&range->time_max) || nstime_cmp(ts, &range->time_max) < 0)
+				range->time_max = *ts;
+		}
+		return;
+	}
+
+	if (strcmp(hfinfo->abbrev, "frame.number") == 0) {
+		min = &range->number_min;
+		max = &range->number_max;
+	}
+	else if (strcmp(hfinfo->abbrev, "frame.len") == 0) {
+		min = &range->len_min;
+		max = &range->len_max;
+	}
+	else {
+		return;
+	}
+	if (fvalue_type_ftenum(fv) != FT_UINT32)
+		return;
+
+	val = fvalue_get_uinteger(fv);
+
+	switch (op) {
+		case STNODE_OP_ANY_EQ:
+		case STNODE_OP_ALL_EQ:
+			*min = MAX(*min, val);
+			*max = MIN(*max, val);
+			break;
+		case STNODE_OP_GT:
+			if (val < UINT32_MAX)
+				val++;
+			/* FALLTHROUGH */
+		case STNODE_OP_GE:
+			*min = MAX(*min, val);
+			break;
+		case STNODE_OP_LT:
+			if (val > 0)
+				val--;
+			/* FALLTHROUGH */
+		case STNODE_OP_LE:
+			*max = MIN(*max, val);
+			break;
+		default:
+			break;
+	}
+}
+
+static void
+frame_range_add_node(dfilter_frame_range_t *range, stnode_t *node)
+{
+	stnode_op_t	op;
+	stnode_t	*left, *right;
+
+	if (node == NULL || stnode_type_id(node) != STTYPE_TEST)
+		return;
+
+	sttype_oper_get(node, &op, &left, &right);
+	if (op == STNODE_OP_AND) {
+		frame_range_add_node(range, left);
+		frame_range_add_node(range, right);
+	}
+	else {
+		/* Nothing under an "or" or a "not" must be true. */
+		frame_range_add_test(range, node);
+	}
+}
+
+static bool
+frame_range_build(dfilter_frame_range_t *range, stnode_t *root)
+{
+	range->number_min = 0;
+	range->number_max = UINT32_MAX;
+	nstime_set_unset(&range->time_min);
+	nstime_set_unset(&range->time_max);
+	range->len_min = 0;
+	range->len_max = UINT32_MAX;
+
+	frame_range_add_node(range, root);
+
+	return range->number_min != 0 || range->number_max != UINT32_MAX ||
+		!nstime_is_unset(&range->time_min) || !nstime_is_unset(&range->time_max) ||
+		range->len_min != 0 || range->len_max != UINT32_MAX;
+}
+
 static dfilter_t *
 dfwork_build(dfwork_t *dfw)
 {
 	dfilter_t	*dfilter;
 	char		*tree_str;
+	dfilter_frame_range_t frame_range;
+	bool		has_frame_range;
 
 	log_syntax_tree(LOG_LEVEL_NOISY, dfw->st_root, "Syntax tree before semantic check", NULL);
 
@@ -488,6 +637,10 @@ dfwork_build(dfwork_t *dfw)
 		tree_str = dump_syntax_tree_str(dfw->st_root);
 	}
 
+	/* Look for bounds on the frames, before code generation takes
+	 * the tree apart. */
+	has_frame_range = frame_range_build(&frame_range, dfw->st_root);
+
 	/* Create bytecode */
 	dfw_gencode(dfw);
 
@@ -506,6 +659,8 @@ dfwork_build(dfwork_t *dfw)
 	dfilter->warnings = dfw->warnings;
 	dfw->warnings = NULL;
 	dfilter->ret_type = dfw->ret_type;
+	dfilter->frame_range = frame_range;
+	dfilter->has_frame_range = has_frame_range;
 
 	if (dfw->flags & DF_SAVE_TREE) {
 		ws_assert(tree_str);
@@ -823,6 +978,36 @@ dfilter_get_return_type(dfilter_t *df)
 	return df->ret_type;
 }
 
+bool
+dfilter_get_frame_range(const dfilter_t *df, dfilter_frame_range_t *range)
+{
+	if (df == NULL || !df->has_frame_range)
+		return false;
+
+	*range = df->frame_range;
+	return true;
+}
+
+bool
+dfilter_frame_range_contains(const dfilter_frame_range_t *range,
+				uint32_t number, const nstime_t *ts, uint32_t len)
+{
+	if (number < range->number_min || number > range->number_max)
+		return false;
+	if (len < range->len_min || len > range->len_max)
+		return false;
+	if (!nstime_is_unset(&range->time_min) || !nstime_is_unset(&range->time_max)) {
+		/* Frames without a time stamp have no frame.time. */
+		if (ts == NULL)
+			return false;
+		if (!nstime_is_unset(&range->time_min) && nstime_cmp(ts, &range->time_min) < 0)
+			return false;
+		if (!nstime_is_unset(&range->time_max) && nstime_cmp(ts, &range->time_max) > 0)
+			return false;
+	}
+	return true;
+}
+
 void
 dfilter_log_full(const char *domain, enum ws_log_level level,
 			const char *file, long line, const char *func,
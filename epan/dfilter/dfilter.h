@@ -364,6 +364,52 @@ WS_DLL_PUBLIC
 ftenum_t
 dfilter_get_return_type(dfilter_t *df);
 
+/**
+ * @brief Bounds on the frame number, arrival time, and length of the
+ * frames a display filter can match. All bounds are inclusive.
+ */
+typedef struct {
+    uint32_t    number_min;     /**< Lowest frame number, 0 if no bound */
+    uint32_t    number_max;     /**< Highest frame number, UINT32_MAX if no bound */
+    nstime_t    time_min;       /**< Earliest arrival time, unset if no bound */
+    nstime_t    time_max;       /**< Latest arrival time, unset if no bound */
+    uint32_t    len_min;        /**< Shortest frame length, 0 if no bound */
+    uint32_t    len_max;        /**< Longest frame length, UINT32_MAX if no bound */
+} dfilter_frame_range_t;
+
+/**
+ * @brief Get the bounds a display filter puts on frame.number, frame.time
+ * (and frame.time_utc and frame.time_epoch) and frame.len.
+ *
+ * The bounds come from comparisons of those fields with constants that
+ * must all be true for the filter to match, i.e. that aren't under an
+ * "or" or a "not". A frame outside them can't match the filter, so it
+ * can be skipped without being dissected; a frame inside them may or may
+ * not match.
+ *
+ * @param df The display filter.
+ * @param range Set to the bounds.
+ * @return true if the filter has any bounds, false otherwise.
+ */
+WS_DLL_PUBLIC
+bool
+dfilter_get_frame_range(const dfilter_t *df, dfilter_frame_range_t *range);
+
+/**
+ * @brief Check whether a frame is inside the bounds from
+ * dfilter_get_frame_range().
+ *
+ * @param range The bounds.
+ * @param number The frame number.
+ * @param ts The frame's arrival time, or NULL if it doesn't have one.
+ * @param len The frame length.
+ * @return false if the frame can't match the filter, true if it may.
+ */
+WS_DLL_PUBLIC
+bool
+dfilter_frame_range_contains(const dfilter_frame_range_t *range,
+				uint32_t number, const nstime_t *ts, uint32_t len);
+
 /* Print bytecode of dfilter to log */
 /**
  * @brief Log a display filter with full details.
@@ -25,6 +25,7 @@
 #include <epan/prefs.h>
 #include <epan/to_str.h>
 #include <epan/sequence_analysis.h>
+#include <epan/stat_tap_ui.h>
 #include <epan/tap.h>
 #include <epan/proto_data.h>
 #include <epan/expert.h>
@@ -1390,8 +1391,127 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 	return tvb_captured_length(tvb);
 }
 
+/* The profile of each protocol's dissectors; see dissector_profile_t. */
+enum {
+	PROFILE_PROTOCOL_COLUMN,
+	PROFILE_CALLS_COLUMN,
+	PROFILE_INCLUSIVE_COLUMN,
+	PROFILE_EXCLUSIVE_COLUMN,
+	PROFILE_BYTES_COLUMN
+};
+
+static stat_tap_table_item dissector_profile_stat_fields[] = {
+	{TABLE_ITEM_STRING, TAP_ALIGN_LEFT,  "Protocol",            "%-20s"},
+	{TABLE_ITEM_UINT,   TAP_ALIGN_RIGHT, "Calls",               "%12u"},
+	{TABLE_ITEM_FLOAT,  TAP_ALIGN_RIGHT, "Inclusive Time (ms)", "%19.3f"},
+	{TABLE_ITEM_FLOAT,  TAP_ALIGN_RIGHT, "Exclusive Time (ms)", "%19.3f"},
+	{TABLE_ITEM_FLOAT,  TAP_ALIGN_RIGHT, "Bytes Allocated",     "%15.0f"}
+};
+
+typedef struct {
+	stat_tap_table *table;
+	unsigned        row;
+} dissector_profile_stat_t;
+
+static void
+dissector_profile_stat_reset(stat_tap_table *table)
+{
+	for (unsigned element = 0; element < table->num_elements; element++)
+		g_free(table->elements[element]);
+	g_free(table->elements);
+	table->elements = NULL;
+	table->num_elements = 0;
+
+	dissector_profile_reset();
+}
+
+static void
+dissector_profile_stat_init(stat_tap_table_ui *new_stat)
+{
+	const char *table_name = "Dissector Profile";
+	stat_tap_table *table;
+
+	table = stat_tap_find_table(new_stat, table_name);
+	if (table) {
+		if (new_stat->stat_tap_reset_table_cb)
+			new_stat->stat_tap_reset_table_cb(table);
+		return;
+	}
+
+	table = stat_tap_init_table(table_name, array_length(dissector_profile_stat_fields), 0, NULL);
+	stat_tap_add_table(new_stat, table);
+	dissector_profile_reset();
+}
+
+static void
+dissector_profile_stat_row(void *data, void *user_data)
+{
+	const dissector_profile_t *profile = (const dissector_profile_t *)data;
+	dissector_profile_stat_t *stat = (dissector_profile_stat_t *)user_data;
+	stat_tap_table_item_type items[array_length(dissector_profile_stat_fields)];
+
+	memset(items, 0, sizeof(items));
+	items[PROFILE_PROTOCOL_COLUMN].type = TABLE_ITEM_STRING;
+	items[PROFILE_PROTOCOL_COLUMN].value.string_value = proto_get_protocol_filter_name(profile->proto_id);
+	items[PROFILE_CALLS_COLUMN].type = TABLE_ITEM_UINT;
+	items[PROFILE_CALLS_COLUMN].value.uint_value = (unsigned)profile->calls;
+	items[PROFILE_INCLUSIVE_COLUMN].type = TABLE_ITEM_FLOAT;
+	items[PROFILE_INCLUSIVE_COLUMN].value.float_value = (double)profile->inclusive_ns / 1000000.0;
+	items[PROFILE_EXCLUSIVE_COLUMN].type = TABLE_ITEM_FLOAT;
+	items[PROFILE_EXCLUSIVE_COLUMN].value.float_value = (double)profile->exclusive_ns / 1000000.0;
+	items[PROFILE_BYTES_COLUMN].type = TABLE_ITEM_FLOAT;
+	items[PROFILE_BYTES_COLUMN].value.float_value = (double)profile->bytes_allocated;
+
+	stat_tap_init_table_row(stat->table, stat->row++, array_length(dissector_profile_stat_fields), items);
+}
+
+/*
+ * The profile is kept by the dissection engine; copy it after each
+ * record. Rows stay in the order in which protocols were first called.
+ */
+static tap_packet_status
+dissector_profile_stat_packet(void *tapdata, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *data _U_, tap_flags_t flags _U_)
+{
+	stat_data_t *stat_data = (stat_data_t *)tapdata;
+	dissector_profile_stat_t stat;
+
+	stat.table = g_array_index(stat_data->stat_tap_data->tables, stat_tap_table *, 0);
+	stat.row = 0;
+	dissector_profile_foreach(dissector_profile_stat_row, &stat);
+
+	return TAP_PACKET_REDRAW;
+}
+
+/* The profile covers every record, so a filter would only make it stale. */
+static void
+dissector_profile_stat_filter_check(const char *opt_arg _U_, const char **filter, char **err)
+{
+	if (*filter != NULL && **filter != '\0')
+		*err = g_strdup("The dissector profile can't be filtered.");
+}
+
 static void common_register_frame(bool use_packets)
 {
+	static tap_param dissector_profile_stat_params[] = {
+		{ PARAM_FILTER, "filter", "Filter", NULL, true }
+	};
+
+	static stat_tap_table_ui dissector_profile_stat_table = {
+		REGISTER_STAT_GROUP_GENERIC,
+		"Dissector Profile",
+		"dissector_profile",
+		"dissector_profile,stat",
+		dissector_profile_stat_init,
+		dissector_profile_stat_packet,
+		dissector_profile_stat_reset,
+		NULL,
+		dissector_profile_stat_filter_check,
+		array_length(dissector_profile_stat_fields), dissector_profile_stat_fields,
+		array_length(dissector_profile_stat_params), dissector_profile_stat_params,
+		NULL,
+		0
+	};
+
 	static hf_register_info hf[] = {
 		{ &hf_frame_arrival_time_local,
 		  { "Arrival Time", "frame.time",
@@ -1784,6 +1904,8 @@ static void common_register_frame(bool use_packets)
 	    10, &max_comment_lines);
 
 	frame_tap=register_tap("frame");
+
+	register_stat_tap_table_ui(&dissector_profile_stat_table);
 }
 
 void
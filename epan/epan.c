@@ -118,11 +118,25 @@ static GSList *epan_plugin_register_all_handoffs;
 static wmem_allocator_t *pinfo_pool_cache;
 static char* epan_env_prefix_cache;
 
+static epan_startup_times startup_times;
+
+/*
+ * Time a phase of startup into a field of startup_times. That's a static
+ * rather than a local so that it can be used inside TRY.
+ */
+#define TIME_STARTUP(field, phase) \
+	do { \
+		startup_times.field = g_get_monotonic_time(); \
+		phase; \
+		startup_times.field = g_get_monotonic_time() - startup_times.field; \
+	} while (0)
+
 /* Global variables holding the content of the corresponding environment variable
  * to save fetching it repeatedly.
  */
 bool wireshark_abort_on_dissector_bug;
 bool wireshark_abort_on_too_many_items;
+bool wireshark_skip_registration_checks;
 
 void
 ws_dissector_bug(const char *format, ...)
@@ -294,6 +308,7 @@ bool
 epan_init(register_cb cb, void *client_data, bool load_plugins, epan_app_data_t* app_data)
 {
 	volatile bool status = true;
+	int64_t init_start = g_get_monotonic_time();
 	epan_env_prefix_cache = g_strdup(app_data->env_var_prefix);
 
 	/* Get the value of some environment variables and set corresponding globals for performance reasons*/
@@ -312,6 +327,12 @@ epan_init(register_cb cb, void *client_data, bool load_plugins, epan_app_data_t*
 		wireshark_abort_on_too_many_items = false;
 	}
 
+	if (getenv("WIRESHARK_SKIP_REGISTRATION_CHECKS") != NULL) {
+		wireshark_skip_registration_checks = true;
+	} else {
+		wireshark_skip_registration_checks = false;
+	}
+
 	check_stack_limit();
 
 	/* initialize memory allocation subsystem */
@@ -326,7 +347,7 @@ epan_init(register_cb cb, void *client_data, bool load_plugins, epan_app_data_t*
 	guids_init();
 
 	/* initialize name resolution (addr_resolv.c) */
-	addr_resolv_init(epan_env_prefix_cache);
+	TIME_STARTUP(addr_resolv, addr_resolv_init(epan_env_prefix_cache));
 
 	except_init();
 
@@ -334,7 +355,7 @@ epan_init(register_cb cb, void *client_data, bool load_plugins, epan_app_data_t*
 
 	if (load_plugins) {
 #ifdef HAVE_PLUGINS
-		libwireshark_plugins = plugins_init(WS_PLUGIN_EPAN, epan_env_prefix_cache);
+		TIME_STARTUP(plugins, libwireshark_plugins = plugins_init(WS_PLUGIN_EPAN, epan_env_prefix_cache));
 #endif
 	}
 
@@ -392,21 +413,22 @@ epan_init(register_cb cb, void *client_data, bool load_plugins, epan_app_data_t*
 		stats_tree_init();
 		stat_tap_init();
 		g_slist_foreach(epan_plugins, epan_plugin_init, NULL);
-		proto_init(epan_plugin_register_all_procotols, epan_plugin_register_all_handoffs,
-			(app_data != NULL) ? app_data->register_func : NULL, (app_data != NULL) ? app_data->handoff_func : NULL, cb, client_data);
+		TIME_STARTUP(register_protocols,
+			proto_init(epan_plugin_register_all_procotols, epan_plugin_register_all_handoffs,
+				(app_data != NULL) ? app_data->register_func : NULL, (app_data != NULL) ? app_data->handoff_func : NULL, cb, client_data));
 		g_slist_foreach(epan_plugins, epan_plugin_register_all_tap_listeners, NULL);
 		packet_cache_proto_handles();
-		dfilter_init(epan_env_prefix_cache);
+		TIME_STARTUP(dfilter, dfilter_init(epan_env_prefix_cache));
 		wscbor_init();
 		final_registration_all_protocols();
 		print_cache_field_handles();
 		expert_packet_init();
 #ifdef HAVE_LUA
-		wslua_init(cb, client_data, epan_env_prefix_cache);
+		TIME_STARTUP(lua, wslua_init(cb, client_data, epan_env_prefix_cache));
 #endif
 		g_slist_foreach(epan_plugins, epan_plugin_post_init, NULL);
 		register_all_tap_listeners(app_data->tap_reg_listeners);
-		uat_load_all(epan_env_prefix_cache);
+		TIME_STARTUP(uats, uat_load_all(epan_env_prefix_cache));
 	}
 	CATCH(DissectorError) {
 		/*
@@ -427,6 +449,7 @@ epan_init(register_cb cb, void *client_data, bool load_plugins, epan_app_data_t*
 		status = false;
 	}
 	ENDTRY;
+	startup_times.init = g_get_monotonic_time() - init_start;
 	return status;
 }
 
@@ -437,21 +460,30 @@ e_prefs *
 epan_load_settings(void)
 {
 	e_prefs *prefs_p;
+	int64_t load_start = g_get_monotonic_time();
 
 	/* load the decode as entries of the current profile */
-	load_decode_as_entries(epan_env_prefix_cache);
+	TIME_STARTUP(decode_as, load_decode_as_entries(epan_env_prefix_cache));
 
-	prefs_p = read_prefs(epan_env_prefix_cache);
+	TIME_STARTUP(prefs, prefs_p = read_prefs(epan_env_prefix_cache));
 
 	/*
 	 * Read the files that enable and disable protocols and heuristic
 	 * dissectors.
 	 */
-	read_enabled_and_disabled_lists(epan_env_prefix_cache);
+	TIME_STARTUP(enabled_protos, read_enabled_and_disabled_lists(epan_env_prefix_cache));
+
+	startup_times.load_settings = g_get_monotonic_time() - load_start;
 
 	return prefs_p;
 }
 
+const epan_startup_times *
+epan_get_startup_times(void)
+{
+	return &startup_times;
+}
+
 void
 epan_cleanup(void)
 {
@@ -872,6 +904,40 @@ epan_dissect_prime_with_hfid_array(epan_dissect_t *edt, GArray *hfids)
 	}
 }
 
+bool
+epan_dissect_prune_to_primed_fields(epan_dissect_t *edt)
+{
+	GHashTable *interesting_hfids;
+	GArray *hfids;
+	GHashTableIter iter;
+	void *key;
+	bool pruned;
+
+	if (!edt->tree)
+		return false;
+
+	interesting_hfids = PTREE_DATA(edt->tree)->interesting_hfids;
+	if (interesting_hfids == NULL || g_hash_table_size(interesting_hfids) == 0)
+		return false;
+
+	hfids = g_array_sized_new(false, false, sizeof(int), g_hash_table_size(interesting_hfids));
+	g_hash_table_iter_init(&iter, interesting_hfids);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		int hfid = GPOINTER_TO_INT(key);
+		g_array_append_val(hfids, hfid);
+	}
+	pruned = dissector_prune_set_hfids((const int *)(void *)hfids->data, hfids->len);
+	g_array_free(hfids, true);
+
+	return pruned;
+}
+
+void
+epan_prune_clear(void)
+{
+	dissector_prune_clear();
+}
+
 /* ----------------------- */
 const char *
 epan_custom_set(epan_dissect_t *edt, GSList *field_ids,
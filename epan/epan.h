@@ -36,6 +36,16 @@ extern bool wireshark_abort_on_dissector_bug;
  */
 extern bool wireshark_abort_on_too_many_items;
 
+/**
+ * @brief Controls whether the sanity checks of built-in fields are skipped at startup.
+ *
+ * This global variable reflects the value of the corresponding environment variable,
+ * allowing Wireshark to avoid repeatedly querying the environment.
+ * If set to true, fields registered by built-in dissectors aren't checked for
+ * valid filter names, display bases and strings when they are registered.
+ */
+extern bool wireshark_skip_registration_checks;
+
 /**
  * @brief Report a dissector bug (and optionally abort).
  *
@@ -221,6 +231,33 @@ bool epan_init(register_cb cb, void *client_data, bool load_plugins, epan_app_da
 WS_DLL_PUBLIC
 e_prefs *epan_load_settings(void);
 
+/**
+ * @brief Time spent in the slower phases of epan_init() and
+ * epan_load_settings(), in microseconds.
+ */
+typedef struct {
+	int64_t init;			/**< All of epan_init() */
+	int64_t addr_resolv;		/**< Reading the name resolution files; see addr_resolv_get_init_times() */
+	int64_t plugins;		/**< Loading binary plugins */
+	int64_t register_protocols;	/**< Registering protocols and their handoffs */
+	int64_t dfilter;		/**< Initializing the display filter engine and reading the macros */
+	int64_t lua;			/**< Loading Lua plugins */
+	int64_t uats;			/**< Reading UAT files */
+	int64_t load_settings;		/**< All of epan_load_settings() */
+	int64_t decode_as;		/**< Reading the decode_as_entries file */
+	int64_t prefs;			/**< Reading the preferences files */
+	int64_t enabled_protos;		/**< Reading the enabled and disabled protocol lists */
+} epan_startup_times;
+
+/**
+ * @brief Get the time spent in the phases of epan_init() and
+ * epan_load_settings().
+ *
+ * @return The times; those of phases that haven't run yet are zero.
+ */
+WS_DLL_PUBLIC
+const epan_startup_times *epan_get_startup_times(void);
+
 /**
  * @brief Clean up the entire epan module.
  *
@@ -744,6 +781,32 @@ WS_DLL_PUBLIC
 void
 epan_dissect_prime_with_hfid_array(epan_dissect_t *edt, GArray *hfids);
 
+/**
+ * @brief Restrict subsequent dissections to the protocols needed for the
+ * fields primed in a dissection context.
+ *
+ * Collects every field and protocol that has been primed in `edt` (by
+ * output fields, display or read filters) and passes them to
+ * dissector_prune_set_hfids(), so that protocols which cannot produce any
+ * of them are not dissected. This affects all dissections until
+ * epan_prune_clear() is called.
+ *
+ * @param edt  A dissection context that has been primed but not yet run.
+ * @return true if pruning was enabled, false if full dissection is needed.
+ *
+ * @see dissector_prune_set_hfids()
+ */
+WS_DLL_PUBLIC
+bool
+epan_dissect_prune_to_primed_fields(epan_dissect_t *edt);
+
+/**
+ * @brief Turn off pruning enabled by epan_dissect_prune_to_primed_fields().
+ */
+WS_DLL_PUBLIC
+void
+epan_prune_clear(void);
+
 /**
  * @brief Populate packet list columns with dissection output.
  *
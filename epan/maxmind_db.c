@@ -42,6 +42,7 @@ static mmdb_lookup_t mmdb_not_found;
 #include <wsutil/ws_pipe.h>
 #include <wsutil/strtoi.h>
 #include <wsutil/glib-compat.h>
+#include <wsutil/pint.h>
 
 // To do:
 // - Add RBL lookups? Along with the "is this a spammer" information that most RBL databases
@@ -365,6 +366,559 @@ read_mmdbr_stdout_worker(void *data _U_) {
     return NULL;
 }
 
+/*
+ * In-process lookups.
+ *
+ * The databases are mapped into memory and read directly, following the
+ * MaxMind DB file format specification at
+ * https://maxmind.github.io/MaxMind-DB/. We don't link with libmaxminddb
+ * here; its license isn't compatible with ours, which is why mmdbresolve
+ * is a separate program.
+ */
+
+#define MMDB_METADATA_MARKER        "\xab\xcd\xefMaxMind.com"
+#define MMDB_METADATA_MARKER_LEN    (sizeof(MMDB_METADATA_MARKER) - 1)
+#define MMDB_METADATA_MAX_LEN       (128 * 1024)
+#define MMDB_DATA_SEPARATOR_LEN     16
+#define MMDB_MAX_DEPTH              32
+
+#define MMDB_TYPE_POINTER   1
+#define MMDB_TYPE_UTF8      2
+#define MMDB_TYPE_DOUBLE    3
+#define MMDB_TYPE_UINT16    5
+#define MMDB_TYPE_UINT32    6
+#define MMDB_TYPE_MAP       7
+#define MMDB_TYPE_INT32     8
+#define MMDB_TYPE_UINT64    9
+#define MMDB_TYPE_ARRAY     11
+#define MMDB_TYPE_BOOLEAN   14
+#define MMDB_TYPE_FLOAT     15
+
+/* A data or metadata section. */
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+} mmdb_section_t;
+
+/* A decoded field: its type, its size, and the offset of its payload
+ * (for maps and arrays, of the first item; for pointers, the target). */
+typedef struct {
+    unsigned type;
+    uint32_t size;
+    size_t offset;
+} mmdb_value_t;
+
+typedef struct {
+    char *path;
+    GMappedFile *mapped;
+    const uint8_t *tree;
+    uint32_t node_count;
+    unsigned record_size;       /* bits per record: 24, 28, or 32 */
+    unsigned node_len;          /* bytes per node */
+    unsigned ip_version;
+    uint32_t ipv4_node;         /* node for ::/96 in IPv6 databases */
+    mmdb_section_t data;
+} mmdb_file_t;
+
+static GPtrArray *mmdb_files; // mmdb_file_t *; NULL unless reading in-process
+static bool mmdb_in_process;
+
+/*
+ * Results of in-process lookups, in a set-associative cache. Each address
+ * hashes to a set of MMDB_CACHE_WAYS entries, and a miss replaces the
+ * least recently used entry of its set. A result returned by a lookup is
+ * therefore never replaced by the lookup that immediately follows it.
+ */
+#define MMDB_CACHE_SETS_LOG2    12
+#define MMDB_CACHE_SETS         (1U << MMDB_CACHE_SETS_LOG2)
+#define MMDB_CACHE_WAYS         4
+
+typedef struct {
+    uint8_t addr[16];
+    bool is_ipv4;
+    uint64_t last_used;         /* 0 if empty */
+    mmdb_lookup_t mmdb_val;
+} mmdb_cache_entry_t;
+
+static mmdb_cache_entry_t *mmdb_cache;
+static uint64_t mmdb_cache_clock;
+
+static const char *mmdb_co_iso_key[]     = {"country", "iso_code", NULL};
+static const char *mmdb_co_name_key[]    = {"country", "names", "en", NULL};
+static const char *mmdb_ci_name_key[]    = {"city", "names", "en", NULL};
+static const char *mmdb_asn_o_key[]      = {"autonomous_system_organization", NULL};
+static const char *mmdb_asn_key[]        = {"autonomous_system_number", NULL};
+static const char *mmdb_l_lat_key[]      = {"location", "latitude", NULL};
+static const char *mmdb_l_lon_key[]      = {"location", "longitude", NULL};
+static const char *mmdb_l_accuracy_key[] = {"location", "accuracy_radius", NULL};
+
+/* Decode the control byte(s) of the field at off. */
+static bool
+mmdb_decode(const mmdb_section_t *sec, size_t off, mmdb_value_t *val, size_t *next)
+{
+    static const uint32_t pointer_bias[] = { 0, 2048, 526336, 0 };
+    static const uint32_t size_bias[] = { 29, 285, 65821 };
+    uint8_t ctrl;
+    unsigned type;
+    uint32_t size;
+
+    if (off >= sec->len) {
+        return false;
+    }
+    ctrl = sec->buf[off++];
+    type = ctrl >> 5;
+
+    if (type == MMDB_TYPE_POINTER) {
+        unsigned ptr_len = ((ctrl >> 3) & 0x03) + 1;
+        uint32_t ptr = ptr_len == 4 ? 0 : ctrl & 0x07;
+
+        if (sec->len - off < ptr_len) {
+            return false;
+        }
+        for (unsigned i = 0; i < ptr_len; i++) {
+            ptr = (ptr << 8) | sec->buf[off++];
+        }
+        val->type = MMDB_TYPE_POINTER;
+        val->size = 0;
+        val->offset = (size_t)ptr + pointer_bias[ptr_len - 1];
+        *next = off;
+        return true;
+    }
+
+    if (type == 0) {
+        /* Extended type */
+        if (off >= sec->len) {
+            return false;
+        }
+        type = 7 + sec->buf[off++];
+    }
+
+    size = ctrl & 0x1f;
+    if (size >= 29) {
+        unsigned size_len = size - 28;
+        uint32_t extra = 0;
+
+        if (sec->len - off < size_len) {
+            return false;
+        }
+        for (unsigned i = 0; i < size_len; i++) {
+            extra = (extra << 8) | sec->buf[off++];
+        }
+        size = size_bias[size_len - 1] + extra;
+    }
+
+    val->type = type;
+    val->size = size;
+    val->offset = off;
+    if (type != MMDB_TYPE_MAP && type != MMDB_TYPE_ARRAY && type != MMDB_TYPE_BOOLEAN) {
+        if (sec->len - off < size) {
+            return false;
+        }
+        off += size;
+    }
+    *next = off;
+    return true;
+}
+
+/* Decode the field at off, following it if it's a pointer. */
+static bool
+mmdb_decode_deref(const mmdb_section_t *sec, size_t off, mmdb_value_t *val, size_t *next)
+{
+    size_t target_next;
+
+    if (!mmdb_decode(sec, off, val, next)) {
+        return false;
+    }
+    if (val->type == MMDB_TYPE_POINTER) {
+        /* Pointers to pointers aren't allowed. */
+        if (!mmdb_decode(sec, val->offset, val, &target_next) || val->type == MMDB_TYPE_POINTER) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Find the end of the field at off, without following pointers. */
+static bool
+mmdb_skip(const mmdb_section_t *sec, size_t off, size_t *next, unsigned depth)
+{
+    mmdb_value_t val;
+    uint64_t items;
+
+    if (depth > MMDB_MAX_DEPTH || !mmdb_decode(sec, off, &val, next)) {
+        return false;
+    }
+    if (val.type == MMDB_TYPE_MAP || val.type == MMDB_TYPE_ARRAY) {
+        items = val.type == MMDB_TYPE_MAP ? (uint64_t)val.size * 2 : val.size;
+        for (uint64_t i = 0; i < items; i++) {
+            if (!mmdb_skip(sec, *next, next, depth + 1)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* Follow a path of map keys from the field at off. */
+static bool
+mmdb_get_path(const mmdb_section_t *sec, size_t off, const char **path, mmdb_value_t *val)
+{
+    size_t next;
+
+    if (!mmdb_decode_deref(sec, off, val, &next)) {
+        return false;
+    }
+    for (; *path != NULL; path++) {
+        size_t key_len = strlen(*path);
+        uint32_t pairs = val->size;
+        bool found = false;
+
+        if (val->type != MMDB_TYPE_MAP) {
+            return false;
+        }
+        off = val->offset;
+        for (uint32_t i = 0; i < pairs && !found; i++) {
+            mmdb_value_t key;
+
+            if (!mmdb_decode_deref(sec, off, &key, &next) || key.type != MMDB_TYPE_UTF8) {
+                return false;
+            }
+            if (key.size == key_len && memcmp(sec->buf + key.offset, *path, key_len) == 0) {
+                if (!mmdb_decode_deref(sec, next, val, &next)) {
+                    return false;
+                }
+                found = true;
+            } else if (!mmdb_skip(sec, next, &off, 0)) {
+                return false;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool
+mmdb_get_uint(const mmdb_section_t *sec, size_t off, const char **path, uint64_t *uint_val)
+{
+    mmdb_value_t val;
+
+    if (!mmdb_get_path(sec, off, path, &val)) {
+        return false;
+    }
+    switch (val.type) {
+    case MMDB_TYPE_UINT16:
+    case MMDB_TYPE_UINT32:
+    case MMDB_TYPE_INT32:
+    case MMDB_TYPE_UINT64:
+        if (val.size > 8) {
+            return false;
+        }
+        *uint_val = 0;
+        for (uint32_t i = 0; i < val.size; i++) {
+            *uint_val = (*uint_val << 8) | sec->buf[val.offset + i];
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool
+mmdb_get_double(const mmdb_section_t *sec, size_t off, const char **path, double *double_val)
+{
+    mmdb_value_t val;
+
+    if (!mmdb_get_path(sec, off, path, &val)) {
+        return false;
+    }
+    if (val.type == MMDB_TYPE_DOUBLE && val.size == 8) {
+        uint64_t bits = pntohu64(sec->buf + val.offset);
+        memcpy(double_val, &bits, sizeof(*double_val));
+        return true;
+    }
+    if (val.type == MMDB_TYPE_FLOAT && val.size == 4) {
+        uint32_t bits = pntohu32(sec->buf + val.offset);
+        float float_val;
+        memcpy(&float_val, &bits, sizeof(float_val));
+        *double_val = float_val;
+        return true;
+    }
+    return false;
+}
+
+/* Returns an interned copy of a string field, or NULL. */
+static const char *
+mmdb_get_string(const mmdb_section_t *sec, size_t off, const char **path)
+{
+    mmdb_value_t val;
+    char *str;
+    const char *chunk_string;
+
+    if (!mmdb_get_path(sec, off, path, &val) || val.type != MMDB_TYPE_UTF8 || val.size == 0) {
+        return NULL;
+    }
+    str = g_strndup((const char *)sec->buf + val.offset, val.size);
+    chunk_string = chunkify_string(str);
+    g_free(str);
+    return chunk_string;
+}
+
+static uint32_t
+mmdb_read_record(const mmdb_file_t *mmdb, uint32_t node, unsigned bit)
+{
+    const uint8_t *p = mmdb->tree + (size_t)node * mmdb->node_len;
+
+    switch (mmdb->record_size) {
+    case 24:
+        return pntohu24(p + bit * 3);
+    case 28:
+        if (bit == 0) {
+            return ((uint32_t)(p[3] & 0xf0) << 20) | pntohu24(p);
+        }
+        return ((uint32_t)(p[3] & 0x0f) << 24) | pntohu24(p + 4);
+    default:
+        return pntohu32(p + bit * 4);
+    }
+}
+
+static void
+mmdb_file_free(void *data)
+{
+    mmdb_file_t *mmdb = (mmdb_file_t *)data;
+
+    g_mapped_file_unref(mmdb->mapped);
+    g_free(mmdb->path);
+    g_free(mmdb);
+}
+
+static mmdb_file_t *
+mmdb_file_open(const char *path)
+{
+    GMappedFile *mapped;
+    GError *err = NULL;
+    const uint8_t *buf;
+    size_t len, search_len, marker_off = 0;
+    bool marker_found;
+    mmdb_section_t metadata;
+    uint64_t node_count, record_size, ip_version;
+    size_t tree_len;
+    mmdb_file_t *mmdb;
+
+    mapped = g_mapped_file_new(path, false, &err);
+    if (mapped == NULL) {
+        ws_debug("can't map %s: %s", path, err->message);
+        g_clear_error(&err);
+        return NULL;
+    }
+    buf = (const uint8_t *)g_mapped_file_get_contents(mapped);
+    len = g_mapped_file_get_length(mapped);
+
+    /* The metadata follows the last marker, in the last 128 KiB. */
+    search_len = MIN(len, MMDB_METADATA_MAX_LEN);
+    marker_found = false;
+    for (size_t i = MMDB_METADATA_MARKER_LEN; i <= search_len && !marker_found; i++) {
+        if (memcmp(buf + len - i, MMDB_METADATA_MARKER, MMDB_METADATA_MARKER_LEN) == 0) {
+            marker_off = len - i;
+            marker_found = true;
+        }
+    }
+    if (!marker_found) {
+        ws_debug("%s: no metadata", path);
+        g_mapped_file_unref(mapped);
+        return NULL;
+    }
+    metadata.buf = buf + marker_off + MMDB_METADATA_MARKER_LEN;
+    metadata.len = len - marker_off - MMDB_METADATA_MARKER_LEN;
+
+    {
+        static const char *node_count_key[] = {"node_count", NULL};
+        static const char *record_size_key[] = {"record_size", NULL};
+        static const char *ip_version_key[] = {"ip_version", NULL};
+
+        if (!mmdb_get_uint(&metadata, 0, node_count_key, &node_count) ||
+                !mmdb_get_uint(&metadata, 0, record_size_key, &record_size) ||
+                !mmdb_get_uint(&metadata, 0, ip_version_key, &ip_version) ||
+                node_count == 0 || node_count > UINT32_MAX ||
+                (record_size != 24 && record_size != 28 && record_size != 32) ||
+                (ip_version != 4 && ip_version != 6)) {
+            ws_debug("%s: invalid metadata", path);
+            g_mapped_file_unref(mapped);
+            return NULL;
+        }
+    }
+
+    tree_len = (size_t)node_count * (size_t)(record_size / 4);
+    if (tree_len / (record_size / 4) != node_count ||
+            tree_len > marker_off || marker_off - tree_len < MMDB_DATA_SEPARATOR_LEN) {
+        ws_debug("%s: invalid search tree size", path);
+        g_mapped_file_unref(mapped);
+        return NULL;
+    }
+
+    mmdb = g_new0(mmdb_file_t, 1);
+    mmdb->path = g_strdup(path);
+    mmdb->mapped = mapped;
+    mmdb->tree = buf;
+    mmdb->node_count = (uint32_t)node_count;
+    mmdb->record_size = (unsigned)record_size;
+    mmdb->node_len = (unsigned)record_size / 4;
+    mmdb->ip_version = (unsigned)ip_version;
+    mmdb->data.buf = buf + tree_len + MMDB_DATA_SEPARATOR_LEN;
+    mmdb->data.len = marker_off - tree_len - MMDB_DATA_SEPARATOR_LEN;
+
+    /* IPv4 addresses are at ::/96 in IPv6 databases. */
+    mmdb->ipv4_node = 0;
+    if (mmdb->ip_version == 6) {
+        for (unsigned i = 0; i < 96 && mmdb->ipv4_node < mmdb->node_count; i++) {
+            mmdb->ipv4_node = mmdb_read_record(mmdb, mmdb->ipv4_node, 0);
+        }
+    }
+
+    ws_debug("opened %s: %u nodes, %u-bit records, IPv%u", path,
+             mmdb->node_count, mmdb->record_size, mmdb->ip_version);
+    return mmdb;
+}
+
+/* Walk the search tree. On success, sets the offset of the record in the
+ * data section. */
+static bool
+mmdb_file_lookup(const mmdb_file_t *mmdb, const uint8_t *addr, unsigned addr_len, size_t *data_off)
+{
+    unsigned addr_bits = addr_len * 8;
+    uint32_t node = 0;
+    unsigned i;
+
+    if (addr_len == 4 && mmdb->ip_version == 6) {
+        node = mmdb->ipv4_node;
+    } else if (addr_len == 16 && mmdb->ip_version == 4) {
+        return false;
+    }
+
+    for (i = 0; i < addr_bits && node < mmdb->node_count; i++) {
+        node = mmdb_read_record(mmdb, node, (addr[i >> 3] >> (7 - (i & 7))) & 1);
+    }
+
+    /* node_count means "no data"; smaller values are nodes, which we
+     * shouldn't still be at after the last bit. */
+    if (node <= mmdb->node_count) {
+        return false;
+    }
+    *data_off = (size_t)(node - mmdb->node_count) - MMDB_DATA_SEPARATOR_LEN;
+    return *data_off < mmdb->data.len;
+}
+
+/* Look an address up in each database. As with mmdbresolve, values found
+ * in later databases replace those found in earlier ones. */
+static void
+mmdb_files_lookup(const uint8_t *addr, unsigned addr_len, mmdb_lookup_t *lookup)
+{
+    init_lookup(lookup);
+
+    for (unsigned i = 0; i < mmdb_files->len; i++) {
+        const mmdb_file_t *mmdb = (const mmdb_file_t *)g_ptr_array_index(mmdb_files, i);
+        const mmdb_section_t *data = &mmdb->data;
+        size_t off;
+        const char *str;
+        uint64_t uint_val;
+        double double_val;
+
+        if (!mmdb_file_lookup(mmdb, addr, addr_len, &off)) {
+            continue;
+        }
+        if ((str = mmdb_get_string(data, off, mmdb_co_iso_key)) != NULL) {
+            lookup->found = true;
+            lookup->country_iso = str;
+        }
+        if ((str = mmdb_get_string(data, off, mmdb_co_name_key)) != NULL) {
+            lookup->found = true;
+            lookup->country = str;
+        }
+        if ((str = mmdb_get_string(data, off, mmdb_ci_name_key)) != NULL) {
+            lookup->found = true;
+            lookup->city = str;
+        }
+        if ((str = mmdb_get_string(data, off, mmdb_asn_o_key)) != NULL) {
+            lookup->found = true;
+            lookup->as_org = str;
+        }
+        if (mmdb_get_uint(data, off, mmdb_asn_key, &uint_val) && uint_val <= UINT32_MAX) {
+            lookup->found = true;
+            lookup->as_number = (uint32_t)uint_val;
+        }
+        if (mmdb_get_double(data, off, mmdb_l_lat_key, &double_val)) {
+            lookup->found = true;
+            lookup->latitude = double_val;
+        }
+        if (mmdb_get_double(data, off, mmdb_l_lon_key, &double_val)) {
+            lookup->found = true;
+            lookup->longitude = double_val;
+        }
+        if (mmdb_get_uint(data, off, mmdb_l_accuracy_key, &uint_val) && uint_val <= UINT16_MAX) {
+            lookup->found = true;
+            lookup->accuracy = (uint16_t)uint_val;
+        }
+    }
+}
+
+static const mmdb_lookup_t *
+mmdb_cache_lookup(const uint8_t *addr, bool is_ipv4)
+{
+    unsigned addr_len = is_ipv4 ? 4 : 16;
+    uint32_t hash = 0;
+    mmdb_cache_entry_t *set, *victim;
+
+    for (unsigned i = 0; i < addr_len; i += 4) {
+        hash = (hash ^ pntohu32(addr + i)) * UINT32_C(0x9E3779B1);
+    }
+    set = &mmdb_cache[(hash >> (32 - MMDB_CACHE_SETS_LOG2)) * MMDB_CACHE_WAYS];
+
+    mmdb_cache_clock++;
+    victim = &set[0];
+    for (unsigned way = 0; way < MMDB_CACHE_WAYS; way++) {
+        mmdb_cache_entry_t *entry = &set[way];
+
+        if (entry->last_used != 0 && entry->is_ipv4 == is_ipv4 &&
+                memcmp(entry->addr, addr, addr_len) == 0) {
+            entry->last_used = mmdb_cache_clock;
+            return &entry->mmdb_val;
+        }
+        if (entry->last_used < victim->last_used) {
+            victim = entry;
+        }
+    }
+
+    mmdb_files_lookup(addr, addr_len, &victim->mmdb_val);
+    memcpy(victim->addr, addr, addr_len);
+    victim->is_ipv4 = is_ipv4;
+    victim->last_used = mmdb_cache_clock;
+    return &victim->mmdb_val;
+}
+
+static void mmdb_files_close(void) {
+    if (mmdb_files) {
+        g_ptr_array_free(mmdb_files, true);
+        mmdb_files = NULL;
+    }
+    g_free(mmdb_cache);
+    mmdb_cache = NULL;
+}
+
+static void mmdb_files_open(void) {
+    mmdb_files_close();
+
+    mmdb_files = g_ptr_array_new_with_free_func(mmdb_file_free);
+    for (unsigned i = 0; i < mmdb_file_arr->len; i++) {
+        mmdb_file_t *mmdb = mmdb_file_open((const char *)g_ptr_array_index(mmdb_file_arr, i));
+        if (mmdb) {
+            g_ptr_array_add(mmdb_files, mmdb);
+        }
+    }
+    mmdb_cache = g_new0(mmdb_cache_entry_t, MMDB_CACHE_SETS * MMDB_CACHE_WAYS);
+    mmdb_cache_clock = 0;
+}
+
 /**
  * Stop our mmdbresolve process.
  * Main thread only.
@@ -479,12 +1033,18 @@ static void mmdb_resolve_start(void) {
     }
 
     mmdb_resolve_stop();
+    mmdb_files_close();
 
     if (mmdb_file_arr->len == 0) {
         ws_debug("no GeoIP databases found");
         return;
     }
 
+    if (mmdb_in_process) {
+        mmdb_files_open();
+        return;
+    }
+
     GPtrArray *args = g_ptr_array_new();
     char *mmdbresolve = get_executable_path("mmdbresolve");
     g_ptr_array_add(args, mmdbresolve);
@@ -571,6 +1131,7 @@ static void maxmind_db_cleanup(void) {
     unsigned i;
 
     mmdb_resolve_stop();
+    mmdb_files_close();
 
     /* If we have old data, clear out the whole thing
      * and start again. TODO: Just update the ones that
@@ -635,6 +1196,14 @@ maxmind_db_pref_init(module_t *nameres)
             "Lookup geolocation information for IPv4 and IPv6 addresses with configured MaxMind databases",
             &gbl_resolv_flags.maxmind_geoip);
 
+    prefs_register_bool_preference(nameres,
+            "maxmind_in_process",
+            "Read geolocation databases in-process",
+            "Look up geolocation information by reading the MaxMind databases"
+            " directly, rather than by running mmdbresolve. Lookups are then"
+            " always synchronous, and their results are cached.",
+            &mmdb_in_process);
+
     static uat_field_t maxmind_db_paths_fields[] = {
         UAT_FLD_DIRECTORYNAME(maxmind_mod, path, "MaxMind Database Directory", "The MaxMind database directory path"),
         UAT_END_FIELDS
@@ -691,18 +1260,21 @@ maxmind_db_pref_init(module_t *nameres)
 void maxmind_db_pref_cleanup(void)
 {
     mmdb_resolve_stop();
+    mmdb_files_close();
 }
 
 void maxmind_db_pref_apply(void)
 {
     if (gbl_resolv_flags.maxmind_geoip) {
-        if (!mmdbr_pipe_valid()) {
+        /* (Re)start if we aren't running, or are running the wrong way. */
+        if (mmdb_in_process ? mmdb_files == NULL : !mmdbr_pipe_valid()) {
             mmdb_resolve_start();
         }
     } else {
         if (mmdbr_pipe_valid()) {
             mmdb_resolve_stop();
         }
+        mmdb_files_close();
     }
 }
 
@@ -780,6 +1352,10 @@ maxmind_db_lookup_ipv4(const ws_in4_addr *addr) {
         return &mmdb_not_found;
     }
 
+    if (mmdb_files) {
+        return mmdb_cache_lookup((const uint8_t *)addr, true);
+    }
+
     mmdb_lookup_t *result = (mmdb_lookup_t *) wmem_map_lookup(mmdb_ipv4_map, GUINT_TO_POINTER(*addr));
 
     if (!result) {
@@ -807,6 +1383,10 @@ maxmind_db_lookup_ipv6(const ws_in6_addr *addr) {
         return &mmdb_not_found;
     }
 
+    if (mmdb_files) {
+        return mmdb_cache_lookup(addr->bytes, false);
+    }
+
     mmdb_lookup_t * result = (mmdb_lookup_t *) wmem_map_lookup(mmdb_ipv6_map, addr->bytes);
 
     if (!result) {
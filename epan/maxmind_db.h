@@ -55,7 +55,9 @@ WS_DLL_LOCAL void maxmind_db_pref_apply(void);
  *
  * @param addr IPv4 address to look up
  *
- * @return The database entry if found, else NULL.
+ * @return The database entry if found, else NULL. If the databases are
+ * read in-process, the entry may be replaced by later lookups; it stays
+ * valid at least until the next one.
  */
 WS_DLL_PUBLIC WS_RETNONNULL const mmdb_lookup_t *maxmind_db_lookup_ipv4(const ws_in4_addr *addr);
 
@@ -64,7 +66,9 @@ WS_DLL_PUBLIC WS_RETNONNULL const mmdb_lookup_t *maxmind_db_lookup_ipv4(const ws
  *
  * @param addr IPv6 address to look up
  *
- * @return The database entry if found, else NULL.
+ * @return The database entry if found, else NULL. If the databases are
+ * read in-process, the entry may be replaced by later lookups; it stays
+ * valid at least until the next one.
  */
 WS_DLL_PUBLIC WS_RETNONNULL const mmdb_lookup_t *maxmind_db_lookup_ipv6(const ws_in6_addr *addr);
 
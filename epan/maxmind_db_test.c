@@ -0,0 +1,708 @@
+/* maxmind_db_test.c
+ * In-process MaxMind database reader tests
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#undef G_DISABLE_ASSERT
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/file_util.h>
+#include <wsutil/filesystem.h>
+#include <wsutil/inet_addr.h>
+#include <wsutil/wslog.h>
+
+#include <epan/epan.h>
+#include <epan/maxmind_db.h>
+#include <epan/prefs.h>
+
+#ifdef HAVE_MAXMINDDB
+
+/*
+ * The tests write their own small databases: a tree of 24-, 28- or
+ * 32-bit records, a data section in which every record shares its
+ * country's names through a pointer, and the metadata map.
+ */
+
+#define MMDB_TYPE_POINTER   1
+#define MMDB_TYPE_UTF8      2
+#define MMDB_TYPE_DOUBLE    3
+#define MMDB_TYPE_UINT16    5
+#define MMDB_TYPE_UINT32    6
+#define MMDB_TYPE_MAP       7
+#define MMDB_TYPE_UINT64    9
+
+#define METADATA_MARKER     "\xab\xcd\xefMaxMind.com"
+#define DATA_SEPARATOR_LEN  16
+
+/* Tree records that aren't nodes */
+#define RECORD_EMPTY        -1
+#define RECORD_DATA(off)    (-2 - (int64_t)(off))
+
+typedef struct {
+    const char *prefix;
+    unsigned    prefix_len;
+    const char *city;
+    uint32_t    as_number;
+    const char *as_org;
+    double      latitude;
+    double      longitude;
+    uint16_t    accuracy;
+} test_network_t;
+
+typedef struct {
+    unsigned              ip_version;
+    unsigned              record_size;
+    const char           *country_iso;
+    const char           *country;
+    const test_network_t *networks;
+    size_t                num_networks;
+} test_db_t;
+
+typedef struct {
+    int64_t record[2];
+} test_node_t;
+
+static const test_network_t networks_v6[] = {
+    /* An IPv4 network, at ::/96 */
+    { "192.0.2.0", 24, "Alpha", 64496, "Alpha Networks", 12.5, -7.25, 100 },
+    { "2001:db8::", 32, "Beta", 64497, "Beta Networks", -33.75, 151.5, 20 },
+};
+
+static const test_network_t networks_v4_28[] = {
+    { "10.0.0.0", 8, "Gamma", 64498, "Gamma Networks", 48.0, 2.25, 500 },
+};
+
+static const test_network_t networks_v4_32[] = {
+    { "11.0.0.0", 8, "Delta", 64499, "Delta Networks", -1.5, 36.75, 1000 },
+};
+
+/* Read after the others, so what it has replaces what they have. */
+static const test_network_t networks_override[] = {
+    { "192.0.2.0", 24, "Omega", 64500, "Omega Networks", 0.5, 0.5, 1 },
+};
+
+static const test_db_t db_v6 = {
+    6, 24, "TL", "Testland", networks_v6, G_N_ELEMENTS(networks_v6)
+};
+
+static const test_db_t db_v4_28 = {
+    4, 28, "EX", "Examplia", networks_v4_28, G_N_ELEMENTS(networks_v4_28)
+};
+
+static const test_db_t db_v4_32 = {
+    4, 32, "EX", "Examplia", networks_v4_32, G_N_ELEMENTS(networks_v4_32)
+};
+
+static const test_db_t db_override = {
+    6, 24, "OV", "Overland", networks_override, G_N_ELEMENTS(networks_override)
+};
+
+static char *test_dir;
+static char *override_path;
+
+static void
+put_ctrl(GByteArray *buf, unsigned type, uint32_t size)
+{
+    uint8_t bytes[4];
+    unsigned len = 0;
+
+    bytes[len++] = (uint8_t)((type > 7 ? 0 : type) << 5);
+    if (type > 7) {
+        bytes[len++] = (uint8_t)(type - 7);
+    }
+    if (size < 29) {
+        bytes[0] |= size;
+    } else {
+        g_assert_cmpuint(size, <, 285);
+        bytes[0] |= 29;
+        bytes[len++] = (uint8_t)(size - 29);
+    }
+    g_byte_array_append(buf, bytes, len);
+}
+
+static void
+put_string(GByteArray *buf, const char *str)
+{
+    put_ctrl(buf, MMDB_TYPE_UTF8, (uint32_t)strlen(str));
+    g_byte_array_append(buf, (const uint8_t *)str, (unsigned)strlen(str));
+}
+
+static void
+put_uint(GByteArray *buf, unsigned type, uint64_t val)
+{
+    uint8_t bytes[8];
+    unsigned len = 0;
+
+    for (uint64_t v = val; v != 0; v >>= 8) {
+        len++;
+    }
+    put_ctrl(buf, type, len);
+    for (unsigned i = 0; i < len; i++) {
+        bytes[i] = (uint8_t)(val >> (8 * (len - 1 - i)));
+    }
+    g_byte_array_append(buf, bytes, len);
+}
+
+static void
+put_double(GByteArray *buf, double val)
+{
+    uint8_t bytes[8];
+    uint64_t bits;
+
+    memcpy(&bits, &val, sizeof(bits));
+    for (unsigned i = 0; i < 8; i++) {
+        bytes[i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    put_ctrl(buf, MMDB_TYPE_DOUBLE, 8);
+    g_byte_array_append(buf, bytes, 8);
+}
+
+/* A pointer with one byte after the control byte, so to below 2048. */
+static void
+put_pointer(GByteArray *buf, size_t off)
+{
+    uint8_t bytes[2];
+
+    g_assert_cmpuint(off, <, 2048);
+    bytes[0] = (uint8_t)((MMDB_TYPE_POINTER << 5) | (off >> 8));
+    bytes[1] = (uint8_t)off;
+    g_byte_array_append(buf, bytes, 2);
+}
+
+/* Write a network's record. The first record's "country" key is a string,
+ * and later ones point to it. */
+static size_t
+put_record(GByteArray *data, const test_db_t *db, const test_network_t *net,
+           size_t names_off, size_t *country_key_off)
+{
+    size_t off = data->len;
+
+    put_ctrl(data, MMDB_TYPE_MAP, 5);
+    if (*country_key_off == SIZE_MAX) {
+        *country_key_off = data->len;
+        put_string(data, "country");
+    } else {
+        put_pointer(data, *country_key_off);
+    }
+    put_ctrl(data, MMDB_TYPE_MAP, 2);
+    put_string(data, "names");
+    put_pointer(data, names_off);
+    put_string(data, "iso_code");
+    put_string(data, db->country_iso);
+
+    put_string(data, "city");
+    put_ctrl(data, MMDB_TYPE_MAP, 1);
+    put_string(data, "names");
+    put_ctrl(data, MMDB_TYPE_MAP, 1);
+    put_string(data, "en");
+    put_string(data, net->city);
+
+    put_string(data, "autonomous_system_number");
+    put_uint(data, MMDB_TYPE_UINT32, net->as_number);
+    put_string(data, "autonomous_system_organization");
+    put_string(data, net->as_org);
+
+    put_string(data, "location");
+    put_ctrl(data, MMDB_TYPE_MAP, 3);
+    put_string(data, "latitude");
+    put_double(data, net->latitude);
+    put_string(data, "longitude");
+    put_double(data, net->longitude);
+    put_string(data, "accuracy_radius");
+    put_uint(data, MMDB_TYPE_UINT16, net->accuracy);
+
+    return off;
+}
+
+static void
+tree_insert(GArray *nodes, const uint8_t *addr, unsigned prefix_len, size_t data_off)
+{
+    uint32_t node = 0;
+
+    for (unsigned i = 0; i < prefix_len; i++) {
+        unsigned bit = (addr[i >> 3] >> (7 - (i & 7))) & 1;
+        test_node_t *n = &g_array_index(nodes, test_node_t, node);
+
+        if (i == prefix_len - 1) {
+            n->record[bit] = RECORD_DATA(data_off);
+            return;
+        }
+        if (n->record[bit] < 0) {
+            test_node_t new_node = { { RECORD_EMPTY, RECORD_EMPTY } };
+
+            g_array_append_val(nodes, new_node);
+            n = &g_array_index(nodes, test_node_t, node);
+            n->record[bit] = nodes->len - 1;
+        }
+        node = (uint32_t)n->record[bit];
+    }
+}
+
+static void
+put_node(GByteArray *buf, unsigned record_size, uint32_t left, uint32_t right)
+{
+    uint8_t bytes[8];
+    unsigned len = record_size / 4;
+
+    switch (record_size) {
+    case 24:
+        bytes[0] = (uint8_t)(left >> 16);
+        bytes[1] = (uint8_t)(left >> 8);
+        bytes[2] = (uint8_t)left;
+        bytes[3] = (uint8_t)(right >> 16);
+        bytes[4] = (uint8_t)(right >> 8);
+        bytes[5] = (uint8_t)right;
+        break;
+    case 28:
+        bytes[0] = (uint8_t)(left >> 16);
+        bytes[1] = (uint8_t)(left >> 8);
+        bytes[2] = (uint8_t)left;
+        bytes[3] = (uint8_t)(((left >> 20) & 0xf0) | ((right >> 24) & 0x0f));
+        bytes[4] = (uint8_t)(right >> 16);
+        bytes[5] = (uint8_t)(right >> 8);
+        bytes[6] = (uint8_t)right;
+        break;
+    default:
+        for (unsigned i = 0; i < 4; i++) {
+            bytes[i] = (uint8_t)(left >> (24 - 8 * i));
+            bytes[4 + i] = (uint8_t)(right >> (24 - 8 * i));
+        }
+        break;
+    }
+    g_byte_array_append(buf, bytes, len);
+}
+
+/* The search tree, the separator and the data section, without metadata. */
+static GByteArray *
+make_db_body(const test_db_t *db, uint32_t *node_count)
+{
+    GByteArray *file = g_byte_array_new();
+    GByteArray *data = g_byte_array_new();
+    GArray *nodes = g_array_new(false, false, sizeof(test_node_t));
+    test_node_t root = { { RECORD_EMPTY, RECORD_EMPTY } };
+    size_t names_off, country_key_off = SIZE_MAX;
+    uint8_t separator[DATA_SEPARATOR_LEN] = { 0 };
+
+    g_array_append_val(nodes, root);
+
+    /* The country's names, which each record points to */
+    names_off = data->len;
+    put_ctrl(data, MMDB_TYPE_MAP, 1);
+    put_string(data, "en");
+    put_string(data, db->country);
+
+    for (size_t i = 0; i < db->num_networks; i++) {
+        const test_network_t *net = &db->networks[i];
+        uint8_t addr[16] = { 0 };
+        unsigned prefix_len = net->prefix_len;
+        size_t off;
+
+        off = put_record(data, db, net, names_off, &country_key_off);
+        if (strchr(net->prefix, ':') != NULL) {
+            g_assert_true(ws_inet_pton6(net->prefix, (ws_in6_addr *)addr));
+        } else {
+            ws_in4_addr addr4;
+
+            g_assert_true(ws_inet_pton4(net->prefix, &addr4));
+            if (db->ip_version == 6) {
+                memcpy(addr + 12, &addr4, 4);
+                prefix_len += 96;
+            } else {
+                memcpy(addr, &addr4, 4);
+            }
+        }
+        tree_insert(nodes, addr, prefix_len, off);
+    }
+
+    *node_count = nodes->len;
+    for (unsigned i = 0; i < nodes->len; i++) {
+        test_node_t *n = &g_array_index(nodes, test_node_t, i);
+        uint32_t records[2];
+
+        for (unsigned bit = 0; bit < 2; bit++) {
+            if (n->record[bit] >= 0) {
+                records[bit] = (uint32_t)n->record[bit];
+            } else if (n->record[bit] == RECORD_EMPTY) {
+                records[bit] = *node_count;
+            } else {
+                records[bit] = *node_count + DATA_SEPARATOR_LEN + (uint32_t)(-2 - n->record[bit]);
+            }
+        }
+        put_node(file, db->record_size, records[0], records[1]);
+    }
+    g_byte_array_append(file, separator, DATA_SEPARATOR_LEN);
+    g_byte_array_append(file, data->data, data->len);
+
+    g_array_free(nodes, true);
+    g_byte_array_free(data, true);
+    return file;
+}
+
+/* The marker and the metadata map. ip_version comes last, so cutting the
+ * map short anywhere loses a key the reader needs. */
+static void
+put_metadata(GByteArray *file, uint64_t node_count, unsigned record_size, unsigned ip_version)
+{
+    g_byte_array_append(file, (const uint8_t *)METADATA_MARKER, sizeof(METADATA_MARKER) - 1);
+    put_ctrl(file, MMDB_TYPE_MAP, 4);
+    put_string(file, "database_type");
+    put_string(file, "Wireshark-Test");
+    put_string(file, "node_count");
+    put_uint(file, node_count > UINT32_MAX ? MMDB_TYPE_UINT64 : MMDB_TYPE_UINT32, node_count);
+    put_string(file, "record_size");
+    put_uint(file, MMDB_TYPE_UINT16, record_size);
+    put_string(file, "ip_version");
+    put_uint(file, MMDB_TYPE_UINT16, ip_version);
+}
+
+static GByteArray *
+make_db(const test_db_t *db)
+{
+    uint32_t node_count;
+    GByteArray *file = make_db_body(db, &node_count);
+
+    put_metadata(file, node_count, db->record_size, db->ip_version);
+    return file;
+}
+
+static void
+write_file(const char *path, const uint8_t *contents, size_t length)
+{
+    GError *gerr = NULL;
+
+    g_file_set_contents(path, (const char *)contents, length, &gerr);
+    g_assert_no_error(gerr);
+}
+
+static void
+write_db(const char *dir, const char *name, const test_db_t *db)
+{
+    char *path = g_build_filename(dir, name, NULL);
+    GByteArray *file = make_db(db);
+
+    write_file(path, file->data, file->len);
+    g_byte_array_free(file, true);
+    g_free(path);
+}
+
+static void
+set_pref(const char *pref)
+{
+    char *arg = g_strdup(pref);
+    char *errmsg = NULL;
+
+    g_assert_cmpint(prefs_set_pref(arg, &errmsg), ==, PREFS_SET_OK);
+    g_free(errmsg);
+    g_free(arg);
+}
+
+static void
+add_db_dir(const char *dir)
+{
+    char *escaped = g_strescape(dir, NULL);
+    char *pref = g_strdup_printf("uat:maxmind_db_paths:\"%s\"", escaped);
+
+    set_pref(pref);
+    g_free(pref);
+    g_free(escaped);
+}
+
+/* Replace the override database, closing the databases while doing so
+ * (Windows won't replace a mapped file). */
+static void
+write_override(const uint8_t *contents, size_t length)
+{
+    set_pref("nameres.maxmind_geoip:FALSE");
+    prefs_apply_all();
+    write_file(override_path, contents, length);
+    set_pref("nameres.maxmind_geoip:TRUE");
+    prefs_apply_all();
+}
+
+static const mmdb_lookup_t *
+lookup(const char *str)
+{
+    if (strchr(str, ':') != NULL) {
+        ws_in6_addr addr;
+
+        g_assert_true(ws_inet_pton6(str, &addr));
+        return maxmind_db_lookup_ipv6(&addr);
+    } else {
+        ws_in4_addr addr;
+
+        g_assert_true(ws_inet_pton4(str, &addr));
+        return maxmind_db_lookup_ipv4(&addr);
+    }
+}
+
+static void
+check_network(const mmdb_lookup_t *result, const test_db_t *db, const test_network_t *net)
+{
+    g_assert_true(result->found);
+    g_assert_cmpstr(result->country_iso, ==, db->country_iso);
+    g_assert_cmpstr(result->country, ==, db->country);
+    g_assert_cmpstr(result->city, ==, net->city);
+    g_assert_cmpuint(result->as_number, ==, net->as_number);
+    g_assert_cmpstr(result->as_org, ==, net->as_org);
+    g_assert_cmpfloat(result->latitude, ==, net->latitude);
+    g_assert_cmpfloat(result->longitude, ==, net->longitude);
+    g_assert_cmpuint(result->accuracy, ==, net->accuracy);
+}
+
+static void
+maxmind_db_test_ipv4(void)
+{
+    check_network(lookup("10.1.2.3"), &db_v4_28, &networks_v4_28[0]);
+    check_network(lookup("11.255.255.255"), &db_v4_32, &networks_v4_32[0]);
+    g_assert_false(lookup("203.0.113.1")->found);
+}
+
+static void
+maxmind_db_test_ipv6(void)
+{
+    check_network(lookup("2001:db8::1"), &db_v6, &networks_v6[1]);
+    check_network(lookup("2001:db8:ffff::1"), &db_v6, &networks_v6[1]);
+    g_assert_false(lookup("2001:db9::1")->found);
+    /* IPv4 databases have nothing for IPv6 addresses. */
+    g_assert_false(lookup("::a01:203")->found);
+}
+
+/* IPv4 addresses in an IPv6 database, under ::/96 */
+static void
+maxmind_db_test_ipv4_in_ipv6(void)
+{
+    check_network(lookup("192.0.2.1"), &db_v6, &networks_v6[0]);
+    check_network(lookup("192.0.2.255"), &db_v6, &networks_v6[0]);
+    check_network(lookup("::c000:201"), &db_v6, &networks_v6[0]);
+    g_assert_false(lookup("192.0.3.1")->found);
+}
+
+/* Both records of the IPv6 database point to the country's names, and the
+ * second one's "country" key points to the first one's. */
+static void
+maxmind_db_test_pointers(void)
+{
+    const mmdb_lookup_t *result;
+
+    result = lookup("192.0.2.2");
+    g_assert_cmpstr(result->country, ==, "Testland");
+    g_assert_cmpstr(result->country_iso, ==, "TL");
+    result = lookup("2001:db8::2");
+    g_assert_cmpstr(result->country, ==, "Testland");
+    g_assert_cmpstr(result->country_iso, ==, "TL");
+}
+
+static void
+check_override_rejected(const uint8_t *contents, size_t length)
+{
+    write_override(contents, length);
+    check_network(lookup("192.0.2.3"), &db_v6, &networks_v6[0]);
+    check_network(lookup("10.0.0.1"), &db_v4_28, &networks_v4_28[0]);
+}
+
+static void
+maxmind_db_test_corrupt(void)
+{
+    GByteArray *file;
+    uint32_t node_count;
+    size_t metadata_off;
+
+    /* A good database there replaces what the others have. */
+    file = make_db(&db_override);
+    write_override(file->data, file->len);
+    check_network(lookup("192.0.2.4"), &db_override, &networks_override[0]);
+    g_byte_array_free(file, true);
+
+    file = make_db_body(&db_override, &node_count);
+    metadata_off = file->len;
+
+    /* No metadata, or some of it */
+    check_override_rejected(file->data, file->len);
+    put_metadata(file, node_count, db_override.record_size, db_override.ip_version);
+    for (size_t len = metadata_off; len < file->len; len++) {
+        check_override_rejected(file->data, len);
+    }
+    g_byte_array_set_size(file, (unsigned)metadata_off);
+
+    /* No nodes, more nodes than the file has, more than 32 bits' worth,
+     * and bad record sizes and IP versions */
+    put_metadata(file, 0, db_override.record_size, db_override.ip_version);
+    check_override_rejected(file->data, file->len);
+    g_byte_array_set_size(file, (unsigned)metadata_off);
+    put_metadata(file, metadata_off, db_override.record_size, db_override.ip_version);
+    check_override_rejected(file->data, file->len);
+    g_byte_array_set_size(file, (unsigned)metadata_off);
+    put_metadata(file, UINT64_C(0x100000000), db_override.record_size, db_override.ip_version);
+    check_override_rejected(file->data, file->len);
+    g_byte_array_set_size(file, (unsigned)metadata_off);
+    put_metadata(file, node_count, 20, db_override.ip_version);
+    check_override_rejected(file->data, file->len);
+    g_byte_array_set_size(file, (unsigned)metadata_off);
+    put_metadata(file, node_count, db_override.record_size, 5);
+    check_override_rejected(file->data, file->len);
+    g_byte_array_free(file, true);
+
+    /* Damage each byte in turn. The result may or may not be readable,
+     * but looking addresses up in it must be safe. */
+    file = make_db(&db_override);
+    for (unsigned i = 0; i < file->len; i++) {
+        file->data[i] ^= 0xff;
+        write_override(file->data, file->len);
+        (void)lookup("192.0.2.5");
+        (void)lookup("192.0.3.5");
+        (void)lookup("2001:db8::5");
+        file->data[i] ^= 0xff;
+    }
+    g_byte_array_free(file, true);
+
+    /* Leave a database that adds nothing for the other tests. */
+    write_override((const uint8_t *)"", 0);
+}
+
+/*
+ * maxmind_db.h promises that a result stays valid until the next lookup.
+ * Hold one across another lookup, for enough addresses that results are
+ * replaced in the cache, and check it still holds what it did and is
+ * still the cached one.
+ */
+static void
+maxmind_db_test_result_lifetime(void)
+{
+    for (uint32_t i = 0; i < 100000; i++) {
+        ws_in4_addr addr_10 = g_htonl(0x0a000000 | i);
+        ws_in4_addr addr_11 = g_htonl(0x0b000000 | i);
+        ws_in4_addr addr_11_hi = g_htonl(0x0b800000 | i);
+        ws_in6_addr addr_v6;
+        const mmdb_lookup_t *held, *other;
+
+        held = maxmind_db_lookup_ipv4(&addr_10);
+        other = maxmind_db_lookup_ipv4(&addr_11);
+        check_network(held, &db_v4_28, &networks_v4_28[0]);
+        check_network(other, &db_v4_32, &networks_v4_32[0]);
+        g_assert_true(maxmind_db_lookup_ipv4(&addr_10) == held);
+
+        g_assert_true(ws_inet_pton6("2001:db8::", &addr_v6));
+        memcpy(addr_v6.bytes + 12, &addr_10, 4);
+        held = maxmind_db_lookup_ipv6(&addr_v6);
+        other = maxmind_db_lookup_ipv4(&addr_11_hi);
+        check_network(held, &db_v6, &networks_v6[1]);
+        check_network(other, &db_v4_32, &networks_v4_32[0]);
+        g_assert_true(maxmind_db_lookup_ipv6(&addr_v6) == held);
+    }
+}
+
+static void
+setup_dbs(void)
+{
+    GError *gerr = NULL;
+    char *good_dir, *override_dir;
+
+    test_dir = g_dir_make_tmp("maxmind_db_test_XXXXXX", &gerr);
+    g_assert_no_error(gerr);
+    good_dir = g_build_filename(test_dir, "good", NULL);
+    override_dir = g_build_filename(test_dir, "override", NULL);
+    g_assert_cmpint(ws_mkdir(good_dir, 0755), ==, 0);
+    g_assert_cmpint(ws_mkdir(override_dir, 0755), ==, 0);
+
+    write_db(good_dir, "test-ipv6.mmdb", &db_v6);
+    write_db(good_dir, "test-ipv4-28.mmdb", &db_v4_28);
+    write_db(good_dir, "test-ipv4-32.mmdb", &db_v4_32);
+    /* The directories are scanned when they're set, so this has to exist
+     * by then; the corrupt test rewrites it. Until then it has no metadata,
+     * and is skipped. */
+    override_path = g_build_filename(override_dir, "test-override.mmdb", NULL);
+    write_file(override_path, (const uint8_t *)"", 0);
+
+    set_pref("nameres.maxmind_in_process:TRUE");
+    set_pref("nameres.maxmind_geoip:TRUE");
+    add_db_dir(good_dir);
+    add_db_dir(override_dir);
+    prefs_apply_all();
+
+    g_free(override_dir);
+    g_free(good_dir);
+}
+
+static void
+remove_dbs(void)
+{
+    const char *names[] = { "good/test-ipv6.mmdb", "good/test-ipv4-28.mmdb",
+                            "good/test-ipv4-32.mmdb", "override/test-override.mmdb",
+                            "good", "override" };
+
+    epan_cleanup();
+    for (size_t i = 0; i < G_N_ELEMENTS(names); i++) {
+        char *path = g_build_filename(test_dir, names[i], NULL);
+        ws_remove(path);
+        g_free(path);
+    }
+    ws_remove(test_dir);
+    g_free(override_path);
+    g_free(test_dir);
+}
+
+#endif /* HAVE_MAXMINDDB */
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+#ifdef HAVE_MAXMINDDB
+    epan_app_data_t app_data;
+    char *init_error;
+#endif
+
+    ws_log_init(NULL, "Testing Debug Console");
+
+    g_test_init(&argc, &argv, NULL);
+
+#ifdef HAVE_MAXMINDDB
+    init_error = configuration_init(argv[0], "wireshark");
+    if (init_error != NULL) {
+        g_printerr("Can't get pathname of directory containing the test program: %s.\n", init_error);
+        g_free(init_error);
+    }
+
+    memset(&app_data, 0, sizeof(app_data));
+    app_data.env_var_prefix = "WIRESHARK";
+    g_assert_true(epan_init(NULL, NULL, false, &app_data));
+    setup_dbs();
+
+    g_test_add_func("/maxmind_db/ipv4", maxmind_db_test_ipv4);
+    g_test_add_func("/maxmind_db/ipv6", maxmind_db_test_ipv6);
+    g_test_add_func("/maxmind_db/ipv4_in_ipv6", maxmind_db_test_ipv4_in_ipv6);
+    g_test_add_func("/maxmind_db/pointers", maxmind_db_test_pointers);
+    g_test_add_func("/maxmind_db/corrupt", maxmind_db_test_corrupt);
+    g_test_add_func("/maxmind_db/result_lifetime", maxmind_db_test_result_lifetime);
+#endif
+
+    ret = g_test_run();
+
+#ifdef HAVE_MAXMINDDB
+    remove_dbs();
+#endif
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
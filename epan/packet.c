@@ -39,8 +39,11 @@
 #include <epan/expert.h>
 #include <epan/prefs.h>
 #include <epan/range.h>
+#include <epan/tap.h>
 
 #include <wsutil/str_util.h>
+#include <wsutil/time_util.h>
+#include <wsutil/uint_index.h>
 #include <wsutil/wslog.h>
 #include <wsutil/ws_assert.h>
 
@@ -96,6 +99,10 @@ struct data_source {
  */
 struct dissector_table {
 	GHashTable	*hash_table;
+	/* For uint tables, a copy of hash_table for faster lookups while
+	   dissecting; see find_uint_dtbl_entry_for_dissection(). */
+	ws_uint_index	uint_index;
+	bool		uint_index_stale;
 	GSList		*dissector_handles;
 	GHashTable	*da_descriptions;
 	const char	*ui_name;
@@ -145,6 +152,19 @@ struct depend_dissector_list {
  */
 static GHashTable *depend_dissector_lists;
 
+/*
+ * Dissection pruning for field extraction.
+ *
+ * "prune_needed_protos" is the set of protocol IDs whose fields were
+ * requested; "prune_keep_protos" is that set plus every protocol from
+ * which one of them can be reached through depend_dissector_lists.
+ * Both are NULL unless pruning has been enabled with
+ * dissector_prune_set_hfids(), so the check in the dispatch path is
+ * a single pointer test in the normal case.
+ */
+static GHashTable *prune_needed_protos;
+static GHashTable *prune_keep_protos;
+
 /* Allow protocols to register a "cleanup" routine to be
  * run after the initial sequential run through the packets.
  * Note that the file can still be open after this; this is not
@@ -194,6 +214,90 @@ static GHashTable *heur_dissector_lists;
 /* Name hashtables for fast detection of duplicate names */
 static GHashTable* heuristic_short_names;
 
+/* Time each heuristic dissector call; see heur_dissector_set_timing(). */
+static bool heur_timing;
+
+/*
+ * Per-protocol profile of dissector calls, kept while anybody listens
+ * to the "dissector_profile" tap; see dissector_profile_foreach().
+ */
+static int dissector_profile_tap;
+static bool dissector_profiling;
+static GHashTable *dissector_profiles;	/* dissector_profile_t by protocol ID */
+static GPtrArray *dissector_profile_list;	/* the same, in the order first called */
+
+/* The time and memory used by the calls made by each call in progress. */
+typedef struct {
+	uint64_t child_ns;
+	uint64_t child_bytes;
+} dissector_profile_level_t;
+
+static GArray *dissector_profile_stack;
+static unsigned dissector_profile_depth;
+
+typedef struct {
+	unsigned depth;
+	uint64_t start_ns;
+	uint64_t start_bytes;
+} dissector_profile_call_t;
+
+/* Profile the dissectors called for a record if anybody wants the profile,
+ * and count what the record's pool allocates only then. */
+static void
+dissector_profile_start_record(packet_info *pinfo)
+{
+	dissector_profiling = have_tap_listener(dissector_profile_tap);
+	wmem_allocator_count_bytes(pinfo->pool, dissector_profiling);
+}
+
+static void
+dissector_profile_enter(dissector_profile_call_t *call, packet_info *pinfo)
+{
+	dissector_profile_level_t *level;
+
+	call->depth = dissector_profile_depth++;
+	if (dissector_profile_stack->len < dissector_profile_depth)
+		g_array_set_size(dissector_profile_stack, dissector_profile_depth);
+	level = &g_array_index(dissector_profile_stack, dissector_profile_level_t, call->depth);
+	level->child_ns = 0;
+	level->child_bytes = 0;
+	call->start_bytes = wmem_allocator_bytes_allocated(pinfo->pool);
+	call->start_ns = ws_clock_get_monotonic_ns();
+}
+
+/* Returns the time taken by the call, in nanoseconds. */
+static uint64_t
+dissector_profile_leave(dissector_profile_call_t *call, packet_info *pinfo, protocol_t *protocol)
+{
+	uint64_t elapsed_ns = ws_clock_get_monotonic_ns() - call->start_ns;
+	uint64_t bytes = wmem_allocator_bytes_allocated(pinfo->pool) - call->start_bytes;
+	dissector_profile_level_t *level;
+	dissector_profile_t *profile;
+	int proto_id = proto_get_id(protocol);
+
+	profile = (dissector_profile_t *)g_hash_table_lookup(dissector_profiles, GINT_TO_POINTER(proto_id));
+	if (profile == NULL) {
+		profile = g_new0(dissector_profile_t, 1);
+		profile->proto_id = proto_id;
+		g_hash_table_insert(dissector_profiles, GINT_TO_POINTER(proto_id), profile);
+		g_ptr_array_add(dissector_profile_list, profile);
+	}
+
+	level = &g_array_index(dissector_profile_stack, dissector_profile_level_t, call->depth);
+	profile->calls++;
+	profile->inclusive_ns += elapsed_ns;
+	profile->exclusive_ns += elapsed_ns - level->child_ns;
+	profile->bytes_allocated += bytes - level->child_bytes;
+
+	dissector_profile_depth = call->depth;
+	if (call->depth > 0) {
+		level--;
+		level->child_ns += elapsed_ns;
+		level->child_bytes += bytes;
+	}
+	return elapsed_ns;
+}
+
 static void
 destroy_heuristic_dissector_entry(void *data)
 {
@@ -219,6 +323,7 @@ destroy_dissector_table(void *data)
 	struct dissector_table *table = (struct dissector_table *)data;
 
 	g_hash_table_destroy(table->hash_table);
+	ws_uint_index_clear(&table->uint_index);
 	g_slist_free(table->dissector_handles);
 	if (table->da_descriptions)
 		g_hash_table_destroy(table->da_descriptions);
@@ -247,6 +352,11 @@ packet_init(void)
 			NULL, destroy_heuristic_dissector_list);
 
 	heuristic_short_names  = g_hash_table_new(g_str_hash, g_str_equal);
+
+	dissector_profiles = g_hash_table_new(g_direct_hash, g_direct_equal);
+	dissector_profile_list = g_ptr_array_new_with_free_func(g_free);
+	dissector_profile_stack = g_array_new(false, true, (unsigned)sizeof(dissector_profile_level_t));
+	dissector_profile_tap = register_tap("dissector_profile");
 }
 
 void
@@ -316,8 +426,12 @@ packet_cleanup(void)
 	g_hash_table_destroy(dissector_table_aliases);
 	g_hash_table_destroy(registered_dissectors);
 	g_hash_table_destroy(depend_dissector_lists);
+	dissector_prune_clear();
 	g_hash_table_destroy(heur_dissector_lists);
 	g_hash_table_destroy(heuristic_short_names);
+	g_hash_table_destroy(dissector_profiles);
+	g_ptr_array_free(dissector_profile_list, true);
+	g_array_free(dissector_profile_stack, true);
 	g_slist_foreach(shutdown_routines, &call_routine, NULL);
 	g_slist_free(shutdown_routines);
 	if (postdissectors) {
@@ -683,6 +797,7 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype, wtap_rec *rec,
 	edt->pi.use_conv_addr_port_endpoints = false;
 	edt->pi.conv_addr_port_endpoints = NULL;
 	edt->pi.conv_elements = NULL;
+	edt->pi.conv_memo = NULL;
 	edt->pi.p2p_dir = P2P_DIR_UNKNOWN;
 	edt->pi.link_dir = LINK_DIR_UNKNOWN;
 	edt->pi.src_win_scale = -1; /* unknown Rcv.Wind.Shift */
@@ -731,6 +846,8 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype, wtap_rec *rec,
 	frame_dissector_data.file_type_subtype = file_type_subtype;
 	frame_dissector_data.color_edt = edt; /* Used strictly for "coloring rules" */
 
+	dissector_profile_start_record(&edt->pi);
+
 	TRY {
 		/*
 		 * XXX - currently, the length arguments in
@@ -768,6 +885,8 @@ dissect_record(epan_dissect_t *edt, int file_type_subtype, wtap_rec *rec,
 					       rec->rec_type_name);
 	}
 	ENDTRY;
+	if (dissector_profiling)
+		tap_queue_packet(dissector_profile_tap, &edt->pi, NULL);
 	wtap_block_unref(rec->block);
 	rec->block = NULL;
 
@@ -807,6 +926,7 @@ dissect_file(epan_dissect_t *edt, wtap_rec *rec,
 	edt->pi.use_conv_addr_port_endpoints = false;
 	edt->pi.conv_addr_port_endpoints = NULL;
 	edt->pi.conv_elements = NULL;
+	edt->pi.conv_memo = NULL;
 	edt->pi.p2p_dir = P2P_DIR_UNKNOWN;
 	edt->pi.link_dir = LINK_DIR_UNKNOWN;
 	edt->pi.layers = wmem_list_new(edt->pi.pool);
@@ -815,6 +935,8 @@ dissect_file(epan_dissect_t *edt, wtap_rec *rec,
 
 	frame_rel_first_frame_time(edt->session, fd, &edt->pi.rel_ts);
 
+	dissector_profile_start_record(&edt->pi);
+
 	TRY {
 		/*
 		 * If the block has been modified, use the modified block,
@@ -848,6 +970,8 @@ dissect_file(epan_dissect_t *edt, wtap_rec *rec,
 					       "[Malformed Record: Packet Length]");
 	}
 	ENDTRY;
+	if (dissector_profiling)
+		tap_queue_packet(dissector_profile_tap, &edt->pi, NULL);
 	wtap_block_unref(rec->block);
 	rec->block = NULL;
 
@@ -929,6 +1053,35 @@ remove_last_layer(packet_info *pinfo, bool reduce_count)
 }
 
 
+/*
+ * Should a call into this protocol be skipped because pruning is enabled
+ * and nothing that was asked for can come from it?
+ *
+ * A protocol is only skipped once one of the requested protocols is
+ * already on the layer stack; until then everything is dissected, so
+ * that lower layers (and any protocols between them that set up state
+ * for the requested ones, e.g. conversations) behave exactly as they
+ * would without pruning.
+ */
+static bool
+dissector_prune_protocol(const protocol_t *protocol, const packet_info *pinfo)
+{
+	wmem_list_frame_t *frame;
+
+	if (prune_keep_protos == NULL || protocol == NULL)
+		return false;
+
+	if (g_hash_table_contains(prune_keep_protos, GINT_TO_POINTER(proto_get_id(protocol))))
+		return false;
+
+	for (frame = wmem_list_head(pinfo->layers); frame != NULL;
+	    frame = wmem_list_frame_next(frame)) {
+		if (g_hash_table_contains(prune_needed_protos, wmem_list_frame_data(frame)))
+			return true;
+	}
+	return false;
+}
+
 /* This function will return
  *   >0  this protocol was successfully dissected and this was this protocol.
  *   0   this packet did not match this protocol.
@@ -986,6 +1139,30 @@ static int
 call_dissector_work_error(dissector_handle_t handle, tvbuff_t *tvb,
 			  packet_info *pinfo_arg, proto_tree *tree, void *);
 
+/* Call a dissector with a protocol through a handle, profiling the call. */
+static int
+call_dissector_work_profiled(dissector_handle_t handle, tvbuff_t *tvb,
+			     packet_info *pinfo, proto_tree *tree, void *data)
+{
+	dissector_profile_call_t call;
+	volatile int len = 0;
+
+	dissector_profile_enter(&call, pinfo);
+	TRY {
+		if (pinfo->flags.in_error_pkt) {
+			len = call_dissector_work_error(handle, tvb, pinfo, tree, data);
+		} else {
+			len = call_dissector_through_handle(handle, tvb, pinfo, tree, data);
+		}
+	}
+	FINALLY {
+		dissector_profile_leave(&call, pinfo, handle->protocol);
+	}
+	ENDTRY;
+
+	return len;
+}
+
 static int
 call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo,
 		    proto_tree *tree, bool add_proto_name, void *data)
@@ -1007,6 +1184,15 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 		return 0;
 	}
 
+	if (dissector_prune_protocol(handle->protocol, pinfo)) {
+		/*
+		 * Nothing we were asked for lives in or below this
+		 * protocol; claim the data without dissecting it, so
+		 * that our caller doesn't go on to try other dissectors.
+		 */
+		return tvb_captured_length(tvb);
+	}
+
 	saved_proto = pinfo->current_proto;
 	saved_proto_layer_num = pinfo->curr_proto_layer_num;
 	saved_can_desegment = pinfo->can_desegment;
@@ -1042,7 +1228,9 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 		}
 	}
 
-	if (pinfo->flags.in_error_pkt) {
+	if (dissector_profiling && handle->protocol != NULL) {
+		len = call_dissector_work_profiled(handle, tvb, pinfo, tree, data);
+	} else if (pinfo->flags.in_error_pkt) {
 		len = call_dissector_work_error(handle, tvb, pinfo, tree, data);
 	} else {
 		/*
@@ -1258,10 +1446,41 @@ find_uint_dtbl_entry(dissector_table_t sub_dissectors, const uint32_t pattern)
 	}
 
 	/*
-	 * Find the entry.
+	 * Find the entry. Until the table is next used for dissection,
+	 * its index may be out of date; see dissector_table_changed().
 	 */
-	return (dtbl_entry_t *)g_hash_table_lookup(sub_dissectors->hash_table,
-				   GUINT_TO_POINTER(pattern));
+	if (sub_dissectors->uint_index_stale)
+		return (dtbl_entry_t *)g_hash_table_lookup(sub_dissectors->hash_table,
+					   GUINT_TO_POINTER(pattern));
+	return (dtbl_entry_t *)ws_uint_index_lookup(&sub_dissectors->uint_index, pattern);
+}
+
+/*
+ * Find an entry in a uint dissector table on the dissection path,
+ * rebuilding the table's index first if entries have been added or
+ * removed since it was last built.
+ */
+static dtbl_entry_t *
+find_uint_dtbl_entry_for_dissection(dissector_table_t sub_dissectors, const uint32_t pattern)
+{
+	if (sub_dissectors->uint_index_stale) {
+		ws_uint_index_build(&sub_dissectors->uint_index, sub_dissectors->hash_table);
+		sub_dissectors->uint_index_stale = false;
+	}
+	return find_uint_dtbl_entry(sub_dissectors, pattern);
+}
+
+/*
+ * Note that entries have been added to or removed from a dissector table.
+ * The index of a uint table isn't rebuilt until the table is next used for
+ * dissection, so that registration, or a Decode As change to a range of
+ * ports, doesn't rebuild it once per entry. Changing the handle of an
+ * existing entry doesn't make the index stale, as it points to the entry.
+ */
+static inline void
+dissector_table_changed(dissector_table_t sub_dissectors)
+{
+	sub_dissectors->uint_index_stale = true;
 }
 
 #if 0
@@ -1344,6 +1563,7 @@ dissector_add_uint_real(const char *name _U_, const uint32_t pattern, dissector_
 	/* do the table insertion */
 	g_hash_table_insert(sub_dissectors->hash_table,
 			     GUINT_TO_POINTER(pattern), (void *)dtbl_entry);
+	dissector_table_changed(sub_dissectors);
 }
 
 /* Add an entry to a uint dissector table. */
@@ -1550,6 +1770,7 @@ dissector_delete_uint(const char *name, const uint32_t pattern,
 		 */
 		g_hash_table_remove(sub_dissectors->hash_table,
 				    GUINT_TO_POINTER(pattern));
+		dissector_table_changed(sub_dissectors);
 	}
 }
 
@@ -1621,6 +1842,7 @@ void dissector_delete_all(const char *name, dissector_handle_t handle)
 	ws_assert (sub_dissectors);
 
 	g_hash_table_foreach_remove (sub_dissectors->hash_table, dissector_delete_all_check, handle);
+	dissector_table_changed(sub_dissectors);
 }
 
 static void
@@ -1632,6 +1854,7 @@ dissector_delete_from_table(void *key _U_, void *value, void *user_data)
 	dissector_handle_t handle = (dissector_handle_t) user_data;
 
 	g_hash_table_foreach_remove(sub_dissectors->hash_table, dissector_delete_all_check, user_data);
+	dissector_table_changed(sub_dissectors);
 	sub_dissectors->dissector_handles = g_slist_remove(sub_dissectors->dissector_handles, user_data);
 	if (sub_dissectors->da_descriptions)
 		g_hash_table_remove(sub_dissectors->da_descriptions, handle->description);
@@ -1667,6 +1890,7 @@ dissector_change_uint(const char *name, const uint32_t pattern, dissector_handle
 		if (handle == NULL && dtbl_entry->initial == NULL) {
 			g_hash_table_remove(sub_dissectors->hash_table,
 					    GUINT_TO_POINTER(pattern));
+			dissector_table_changed(sub_dissectors);
 			return;
 		}
 		dtbl_entry->current = handle;
@@ -1688,6 +1912,7 @@ dissector_change_uint(const char *name, const uint32_t pattern, dissector_handle
 	/* do the table insertion */
 	g_hash_table_insert(sub_dissectors->hash_table,
 			     GUINT_TO_POINTER(pattern), (void *)dtbl_entry);
+	dissector_table_changed(sub_dissectors);
 }
 
 /* Reset an entry in a uint dissector table to its initial value. */
@@ -1716,6 +1941,7 @@ dissector_reset_uint(const char *name, const uint32_t pattern)
 	} else {
 		g_hash_table_remove(sub_dissectors->hash_table,
 				    GUINT_TO_POINTER(pattern));
+		dissector_table_changed(sub_dissectors);
 	}
 }
 
@@ -1728,7 +1954,7 @@ bool
 dissector_is_uint_changed(dissector_table_t const sub_dissectors, const uint32_t uint_val)
 {
 	if (sub_dissectors != NULL) {
-		dtbl_entry_t *dtbl_entry = find_uint_dtbl_entry(sub_dissectors, uint_val);
+		dtbl_entry_t *dtbl_entry = find_uint_dtbl_entry_for_dissection(sub_dissectors, uint_val);
 		if (dtbl_entry != NULL)
 			return (dtbl_entry->current != dtbl_entry->initial);
 	}
@@ -1749,7 +1975,7 @@ dissector_try_uint_with_data(dissector_table_t sub_dissectors, const uint32_t ui
 	uint32_t                 saved_match_uint;
 	int len;
 
-	dtbl_entry = find_uint_dtbl_entry(sub_dissectors, uint_val);
+	dtbl_entry = find_uint_dtbl_entry_for_dissection(sub_dissectors, uint_val);
 	if (dtbl_entry == NULL) {
 		/*
 		 * There's no entry in the table for our value.
@@ -1811,7 +2037,7 @@ dissector_get_uint_handle(dissector_table_t const sub_dissectors, const uint32_t
 {
 	dtbl_entry_t *dtbl_entry;
 
-	dtbl_entry = find_uint_dtbl_entry(sub_dissectors, uint_val);
+	dtbl_entry = find_uint_dtbl_entry_for_dissection(sub_dissectors, uint_val);
 	if (dtbl_entry != NULL)
 		return dtbl_entry->current;
 	else
@@ -2836,6 +3062,8 @@ register_dissector_table(const char *name, const char *ui_name, const int proto,
 		ws_error("The dissector table %s (%s) is registering an unsupported type - are you using a buggy plugin?", name, ui_name);
 		ws_assert_not_reached();
 	}
+	ws_uint_index_init(&sub_dissectors->uint_index);
+	sub_dissectors->uint_index_stale = true;
 	sub_dissectors->dissector_handles = NULL;
 	sub_dissectors->da_descriptions = NULL;
 	sub_dissectors->ui_name = ui_name;
@@ -2863,6 +3091,8 @@ dissector_table_t register_custom_dissector_table(const char *name,
 							       key_destroy_func,
 							       &g_free);
 
+	ws_uint_index_init(&sub_dissectors->uint_index);
+	sub_dissectors->uint_index_stale = true;
 	sub_dissectors->dissector_handles = NULL;
 	sub_dissectors->da_descriptions = NULL;
 	sub_dissectors->ui_name = ui_name;
@@ -3020,6 +3250,9 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const char *dis
 	hdtbl_entry->list_name = g_strdup(name);
 	hdtbl_entry->enabled   = (enable == HEURISTIC_ENABLE);
 	hdtbl_entry->enabled_by_default = (enable == HEURISTIC_ENABLE);
+	hdtbl_entry->attempts  = 0;
+	hdtbl_entry->hits      = 0;
+	hdtbl_entry->time_ns   = 0;
 
 	/* do the table insertion */
 	/* Ensure short_name is unique */
@@ -3078,6 +3311,70 @@ heur_dissector_delete(const char *name, heur_dissector_t dissector, const int pr
 	}
 }
 
+/*
+ * Move a heuristic dissector that has just matched ahead of others in its
+ * list, as prefs.heuristic_order says, so that it's tried sooner next time.
+ */
+static void
+heur_dissector_promote(heur_dissector_list_t sub_dissectors, GSList *entry)
+{
+	heur_dtbl_entry_t *hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+	GSList            *pos;
+
+	if (entry == sub_dissectors->dissectors)
+		return;
+
+	switch (prefs.heuristic_order) {
+
+	case HEUR_ORDER_FIXED:
+		break;
+
+	case HEUR_ORDER_HITS:
+		/* Stay behind every dissector that has matched at least as often,
+		   so that ties keep their order. */
+		for (pos = sub_dissectors->dissectors; pos != entry; pos = g_slist_next(pos)) {
+			if (((heur_dtbl_entry_t *)pos->data)->hits < hdtbl_entry->hits)
+				break;
+		}
+		if (pos != entry) {
+			sub_dissectors->dissectors = g_slist_remove_link(sub_dissectors->dissectors, entry);
+			sub_dissectors->dissectors = g_slist_insert_before(sub_dissectors->dissectors, pos, hdtbl_entry);
+			g_slist_free_1(entry);
+		}
+		break;
+
+	case HEUR_ORDER_LAST_MATCH:
+	default:
+		/* Bubble the matched entry to the top for faster search next time. */
+		sub_dissectors->dissectors = g_slist_remove_link(sub_dissectors->dissectors, entry);
+		sub_dissectors->dissectors = g_slist_concat(entry, sub_dissectors->dissectors);
+		break;
+	}
+}
+
+/* Call a heuristic dissector with a protocol, profiling the call. */
+static int
+call_heuristic_profiled(heur_dtbl_entry_t *hdtbl_entry, tvbuff_t *tvb,
+			packet_info *pinfo, proto_tree *tree, void *data)
+{
+	dissector_profile_call_t call;
+	volatile int len = 0;
+
+	dissector_profile_enter(&call, pinfo);
+	TRY {
+		len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+	}
+	FINALLY {
+		uint64_t elapsed_ns = dissector_profile_leave(&call, pinfo, hdtbl_entry->protocol);
+
+		if (heur_timing)
+			hdtbl_entry->time_ns += elapsed_ns;
+	}
+	ENDTRY;
+
+	return len;
+}
+
 bool
 dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 			packet_info *pinfo, proto_tree *tree, heur_dtbl_entry_t **heur_dtbl_entry, void *data)
@@ -3087,7 +3384,6 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	int                saved_proto_layer_num;
 	const char        *saved_heur_list_name;
 	GSList            *entry;
-	GSList            *prev_entry = NULL;
 	uint16_t           saved_can_desegment;
 	unsigned           saved_layers_len = 0;
 	heur_dtbl_entry_t *hdtbl_entry;
@@ -3134,6 +3430,14 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 			continue;
 		}
 
+		if (dissector_prune_protocol(hdtbl_entry->protocol, pinfo)) {
+			/*
+			 * Pruned; if nothing else claims the data, it
+			 * ends up with the (equally pruned) data dissector.
+			 */
+			continue;
+		}
+
 		if (hdtbl_entry->protocol != NULL) {
 			proto_id = proto_get_id(hdtbl_entry->protocol);
 			/* do NOT change this behavior - wslua uses the protocol short name set here in order
@@ -3151,7 +3455,16 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 		pinfo->heur_list_name = hdtbl_entry->list_name;
 
 		saved_desegment_len = pinfo->desegment_len;
-		len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+		hdtbl_entry->attempts++;
+		if (dissector_profiling && hdtbl_entry->protocol != NULL) {
+			len = call_heuristic_profiled(hdtbl_entry, tvb, pinfo, tree, data);
+		} else if (heur_timing) {
+			uint64_t start_ns = ws_clock_get_monotonic_ns();
+			len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+			hdtbl_entry->time_ns += ws_clock_get_monotonic_ns() - start_ns;
+		} else {
+			len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+		}
 		consumed_none = len == 0 || (pinfo->desegment_len != saved_desegment_len && pinfo->desegment_offset == 0);
 		if (hdtbl_entry->protocol != NULL &&
 			(consumed_none || (tree && saved_tree_count == tree->tree_data->count))) {
@@ -3176,16 +3489,11 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 			}
 
 			*heur_dtbl_entry = hdtbl_entry;
-
-			/* Bubble the matched entry to the top for faster search next time. */
-			if (prev_entry != NULL) {
-				sub_dissectors->dissectors = g_slist_remove_link(sub_dissectors->dissectors, entry);
-				sub_dissectors->dissectors = g_slist_concat(entry, sub_dissectors->dissectors);
-			}
+			hdtbl_entry->hits++;
+			heur_dissector_promote(sub_dissectors, entry);
 			status = true;
 			break;
 		}
-		prev_entry = entry;
 	}
 
 	pinfo->current_proto = saved_curr_proto;
@@ -3331,6 +3639,109 @@ dissector_dump_heur_decodes(void)
 	dissector_all_heur_tables_foreach_table(dissector_dump_heur_decodes_display, NULL, NULL);
 }
 
+void
+heur_dissector_set_timing(bool enable)
+{
+	heur_timing = enable;
+}
+
+void
+heur_dissector_reset_stats(void)
+{
+	GHashTableIter iter;
+	void *value;
+
+	g_hash_table_iter_init(&iter, heur_dissector_lists);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		heur_dissector_list_t sub_dissectors = (heur_dissector_list_t)value;
+
+		for (GSList *entry = sub_dissectors->dissectors; entry != NULL; entry = g_slist_next(entry)) {
+			heur_dtbl_entry_t *hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+
+			hdtbl_entry->attempts = 0;
+			hdtbl_entry->hits = 0;
+			hdtbl_entry->time_ns = 0;
+		}
+	}
+}
+
+void
+dissector_profile_reset(void)
+{
+	g_hash_table_remove_all(dissector_profiles);
+	g_ptr_array_set_size(dissector_profile_list, 0);
+}
+
+void
+dissector_profile_foreach(GFunc func, void *user_data)
+{
+	g_ptr_array_foreach(dissector_profile_list, func, user_data);
+}
+
+typedef struct {
+	const char        *list_name;
+	heur_dtbl_entry_t *hdtbl_entry;
+} heur_stats_row_t;
+
+static int
+heur_stats_row_compare(const void *a, const void *b)
+{
+	const heur_stats_row_t *row_a = *(const heur_stats_row_t * const *)a;
+	const heur_stats_row_t *row_b = *(const heur_stats_row_t * const *)b;
+	int ret;
+
+	ret = strcmp(row_a->list_name, row_b->list_name);
+	if (ret != 0)
+		return ret;
+	if (row_a->hdtbl_entry->attempts != row_b->hdtbl_entry->attempts)
+		return row_a->hdtbl_entry->attempts > row_b->hdtbl_entry->attempts ? -1 : 1;
+	return strcmp(row_a->hdtbl_entry->short_name, row_b->hdtbl_entry->short_name);
+}
+
+void
+heur_dissector_dump_stats(FILE *fh)
+{
+	GHashTableIter iter;
+	void *key, *value;
+	GPtrArray *rows;
+
+	rows = g_ptr_array_new_with_free_func(g_free);
+	g_hash_table_iter_init(&iter, heur_dissector_lists);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		heur_dissector_list_t sub_dissectors = (heur_dissector_list_t)value;
+
+		for (GSList *entry = sub_dissectors->dissectors; entry != NULL; entry = g_slist_next(entry)) {
+			heur_dtbl_entry_t *hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+			heur_stats_row_t *row;
+
+			if (hdtbl_entry->attempts == 0)
+				continue;
+			row = g_new(heur_stats_row_t, 1);
+			row->list_name = (const char *)key;
+			row->hdtbl_entry = hdtbl_entry;
+			g_ptr_array_add(rows, row);
+		}
+	}
+	g_ptr_array_sort(rows, heur_stats_row_compare);
+
+	fprintf(fh, "%-20s %-24s %12s %12s %7s %12s\n",
+	    "List", "Dissector", "Attempts", "Hits", "Hit %", "Time (ms)");
+	for (unsigned i = 0; i < rows->len; i++) {
+		heur_stats_row_t *row = (heur_stats_row_t *)g_ptr_array_index(rows, i);
+		heur_dtbl_entry_t *hdtbl_entry = row->hdtbl_entry;
+
+		fprintf(fh, "%-20s %-24s %12" PRIu64 " %12" PRIu64 " %7.2f",
+		    row->list_name, hdtbl_entry->short_name,
+		    hdtbl_entry->attempts, hdtbl_entry->hits,
+		    100.0 * (double)hdtbl_entry->hits / (double)hdtbl_entry->attempts);
+		if (heur_timing)
+			fprintf(fh, " %12.3f\n", (double)hdtbl_entry->time_ns / 1000000.0);
+		else
+			fprintf(fh, " %12s\n", "-");
+	}
+	g_ptr_array_free(rows, true);
+}
+
 
 heur_dissector_list_t
 register_heur_dissector_list_with_description(const char *name, const char *ui_name, const int proto)
@@ -3843,6 +4254,106 @@ depend_dissector_list_t find_depend_dissector_list(const char* name)
 	return (depend_dissector_list_t)g_hash_table_lookup(depend_dissector_lists, name);
 }
 
+static void
+prune_add_reverse_depends(void *key, void *value, void *user_data)
+{
+	const char *parent = (const char *)key;
+	depend_dissector_list_t sub_dissectors = (depend_dissector_list_t)value;
+	GHashTable *parents_of = (GHashTable *)user_data;
+	GHashTableIter iter;
+	void *dependent;
+	GSList *parents;
+
+	g_hash_table_iter_init(&iter, sub_dissectors->dissectors);
+	while (g_hash_table_iter_next(&iter, &dependent, NULL)) {
+		parents = (GSList *)g_hash_table_lookup(parents_of, dependent);
+		g_hash_table_steal(parents_of, dependent);
+		g_hash_table_insert(parents_of, dependent, g_slist_prepend(parents, (void *)parent));
+	}
+}
+
+static void
+prune_free_parents(void *data)
+{
+	g_slist_free((GSList *)data);
+}
+
+void
+dissector_prune_clear(void)
+{
+	if (prune_keep_protos != NULL) {
+		g_hash_table_destroy(prune_keep_protos);
+		prune_keep_protos = NULL;
+	}
+	if (prune_needed_protos != NULL) {
+		g_hash_table_destroy(prune_needed_protos);
+		prune_needed_protos = NULL;
+	}
+}
+
+bool
+dissector_prune_set_hfids(const int *hfids, unsigned num_hfids)
+{
+	GHashTable     *parents_of;
+	GHashTableIter  iter;
+	void           *key;
+	GQueue          pending = G_QUEUE_INIT;
+	const char     *name;
+	GSList         *parent;
+	int             proto_id;
+
+	dissector_prune_clear();
+
+	if (num_hfids == 0)
+		return false;
+
+	prune_needed_protos = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (unsigned i = 0; i < num_hfids; i++) {
+		if (proto_registrar_is_protocol(hfids[i]))
+			proto_id = hfids[i];
+		else
+			proto_id = proto_registrar_get_parent(hfids[i]);
+		if (proto_id <= 0 ||
+		    g_str_has_prefix(proto_get_protocol_filter_name(proto_id), "_ws.")) {
+			/*
+			 * Not a field of a real protocol, or a field that
+			 * can be added by any dissector (expert info,
+			 * columns, malformed packet...); we can't tell what
+			 * to leave out.
+			 */
+			dissector_prune_clear();
+			return false;
+		}
+		g_hash_table_add(prune_needed_protos, GINT_TO_POINTER(proto_id));
+	}
+
+	/* Invert the "parent calls dependent" lists. */
+	parents_of = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, prune_free_parents);
+	g_hash_table_foreach(depend_dissector_lists, prune_add_reverse_depends, parents_of);
+
+	/* Everything that can lead to a requested protocol is kept. */
+	prune_keep_protos = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_hash_table_iter_init(&iter, prune_needed_protos);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		g_hash_table_add(prune_keep_protos, key);
+		g_queue_push_tail(&pending, (void *)proto_get_protocol_short_name(find_protocol_by_id(GPOINTER_TO_INT(key))));
+	}
+	while ((name = (const char *)g_queue_pop_head(&pending)) != NULL) {
+		for (parent = (GSList *)g_hash_table_lookup(parents_of, name); parent != NULL; parent = parent->next) {
+			proto_id = proto_get_id_by_short_name((const char *)parent->data);
+			if (proto_id <= 0 || g_hash_table_contains(prune_keep_protos, GINT_TO_POINTER(proto_id)))
+				continue;
+			g_hash_table_add(prune_keep_protos, GINT_TO_POINTER(proto_id));
+			g_queue_push_tail(&pending, parent->data);
+		}
+	}
+	g_hash_table_destroy(parents_of);
+
+	ws_debug("Pruning dissection to %u protocols (%u requested)",
+	    g_hash_table_size(prune_keep_protos), g_hash_table_size(prune_needed_protos));
+	return true;
+}
+
 /*
  * Dumps the "layer type"/"decode as" associations to stdout, similar
  * to the proto_registrar_dump_*() routines.
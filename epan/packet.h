@@ -8,6 +8,7 @@
  * SPDX-License-Identifier: GPL-2.0-or-later
  */
 #pragma once
+#include <stdio.h>
 #include <wsutil/array.h>
 #include "proto.h"
 #include "range.h"
@@ -676,6 +677,9 @@ typedef struct heur_dtbl_entry {
     char*            short_name;       /**< Internal unique identifier string used to distinguish this heuristic from others. */
     bool             enabled;          /**< Whether this heuristic dissector is currently enabled. */
     bool             enabled_by_default; /**< Whether this heuristic dissector is enabled by default upon registration. */
+    uint64_t         attempts;         /**< Number of times the dissector has been tried. */
+    uint64_t         hits;             /**< Number of times it has accepted the data. */
+    uint64_t         time_ns;          /**< Time spent in it, in nanoseconds, while timing is on; see heur_dissector_set_timing(). */
 } heur_dtbl_entry_t;
 
 /** A protocol uses this function to register a heuristic sub-dissector list.
@@ -1091,6 +1095,26 @@ WS_DLL_PUBLIC bool deregister_depend_dissector(const char* parent, const char* d
  */
 WS_DLL_PUBLIC depend_dissector_list_t find_depend_dissector_list(const char* name);
 
+/** Restrict dissection to the protocols needed to produce a set of fields.
+ * The protocols of the given fields, and every protocol from which one of
+ * them can be reached according to the dependency lists above, are
+ * dissected as usual.  Once one of the requested protocols is on the
+ * layer stack of a packet, calls into any other protocol are skipped,
+ * and the data they would have dissected is treated as consumed.
+ *
+ * This is meant for field extraction (e.g. "tshark -T fields"); it is not
+ * suitable when the full protocol tree, columns or taps are wanted.
+ *
+ *   @param hfids Array of header field IDs (fields or protocols)
+ *   @param num_hfids Number of entries in hfids
+ *   @return true if pruning was enabled, false if the fields don't allow
+ *   it (e.g. columns or expert info) and full dissection remains in effect
+ */
+WS_DLL_PUBLIC bool dissector_prune_set_hfids(const int *hfids, unsigned num_hfids);
+
+/** Disable pruning enabled by dissector_prune_set_hfids(). */
+WS_DLL_PUBLIC void dissector_prune_clear(void);
+
 /**
  * @brief Given a tvbuff, and a length from a packet header, adjust the length
  * of the tvbuff to reflect the specified length.
@@ -1358,6 +1382,65 @@ WS_DLL_PUBLIC void dissector_dump_decodes(void);
  */
 WS_DLL_PUBLIC void dissector_dump_heur_decodes(void);
 
+/**
+ * @brief Time each call to a heuristic dissector, or stop doing so.
+ *
+ * The attempts and hits of each heuristic dissector are always counted;
+ * timing them costs two clock reads per attempt, so it's off by default.
+ *
+ * @param enable true to time the calls.
+ */
+WS_DLL_PUBLIC void heur_dissector_set_timing(bool enable);
+
+/**
+ * @brief Set the attempts, hits and time of every heuristic dissector to zero.
+ */
+WS_DLL_PUBLIC void heur_dissector_reset_stats(void);
+
+/**
+ * @brief Print the attempts, hits and time of each heuristic dissector that
+ * has been tried, by list, most often tried first.
+ *
+ * @param fh The file to print to.
+ */
+WS_DLL_PUBLIC void heur_dissector_dump_stats(FILE *fh);
+
+/**
+ * @brief The profile of the calls to one protocol's dissectors.
+ *
+ * Calls through dissector handles and to heuristic dissectors are
+ * profiled while there is a listener for the "dissector_profile" tap,
+ * which gets a packet, with no data, after each record is dissected.
+ * Otherwise nothing is measured, and it costs nothing.
+ *
+ * The exclusive time and memory of a call leave out those of the
+ * dissectors it calls. Dissectors without a protocol aren't profiled,
+ * so they count towards the dissector that called them. Calls that
+ * throw an exception are profiled too.
+ */
+typedef struct dissector_profile {
+    int      proto_id;          /**< The protocol. */
+    uint64_t calls;             /**< Number of calls, including ones that rejected the data. */
+    uint64_t inclusive_ns;      /**< Time spent in the calls, in nanoseconds. */
+    uint64_t exclusive_ns;      /**< Time spent in the calls but not in the dissectors they called. */
+    uint64_t bytes_allocated;   /**< Bytes allocated from pinfo->pool by the calls but not the dissectors they called. */
+} dissector_profile_t;
+
+/**
+ * @brief Forget the profile of every protocol.
+ */
+WS_DLL_PUBLIC void dissector_profile_reset(void);
+
+/**
+ * @brief Call a function for the profile of each protocol that has been
+ * called since the last reset, in the order in which they were first
+ * called.
+ *
+ * @param func The function, which gets a dissector_profile_t.
+ * @param user_data Passed to the function.
+ */
+WS_DLL_PUBLIC void dissector_profile_foreach(GFunc func, void *user_data);
+
 /*
  * postdissectors are to be called by packet-frame.c after every other
  * dissector has been called.
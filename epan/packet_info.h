@@ -82,6 +82,7 @@ typedef struct _packet_info {
   bool use_conv_addr_port_endpoints;                  /**< True if address/port endpoints should be used for conversations */
   struct conversation_addr_port_endpoints *conv_addr_port_endpoints; /**< Address+port conversation data, including wildcarding */
   struct conversation_element *conv_elements;         /**< Arbitrary conversation identifier (cannot be wildcarded) */
+  struct conversation_pinfo_memo *conv_memo;          /**< Results of find_conversation_pinfo() for this packet (private to conversation.c) */
 
   uint16_t can_desegment;                             /**< >0 if this segment could be desegmented.
                                                           A dissector that can offer this API (e.g.
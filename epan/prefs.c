@@ -175,6 +175,13 @@ static const enum_val_t abs_time_format_options[] = {
     {NULL, NULL, -1}
 };
 
+static const enum_val_t heur_order_options[] = {
+    {"LAST_MATCH", "Most recently matched first", HEUR_ORDER_LAST_MATCH},
+    {"FIXED", "Registration order", HEUR_ORDER_FIXED},
+    {"HITS", "Most often matched first", HEUR_ORDER_HITS},
+    {NULL, NULL, -1}
+};
+
 static const enum_val_t gui_packet_list_elide_mode[] = {
     {"LEFT", "LEFT", ELIDE_LEFT},
     {"RIGHT", "RIGHT", ELIDE_RIGHT},
@@ -3961,12 +3968,51 @@ prefs_register_modules(void)
                                    "Separate into different conversations frames that look like duplicates but have different Interface, MAC, or VLAN field values.",
                                    (int *)&prefs.conversation_deinterlacing_key, conv_deint_options, false);
 
+    prefs_register_enum_preference(protocols_module, "heuristic_order",
+                                   "Order in which heuristic dissectors are tried",
+                                   "Heuristic dissectors that match are moved ahead of the others in their list, "
+                                   "so that they're tried first next time. \"Registration order\" never moves them, "
+                                   "so that which dissector a payload goes to doesn't depend on the packets before it. "
+                                   "\"Most often matched first\" only moves a dissector ahead of those that have matched fewer times.",
+                                   (int *)&prefs.heuristic_order, heur_order_options, false);
+
     prefs_register_uint_preference(protocols_module, "ignore_dup_frames_cache_entries",
             "The max number of hashes to keep in memory for determining duplicates frames",
             "If \"Ignore duplicate frames\" is set, this setting sets the maximum number "
             "of cache entries to maintain. A 0 means no limit.",
             10, &prefs.ignore_dup_frames_cache_entries);
 
+    prefs_register_uint_preference(protocols_module, "reassembly_max_age_frames",
+            "Discard incomplete reassemblies after this many frames",
+            "On the first pass, fragments of a reassembly that have seen no new "
+            "fragment for this many frames are discarded. A 0 means never.",
+            10, &prefs.reassembly_max_age_frames);
+
+    prefs_register_uint_preference(protocols_module, "reassembly_max_age_secs",
+            "Discard incomplete reassemblies after this many seconds",
+            "On the first pass, fragments of a reassembly that have seen no new "
+            "fragment for this many seconds of capture time are discarded. A 0 means never.",
+            10, &prefs.reassembly_max_age_secs);
+
+    prefs_register_uint_preference(protocols_module, "reassembly_table_memory_limit",
+            "Reassembly memory limit per table (MiB)",
+            "When one reassembly table holds more than this, its completed "
+            "reassemblies are moved to disk if allowed, and then its oldest "
+            "incomplete reassemblies are discarded. A 0 means no limit.",
+            10, &prefs.reassembly_table_memory_limit);
+
+    prefs_register_uint_preference(protocols_module, "reassembly_memory_limit",
+            "Reassembly memory limit (MiB)",
+            "As the per table limit, but for all reassembly tables together. A 0 means no limit.",
+            10, &prefs.reassembly_memory_limit);
+
+    prefs_register_bool_preference(protocols_module, "reassembly_spill_completed",
+            "Move completed reassemblies to disk when over the memory limit",
+            "Keep the data of completed reassemblies in a temporary file rather than "
+            "in memory once a reassembly memory limit is reached. They are read back "
+            "when needed again, e.g. on the second pass or when a packet is selected.",
+            &prefs.reassembly_spill_completed);
+
 
     /* Obsolete preferences
      * These "modules" were reorganized/renamed to correspond to their GUI
@@ -4292,8 +4338,14 @@ prefs_set_global_defaults(wmem_allocator_t* pref_scope, const char** col_fmt, in
     prefs.display_hidden_proto_items = false;
     prefs.display_byte_fields_with_spaces = false;
     prefs.display_abs_time_ascii = ABS_TIME_ASCII_TREE;
+    prefs.heuristic_order = HEUR_ORDER_LAST_MATCH;
     prefs.ignore_dup_frames = false;
     prefs.ignore_dup_frames_cache_entries = 10000;
+    prefs.reassembly_max_age_frames = 0;
+    prefs.reassembly_max_age_secs = 0;
+    prefs.reassembly_table_memory_limit = 0;
+    prefs.reassembly_memory_limit = 0;
+    prefs.reassembly_spill_completed = false;
 
     /* set the default values for the io graph dialog */
     prefs.gui_io_graph_automatic_update = true;
@@ -176,6 +176,15 @@ typedef enum {
     ABS_TIME_ASCII_ALWAYS, /**< Always render absolute timestamps as ASCII strings */
 } abs_time_format_e;
 
+/**
+ * @brief Order in which the heuristic dissectors of a list are tried.
+ */
+typedef enum {
+    HEUR_ORDER_LAST_MATCH,  /**< The one that matched most recently first (the default) */
+    HEUR_ORDER_FIXED,       /**< Never reorder; results don't depend on earlier packets */
+    HEUR_ORDER_HITS,        /**< The ones that have matched most often first */
+} heur_order_e;
+
 
 /**
  * @brief Automatic software update channel selection.
@@ -319,11 +328,19 @@ typedef struct _e_prefs {
     bool          incomplete_dissectors_check_debug;   /**< If true, emit debug output for incomplete dissector checks */
     bool          strict_conversation_tracking_heuristics; /**< If true, apply stricter heuristics for conversation tracking */
     int           conversation_deinterlacing_key;      /**< Key bitmask controlling conversation deinterlacing behavior */
+    heur_order_e  heuristic_order;                     /**< Order in which heuristic dissectors are tried */
 
     /* Duplicate frame detection */
     bool          ignore_dup_frames;                   /**< If true, suppress display of duplicate frames */
     unsigned      ignore_dup_frames_cache_entries;     /**< Number of frames to cache for duplicate detection */
 
+    /* Reassembly memory */
+    unsigned      reassembly_max_age_frames;           /**< Discard incomplete reassemblies idle for this many frames (0 = never) */
+    unsigned      reassembly_max_age_secs;             /**< Discard incomplete reassemblies idle for this many seconds (0 = never) */
+    unsigned      reassembly_table_memory_limit;       /**< Per-table reassembly memory budget in MiB (0 = unlimited) */
+    unsigned      reassembly_memory_limit;             /**< Reassembly memory budget across all tables in MiB (0 = unlimited) */
+    bool          reassembly_spill_completed;          /**< If true, move completed reassemblies to a temporary file when over budget */
+
     /* Migration flags */
     bool          filter_expressions_old;   /**< True if legacy filter expression preferences were loaded from disk */
     bool          cols_hide_new;            /**< True if the new index-based gui.column.hide preference was loaded */
@@ -439,6 +439,11 @@ static GPtrArray *deregistered_slice;
 /* indexed by prefix, contains initializers */
 static GHashTable* prefixes;
 
+/* true while the built-in dissectors are registering their protocols and handoffs */
+static bool registering_builtin;
+/* the number of their fields that WIRESHARK_SKIP_REGISTRATION_CHECKS let through unchecked */
+static unsigned registration_checks_skipped;
+
 /* Contains information about a field when a dissector calls
  * proto_tree_add_item.  */
 #define FIELD_INFO_NEW(pool, fi)  fi = wmem_new(pool, field_info)
@@ -652,8 +657,11 @@ proto_init(GSList *register_all_plugin_protocols_list,
 	   dissector tables, and dissectors to be called through a
 	   handle, and do whatever one-time initialization it needs to
 	   do. */
-	if (register_func != NULL)
+	if (register_func != NULL) {
+		registering_builtin = true;
 		register_func(cb, client_data);
+		registering_builtin = false;
+	}
 
 	/* Now call the registration routines for all epan plugins. */
 	for (GSList *l = register_all_plugin_protocols_list; l != NULL; l = l->next) {
@@ -669,8 +677,14 @@ proto_init(GSList *register_all_plugin_protocols_list,
 	   dissectors; those routines register the dissector in other
 	   dissectors' handoff tables, and fetch any dissector handles
 	   they need. */
-	if (handoff_func != NULL)
+	if (handoff_func != NULL) {
+		registering_builtin = true;
 		handoff_func(cb, client_data);
+		registering_builtin = false;
+	}
+	if (wireshark_skip_registration_checks)
+		ws_info("Skipped the registration checks of %u built-in fields",
+			 registration_checks_skipped);
 
 	/* Now do the same with epan plugins. */
 	for (GSList *l = register_all_plugin_handoffs_list; l != NULL; l = l->next) {
@@ -9568,10 +9582,10 @@ tmp_fld_check_assert(header_field_info *hfinfo)
 	if (!hfinfo->abbrev || !hfinfo->abbrev[0])
 		REPORT_DISSECTOR_BUG("Field '%s' does not have an abbreviation", hfinfo->name);
 
-	/* TODO: This check is a significant percentage of startup time (~10%),
+	/* This check is a significant percentage of startup time (~10%),
 	   although not nearly as slow as what's enabled by ENABLE_CHECK_FILTER.
-	   It might be nice to have a way to disable this check when, e.g.,
-	   running TShark many times with the same configuration. */
+	   WIRESHARK_SKIP_REGISTRATION_CHECKS skips it, and the rest of this
+	   function, for built-in fields; see proto_register_field_init(). */
 	/* Check that the filter name (abbreviation) is legal;
 	 * it must contain only alphanumerics, '-', "_", and ".". */
 	unsigned char c;
@@ -10206,8 +10220,16 @@ register_varint_errors(void)
 static int
 proto_register_field_init(header_field_info *hfinfo, const int parent)
 {
-
-	tmp_fld_check_assert(hfinfo);
+	/*
+	 * Every field of the built-in dissectors is checked whenever the
+	 * test suite runs or a glossary is dumped, so a program that
+	 * starts many times with the same build can skip checking them
+	 * again. Fields from plugins and Lua scripts are always checked.
+	 */
+	if (!(registering_builtin && wireshark_skip_registration_checks))
+		tmp_fld_check_assert(hfinfo);
+	else
+		registration_checks_skipped++;
 
 	hfinfo->parent         = parent;
 	hfinfo->same_name_next = NULL;
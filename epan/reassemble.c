@@ -14,10 +14,13 @@
 
 #include <epan/packet.h>
 #include <epan/exceptions.h>
+#include <epan/prefs.h>
 #include <epan/reassemble.h>
 #include <epan/tvbuff-int.h>
 
+#include <wsutil/file_util.h>
 #include <wsutil/str_util.h>
+#include <wsutil/tempfile.h>
 #include <wsutil/ws_assert.h>
 
 /*
@@ -347,6 +350,64 @@ fragment_item_free_tvb(fragment_item *fd_i)
 	fd_i->tvb_data=NULL;
 }
 
+/*
+ * Can the data of the fragments be handed to a composite tvbuff as is,
+ * rather than copied into a new buffer? Only when nothing has been
+ * reassembled from them before, and every fragment still has its own data.
+ */
+static bool
+fragment_items_shareable(const fragment_head *fd_head)
+{
+	for (const fragment_item *fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
+		if (!fd_i->len)
+			continue;
+		if (!fd_i->tvb_data || (fd_i->flags & (FD_DEFRAGMENTED|FD_SUBSET_TVB)))
+			return false;
+		if (fd_i->offset + fd_i->len < fd_i->offset)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Make a fragment's data (or the part of it from frag_offset on) a member
+ * of the composite reassembled tvbuff. The fragment tvbuff moves to the
+ * composite's chain and is marked FD_SUBSET_TVB so that it is released,
+ * not freed, along with the fragment item.
+ */
+static void
+fragment_item_share_tvb(tvbuff_t *composite, fragment_item *fd_i,
+			const uint32_t frag_offset, const uint32_t len)
+{
+	tvbuff_t *member = fd_i->tvb_data;
+
+	if (frag_offset || len < tvb_captured_length(member))
+		member = tvb_new_subset_length(fd_i->tvb_data, frag_offset, len);
+	tvb_composite_append(composite, member);
+	tvb_add_to_chain(composite, fd_i->tvb_data);
+	fd_i->flags |= FD_SUBSET_TVB;
+}
+
+/*
+ * Compare a fragment with the reassembled data without asking the
+ * (possibly composite) reassembled tvbuff for a contiguous pointer,
+ * which would flatten it.
+ */
+static bool
+fragment_item_conflicts(tvbuff_t *reassembled, const uint32_t offset,
+			tvbuff_t *frag_tvb, const uint32_t len)
+{
+	uint8_t *buf;
+	bool conflict;
+
+	if (!len)
+		return false;
+	buf = (uint8_t *)tvb_memdup(NULL, reassembled, offset, len);
+	conflict = memcmp(buf, tvb_get_ptr(frag_tvb, 0, len), len) != 0;
+	g_free(buf);
+	return conflict;
+}
+
 /* Returns the pointer to the next item so that the list can be freed. */
 static fragment_item*
 fragment_item_free(fragment_item *fd_i)
@@ -375,11 +436,17 @@ static fragment_head *new_head(const uint32_t flags)
  * For a reassembled-packet hash table entry, free the fragment data
  * to which the value refers. (The key is freed by reassembled_key_free.)
  */
+static void reassembly_spill_unref(void);
+
 static void
 free_fd_head(fragment_head *fd_head)
 {
 	fragment_item *fd_i;
 
+	if (fd_head->spill_len)
+		reassembly_spill_unref();
+	if (fd_head->unspilled)
+		fd_head->unspilled->fd_head = NULL;
 	if (fd_head->flags & FD_SUBSET_TVB)
 		fd_head->tvb_data = NULL;
 	if (fd_head->tvb_data)
@@ -422,21 +489,483 @@ free_all_fragments(void *key_arg _U_, void *value, void *user_data _U_)
 	return TRUE;
 }
 
+/* ------------------------- memory limits ------------------------- */
+
+/*
+ * The reassembly preferences in the "protocols" module put limits on how
+ * long incomplete reassemblies are kept and on how much memory the tables
+ * use. Tables are checked against them every REASSEMBLY_SWEEP_INTERVAL
+ * fragments, or more often while over a limit.
+ */
+#define REASSEMBLY_SWEEP_INTERVAL		256
+#define REASSEMBLY_SWEEP_INTERVAL_OVER_LIMIT	16
+
+/* Once over a limit, free memory until this percentage of it is used. */
+#define REASSEMBLY_LIMIT_LOW_WATER		90
+
+/* Bytes held by all reassembly tables together. */
+static size_t reassembly_memory_used;
+
+/*
+ * Completed reassemblies moved out of memory are appended to one
+ * temporary file, shared by all tables and removed when the tables are
+ * cleaned up.
+ */
+static int spill_fd = -1;
+static char *spill_path;
+static uint64_t spill_size;
+static bool spill_failed;
+static unsigned spill_refs;	/* fd_heads with data in the file */
+
+typedef struct {
+	reassembled_key key;
+	uint32_t queued_in;	/* frame in which it was queued */
+} spill_queue_entry;
+
+/*
+ * Data read back from the spill file for a frame that was already
+ * dissected. The dissections that looked it up hold it until their
+ * pinfo->pool is freed; after the last of them it goes back to disk.
+ */
+typedef struct _reassembly_unspilled {
+	fragment_head *fd_head;	/* NULL once the reassembly is freed */
+	unsigned refs;		/* lookups still holding the data */
+} reassembly_unspilled;
+
+static void
+reassembly_table_set_pending(reassembly_table *table, size_t bytes)
+{
+	reassembly_memory_used -= table->pending_bytes;
+	reassembly_memory_used += bytes;
+	table->pending_bytes = bytes;
+}
+
+static void
+reassembly_table_add_completed(reassembly_table *table, size_t bytes)
+{
+	reassembly_memory_used += bytes;
+	table->completed_bytes += bytes;
+}
+
+static void
+reassembly_table_sub_completed(reassembly_table *table, size_t bytes)
+{
+	bytes = MIN(bytes, table->completed_bytes);
+	reassembly_memory_used -= bytes;
+	table->completed_bytes -= bytes;
+}
+
+static void
+reassembly_table_reset_accounting(reassembly_table *table)
+{
+	reassembly_table_set_pending(table, 0);
+	reassembly_table_sub_completed(table, table->completed_bytes);
+	table->adds_since_sweep = 0;
+	if (table->spill_queue) {
+		g_queue_free_full(table->spill_queue, g_free);
+		table->spill_queue = NULL;
+	}
+}
+
+static bool
+reassembly_limits_enabled(void)
+{
+	return prefs.reassembly_table_memory_limit || prefs.reassembly_memory_limit;
+}
+
+/*
+ * Is the table, or are all tables together, using more than percent
+ * percent of the memory they are allowed?
+ */
+static bool
+reassembly_over_limit(const reassembly_table *table, const unsigned percent)
+{
+	uint64_t table_limit = (uint64_t)prefs.reassembly_table_memory_limit * 1024 * 1024;
+	uint64_t limit = (uint64_t)prefs.reassembly_memory_limit * 1024 * 1024;
+
+	if (table_limit &&
+	    (uint64_t)(table->pending_bytes + table->completed_bytes) * 100 > table_limit * percent)
+		return true;
+	if (limit && (uint64_t)reassembly_memory_used * 100 > limit * percent)
+		return true;
+	return false;
+}
+
+/*
+ * Bytes of fragment (and, if it isn't accounted for as a completed
+ * reassembly, reassembled) data held by an fd_head.
+ */
+static size_t
+fragment_head_bytes(const fragment_head *fd_head)
+{
+	size_t bytes = 0;
+
+	if (fd_head->tvb_data && !(fd_head->flags & FD_SUBSET_TVB) && fd_head->ref_count == 0)
+		bytes += tvb_captured_length(fd_head->tvb_data);
+	for (const fragment_item *fd_i = fd_head->next; fd_i; fd_i = fd_i->next) {
+		if (fd_i->tvb_data && !(fd_i->flags & FD_SUBSET_TVB))
+			bytes += tvb_captured_length(fd_i->tvb_data);
+	}
+	return bytes;
+}
+
+static void
+reassembly_spill_close(void)
+{
+	if (spill_fd != -1) {
+		ws_close(spill_fd);
+		spill_fd = -1;
+	}
+	if (spill_path) {
+		ws_unlink(spill_path);
+		g_free(spill_path);
+		spill_path = NULL;
+	}
+	spill_size = 0;
+	spill_failed = false;
+	spill_refs = 0;
+}
+
+/* The file goes away once nothing refers to it anymore. */
+static void
+reassembly_spill_unref(void)
+{
+	if (spill_refs && --spill_refs == 0)
+		reassembly_spill_close();
+}
+
+static bool
+reassembly_spill_write(const uint8_t *data, const uint32_t len, uint64_t *offset)
+{
+	uint32_t done = 0;
+	ssize_t written;
+
+	if (spill_fd == -1) {
+		if (spill_failed)
+			return false;
+		spill_fd = create_tempfile(NULL, &spill_path, "wireshark_reassembly_", NULL, NULL);
+		if (spill_fd == -1) {
+			/* Don't try again for every reassembly. */
+			spill_failed = true;
+			return false;
+		}
+	}
+	if (ws_lseek64(spill_fd, (int64_t)spill_size, SEEK_SET) == -1)
+		return false;
+	while (done < len) {
+		written = ws_write(spill_fd, data + done, len - done);
+		if (written <= 0)
+			return false;
+		done += (uint32_t)written;
+	}
+	*offset = spill_size;
+	spill_size += len;
+	return true;
+}
+
+static bool
+reassembly_spill_read(const uint64_t offset, uint8_t *data, const uint32_t len)
+{
+	uint32_t done = 0;
+	ssize_t got;
+
+	if (spill_fd == -1 || offset + len > spill_size)
+		return false;
+	if (ws_lseek64(spill_fd, (int64_t)offset, SEEK_SET) == -1)
+		return false;
+	while (done < len) {
+		got = ws_read(spill_fd, data + done, len - done);
+		if (got <= 0)
+			return false;
+		done += (uint32_t)got;
+	}
+	return true;
+}
+
+static void
+reassembly_spill_queue_push(reassembly_table *table, const reassembled_key *key,
+			    const packet_info *pinfo)
+{
+	spill_queue_entry *entry;
+
+	if (!table->spill_queue)
+		table->spill_queue = g_queue_new();
+	entry = g_new(spill_queue_entry, 1);
+	entry->key = *key;
+	entry->queued_in = pinfo->num;
+	g_queue_push_tail(table->spill_queue, entry);
+}
+
+/*
+ * Move the data of a completed reassembly to the spill file (unless it
+ * is already there from an earlier time) and free it.
+ */
+static bool
+reassembly_spill(reassembly_table *table, fragment_head *fd_head,
+		 const packet_info *pinfo)
+{
+	uint32_t len;
+	uint8_t *data;
+	bool ok;
+
+	/* Partial reassemblies may be extended later, and need their data;
+	 * data read back for already dissected frames goes back by itself. */
+	if (!(fd_head->flags & FD_DEFRAGMENTED) ||
+	    (fd_head->flags & (FD_PARTIAL_REASSEMBLY|FD_SUBSET_TVB|FD_SPILLED)) ||
+	    !fd_head->tvb_data || fd_head->unspilled ||
+	    fd_head->reassembled_in == pinfo->num)
+		return false;
+	len = tvb_captured_length(fd_head->tvb_data);
+	if (len == 0)
+		return false;
+
+	if (fd_head->spill_len != len) {
+		data = (uint8_t *)tvb_memdup(NULL, fd_head->tvb_data, 0, len);
+		ok = reassembly_spill_write(data, len, &fd_head->spill_offset);
+		g_free(data);
+		if (!ok)
+			return false;
+		if (!fd_head->spill_len)
+			spill_refs++;
+		fd_head->spill_len = len;
+	}
+
+	tvb_free(fd_head->tvb_data);
+	fd_head->tvb_data = NULL;
+	fd_head->flags |= FD_SPILLED;
+	reassembly_table_sub_completed(table, len);
+	return true;
+}
+
+static bool
+reassembly_unspilled_release(wmem_allocator_t *allocator _U_,
+			     wmem_cb_event_t event _U_, void *user_data)
+{
+	reassembly_unspilled *unspilled = (reassembly_unspilled *)user_data;
+	fragment_head *fd_head = unspilled->fd_head;
+
+	if (--unspilled->refs > 0)
+		return false;
+	if (fd_head) {
+		/* It's still in the spill file; just drop the copy. */
+		tvb_free(fd_head->tvb_data);
+		fd_head->tvb_data = NULL;
+		fd_head->flags |= FD_SPILLED;
+		fd_head->unspilled = NULL;
+	}
+	g_free(unspilled);
+	return false;
+}
+
+/*
+ * Read the data of a completed reassembly back from the spill file.
+ *
+ * On the first pass it stays in memory, counted against the limits, and
+ * is queued to be moved out again. Later passes never drain the queue,
+ * so there it is held for the dissection of this frame only.
+ */
 static void
-reassembled_table_insert(GHashTable *reassembled_table, reassembled_key *key, fragment_head *fd_head)
+reassembly_unspill(reassembly_table *table, fragment_head *fd_head,
+		   const reassembled_key *key, const packet_info *pinfo)
 {
+	uint8_t *data;
+
+	data = (uint8_t *)g_malloc(fd_head->spill_len);
+	if (!reassembly_spill_read(fd_head->spill_offset, data, fd_head->spill_len)) {
+		memset(data, 0, fd_head->spill_len);
+		fd_head->error = "reassembled data could not be read back from disk";
+	}
+	fd_head->tvb_data = tvb_new_real_data(data, fd_head->spill_len, fd_head->spill_len);
+	tvb_set_free_cb(fd_head->tvb_data, g_free);
+	fd_head->flags &= ~FD_SPILLED;
+	if (pinfo->fd->visited) {
+		fd_head->unspilled = g_new0(reassembly_unspilled, 1);
+		fd_head->unspilled->fd_head = fd_head;
+		return;
+	}
+	reassembly_table_add_completed(table, fd_head->spill_len);
+	/* It can be moved out again once it's no longer the newest. */
+	reassembly_spill_queue_push(table, key, pinfo);
+}
+
+/*
+ * Look up a completed reassembly, reading its data back if it was moved
+ * out of memory.
+ */
+static fragment_head *
+lookup_reassembled(reassembly_table *table, const reassembled_key *key,
+		   const packet_info *pinfo)
+{
+	fragment_head *fd_head;
+
+	fd_head = (fragment_head *)g_hash_table_lookup(table->reassembled_table, key);
+	if (fd_head && (fd_head->flags & FD_SPILLED))
+		reassembly_unspill(table, fd_head, key, pinfo);
+	if (fd_head && fd_head->unspilled) {
+		/* Every lookup holds it until its dissection is done, in
+		 * case another dissection of a frame is still using it. */
+		fd_head->unspilled->refs++;
+		wmem_register_callback(pinfo->pool, reassembly_unspilled_release,
+				       fd_head->unspilled);
+	}
+	return fd_head;
+}
+
+typedef struct {
+	fragment_head *fd_head;
+	void *key;
+} sweep_candidate;
+
+typedef struct {
+	const packet_info *pinfo;
+	size_t bytes;
+	GArray *incomplete;	/* sweep_candidate, if limits are set */
+} reassembly_sweep_t;
+
+static bool
+fragment_head_expired(const fragment_head *fd_head, const packet_info *pinfo)
+{
+	if (prefs.reassembly_max_age_frames &&
+	    pinfo->num > fd_head->frame &&
+	    pinfo->num - fd_head->frame > prefs.reassembly_max_age_frames)
+		return true;
+	if (prefs.reassembly_max_age_secs &&
+	    pinfo->abs_ts.secs > fd_head->last_secs &&
+	    (uint64_t)(pinfo->abs_ts.secs - fd_head->last_secs) > prefs.reassembly_max_age_secs)
+		return true;
+	return false;
+}
+
+static gboolean
+reassembly_sweep_fragment(void *key, void *value, void *user_data)
+{
+	fragment_head *fd_head = (fragment_head *)value;
+	reassembly_sweep_t *sweep = (reassembly_sweep_t *)user_data;
+
+	/* Only incomplete reassemblies that nothing else refers to and
+	 * that didn't get a fragment in this frame can go. */
+	if (!(fd_head->flags & FD_DEFRAGMENTED) && fd_head->ref_count == 0 &&
+	    fd_head->frame < sweep->pinfo->num) {
+		if (fragment_head_expired(fd_head, sweep->pinfo)) {
+			free_fd_head(fd_head);
+			return TRUE;
+		}
+		if (sweep->incomplete) {
+			sweep_candidate candidate = { fd_head, key };
+			g_array_append_val(sweep->incomplete, candidate);
+		}
+	}
+	sweep->bytes += fragment_head_bytes(fd_head);
+	return FALSE;
+}
+
+static int
+sweep_candidate_compare(const void *a, const void *b)
+{
+	const sweep_candidate *ca = (const sweep_candidate *)a;
+	const sweep_candidate *cb = (const sweep_candidate *)b;
+
+	if (ca->fd_head->frame < cb->fd_head->frame)
+		return -1;
+	return ca->fd_head->frame > cb->fd_head->frame;
+}
+
+/*
+ * Check a table against the age and memory limits. Completed reassemblies
+ * are moved to disk first, if allowed, as nothing is lost by that; only
+ * then are the incomplete reassemblies that have been idle longest
+ * discarded. Both happen on the first pass only: the second pass must see
+ * what the first one did, and on later passes tvbs handed out for earlier
+ * frames (e.g. in an epan_dissect_t that is kept around) may still point
+ * into reassembled data, so it can't be freed under them.
+ */
+static void
+reassembly_table_maintain(reassembly_table *table, const packet_info *pinfo)
+{
+	bool aging = prefs.reassembly_max_age_frames || prefs.reassembly_max_age_secs;
+	bool limited = reassembly_limits_enabled();
+	reassembly_sweep_t sweep = { pinfo, 0, NULL };
+	spill_queue_entry *entry;
+	fragment_head *fd_head;
+
+	if (!aging && !limited)
+		return;
+
+	table->adds_since_sweep++;
+	if (table->adds_since_sweep < REASSEMBLY_SWEEP_INTERVAL_OVER_LIMIT ||
+	    (table->adds_since_sweep < REASSEMBLY_SWEEP_INTERVAL &&
+	     !(limited && reassembly_over_limit(table, 100))))
+		return;
+	table->adds_since_sweep = 0;
+
+	if (!pinfo->fd->visited) {
+		if (limited)
+			sweep.incomplete = g_array_new(false, false, sizeof(sweep_candidate));
+		g_hash_table_foreach_remove(table->fragment_table,
+					    reassembly_sweep_fragment, &sweep);
+		reassembly_table_set_pending(table, sweep.bytes);
+	}
+
+	if (!pinfo->fd->visited && limited && prefs.reassembly_spill_completed &&
+	    table->spill_queue) {
+		while (reassembly_over_limit(table, REASSEMBLY_LIMIT_LOW_WATER) &&
+		       (entry = (spill_queue_entry *)g_queue_peek_head(table->spill_queue)) != NULL &&
+		       entry->queued_in != pinfo->num) {
+			g_queue_pop_head(table->spill_queue);
+			fd_head = (fragment_head *)g_hash_table_lookup(table->reassembled_table, &entry->key);
+			if (fd_head)
+				reassembly_spill(table, fd_head, pinfo);
+			g_free(entry);
+		}
+	}
+
+	if (sweep.incomplete) {
+		g_array_sort(sweep.incomplete, sweep_candidate_compare);
+		for (unsigned i = 0; i < sweep.incomplete->len &&
+		     reassembly_over_limit(table, REASSEMBLY_LIMIT_LOW_WATER); i++) {
+			sweep_candidate *candidate = &g_array_index(sweep.incomplete, sweep_candidate, i);
+			size_t bytes = fragment_head_bytes(candidate->fd_head);
+
+			/* The fragment table doesn't free values. */
+			g_hash_table_remove(table->fragment_table, candidate->key);
+			free_fd_head(candidate->fd_head);
+			reassembly_table_set_pending(table, table->pending_bytes - MIN(bytes, table->pending_bytes));
+		}
+		g_array_free(sweep.incomplete, true);
+	}
+}
+
+static void
+reassembled_table_insert(reassembly_table *table, reassembled_key *key,
+			 fragment_head *fd_head, const packet_info *pinfo)
+{
+	GHashTable *reassembled_table = table->reassembled_table;
 	fragment_head *old_fd_head;
 	fd_head->ref_count++;
+	if (fd_head->ref_count == 1 && fd_head->tvb_data) {
+		/* Newly completed; account for it, and let it be moved
+		 * out of memory later if that's allowed. Only the first
+		 * pass drains the queue, so only queue it then. */
+		reassembly_table_add_completed(table, tvb_captured_length(fd_head->tvb_data));
+		if (prefs.reassembly_spill_completed && reassembly_limits_enabled() &&
+		    !pinfo->fd->visited)
+			reassembly_spill_queue_push(table, key, pinfo);
+	}
 	if ((old_fd_head = g_hash_table_lookup(reassembled_table, key)) != NULL) {
 		if (old_fd_head->ref_count == 1) {
+			/* The old reassembly is freed when it's replaced
+			 * below; it no longer counts against the limits. */
+			if (old_fd_head->tvb_data && !old_fd_head->unspilled)
+				reassembly_table_sub_completed(table, tvb_captured_length(old_fd_head->tvb_data));
 			/* We're replacing the last entry in the reassembled
 			 * table for an old reassembly. Does it have a tvb?
 			 * We might still be using that tvb's memory for an
 			 * address via set_address_tvb(). (See #19094.)
 			 */
 			if (old_fd_head->tvb_data && fd_head->tvb_data) {
-				/* Free it when the new tvb is freed */
-				tvb_set_child_real_data_tvbuff(fd_head->tvb_data, old_fd_head->tvb_data);
+				/* Free it when the new tvb is freed. (Either
+				 * may be a composite, so chain it directly.) */
+				tvb_add_to_chain(fd_head->tvb_data, old_fd_head->tvb_data);
 			}
 			/* XXX: Set the old data to NULL regardless. If we
 			 * have old data but not new data, that is odd (we're
@@ -492,6 +1021,7 @@ reassembly_table_init(reassembly_table *table,
 		table->persistent_key_func = funcs->persistent_key_func;
 	if (table->free_temporary_key_func == NULL)
 		table->free_temporary_key_func = funcs->free_temporary_key_func;
+	reassembly_table_reset_accounting(table);
 	if (table->fragment_table != NULL) {
 		/*
 		 * The fragment hash table exists.
@@ -537,6 +1067,7 @@ reassembly_table_destroy(reassembly_table *table)
 	table->temporary_key_func = NULL;
 	table->persistent_key_func = NULL;
 	table->free_temporary_key_func = NULL;
+	reassembly_table_reset_accounting(table);
 	if (table->fragment_table != NULL) {
 		/*
 		 * The fragment hash table exists.
@@ -615,6 +1146,8 @@ insert_fd_head(reassembly_table *table, fragment_head *fd_head,
 	 */
 	key = table->persistent_key_func(pinfo, id, data);
 	g_hash_table_insert(table->fragment_table, key, fd_head);
+	if (!fd_head->last_secs)
+		fd_head->last_secs = pinfo->abs_ts.secs;
 	return key;
 }
 
@@ -677,7 +1210,7 @@ fragment_get_reassembled_id(reassembly_table *table, const packet_info *pinfo,
 	/* create key to search hash with */
 	key.frame = pinfo->num;
 	key.id = id;
-	fd_head = (fragment_head *)g_hash_table_lookup(table->reassembled_table, &key);
+	fd_head = lookup_reassembled(table, &key, pinfo);
 
 	return fd_head;
 }
@@ -1046,7 +1579,7 @@ fragment_reassembled(reassembly_table *table, fragment_head *fd_head,
 		new_key = g_slice_new(reassembled_key);
 		new_key->frame = pinfo->num;
 		new_key->id = id;
-		reassembled_table_insert(table->reassembled_table, new_key, fd_head);
+		reassembled_table_insert(table, new_key, fd_head, pinfo);
 	} else {
 		/*
 		 * Hash it with the frame numbers for all the frames.
@@ -1055,7 +1588,7 @@ fragment_reassembled(reassembly_table *table, fragment_head *fd_head,
 			new_key = g_slice_new(reassembled_key);
 			new_key->frame = fd->frame;
 			new_key->id = id;
-			reassembled_table_insert(table->reassembled_table, new_key, fd_head);
+			reassembled_table_insert(table, new_key, fd_head, pinfo);
 		}
 	}
 	fd_head->flags |= FD_DEFRAGMENTED;
@@ -1084,7 +1617,7 @@ fragment_reassembled_single(reassembly_table *table, fragment_head *fd_head,
 		new_key = g_slice_new(reassembled_key);
 		new_key->frame = pinfo->num;
 		new_key->id = id;
-		reassembled_table_insert(table->reassembled_table, new_key, fd_head);
+		reassembled_table_insert(table, new_key, fd_head, pinfo);
 	} else {
 		/*
 		 * Hash it with the frame numbers for all the frames.
@@ -1093,7 +1626,7 @@ fragment_reassembled_single(reassembly_table *table, fragment_head *fd_head,
 			new_key = g_slice_new(reassembled_key);
 			new_key->frame = fd->frame;
 			new_key->id = id + fd->offset;
-			reassembled_table_insert(table->reassembled_table, new_key, fd_head);
+			reassembled_table_insert(table, new_key, fd_head, pinfo);
 		}
 	}
 	fd_head->flags |= FD_DEFRAGMENTED;
@@ -1215,6 +1748,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	uint32_t dfpos, fraglen, overlap;
 	tvbuff_t *old_tvb_data;
 	uint8_t *data;
+	bool share;
 
 	/* create new fd describing this fragment */
 	fd = new_fragment_item(frag_frame, frag_offset, frag_data_len);
@@ -1291,6 +1825,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	 * fd_head->frame in a bad state if we do */
 	if (fd->frame > fd_head->frame)
 		fd_head->frame = fd->frame;
+	fd_head->last_secs = pinfo->abs_ts.secs;
 
 	if (!more_frags) {
 		/*
@@ -1381,9 +1916,19 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	 */
 	/* store old data just in case */
 	old_tvb_data=fd_head->tvb_data;
-	data = (uint8_t *) g_malloc(fd_head->datalen);
-	fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
-	tvb_set_free_cb(fd_head->tvb_data, g_free);
+	/* For a first reassembly, build the result as a composite of the
+	 * fragments rather than copying them all once more; it only gets
+	 * flattened if a dissector wants a pointer spanning fragments.
+	 * Extending an earlier (partial) reassembly still copies. */
+	share = !old_tvb_data && fd_head->datalen && fragment_items_shareable(fd_head);
+	if (share) {
+		data = NULL;
+		fd_head->tvb_data = tvb_new_composite_owning();
+	} else {
+		data = (uint8_t *) g_malloc(fd_head->datalen);
+		fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
+		tvb_set_free_cb(fd_head->tvb_data, g_free);
+	}
 
 	dfpos = old_tvb_data ? tvb_captured_length(old_tvb_data) : 0;
 	if (dfpos) {
@@ -1484,7 +2029,9 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 					overlap = MIN(dfpos, fd_head->datalen) - fd_i->offset;
 					uint32_t cmp_len = MIN(fd_i->len,overlap);
 
-					if ( cmp_len && memcmp(data + fd_i->offset,
+					/* (With a composite, that is compared
+					 * once it has been finalized below.) */
+					if ( !share && cmp_len && memcmp(data + fd_i->offset,
 							tvb_get_ptr(fd_i->tvb_data, 0, cmp_len),
 							cmp_len)
 							 ) {
@@ -1512,14 +2059,40 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 				 * out rather than mixed with the new ones?
 				 */
 				if (fd_i->offset + fraglen > dfpos) {
-					memcpy(data+dfpos,
-						tvb_get_ptr(fd_i->tvb_data, overlap, fraglen-overlap),
-						fraglen-overlap);
+					if (share) {
+						fragment_item_share_tvb(fd_head->tvb_data, fd_i,
+							overlap, fraglen-overlap);
+					} else {
+						memcpy(data+dfpos,
+							tvb_get_ptr(fd_i->tvb_data, overlap, fraglen-overlap),
+							fraglen-overlap);
+					}
 					dfpos = fd_i->offset + fraglen;
 				}
 			}
 			/* Mark that this fragment as used and clear data. */
 			fd_i->flags |= FD_DEFRAGMENTED;
+			if (!share)
+				fragment_item_free_tvb(fd_i);
+		}
+	}
+
+	if (share) {
+		tvb_composite_finalize(fd_head->tvb_data);
+		for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
+			if (!(fd_i->flags & FD_DEFRAGMENTED))
+				continue;
+			if ((fd_i->flags & FD_OVERLAP) && fd_i->offset < fd_head->datalen) {
+				/* Comparing the whole fragment is the same
+				 * as comparing just the overlap, as the
+				 * rest of it is what's in the composite. */
+				fraglen = MIN(fd_i->len, fd_head->datalen - fd_i->offset);
+				if (fragment_item_conflicts(fd_head->tvb_data, fd_i->offset,
+						fd_i->tvb_data, fraglen)) {
+					fd_i->flags    |= FD_OVERLAPCONFLICT;
+					fd_head->flags |= FD_OVERLAPCONFLICT;
+				}
+			}
 			fragment_item_free_tvb(fd_i);
 		}
 	}
@@ -1562,6 +2135,8 @@ fragment_add_common(reassembly_table *table, tvbuff_t *tvb, const int offset,
 	 */
 	DISSECTOR_ASSERT(tvb_bytes_exist(tvb, offset, frag_data_len));
 
+	reassembly_table_maintain(table, pinfo);
+
 	fd_head = lookup_fd_head(table, pinfo, id, data, NULL);
 
 #if 0
@@ -1791,6 +2366,8 @@ fragment_add_check_common(reassembly_table *table, tvbuff_t *tvb, const int offs
 	void *orig_key;
 	bool late_retransmission = false;
 
+	reassembly_table_maintain(table, pinfo);
+
 	/*
 	 * If this isn't the first pass, look for this frame in the table
 	 * of reassembled packets.
@@ -1798,7 +2375,7 @@ fragment_add_check_common(reassembly_table *table, tvbuff_t *tvb, const int offs
 	if (pinfo->fd->visited) {
 		reass_key.frame = pinfo->num;
 		reass_key.id = id;
-		return (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		return lookup_reassembled(table, &reass_key, pinfo);
 	}
 
 	/* Looks up a key in the GHashTable, returning the original key and the associated value
@@ -1810,13 +2387,13 @@ fragment_add_check_common(reassembly_table *table, tvbuff_t *tvb, const int offs
 		/* Check if there is completed reassembly reachable from fallback frame */
 		reass_key.frame = fallback_frame;
 		reass_key.id = id;
-		fd_head = (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		fd_head = lookup_reassembled(table, &reass_key, pinfo);
 		if (fd_head != NULL) {
 			/* Found completely reassembled packet, hash it with current frame number */
 			reassembled_key *new_key = g_slice_new(reassembled_key);
 			new_key->frame = pinfo->num;
 			new_key->id = id;
-			reassembled_table_insert(table->reassembled_table, new_key, fd_head);
+			reassembled_table_insert(table, new_key, fd_head, pinfo);
 			late_retransmission = true;
 		}
 	}
@@ -1942,8 +2519,10 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 	fragment_item *fd_i = NULL;
 	fragment_item *last_fd = NULL;
 	uint32_t dfpos = 0, old_dfpos = 0, size = 0;
+	fragment_item *seq_fd = NULL;
 	tvbuff_t *old_tvb_data = NULL;
 	uint8_t *data;
+	bool share;
 
 	for(fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
 		if(!last_fd || last_fd->offset!=fd_i->offset){
@@ -1959,9 +2538,17 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 
 	/* store old data in case the fd_i->data pointers refer to it */
 	old_tvb_data=fd_head->tvb_data;
-	data = (uint8_t *) g_malloc(size);
-	fd_head->tvb_data = tvb_new_real_data(data, size, size);
-	tvb_set_free_cb(fd_head->tvb_data, g_free);
+	/* As in fragment_add_work(), share the fragments' data with a
+	 * composite when this is the first time they are put together. */
+	share = !old_tvb_data && size && fragment_items_shareable(fd_head);
+	if (share) {
+		data = NULL;
+		fd_head->tvb_data = tvb_new_composite_owning();
+	} else {
+		data = (uint8_t *) g_malloc(size);
+		fd_head->tvb_data = tvb_new_real_data(data, size, size);
+		tvb_set_free_cb(fd_head->tvb_data, g_free);
+	}
 	fd_head->len = size;		/* record size for caller	*/
 
 	if (old_tvb_data) {
@@ -1988,7 +2575,10 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 					fd_i->flags    |= FD_TOOLONGFRAGMENT; // FD_OVERFLOW?
 					fd_head->flags |= FD_TOOLONGFRAGMENT; // FD_OVERFLOW?
 				}
-				if (!(fd_i->flags & FD_DEFRAGMENTED)) {
+				if (share) {
+					fragment_item_share_tvb(fd_head->tvb_data, fd_i, 0, copy_len);
+					seq_fd = fd_i;
+				} else if (!(fd_i->flags & FD_DEFRAGMENTED)) {
 					/* Copy if not already copied on the first pass */
 					memcpy(data + old_dfpos, tvb_get_ptr(fd_i->tvb_data, 0, fd_i->len), copy_len);
 				}
@@ -1997,18 +2587,33 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 				/* Note that overlaps of old fragments were already calculated. */
 				fd_i->flags    |= FD_OVERLAP;
 				fd_head->flags |= FD_OVERLAP;
+				/* With a composite, the data at old_dfpos is the
+				 * start of the fragment that was shared for it. */
 				if((old_dfpos + fd_i->len != dfpos)
-				   || tvb_memeql(fd_i->tvb_data, 0, data+old_dfpos, fd_i->len) ) {
+				   || tvb_memeql(fd_i->tvb_data, 0,
+					share ? tvb_get_ptr(seq_fd->tvb_data, 0, fd_i->len) : data+old_dfpos,
+					fd_i->len) ) {
 					fd_i->flags    |= FD_OVERLAPCONFLICT;
 					fd_head->flags |= FD_OVERLAPCONFLICT;
 				}
 			}
-			fragment_item_free_tvb(fd_i);
+			/* The shared fragments must stay until all the
+			 * duplicates have been compared with them. */
+			if (!share)
+				fragment_item_free_tvb(fd_i);
 			fd_i->flags |= FD_DEFRAGMENTED;
 		}
 		last_fd=fd_i;
 	}
 
+	if (share) {
+		tvb_composite_finalize(fd_head->tvb_data);
+		for (fd_i=fd_head->next; fd_i; fd_i=fd_i->next) {
+			if (fd_i->len)
+				fragment_item_free_tvb(fd_i);
+		}
+	}
+
 	if (old_tvb_data)
 		tvb_free(old_tvb_data);
 
@@ -2066,6 +2671,7 @@ fragment_add_seq_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	 * fragments added to the reassembly. */
 	if (fd->frame > fd_head->frame)
 		fd_head->frame = fd->frame;
+	fd_head->last_secs = pinfo->abs_ts.secs;
 
 	if (!more_frags) {
 		/*
@@ -2264,6 +2870,8 @@ fragment_add_seq_common(reassembly_table *table, tvbuff_t *tvb,
 	fragment_head *fd_head;
 	void *orig_key;
 
+	reassembly_table_maintain(table, pinfo);
+
 	fd_head = lookup_fd_head(table, pinfo, id, data, &orig_key);
 
 	/* have we already seen this frame ?*/
@@ -2425,9 +3033,11 @@ fragment_add_seq_check_work(reassembly_table *table, tvbuff_t *tvb,
 	 * If so, look for it in the table of reassembled packets.
 	 */
 	if (pinfo->fd->visited) {
+		/* (fragment_add_seq_common() does this on the first pass.) */
+		reassembly_table_maintain(table, pinfo);
 		reass_key.frame = pinfo->num;
 		reass_key.id = id;
-		return (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		return lookup_reassembled(table, &reass_key, pinfo);
 	}
 
 	fd_head = fragment_add_seq_common(table, tvb, offset, pinfo, id, data,
@@ -2576,6 +3186,9 @@ fragment_add_seq_single_work(reassembly_table *table, tvbuff_t *tvb,
 	fragment_head *fh, *new_fh;
 	fragment_item *fd, *prev_fd;
 	uint32_t frag_number, tmp_offset;
+
+	reassembly_table_maintain(table, pinfo);
+
 	/* Have we already seen this frame?
 	 * If so, look for it in the table of reassembled packets.
 	 * Note here we store in the reassembly table by the single sequence
@@ -2583,7 +3196,7 @@ fragment_add_seq_single_work(reassembly_table *table, tvbuff_t *tvb,
 	if (pinfo->fd->visited) {
 		reass_key.frame = pinfo->num;
 		reass_key.id = id;
-		fh = (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		fh = lookup_reassembled(table, &reass_key, pinfo);
 		return fh;
 	}
 	/* First let's figure out where we want to add our new fragment */
@@ -2860,7 +3473,7 @@ fragment_end_seq_next(reassembly_table *table, const packet_info *pinfo,
 	if (pinfo->fd->visited) {
 		reass_key.frame = pinfo->num;
 		reass_key.id = id;
-		return (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		return lookup_reassembled(table, &reass_key, pinfo);
 	}
 
 	fd_head = lookup_fd_head(table, pinfo, id, data, &orig_key);
@@ -2890,7 +3503,7 @@ fragment_end_seq_next(reassembly_table *table, const packet_info *pinfo,
 			new_key = g_slice_new(reassembled_key);
 			new_key->frame = pinfo->num;
 			new_key->id = id;
-			reassembled_table_insert(table->reassembled_table, new_key, fd_head);
+			reassembled_table_insert(table, new_key, fd_head, pinfo);
 		}
 
 		return fd_head;
@@ -3230,6 +3843,7 @@ static void
 reassembly_table_cleanup_reg_tables(void)
 {
 	g_list_foreach(reassembly_table_list, reassembly_table_cleanup_reg_table, NULL);
+	reassembly_spill_close();
 }
 
 void reassembly_tables_init(void)
@@ -3251,6 +3865,7 @@ reassembly_table_cleanup(void)
 {
 	g_list_foreach(reassembly_table_list, reassembly_table_free, NULL);
 	g_list_free(reassembly_table_list);
+	reassembly_spill_close();
 }
 
 /* One instance of this structure is created for each pdu that spans across
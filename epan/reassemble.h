@@ -56,6 +56,10 @@ extern "C" {
  */
 #define FD_DATALEN_SET		0x0400
 
+/* in fd_head: the reassembled data has been moved out of memory to the
+ * spill file; tvb_data is NULL until it is read back */
+#define FD_SPILLED		0x0800
+
 struct dissector_handle;
 
 /**
@@ -97,6 +101,11 @@ typedef struct _fragment_head {
     tvbuff_t* tvb_data;                   /**< Tvbuff containing the reassembled payload once reassembly is complete. */
     const char* error;                    /**< NULL if reassembly completed without error; otherwise a string
                                                describing the reassembly error that occurred. */
+    time_t    last_secs;                  /**< Capture time (seconds) of the most recently added fragment; used for aging. */
+    uint64_t  spill_offset;               /**< Offset of the reassembled data in the spill file; valid when spill_len is non-zero. */
+    uint32_t  spill_len;                  /**< Length of the reassembled data in the spill file, or 0 if it was never spilled. */
+    struct _reassembly_unspilled* unspilled; /**< Non-NULL while tvb_data was read back from the spill file for frames
+                                               already dissected, and belongs to the dissections that looked it up. */
 } fragment_head;
 
 /*
@@ -143,6 +152,10 @@ typedef struct {
     fragment_temporary_key  temporary_key_func;      /**< Callback that constructs a short-lived lookup key from packet data for fragment_table queries. */
     fragment_persistent_key persistent_key_func;     /**< Callback that constructs a long-lived key allocated for permanent storage in the fragment_table. */
     GDestroyNotify          free_temporary_key_func; /**< GLib destroy callback used to release temporary keys after a lookup. */
+    size_t                  pending_bytes;           /**< Estimated bytes held by fragment_table entries; recounted on each sweep. */
+    size_t                  completed_bytes;         /**< Bytes of reassembled data held in memory for reassembled_table entries. */
+    unsigned                adds_since_sweep;        /**< Fragments added since the table was last checked against the age and memory limits. */
+    GQueue*                 spill_queue;             /**< Keys of completed reassemblies, oldest first, that may be moved to the spill file. */
 } reassembly_table;
 
 /**
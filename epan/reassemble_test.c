@@ -38,6 +38,7 @@
 
 #include <epan/packet.h>
 #include <epan/packet_info.h>
+#include <epan/prefs.h>
 #include <epan/proto.h>
 #include <epan/tvbuff.h>
 #include <epan/reassemble.h>
@@ -3203,6 +3204,156 @@ test_fragment_add_check_duplicate_conflict(void)
         print_fragment_table();
     }
 }
+/**********************************************************************************
+ *
+ * Memory limits
+ *
+ *********************************************************************************/
+
+/* An incomplete reassembly that sees no more fragments is discarded once
+ * it is older than reassembly_max_age_frames, while one that keeps getting
+ * fragments is kept.
+ */
+static void
+test_fragment_add_aging(void)
+{
+    fragment_head *fd_head;
+    uint32_t i;
+
+    printf("Starting test test_fragment_add_aging\n");
+
+    prefs.reassembly_max_age_frames = 10;
+
+    pinfo.num = 1;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
+                         0, 50, true);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+    ASSERT_NE_POINTER(NULL,fragment_get(&test_reassembly_table, &pinfo, 12, NULL));
+
+    /* Enough fragments of another reassembly for the table to be checked. */
+    for (i = 0; i < 300; i++) {
+        pinfo.num = 2 + i;
+        fragment_add(&test_reassembly_table, tvb, 0, &pinfo, 13, NULL,
+                     i * 2, 2, true);
+    }
+
+    ASSERT_EQ_POINTER(NULL,fragment_get(&test_reassembly_table, &pinfo, 12, NULL));
+    ASSERT_NE_POINTER(NULL,fragment_get(&test_reassembly_table, &pinfo, 13, NULL));
+
+    prefs.reassembly_max_age_frames = 0;
+}
+
+#define SPILL_PDU_LEN (64 * 1024)
+#define SPILL_PDUS 40
+
+static void
+count_spilled(void *k _U_, void *v, void *ud)
+{
+    fragment_head *fd_head = (fragment_head *)v;
+
+    if (fd_head->flags & FD_SPILLED) {
+        ASSERT_EQ_POINTER(NULL,fd_head->tvb_data);
+        (*(uint32_t *)ud)++;
+    }
+}
+
+/* With a memory limit and reassembly_spill_completed, older completed
+ * reassemblies are moved out of memory, and are read back intact when
+ * they are looked up on later passes.
+ */
+static void
+test_fragment_add_check_spill(void)
+{
+    fragment_head *fd_head, *first_fd_head = NULL;
+    tvbuff_t *big_tvb, *first_tvb = NULL;
+    uint8_t *big_data;
+    wmem_allocator_t *first_pool, *frame_pool;
+    uint32_t i, spilled, respilled, queued;
+
+    printf("Starting test test_fragment_add_check_spill\n");
+
+    big_data = (uint8_t *)g_malloc(SPILL_PDU_LEN + SPILL_PDUS);
+    for (i = 0; i < SPILL_PDU_LEN + SPILL_PDUS; i++) {
+        big_data[i] = (uint8_t)(i * 7);
+    }
+    big_tvb = tvb_new_real_data(big_data, SPILL_PDU_LEN + SPILL_PDUS,
+                                SPILL_PDU_LEN + SPILL_PDUS);
+
+    prefs.reassembly_table_memory_limit = 1;
+    prefs.reassembly_spill_completed = true;
+
+    /* Single fragment reassemblies, each starting at a different offset
+     * so they can be told apart, adding up to more than the limit. */
+    for (i = 1; i <= SPILL_PDUS; i++) {
+        pinfo.num = i;
+        fd_head=fragment_add_check(&test_reassembly_table, big_tvb, i, &pinfo, i,
+                                   NULL, 0, SPILL_PDU_LEN, false);
+        ASSERT_NE_POINTER(NULL,fd_head);
+        ASSERT_NE_POINTER(NULL,fd_head->tvb_data);
+    }
+
+    /* Some were spilled, and what's left in memory is accounted for. */
+    spilled = 0;
+    g_hash_table_foreach(test_reassembly_table.reassembled_table, count_spilled, &spilled);
+    ASSERT(spilled > 0);
+    ASSERT_EQ((uint64_t)(SPILL_PDUS - spilled) * SPILL_PDU_LEN,
+              test_reassembly_table.completed_bytes);
+
+    /* On later passes they are read back for the dissection of the frame
+     * only: the data stays valid until that frame's pinfo->pool is freed,
+     * even while other frames are dissected, and then goes back to disk. */
+    queued = g_queue_get_length(test_reassembly_table.spill_queue);
+    first_pool = wmem_allocator_new(WMEM_ALLOCATOR_SIMPLE);
+    frame_pool = wmem_allocator_new(WMEM_ALLOCATOR_SIMPLE);
+    pinfo.fd->visited = true;
+    for (i = 1; i <= SPILL_PDUS; i++) {
+        pinfo.num = i;
+        pinfo.pool = (i == 1) ? first_pool : frame_pool;
+        fd_head=fragment_add_check(&test_reassembly_table, big_tvb, i, &pinfo, i,
+                                   NULL, 0, SPILL_PDU_LEN, false);
+        ASSERT_NE_POINTER(NULL,fd_head);
+        ASSERT_EQ(0,fd_head->flags & FD_SPILLED);
+        ASSERT_EQ_POINTER(NULL,fd_head->error);
+        ASSERT(!tvb_memeql(fd_head->tvb_data, 0, big_data + i, SPILL_PDU_LEN));
+        if (i == 1) {
+            first_fd_head = fd_head;
+            first_tvb = fd_head->tvb_data;
+        } else {
+            wmem_free_all(frame_pool);
+        }
+    }
+    pinfo.fd->visited = false;
+    pinfo.pool = NULL;
+
+    /* The oldest was spilled, so frame 1 holds a copy of its own. */
+    ASSERT_NE_POINTER(NULL,first_fd_head->unspilled);
+    ASSERT_EQ_POINTER(first_tvb,first_fd_head->tvb_data);
+    ASSERT(!tvb_memeql(first_tvb, 0, big_data + 1, SPILL_PDU_LEN));
+    respilled = 0;
+    g_hash_table_foreach(test_reassembly_table.reassembled_table, count_spilled, &respilled);
+    ASSERT_EQ(spilled - 1,respilled);
+
+    /* Reading back on later passes isn't counted against the limits,
+     * nor queued to be spilled by a first pass that won't come. */
+    wmem_free_all(first_pool);
+    ASSERT_EQ_POINTER(NULL,first_fd_head->unspilled);
+    respilled = 0;
+    g_hash_table_foreach(test_reassembly_table.reassembled_table, count_spilled, &respilled);
+    ASSERT_EQ(spilled,respilled);
+    ASSERT_EQ((uint64_t)(SPILL_PDUS - spilled) * SPILL_PDU_LEN,
+              test_reassembly_table.completed_bytes);
+    ASSERT_EQ(queued,g_queue_get_length(test_reassembly_table.spill_queue));
+
+    wmem_destroy_allocator(frame_pool);
+    wmem_destroy_allocator(first_pool);
+
+    prefs.reassembly_table_memory_limit = 0;
+    prefs.reassembly_spill_completed = false;
+
+    tvb_free(big_tvb);
+    g_free(big_data);
+}
+
 /**********************************************************************************
  *
  * main
@@ -3251,6 +3402,8 @@ main(int argc _U_, char **argv _U_)
         test_fragment_add_check_duplicate_last,
 #endif
         test_fragment_add_check_duplicate_conflict,
+        test_fragment_add_aging,
+        test_fragment_add_check_spill,
     };
 
     /* a tvbuff for testing with */
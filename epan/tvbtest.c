@@ -616,6 +616,82 @@ run_tests(void)
 	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
 }
 
+/* Read a composite of many small members forwards, backwards and at
+ * scattered offsets, which takes the member lookup through its sequential
+ * and its binary search paths. */
+static void
+composite_lookup_tests(void)
+{
+	tvbuff_t	*tvb_parent, *tvb_comp;
+	uint8_t		*buf;
+	unsigned	buf_len = 0, offset, i, len;
+	uint32_t	seed = 1;
+	uint8_t		val[4];
+	bool		ok = true;
+
+	buf = (uint8_t *)g_malloc(4096 * 8);
+	for (i = 0; i < 4096 * 8; i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = (uint8_t)(seed >> 16);
+	}
+
+	tvb_parent = tvb_new_real_data(buf, 4096 * 8, 4096 * 8);
+	tvb_set_free_cb(tvb_parent, g_free);
+	tvb_comp = tvb_new_composite();
+	for (i = 0; i < 4096; i++) {
+		len = 1 + i % 7;
+		tvb_composite_append(tvb_comp, tvb_new_subset_length(tvb_parent, buf_len, len));
+		buf_len += len;
+	}
+	tvb_composite_finalize(tvb_comp);
+
+	if (tvb_captured_length(tvb_comp) != buf_len) {
+		printf("Composite lookup: length %u, expected %u\n", tvb_captured_length(tvb_comp), buf_len);
+		ok = false;
+	}
+	for (offset = 0; ok && offset < buf_len; offset++) {
+		if (tvb_get_uint8(tvb_comp, offset) != buf[offset]) {
+			printf("Composite lookup: forward read failed at %u\n", offset);
+			ok = false;
+		}
+	}
+	for (offset = buf_len; ok && offset-- > 0; ) {
+		if (tvb_get_uint8(tvb_comp, offset) != buf[offset]) {
+			printf("Composite lookup: backward read failed at %u\n", offset);
+			ok = false;
+		}
+	}
+	for (i = 0; ok && i < 10000; i++) {
+		seed = seed * 1103515245 + 12345;
+		offset = (seed >> 8) % (buf_len - (unsigned)sizeof val + 1);
+		/* (tvb_memcpy rather than tvb_get_ntohl, which would flatten
+		 * the composite as soon as a read spans two members.) */
+		tvb_memcpy(tvb_comp, val, offset, sizeof val);
+		if (memcmp(val, buf + offset, sizeof val) != 0) {
+			printf("Composite lookup: scattered read failed at %u\n", offset);
+			ok = false;
+		}
+	}
+	/* Search across members, from a member in the middle. */
+	for (i = 0; ok && i < 256; i++) {
+		unsigned found;
+		const uint8_t *expected = (const uint8_t *)memchr(buf + buf_len / 2, i, buf_len - buf_len / 2);
+		bool got = tvb_find_uint8_remaining(tvb_comp, buf_len / 2, (uint8_t)i, &found);
+		if (got != (expected != NULL) || (got && found != (unsigned)(expected - buf))) {
+			printf("Composite lookup: find of 0x%02x failed\n", i);
+			ok = false;
+		}
+	}
+
+	if (ok) {
+		printf("Passed composite lookup tests.\n");
+	} else {
+		failed = true;
+	}
+
+	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
+}
+
 typedef struct
 {
 	// Raw bytes
@@ -821,6 +897,7 @@ main(void)
 
 	except_init();
 	run_tests();
+	composite_lookup_tests();
 	varint_tests();
 	zstd_tests ();
 	except_deinit();
@@ -156,6 +156,18 @@ tvbuff_t *tvb_new_proxy(tvbuff_t *backing);
  */
 void tvb_add_to_chain(tvbuff_t *parent, tvbuff_t *child);
 
+/**
+ * @brief Creates an empty composite tvbuff that owns its members.
+ *
+ * Unlike tvb_new_composite(), the composite is not attached to the chain
+ * of its first member. Instead the caller hands each member (or the tvbuff
+ * backing it) to the composite with tvb_add_to_chain(), so that freeing
+ * the composite frees the members too.
+ *
+ * @return A pointer to a new, empty composite tvbuff.
+ */
+tvbuff_t *tvb_new_composite_owning(void);
+
 /**
  * @brief Calculates the offset from the real beginning of a TVBuffer using a counter.
  *
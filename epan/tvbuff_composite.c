@@ -24,42 +24,21 @@ typedef struct {
 	unsigned end_offset;
 } tvb_comp_member_t;
 
-static int
-tvb_comp_off_compare(const void *a, const void *b, void *user_data)
-{
-	tvb_comp_member_t* off_a = (tvb_comp_member_t*)a;
-	tvb_comp_member_t* off_b = (tvb_comp_member_t*)b;
-	tvb_comp_member_t* key = (tvb_comp_member_t*)user_data;
-
-	if (off_a->end_offset < off_b->end_offset)
-		return -1;
-	else if (off_a->end_offset > off_b->end_offset)
-		return 1;
-
-	/* This is a hack to ensure that in cases of ties, key is always
-	 * sorted first. This ensures that g_sequence_search returns an
-	 * iterator pointing to the tvb in the sequence with a matching
-	 * offset instead of the node after it. (It would be simpler but
-	 * somewhat slower to have the natural comparison function and
-	 * call g_sequence_lookup followed by g_sequence_search in case
-	 * of failure.)
-	 *
-	 * If we allowed zero length TVBs to be part of the composite,
-	 * we might have to search through all the TVBs with the same
-	 * end_offset to find the right one. (Or maybe we could just
-	 * no-op and not add the zero length TVBs?)
-	 */
-	if (off_a == key) {
-		return -1;
-	} else if (off_b == key) {
-		return 1;
-	}
-	return 0;
-}
-
 typedef struct {
+	/* Members as appended or prepended, until the composite is
+	 * finalized and they are moved to the array below. */
 	GSequence	*tvbs;
 
+	/* Finalized members, sorted by offset, and the one in which the
+	 * last lookup ended up. Dissectors mostly read a composite from
+	 * front to back, so that or the next one is usually the answer. */
+	tvb_comp_member_t *members;
+	unsigned	num_members;
+	unsigned	last_hit;
+
+	/* Members are chained to the composite rather than the other way
+	 * around; see tvb_new_composite_owning(). */
+	bool		owning;
 } tvb_comp_t;
 
 struct tvb_composite {
@@ -74,11 +53,50 @@ composite_free(tvbuff_t *tvb)
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
 
-	g_sequence_free(composite->tvbs);
+	if (composite->tvbs)
+		g_sequence_free(composite->tvbs);
+	g_free(composite->members);
 
 	g_free((void *)tvb->real_data);
 }
 
+/*
+ * Return the index of the member containing abs_offset, or num_members if
+ * abs_offset is at (or past) the end of the composite.
+ */
+static unsigned
+composite_member_index(tvb_comp_t *composite, const unsigned abs_offset)
+{
+	const tvb_comp_member_t *members = composite->members;
+	unsigned num_members = composite->num_members;
+	unsigned i = composite->last_hit;
+	unsigned lo, hi, mid;
+
+	if (i < num_members && members[i].start_offset <= abs_offset) {
+		if (abs_offset <= members[i].end_offset)
+			return i;
+		if (i + 1 < num_members && abs_offset <= members[i + 1].end_offset) {
+			composite->last_hit = i + 1;
+			return i + 1;
+		}
+	}
+
+	/* Find the first member that ends at or after abs_offset. Members
+	 * are never zero length, so that is the one containing it. */
+	lo = 0;
+	hi = num_members;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (members[mid].end_offset < abs_offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < num_members)
+		composite->last_hit = lo;
+	return lo;
+}
+
 static unsigned
 composite_offset(const tvbuff_t *tvb _U_, const unsigned counter)
 {
@@ -93,6 +111,7 @@ composite_get_ptr(tvbuff_t *tvb, unsigned abs_offset, unsigned abs_length)
 	tvb_comp_member_t *member = NULL;
 	tvbuff_t   *member_tvb = NULL;
 	unsigned	member_offset;
+	unsigned	i;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
@@ -100,16 +119,15 @@ composite_get_ptr(tvbuff_t *tvb, unsigned abs_offset, unsigned abs_length)
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &composite_tvb->composite;
 
-	tvb_comp_member_t key = { .end_offset = abs_offset };
-	GSequenceIter *iter = g_sequence_search(composite->tvbs, &key, tvb_comp_off_compare, &key);
+	i = composite_member_index(composite, abs_offset);
 
 	/* special case */
-	if (g_sequence_iter_is_end(iter)) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return (const uint8_t*)"";
 	}
 
-	member = (tvb_comp_member_t *)g_sequence_get(iter);
+	member = &composite->members[i];
 	member_tvb = member->tvb;
 	member_offset = abs_offset - member->start_offset;
 
@@ -141,6 +159,7 @@ composite_memcpy(tvbuff_t *tvb, void* _target, unsigned abs_offset, unsigned abs
 	tvb_comp_member_t *member = NULL;
 	tvbuff_t   *member_tvb = NULL;
 	unsigned	    member_offset, member_length;
+	unsigned	    i;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
@@ -148,16 +167,15 @@ composite_memcpy(tvbuff_t *tvb, void* _target, unsigned abs_offset, unsigned abs
 	 * is contiguous inside one of the member tvbuffs */
 	composite   = &composite_tvb->composite;
 
-	tvb_comp_member_t key = { .end_offset = abs_offset };
-	GSequenceIter *iter = g_sequence_search(composite->tvbs, &key, tvb_comp_off_compare, &key);
+	i = composite_member_index(composite, abs_offset);
 
 	/* special case */
-	if (g_sequence_iter_is_end(iter)) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return target;
 	}
 
-	member = (tvb_comp_member_t *)g_sequence_get(iter);
+	member = &composite->members[i];
 	member_tvb = member->tvb;
 	member_offset = abs_offset - member->start_offset;
 
@@ -189,12 +207,12 @@ composite_memcpy(tvbuff_t *tvb, void* _target, unsigned abs_offset, unsigned abs
 
 			if (!abs_length)
 				break;
-			iter = g_sequence_iter_next(iter);
+			i++;
 			/* tvb_memcpy calls check_offset_length and so there
 			 * should be enough captured length to copy. */
-			DISSECTOR_ASSERT(!g_sequence_iter_is_end(iter));
+			DISSECTOR_ASSERT(i < composite->num_members);
 
-			member = (tvb_comp_member_t *)g_sequence_get(iter);
+			member = &composite->members[i];
 			member_tvb = member->tvb;
 			member_offset = 0;
 		}
@@ -205,6 +223,84 @@ composite_memcpy(tvbuff_t *tvb, void* _target, unsigned abs_offset, unsigned abs
 	DISSECTOR_ASSERT_NOT_REACHED();
 }
 
+/*
+ * Search the members in turn, so that scanning a composite (e.g. looking
+ * for the end of a line in reassembled data) doesn't flatten it.
+ */
+static bool
+composite_find_uint8(tvbuff_t *tvb, unsigned abs_offset, unsigned limit, uint8_t needle, unsigned *found_offset)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	tvb_comp_member_t *member;
+	unsigned	member_offset, member_length;
+	unsigned	i;
+
+	if (found_offset) {
+		*found_offset = abs_offset + limit;
+	}
+
+	i = composite_member_index(composite, abs_offset);
+
+	while (limit && i < composite->num_members) {
+		member = &composite->members[i];
+		member_offset = abs_offset - member->start_offset;
+		member_length = MIN(member->end_offset - abs_offset + 1, limit);
+
+		if (tvb_find_uint8_length(member->tvb, member_offset, member_length, needle, found_offset)) {
+			if (found_offset) {
+				*found_offset += member->start_offset;
+			}
+			return true;
+		}
+		abs_offset += member_length;
+		limit -= member_length;
+		i++;
+	}
+
+	if (found_offset) {
+		*found_offset = abs_offset + limit;
+	}
+	return false;
+}
+
+static bool
+composite_pbrk_uint8(tvbuff_t *tvb, unsigned abs_offset, unsigned limit, const ws_mempbrk_pattern* pattern, unsigned *found_offset, unsigned char *found_needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	tvb_comp_member_t *member;
+	unsigned	member_offset, member_length;
+	unsigned	i;
+
+	if (found_offset) {
+		*found_offset = abs_offset + limit;
+	}
+
+	i = composite_member_index(composite, abs_offset);
+
+	while (limit && i < composite->num_members) {
+		member = &composite->members[i];
+		member_offset = abs_offset - member->start_offset;
+		member_length = MIN(member->end_offset - abs_offset + 1, limit);
+
+		if (tvb_ws_mempbrk_uint8_length(member->tvb, member_offset, member_length, pattern, found_offset, found_needle)) {
+			if (found_offset) {
+				*found_offset += member->start_offset;
+			}
+			return true;
+		}
+		abs_offset += member_length;
+		limit -= member_length;
+		i++;
+	}
+
+	if (found_offset) {
+		*found_offset = abs_offset + limit;
+	}
+	return false;
+}
+
 static const struct tvb_ops tvb_composite_ops = {
 	sizeof(struct tvb_composite), /* size */
 
@@ -212,10 +308,8 @@ static const struct tvb_ops tvb_composite_ops = {
 	composite_offset,     /* offset */
 	composite_get_ptr,    /* get_ptr */
 	composite_memcpy,     /* memcpy */
-	/* XXX - The generic find routines work, but specialized ones
-	 * might be able to avoid some memcpys */
-	NULL,                 /* find_uint8 XXX */
-	NULL,                 /* pbrk_uint8 XXX */
+	composite_find_uint8, /* find_uint8 */
+	composite_pbrk_uint8, /* pbrk_uint8 */
 	NULL,                 /* clone */
 };
 
@@ -239,6 +333,21 @@ tvb_new_composite(void)
 	tvb_comp_t *composite = &composite_tvb->composite;
 
 	composite->tvbs		 = g_sequence_new(g_free);
+	composite->members	 = NULL;
+	composite->num_members	 = 0;
+	composite->last_hit	 = 0;
+	composite->owning	 = false;
+
+	return tvb;
+}
+
+tvbuff_t *
+tvb_new_composite_owning(void)
+{
+	tvbuff_t *tvb = tvb_new_composite();
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+
+	composite_tvb->composite.owning = true;
 
 	return tvb;
 }
@@ -258,7 +367,7 @@ tvb_composite_append(tvbuff_t *tvb, tvbuff_t *member)
 	if (member && member->length) {
 		composite       = &composite_tvb->composite;
 		/* Attach the composite TVB to the first TVB only. */
-		if (g_sequence_is_empty(composite->tvbs)) {
+		if (!composite->owning && g_sequence_is_empty(composite->tvbs)) {
 			tvb_add_to_chain(member, tvb);
 		}
 		tvb_comp_member_t *new_member = g_new(tvb_comp_member_t, 1);
@@ -284,7 +393,7 @@ tvb_composite_prepend(tvbuff_t *tvb, tvbuff_t *member)
 	if (member && member->length) {
 		composite       = &composite_tvb->composite;
 		/* Attach the composite TVB to the first TVB only. */
-		if (g_sequence_is_empty(composite->tvbs)) {
+		if (!composite->owning && g_sequence_is_empty(composite->tvbs)) {
 			tvb_add_to_chain(member, tvb);
 		}
 		tvb_comp_member_t *new_member = g_new(tvb_comp_member_t, 1);
@@ -319,20 +428,25 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	/* Dissectors should not create composite TVBs if they're not going to
 	 * put at least one TVB in them.
 	 * (Without this check--or something similar--we'll seg-fault below.)
-	 * (XXX - Now with a GSequence we shouldn't segfault, we'll get the
-	 * end iterator and it should work, so we could remove this and some
-	 * checks in dissectors to simplify their code.)
+	 * (XXX - With the lookups returning num_members for the end we
+	 * shouldn't segfault, so we could remove this and some checks in
+	 * dissectors to simplify their code.)
 	 */
 	DISSECTOR_ASSERT(num_members);
 
 	/* Record the offsets - we have to do that now because it's possible
 	 * to prepend TVBs. Note that the GSequence is already sorted according
 	 * to these offsets, we're just noting them, so we don't need to sort.
+	 * The members go into a flat array that lookups can binary search.
 	 */
+	composite->members = g_new(tvb_comp_member_t, num_members);
+	composite->num_members = num_members;
+	composite->last_hit = 0;
 	GSequenceIter *iter = g_sequence_get_begin_iter(composite->tvbs);
 	for (i=0; i < num_members; i++, iter=g_sequence_iter_next(iter)) {
-		member = (tvb_comp_member_t *)g_sequence_get(iter);
-		member_tvb = member->tvb;
+		member = &composite->members[i];
+		member_tvb = ((tvb_comp_member_t *)g_sequence_get(iter))->tvb;
+		member->tvb = member_tvb;
 		member->start_offset = tvb->length;
 		tvb->length += member_tvb->length;
 		/* XXX - What does it mean to make a composite TVB out of
@@ -342,6 +456,8 @@ tvb_composite_finalize(tvbuff_t *tvb)
 		tvb->contained_length += member_tvb->contained_length;
 		member->end_offset = tvb->length - 1;
 	}
+	g_sequence_free(composite->tvbs);
+	composite->tvbs = NULL;
 
 	tvb->initialized = true;
 	tvb->ds_tvb = tvb;
@@ -1511,6 +1511,7 @@ cf_merge_files_to_tempfile(void *pd_window, const char *temp_dir, char **out_fil
     cb_data->pd_window = pd_window;
     cb.callback_func = merge_callback;
     cb.data = cb_data;
+    cb.record_filter = NULL;
 
     cf_callback_invoke(cf_cb_file_merge_started, NULL);
 
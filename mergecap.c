@@ -42,11 +42,15 @@
 #endif
 
 #include <wiretap/merge.h>
+#include <wiretap/pcap-encap.h>
 
 #include "ui/failure_message.h"
 
+#include "writecap/flow_index.h"
+
 #define LONGOPT_COMPRESS                LONGOPT_BASE_APPLICATION+1
 #define LONGOPT_NO_MERGING_COMMENT      LONGOPT_BASE_APPLICATION+2
+#define LONGOPT_FLOW_ADDRESS            LONGOPT_BASE_APPLICATION+3
 
 /*
  * Show the usage
@@ -71,6 +75,11 @@ print_usage(FILE *output)
     fprintf(output, "  --no-merging-comment\n");
     fprintf(output, "                    do not add \"File created by merging:\" comment.\n");
     fprintf(output, "\n");
+    fprintf(output, "Input:\n");
+    fprintf(output, "  --flow-address <address>[,<address>[,<proto>[,<port>[,<port>]]]]\n");
+    fprintf(output, "                    only merge the packets of the flow, skipping input files\n");
+    fprintf(output, "                    and packets that dumpcap's flow index shows don't have it.\n");
+    fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -h, --help        display this help and exit.\n");
     fprintf(output, "  -V                verbose output.\n");
@@ -116,13 +125,56 @@ list_output_compression_types(void) {
     g_slist_free(output_compression_types);
 }
 
+/* What --flow-address selects, and where the index says the flow's
+   packets are in each input file that has one. */
+typedef struct {
+    bool             verbose;
+    flow_index_flow  flow;
+    GHashTable      *spans;     /* flow_index_span, keyed by input file name */
+} merge_flow_filter;
+
+/* Keep a record if it's a packet of the flow and the index, if any, says
+   it's where the flow's packets are. */
+static bool
+merge_flow_record_filter(const merge_in_file_t *in_file, void *data)
+{
+    const merge_flow_filter *filter = (const merge_flow_filter *)data;
+    const wtap_rec          *rec = &in_file->rec;
+    const flow_index_span   *span;
+    uint64_t                 ts;
+
+    if (rec->rec_type != REC_TYPE_PACKET) {
+        return true;
+    }
+    span = (const flow_index_span *)g_hash_table_lookup(filter->spans, in_file->filename);
+    if (span != NULL) {
+        if (in_file->packet_num < span->first_packet ||
+            in_file->packet_num > span->last_packet) {
+            return false;
+        }
+        ts = (uint64_t)rec->ts.secs * 1000000000 + rec->ts.nsecs;
+        if (ts < span->first_ts || ts > span->last_ts) {
+            return false;
+        }
+    }
+    return flow_index_packet_in_flow(&filter->flow,
+                                     wtap_wtap_encap_to_pcap_encap(rec->rec_header.packet_header.pkt_encap),
+                                     ws_buffer_start_ptr(&rec->data),
+                                     rec->rec_header.packet_header.caplen);
+}
+
 static bool
 merge_callback(merge_event event, int num,
         const merge_in_file_t in_files[], const unsigned in_file_count,
-        void *data _U_)
+        void *data)
 {
+    const merge_flow_filter *filter = (const merge_flow_filter *)data;
     unsigned i;
 
+    /* With --flow-address but not -V, we're only called for the filter. */
+    if (filter != NULL && !filter->verbose)
+        return false;
+
     switch (event) {
 
         case MERGE_EVENT_INPUT_FILES_OPENED:
@@ -191,6 +243,7 @@ main(int argc, char *argv[])
         {"version", ws_no_argument, NULL, 'v'},
         {"compress", ws_required_argument, NULL, LONGOPT_COMPRESS},
         {"no-merging-comment", ws_no_argument, NULL, LONGOPT_NO_MERGING_COMMENT},
+        {"flow-address", ws_required_argument, NULL, LONGOPT_FLOW_ADDRESS},
         LONGOPT_WSLOG
         {0, 0, 0, 0 }
     };
@@ -206,6 +259,9 @@ main(int argc, char *argv[])
     bool                  status           = true;
     idb_merge_mode        mode             = IDB_MERGE_MODE_MAX;
     ws_compression_type   compression_type = WS_FILE_UNKNOWN_COMPRESSION;
+    bool                  have_flow_address = false;
+    merge_flow_filter     flow_filter      = { 0 };
+    GPtrArray            *in_filenames     = NULL;
     merge_progress_callback_t cb;
     const struct file_extension_info* file_extensions;
     unsigned num_extensions;
@@ -322,6 +378,17 @@ main(int argc, char *argv[])
                 add_merging_comment = false;
                 break;
 
+            case LONGOPT_FLOW_ADDRESS:
+                if (!flow_index_parse_flow(ws_optarg, &flow_filter.flow)) {
+                    cmdarg_err("\"%s\" isn't a valid flow: an IPv4 or IPv6 address, optionally followed by "
+                               "another, a protocol and ports, separated by commas",
+                               ws_optarg);
+                    status = false;
+                    goto clean_exit;
+                }
+                have_flow_address = true;
+                break;
+
             case '?':              /* Bad options if GNU getopt */
             default:
                 /* wslog arguments are okay */
@@ -353,6 +420,7 @@ main(int argc, char *argv[])
 
     cb.callback_func = merge_callback;
     cb.data = NULL;
+    cb.record_filter = NULL;
 
     /* check for proper args; at a minimum, must have an output
      * filename and one input file
@@ -369,6 +437,57 @@ main(int argc, char *argv[])
         return 1;
     }
 
+    /*
+     * If we're only interested in one flow, leave out the files that
+     * dumpcap's flow index says don't have it, without opening them, and
+     * note where its packets are in the rest. Packets are only merged if
+     * they're in the flow; files without an index are read in full.
+     */
+    in_filenames = g_ptr_array_sized_new(in_file_count);
+    if (have_flow_address) {
+        flow_filter.verbose = verbose;
+        flow_filter.spans = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+        cb.data = &flow_filter;
+        cb.record_filter = merge_flow_record_filter;
+    }
+    for (int i = ws_optind; i < argc; i++) {
+        if (have_flow_address) {
+            char            *index_name = flow_index_filename(argv[i]);
+            flow_index_file *fif;
+            flow_index_span  span;
+            int              err;
+
+            fif = flow_index_file_read(index_name, &err);
+            g_free(index_name);
+            if (fif != NULL) {
+                bool has_flow = flow_index_file_find_flow(fif, &flow_filter.flow, &span);
+
+                flow_index_file_free(fif);
+                if (!has_flow) {
+                    if (verbose) {
+                        fprintf(stderr, "mergecap: skipping %s, which has no packets in the flow\n",
+                                argv[i]);
+                    }
+                    continue;
+                }
+                if (verbose) {
+                    fprintf(stderr, "mergecap: reading packets %u to %u of %s\n",
+                            span.first_packet, span.last_packet, argv[i]);
+                }
+                /* The merge code has the names we give it, so look
+                   them up by address. */
+                g_hash_table_insert(flow_filter.spans, argv[i], g_memdup2(&span, sizeof span));
+            }
+        }
+        g_ptr_array_add(in_filenames, argv[i]);
+    }
+    in_file_count = (int)in_filenames->len;
+    if (in_file_count < 1) {
+        cmdarg_err("None of the input files have packets in the flow");
+        status = false;
+        goto clean_exit;
+    }
+
     if (compression_type == WS_FILE_UNKNOWN_COMPRESSION) {
         /* An explicitly specified compression type overrides filename
          * magic. (Should we allow specifying "no" compression with, e.g.
@@ -417,19 +536,23 @@ main(int argc, char *argv[])
     if (strcmp(out_filename, "-") == 0) {
         /* merge the files to the standard output */
         status = merge_files_to_stdout(file_type,
-                (const char *const *) &argv[ws_optind],
+                (const char *const *) in_filenames->pdata,
                 in_file_count, add_merging_comment, do_append, mode, snaplen,
                 get_appname_and_version(), application_configuration_environment_prefix(),
-                verbose ? &cb : NULL, compression_type);
+                (verbose || have_flow_address) ? &cb : NULL, compression_type);
     } else {
         /* merge the files to the outfile */
         status = merge_files(out_filename, file_type,
-                (const char *const *) &argv[ws_optind], in_file_count,
+                (const char *const *) in_filenames->pdata, in_file_count,
                 add_merging_comment, do_append, mode, snaplen, get_appname_and_version(), application_configuration_environment_prefix(),
-                verbose ? &cb : NULL, compression_type);
+                (verbose || have_flow_address) ? &cb : NULL, compression_type);
     }
 
 clean_exit:
+    if (in_filenames != NULL)
+        g_ptr_array_free(in_filenames, TRUE);
+    if (flow_filter.spans != NULL)
+        g_hash_table_destroy(flow_filter.spans);
     wtap_cleanup();
     free_progdirs();
     return status ? 0 : 2;
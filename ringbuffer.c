@@ -29,6 +29,10 @@
  */
 
 #include <config.h>
+#ifdef HAVE_FALLOCATE
+#define _GNU_SOURCE /* For fallocate() and FALLOC_FL_KEEP_SIZE */
+#include <fcntl.h>
+#endif
 
 #ifdef HAVE_LIBPCAP
 
@@ -55,6 +59,7 @@
 #include <wsutil/array.h>
 #include <wsutil/file_util.h>
 #include <wsutil/file_compressed.h>
+#include "writecap/flow_index.h"
 
 /* Ringbuffer file structure */
 typedef struct _rb_file {
@@ -78,10 +83,26 @@ typedef struct _ringbuf_data {
     bool          group_read_access;   /**< true if files need to be opened with group read access */
     FILE         *name_h;              /**< write names of completed files to this handle */
     const char   *compress_type;       /**< compress type */
+    uint64_t      preallocate;         /**< bytes of disk space to reserve for each file, or 0 */
 } ringbuf_data;
 
 static ringbuf_data rb_data;
 
+/*
+ * remove a ring buffer file, along with its flow index if dumpcap wrote one
+ * (ignoring errors, as either may not exist)
+ */
+static void
+ringbuf_unlink_file(const char *name)
+{
+    char *index_name;
+
+    ws_unlink(name);
+    index_name = flow_index_filename(name);
+    ws_unlink(index_name);
+    g_free(index_name);
+}
+
 /*
  * create the next filename and open a new binary file with that name
  */
@@ -96,7 +117,7 @@ ringbuf_open_file(rb_file *rfile, int *err)
     if (rfile->name != NULL) {
         if (rb_data.unlimited == false) {
             /* remove old file (if any, so ignore error) */
-            ws_unlink(rfile->name);
+            ringbuf_unlink_file(rfile->name);
         }
         g_free(rfile->name);
     }
@@ -127,9 +148,24 @@ ringbuf_open_file(rb_file *rfile, int *err)
     rb_data.fd = ws_open(rfile->name, O_RDWR|O_BINARY|O_TRUNC|O_CREAT,
             rb_data.group_read_access ? 0640 : 0600);
 
-    if (rb_data.fd == -1 && err != NULL) {
-        *err = errno;
+    if (rb_data.fd == -1) {
+        if (err != NULL)
+            *err = errno;
+        return -1;
+    }
+
+#ifdef HAVE_FALLOCATE
+    /*
+     * Reserve the space the file will need now, so the blocks for it are
+     * less likely to be scattered, and writing the file doesn't have to
+     * wait for them to be allocated. The file's size doesn't change, so
+     * readers of the file, and closing it early, aren't affected. This
+     * isn't supported by all file systems, so failing isn't an error.
+     */
+    if (rb_data.preallocate > 0) {
+        (void) fallocate(rb_data.fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)rb_data.preallocate);
     }
+#endif
 
     return rb_data.fd;
 }
@@ -286,6 +322,22 @@ ringbuf_current_filename(void)
     return rb_data.files[rb_data.curr_file_num % rb_data.num_files].name;
 }
 
+void
+ringbuf_set_preallocate(uint64_t size)
+{
+    rb_data.preallocate = size;
+}
+
+bool
+ringbuf_can_preallocate(void)
+{
+#ifdef HAVE_FALLOCATE
+    return true;
+#else
+    return false;
+#endif
+}
+
 /*
  * Calls ws_fdopen() for the current ringbuffer file
  */
@@ -429,7 +481,7 @@ ringbuf_error_cleanup(void)
     if (rb_data.files != NULL) {
         for (i=0; i < rb_data.num_files; i++) {
             if (rb_data.files[i].name != NULL) {
-                ws_unlink(rb_data.files[i].name);
+                ringbuf_unlink_file(rb_data.files[i].name);
             }
         }
     }
@@ -54,6 +54,23 @@ bool ringbuf_is_initialized(void);
  */
 const char *ringbuf_current_filename(void);
 
+/**
+ * @brief Reserve disk space for each ringbuffer file when it is opened.
+ *
+ * Call before ringbuf_init(). The files' sizes aren't changed; the space
+ * is just allocated ahead of the writes. Does nothing if
+ * ringbuf_can_preallocate() returns false.
+ *
+ * @param size The number of bytes to reserve, or 0 not to.
+ */
+void ringbuf_set_preallocate(uint64_t size);
+
+/**
+ * @brief Check if ringbuf_set_preallocate() is supported on this platform.
+ * @return true if it is, false otherwise.
+ */
+bool ringbuf_can_preallocate(void);
+
 /**
  * @brief Initialize a libpcap dump file for the ringbuffer.
  * Initializes a libpcap dump file for writing captured packets to the ringbuffer.
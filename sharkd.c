@@ -48,6 +48,7 @@
 #include <wsutil/filter_files.h>
 #include <ui/tap_export_pdu.h>
 #include <ui/failure_message.h>
+#include <capture/capture_file_filter.h>
 #include <wiretap/wtap.h>
 #include <epan/epan_dissect.h>
 #include <epan/tap.h>
@@ -276,11 +277,16 @@ sharkd_epan_new(capture_file *cf)
 
 static bool
 process_packet(capture_file *cf, epan_dissect_t *edt, int64_t offset,
-               wtap_rec *rec)
+               wtap_rec *rec, capture_file_filter *cfilter)
 {
     frame_data     fdlocal;
     bool           passed;
 
+    /* Packets that don't match the capture filter are dropped before
+       they're numbered, as if they weren't in the file. */
+    if (cfilter && !capture_file_filter_apply(cfilter, rec))
+        return false;
+
     /* If we're not running a display filter and we're not printing any
        packet information, we don't need to do a dissection. This means
        that all packets can be marked as 'passed'. */
@@ -352,7 +358,8 @@ process_packet(capture_file *cf, epan_dissect_t *edt, int64_t offset,
 
 
 static int
-load_cap_file(capture_file *cf, int max_packet_count, int64_t max_byte_count)
+load_cap_file(capture_file *cf, int max_packet_count, int64_t max_byte_count,
+              capture_file_filter *cfilter)
 {
     int          err;
     char        *err_info = NULL;
@@ -389,7 +396,7 @@ load_cap_file(capture_file *cf, int max_packet_count, int64_t max_byte_count)
         wtap_rec_init(&rec, DEFAULT_INIT_BUFFER_SIZE_2048);
 
         while (wtap_read(cf->provider.wth, &rec, &err, &err_info, &data_offset)) {
-            if (process_packet(cf, edt, data_offset, &rec)) {
+            if (process_packet(cf, edt, data_offset, &rec, cfilter)) {
                 wtap_rec_reset(&rec);
                 /* Stop reading if we have the maximum number of packets;
                  * When the -c option has not been used, max_packet_count
@@ -523,13 +530,20 @@ sharkd_cf_open(const char *fname, unsigned int type, bool is_tempfile, int *err)
 int
 sharkd_load_cap_file(void)
 {
-    return load_cap_file(&cfile, 0, 0);
+    return load_cap_file(&cfile, 0, 0, NULL);
 }
 
 int
 sharkd_load_cap_file_with_limits(int max_packet_count, int64_t max_byte_count)
 {
-    return load_cap_file(&cfile, max_packet_count, max_byte_count);
+    return load_cap_file(&cfile, max_packet_count, max_byte_count, NULL);
+}
+
+int
+sharkd_load_cap_file_with_cfilter(int max_packet_count, int64_t max_byte_count,
+                                  capture_file_filter *cfilter)
+{
+    return load_cap_file(&cfile, max_packet_count, max_byte_count, cfilter);
 }
 
 frame_data *
@@ -668,6 +682,8 @@ sharkd_filter(const char *dftext, uint8_t **result)
     uint8_t passed_bits;
 
     epan_dissect_t edt;
+    dfilter_frame_range_t frame_range;
+    bool has_frame_range;
 
     if (!dfilter_compile(dftext, &dfcode, NULL)) {
         return -1;
@@ -680,6 +696,7 @@ sharkd_filter(const char *dftext, uint8_t **result)
     }
 
     frames_count = cfile.count;
+    has_frame_range = dfilter_get_frame_range(dfcode, &frame_range);
 
     wtap_rec_init(&rec, DEFAULT_INIT_BUFFER_SIZE_2048);
     epan_dissect_init(&edt, cfile.epan, true, false);
@@ -695,6 +712,13 @@ sharkd_filter(const char *dftext, uint8_t **result)
             passed_bits = 0;
         }
 
+        /* The frames have all been dissected once already, so the ones
+           the filter can't match can be left out without reading them. */
+        if (has_frame_range &&
+                !dfilter_frame_range_contains(&frame_range, fdata->num,
+                    fdata->has_ts ? &fdata->abs_ts : NULL, fdata->pkt_len))
+            continue;
+
         if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &err, &err_info))
             break;
 
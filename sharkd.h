@@ -14,6 +14,7 @@
 
 #include <file.h>
 #include <wiretap/wtap_opttypes.h>
+#include <capture/capture_file_filter.h>
 
 #define SHARKD_DISSECT_FLAG_NULL       0x00u
 #define SHARKD_DISSECT_FLAG_BYTES      0x01u
@@ -63,6 +64,20 @@ int sharkd_load_cap_file(void);
  */
 int sharkd_load_cap_file_with_limits(int max_packet_count, int64_t max_byte_count);
 
+/**
+ * @brief Load a capture file, keeping only the packets that match a capture filter.
+ *
+ * Like sharkd_load_cap_file_with_limits(), but packets that don't match the
+ * capture filter are dropped before they're numbered or dissected.
+ *
+ * @param max_packet_count The maximum number of packets to load, or 0 for no limit.
+ * @param max_byte_count The maximum number of bytes to load, or 0 for no limit.
+ * @param cfilter The capture filter, or NULL to keep every packet.
+ * @return 0 on success, non-zero on failure.
+ */
+int sharkd_load_cap_file_with_cfilter(int max_packet_count, int64_t max_byte_count,
+                                      capture_file_filter *cfilter);
+
 /**
  * @brief Retaps all packets in the current capture file.
  *
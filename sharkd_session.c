@@ -452,6 +452,7 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
         {"load",       "file",           2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_MANDATORY},
         {"load",       "max_packets",    2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, SHARKD_OPTIONAL},
         {"load",       "max_bytes",      2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, SHARKD_OPTIONAL},
+        {"load",       "cfilter",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
         {"setcomment", "frame",          2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, SHARKD_MANDATORY},
         {"setcomment", "comment",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_MANDATORY},
         {"setconf",    "name",           2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_MANDATORY},
@@ -1286,6 +1287,7 @@ sharkd_session_process_field(const char* buf, const jsmntok_t* tokens, int count
  *
  * Input:
  *   (m) file - file to be loaded
+ *   (o) cfilter - capture filter; only packets that match it are loaded
  *
  * Output object with attributes:
  *   (m) err - error code
@@ -1296,6 +1298,9 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
     const char *tok_file = json_find_attr(buf, tokens, count, "file");
     const char *tok_max_packets = json_find_attr(buf, tokens, count, "max_packets");
     const char *tok_max_bytes = json_find_attr(buf, tokens, count, "max_bytes");
+    const char *tok_cfilter = json_find_attr(buf, tokens, count, "cfilter");
+    capture_file_filter *cfilter = NULL;
+    char *err_msg = NULL;
     int err = 0;
 
     uint32_t max_packets = 0;  /* 0 means unlimited */
@@ -1333,12 +1338,49 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
     fprintf(stderr, "load: filename=%s, max_packets=%u, max_bytes=%" PRIu64 "\n",
             tok_file, max_packets, max_bytes);
 
+    /* Check the capture filter before opening the file for loading, which
+     * closes the file already loaded; a bad filter mustn't lose it. If the
+     * new file has a single link-layer type, compile the filter for it,
+     * using a handle of its own. */
+    if (tok_cfilter && *tok_cfilter)
+    {
+        cfilter = capture_file_filter_new(tok_cfilter, true, &err_msg);
+        if (cfilter)
+        {
+            char *err_info = NULL;
+            wtap *wth = wtap_open_offline(tok_file, WTAP_TYPE_AUTO, &err, &err_info, false);
+
+            if (wth)
+            {
+                int file_encap = wtap_file_encap(wth);
+
+                if (file_encap != WTAP_ENCAP_PER_PACKET && file_encap != WTAP_ENCAP_UNKNOWN)
+                    capture_file_filter_compile(cfilter, file_encap, &err_msg);
+                wtap_close(wth);
+            }
+            /* If it can't be opened, sharkd_cf_open() reports that below. */
+            g_free(err_info);
+            err = 0;
+        }
+        if (err_msg)
+        {
+            sharkd_json_error(
+                    rpcid, -2002, NULL,
+                    "%s", err_msg
+                    );
+            g_free(err_msg);
+            capture_file_filter_free(cfilter);
+            return;
+        }
+    }
+
     if (sharkd_cf_open(tok_file, WTAP_TYPE_AUTO, false, &err) != CF_OK)
     {
         sharkd_json_error(
                 rpcid, -2001, NULL,
                 "Unable to open the file"
                 );
+        capture_file_filter_free(cfilter);
         return;
     }
 
@@ -1348,7 +1390,11 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 
     TRY
     {
-        if (max_packets > 0 || max_bytes > 0)
+        if (cfilter)
+        {
+            err = sharkd_load_cap_file_with_cfilter((int)max_packets, (int64_t)max_bytes, cfilter);
+        }
+        else if (max_packets > 0 || max_bytes > 0)
         {
             err = sharkd_load_cap_file_with_limits((int)max_packets, (int64_t)max_bytes);
         }
@@ -1368,6 +1414,8 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
     }
     ENDTRY;
 
+    capture_file_filter_free(cfilter);
+
     if (err == 0)
     {
         sharkd_json_simple_ok(rpcid);
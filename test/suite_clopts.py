@@ -10,9 +10,14 @@
 
 import json
 import os.path
+import re
 import shutil
+import socket
+import stat
 import subprocess
 import sys
+import tempfile
+import time
 import types
 
 import pytest
@@ -133,6 +138,165 @@ class TestTsharkOptions:
         assert obj.get('ip.proto', 'NOT FOUND') == ['6']
         assert obj.get('http.host', 'NOT FOUND') == 'NOT FOUND'
 
+    def test_tshark_prune_dissection(self, cmd_tshark, capture_file, test_env):
+        '''--prune-dissection gives the same fields as a full dissection'''
+        # Only L3/L4 fields are requested, so HTTP can be pruned. frame.protocols
+        # shows which protocols were actually dissected.
+        fields_args = ("-r", capture_file("http.pcap"), "-Tfields",
+                    "-eip.src", "-etcp.dstport", "-eframe.protocols")
+        full = subprocesstest.run((cmd_tshark, *fields_args),
+                    capture_output=True, env=test_env)
+        pruned = subprocesstest.run((cmd_tshark, *fields_args, "--prune-dissection"),
+                    capture_output=True, env=test_env)
+        assert full.returncode == ExitCodes.OK
+        assert pruned.returncode == ExitCodes.OK
+        full_lines = full.stdout.splitlines()
+        pruned_lines = pruned.stdout.splitlines()
+        assert len(pruned_lines) == len(full_lines)
+        assert [line.split('\t')[:2] for line in pruned_lines] == \
+                    [line.split('\t')[:2] for line in full_lines]
+        assert any(':http' in line.split('\t')[2] for line in full_lines)
+        assert not any(':http' in line.split('\t')[2] for line in pruned_lines)
+        assert all(':tcp' in line.split('\t')[2] for line in pruned_lines)
+
+    def test_tshark_prune_dissection_requires_fields(self, cmd_tshark, capture_file, test_env):
+        '''--prune-dissection without -T fields'''
+        process = subprocesstest.run((cmd_tshark, "-r", capture_file("http.pcap"),
+                    "--prune-dissection"), capture_output=True, env=test_env)
+        assert process.returncode == ExitCodes.INVALID_OPTION
+
+    def test_tshark_prefilter_frames(self, cmd_tshark, capture_file, test_env):
+        '''--prefilter-frames gives the same frames as a full dissection, and stops reading early'''
+        fields_args = ("-r", capture_file("dhcp.pcap"), "-Tfields", "-eframe.number",
+                    "-Y", "frame.number >= 2 && frame.len > 300 && frame.number < 4")
+        full = subprocesstest.run((cmd_tshark, *fields_args),
+                    capture_output=True, env=test_env)
+        skipped = subprocesstest.run((cmd_tshark, *fields_args, "--prefilter-frames",
+                    "--log-level", "info"),
+                    capture_output=True, env=test_env)
+        assert skipped.returncode == ExitCodes.OK
+        assert skipped.stdout == full.stdout
+        assert skipped.stdout.split() == ['2', '3']
+        # Reading stopped after frame 3 rather than going on to the end.
+        assert grep_output(skipped.stderr, r'No frame after #3 can pass the display filter')
+        assert not grep_output(full.stderr, r'No frame after')
+
+    def test_tshark_read_capfilter(self, cmd_tshark, capture_file, features, test_env):
+        '''A capture filter drops packets read from a file before they're numbered'''
+        if not features.have_pcap:
+            pytest.skip('Test requires libpcap at runtime.')
+        proc = subprocesstest.run((cmd_tshark, "-r", capture_file("dhcp.pcap"),
+                    "-f", "udp src port 68", "-Tfields", "-eframe.number", "-edhcp.type"),
+                    capture_output=True, env=test_env)
+        assert proc.returncode == ExitCodes.OK
+        assert proc.stdout.split() == ['1', '1', '2', '1']
+
+    def test_tshark_read_capfilter_raw_ip(self, cmd_tshark, capture_file, features, test_env):
+        '''A capture filter applies to raw IP (LINKTYPE_RAW) packets read from a file'''
+        if not features.have_pcap:
+            pytest.skip('Test requires libpcap at runtime.')
+        proc = subprocesstest.run((cmd_tshark, "-r", capture_file("tcp-rst-diagnostic.pcap"),
+                    "-f", "tcp dst port 443", "-Tfields", "-eframe.number", "-etcp.srcport"),
+                    capture_output=True, env=test_env)
+        assert proc.returncode == ExitCodes.OK
+        assert proc.stdout.split() == ['1', '12346', '2', '22222']
+
+    def test_tshark_heuristic_stats(self, cmd_tshark, capture_file, test_env):
+        '''--heuristic-stats reports the heuristic dissectors that were tried'''
+        fields_args = ("-r", capture_file("dhcp.pcap"), "-Tfields", "-eframe.number",
+                    "-o", "udp.try_heuristic_first:TRUE")
+        plain = subprocesstest.run((cmd_tshark, *fields_args),
+                    capture_output=True, env=test_env)
+        proc = subprocesstest.run((cmd_tshark, *fields_args, "--heuristic-stats",
+                    "-o", "protocols.heuristic_order:FIXED"),
+                    capture_output=True, env=test_env)
+        assert proc.returncode == ExitCodes.OK
+        assert proc.stdout == plain.stdout
+        assert grep_output(proc.stderr, 'Attempts')
+        assert grep_output(proc.stderr, r'^udp\s+\S+\s+4\s')
+        two_pass = subprocesstest.run((cmd_tshark, *fields_args, "-2", "--heuristic-stats",
+                    "-o", "protocols.heuristic_order:FIXED"),
+                    capture_output=True, env=test_env)
+        assert two_pass.returncode == ExitCodes.OK
+        assert two_pass.stdout == plain.stdout
+        # Only the second pass is counted.
+        assert grep_output(two_pass.stderr, r'^udp\s+\S+\s+4\s')
+
+    def test_tshark_skip_registration_checks(self, cmd_tshark, capture_file, test_env):
+        '''WIRESHARK_SKIP_REGISTRATION_CHECKS skips the checks without changing the dissection'''
+        fields_args = ("--log-level", "info", "-r", capture_file("http.pcap"),
+                    "-Tfields", "-eip.src", "-etcp.dstport", "-ehttp.host")
+        skipped_re = r'Skipped the registration checks of (\d+) built-in fields'
+        checked = subprocesstest.run((cmd_tshark, *fields_args),
+                    capture_output=True, env=test_env)
+        assert checked.returncode == ExitCodes.OK
+        assert re.search(skipped_re, checked.stderr) is None
+        skip_env = test_env.copy()
+        skip_env['WIRESHARK_SKIP_REGISTRATION_CHECKS'] = '1'
+        skipped = subprocesstest.run((cmd_tshark, *fields_args),
+                    capture_output=True, env=skip_env)
+        assert skipped.returncode == ExitCodes.OK
+        match = re.search(skipped_re, skipped.stderr)
+        assert match is not None
+        # Each built-in dissector's fields, not just a few
+        assert int(match.group(1)) > 10000
+        assert skipped.stdout == checked.stdout
+
+    @pytest.mark.skipif(sys.platform == 'win32', reason='Requires Unix domain sockets')
+    def test_tshark_zygote(self, cmd_tshark, capture_file, test_env):
+        '''A job run by --zygote gives the same output as a normal run, takes log options, and is reaped'''
+        fields_args = ("-r", capture_file("http.pcap"), "-Tfields",
+                    "-eip.src", "-etcp.dstport", "-ehttp.host")
+        plain = subprocesstest.run((cmd_tshark, *fields_args),
+                    capture_output=True, env=test_env)
+        with tempfile.TemporaryDirectory() as sock_dir:
+            sock_path = os.path.join(sock_dir, 'zygote.sock')
+            zygote = subprocess.Popen((cmd_tshark, '--zygote', sock_path),
+                        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, env=test_env)
+            try:
+                outputs = []
+                # The third job's log options apply to it.
+                log_job = (*fields_args, "--log-level", "info", "--prefilter-frames",
+                        "-Y", "frame.number <= 2")
+                for job in (fields_args, ("-r", "-", *fields_args[2:]), log_job):
+                    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+                        for _ in range(300):
+                            try:
+                                sock.connect(sock_path)
+                                break
+                            except (FileNotFoundError, ConnectionRefusedError):
+                                time.sleep(0.1)
+                        sock.sendall((json.dumps(job) + '\n').encode('utf-8'))
+                        if job[1] == "-":
+                            with open(capture_file("http.pcap"), 'rb') as f:
+                                sock.sendall(f.read())
+                        sock.shutdown(socket.SHUT_WR)
+                        output = b''
+                        chunk = sock.recv(65536)
+                        while chunk:
+                            output += chunk
+                            chunk = sock.recv(65536)
+                        outputs.append(output.decode('utf-8'))
+                # Only our user may connect.
+                assert stat.S_IMODE(os.stat(sock_path).st_mode) == 0o600
+                # Finished jobs are reaped without waiting for another
+                # connection. Linux lists a process's children, zombies
+                # included.
+                children_path = f'/proc/{zygote.pid}/task/{zygote.pid}/children'
+                if os.path.exists(children_path):
+                    for _ in range(100):
+                        with open(children_path) as children:
+                            if not children.read().split():
+                                break
+                        time.sleep(0.1)
+                    else:
+                        pytest.fail('the zygote left jobs unreaped')
+            finally:
+                zygote.kill()
+                zygote.wait()
+        assert outputs[:2] == [plain.stdout, plain.stdout]
+        assert grep_output(outputs[2], 'No frame after #2 can pass the display filter')
+
 
 class TestTsharkCaptureClopts:
     def test_tshark_invalid_capfilter(self, cmd_tshark, capture_interface, result_file, test_env):
@@ -324,6 +488,24 @@ class TestTsharkZExpert:
         assert not grep_output(proc.stdout, 'Chats')
 
 
+class TestTsharkZDissectorProfile:
+    def test_tshark_z_dissector_profile(self, cmd_tshark, capture_file, test_env):
+        proc = subprocesstest.run((cmd_tshark, '-q', '-z', 'dissector_profile,stat',
+            '-r', capture_file('dhcp.pcap')), capture_output=True, env=test_env)
+        assert proc.returncode == ExitCodes.OK
+        assert grep_output(proc.stdout, 'Exclusive Time')
+        # Each of the four frames is dissected once.
+        assert grep_output(proc.stdout, r'^frame\s+\|\s+4 \|')
+        assert grep_output(proc.stdout, r'^udp\s+\|\s+4 \|')
+        assert grep_output(proc.stdout, r'^dhcp\s+\|\s+4 \|')
+
+    def test_tshark_z_dissector_profile_filter(self, cmd_tshark, capture_file, test_env):
+        proc = subprocesstest.run((cmd_tshark, '-q', '-z', 'dissector_profile,stat,udp',
+            '-r', capture_file('dhcp.pcap')), capture_output=True, env=test_env)
+        assert proc.returncode == ExitCodes.COMMAND_LINE
+        assert grep_output(proc.stderr, "can't be filtered")
+
+
 @pytest.fixture
 def extcap_pyenv(home_path, test_env, features):
     if not features.have_pcap:
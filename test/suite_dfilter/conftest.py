@@ -149,3 +149,23 @@ def checkDFilterSucceed(dftest_cmd, dfilter_env):
         if expect_stdout:
             assert expect_stdout in proc.stdout
     return checkDFilterSucceed_real
+
+@pytest.fixture
+def checkDFilterFrameRange(cmd_dftest, dfilter_env):
+    def checkDFilterFrameRange_real(dfilter, expected_bounds):
+        """Compile a display filter and expect dftest to report these frame bounds."""
+        proc = subprocesstest.run((cmd_dftest, "--frame-range", "--", dfilter),
+                                capture_output=True,
+                                universal_newlines=True,
+                                env=dfilter_env)
+        if proc.stderr:
+            logging.debug(proc.stderr)
+        assert proc.returncode == 0
+        lines = proc.stdout.splitlines()
+        if not expected_bounds:
+            assert "Frame range: (none)" in lines
+            return
+        start = lines.index("Frame range:") + 1
+        end = lines.index("", start)
+        assert [line.strip() for line in lines[start:end]] == expected_bounds
+    return checkDFilterFrameRange_real
@@ -0,0 +1,53 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+# Bounds that dfilter_get_frame_range() finds in a display filter, as
+# printed by dftest --frame-range.
+
+
+class TestDfilterFrameRange:
+
+    def test_number(self, checkDFilterFrameRange):
+        dfilter = 'frame.number >= 5 && frame.number < 10'
+        checkDFilterFrameRange(dfilter, ['frame.number >= 5', 'frame.number <= 9'])
+
+    def test_number_eq(self, checkDFilterFrameRange):
+        dfilter = 'frame.number == 7'
+        checkDFilterFrameRange(dfilter, ['frame.number >= 7', 'frame.number <= 7'])
+
+    def test_number_reversed(self, checkDFilterFrameRange):
+        dfilter = '10 > frame.number'
+        checkDFilterFrameRange(dfilter, ['frame.number <= 9'])
+
+    def test_len(self, checkDFilterFrameRange):
+        dfilter = 'frame.len >= 60 && frame.len >= 100 && frame.len <= 1500'
+        checkDFilterFrameRange(dfilter, ['frame.len >= 100', 'frame.len <= 1500'])
+
+    def test_time(self, checkDFilterFrameRange):
+        dfilter = 'frame.time >= 1041342931.3 && frame.time_epoch < 1041342932'
+        checkDFilterFrameRange(dfilter, ['frame.time >= 1041342931.300000000',
+                                         'frame.time <= 1041342932.000000000'])
+
+    def test_time_eq(self, checkDFilterFrameRange):
+        dfilter = 'frame.time == 1041342931.3'
+        checkDFilterFrameRange(dfilter, ['frame.time >= 1041342931.300000000',
+                                         'frame.time <= 1041342931.300000000'])
+
+    def test_and_other_tests(self, checkDFilterFrameRange):
+        dfilter = 'frame.number > 5 and ip and frame.len <= 60'
+        checkDFilterFrameRange(dfilter, ['frame.number >= 6', 'frame.len <= 60'])
+
+    def test_or(self, checkDFilterFrameRange):
+        dfilter = 'frame.number > 5 || frame.len < 60'
+        checkDFilterFrameRange(dfilter, None)
+
+    def test_not(self, checkDFilterFrameRange):
+        dfilter = '!(frame.number > 5)'
+        checkDFilterFrameRange(dfilter, None)
+
+    def test_and_with_or_and_not(self, checkDFilterFrameRange):
+        dfilter = '(frame.number > 5 || ip) && frame.number < 9 && !(frame.len < 60)'
+        checkDFilterFrameRange(dfilter, ['frame.number <= 8'])
+
+    def test_other_fields(self, checkDFilterFrameRange):
+        dfilter = 'ip.len > 5 && frame.cap_len < 60 && frame.number in {1 2}'
+        checkDFilterFrameRange(dfilter, None)
@@ -9,12 +9,14 @@
 '''File format conversion tests'''
 
 import os.path
+import re
+import struct
 import subprocess
 from pathlib import PurePath
 
 import pytest
 
-from subprocesstest import count_output
+from subprocesstest import check_packet_count, count_output
 
 # XXX Currently unused. It would be nice to be able to use this below.
 time_output_args = ('-Tfields', '-e', 'frame.number', '-e', 'frame.time_epoch', '-e', 'frame.time_delta')
@@ -253,6 +255,54 @@ class TestFileFormatsPcapngDsb:
         assert dsb1_contents == dsb1_out
         assert dsb2_contents == dsb2_out
 
+class TestFileFormatsTimeIndex:
+    # Time index entries are at least a second and 1 MiB apart, so the
+    # capture has to be bigger than that for there to be anywhere to seek to.
+    packet_count = 3000
+    packet_len = 1400
+    first_secs = 1700000000
+
+    def write_capture(self, filename):
+        '''Write a pcap file of UDP packets 10 ms apart.'''
+        with open(filename, 'wb') as f:
+            f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+            frame = bytes(12) + b'\x08\x00' + bytes(self.packet_len - 14)
+            for i in range(self.packet_count):
+                f.write(struct.pack('<IIII', self.first_secs + i // 100, (i % 100) * 10000,
+                    self.packet_len, self.packet_len))
+                f.write(frame)
+
+    def test_time_index_start_time(self, cmd_editcap, cmd_capinfos, cmd_tshark, result_file, test_env):
+        '''Write a time index for a capture file and use it with -A.'''
+        infile = result_file('time-index.pcap')
+        self.write_capture(infile)
+        subprocess.run((cmd_editcap,
+            '--write-time-index',
+            infile, result_file('time-index-copy.pcap')
+        ), check=True, env=test_env)
+        assert os.path.isfile(infile + '.timeidx')
+
+        # Packet 2001 (from 1), 20 seconds and about 2.8 MB in.
+        outfile = result_file('time-index-start.pcap')
+        editcap_proc = subprocess.run((cmd_editcap,
+            '--log-level', 'info',
+            '-A', f'{self.first_secs + 20}.000000',
+            infile, outfile
+        ), capture_output=True, check=True, encoding='utf-8', env=test_env)
+        skipped = re.search(r'skipped (\d+) records', editcap_proc.stderr)
+        assert skipped, 'editcap -A did not use the time index'
+        assert 0 < int(skipped.group(1)) <= 2000
+
+        check_packet_count(cmd_capinfos, self.packet_count - 2000, outfile)
+        proc_stdout = subprocess.check_output((cmd_tshark,
+                '-r', outfile,
+                '-c', '2',
+                '-Tfields',
+                '-e', 'frame.time_epoch',
+            ), encoding='utf-8', env=test_env)
+        assert proc_stdout.split() == [f'{self.first_secs + 20}.000000000', f'{self.first_secs + 20}.010000000']
+
+
 class TestFileFormatMime:
     def test_mime_pcapng_gz(self, cmd_tshark, capture_file, test_env):
         '''Test that the full uncompressed contents is shown.'''
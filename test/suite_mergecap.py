@@ -8,7 +8,10 @@
 #
 '''Mergecap tests'''
 
+import ipaddress
 import re
+import shutil
+import struct
 import subprocess
 
 from subprocesstest import grep_output
@@ -270,3 +273,134 @@ class TestMergecapPcapng:
         ), capture_output=True, encoding='utf-8', env=test_env, check=False)
         # check for 11 IDBs, 88*3=264 total pkts, 86*3=258 in first IDB
         check_mergecap(mergecap_proc, 'pcapng', 'Per packet', 264, 11, 258, cmd_capinfos, testout_file, test_env)
+
+
+def fnv1a_64(data):
+    h = 0xcbf29ce484222325
+    for b in data:
+        h ^= b
+        h = (h * 0x100000001b3) & 0xffffffffffffffff
+    return h
+
+
+def write_flow_index(filename, flows):
+    '''Write a dumpcap flow index (see writecap/flow_index.c) for a list of
+    IPv4 UDP flows, each ((address, port), (address, port), first packet
+    number, last packet number, first time stamp, last time stamp).'''
+    bloom_bytes = 128 * 1024
+    bloom = bytearray(bloom_bytes)
+    records = b''
+    total_packets = 0
+    for end_1, end_2, first_packet, last_packet, first_ts, last_ts in flows:
+        ends = sorted((ipaddress.IPv4Address(a).packed + bytes(12), port) for a, port in (end_1, end_2))
+        for addr, _ in ends:
+            h = fnv1a_64(bytes([4]) + addr)
+            h1 = h & 0xffffffff
+            h2 = (h >> 32) | 1
+            for i in range(4):
+                bit = ((h1 + i * h2) & 0xffffffff) % (bloom_bytes * 8)
+                bloom[bit // 8] |= 1 << (bit % 8)
+        packets = last_packet - first_packet + 1
+        total_packets += packets
+        records += struct.pack('<BBH16s16sHHQQQQII', 4, 17, 0, ends[0][0], ends[1][0],
+            ends[0][1], ends[1][1], first_ts, last_ts, packets, 0, first_packet, last_packet)
+    first_ts = min((flow[4] for flow in flows), default=0)
+    last_ts = max((flow[5] for flow in flows), default=0)
+    header = struct.pack('<4sIIIIIQQQQ', b'WSFI', 1, 0, bloom_bytes, len(flows), 0,
+        first_ts, last_ts, total_packets, 0)
+    with open(filename, 'wb') as f:
+        f.write(header + bloom + records)
+
+
+# The flows in dhcp.pcap: packets 1 and 3 go from 0.0.0.0:68 to
+# 255.255.255.255:67, and packets 2 and 4 from 192.168.0.1:67 to
+# 192.168.0.10:68.
+dhcp_ts = [1102274184317453000, 1102274184317748000, 1102274184387484000, 1102274184387798000]
+dhcp_discover_flow = (('0.0.0.0', 68), ('255.255.255.255', 67), 1, 3, dhcp_ts[0], dhcp_ts[2])
+dhcp_offer_flow = (('192.168.0.1', 67), ('192.168.0.10', 68), 2, 4, dhcp_ts[1], dhcp_ts[3])
+
+
+def run_mergecap_flow(cmd_mergecap, flow, testout_file, in_files, env):
+    return subprocess.run((cmd_mergecap,
+        '-V',
+        '--flow-address', flow,
+        '-F', 'pcap',
+        '-w', testout_file,
+        *in_files,
+    ), capture_output=True, encoding='utf-8', env=env, check=False)
+
+
+class TestMergecapFlowAddress:
+    def test_mergecap_flow_address(self, cmd_mergecap, capture_file, result_file, cmd_capinfos, test_env):
+        '''Merge only the packets to or from the address, leaving out the files whose flow index doesn't have it.'''
+        with_addr = result_file('with_addr.pcap')
+        without_addr = result_file('without_addr.pcap')
+        no_index = result_file('no_index.pcap')
+        for f in (with_addr, without_addr, no_index):
+            shutil.copyfile(capture_file('dhcp.pcap'), f)
+        write_flow_index(with_addr + '.flowidx', [dhcp_discover_flow, dhcp_offer_flow])
+        # Claims not to have the address, so that we can tell that only the
+        # index was used to leave it out.
+        write_flow_index(without_addr + '.flowidx', [dhcp_discover_flow])
+
+        testout_file = result_file(testout_pcap)
+        mergecap_proc = run_mergecap_flow(cmd_mergecap, '192.168.0.10', testout_file,
+            (with_addr, without_addr, no_index), test_env)
+        assert grep_output(mergecap_proc.stderr, 'skipping .*without_addr.pcap')
+        assert not grep_output(mergecap_proc.stderr, 'skipping .*with_addr.pcap')
+        assert not grep_output(mergecap_proc.stderr, 'skipping .*no_index.pcap')
+        assert grep_output(mergecap_proc.stderr, 'reading packets 2 to 4 of .*with_addr.pcap')
+        # Packets 2 and 4 of two of the three files
+        check_mergecap(mergecap_proc, 'pcap', 'Ethernet', 4, 1, 4, cmd_capinfos, testout_file, test_env)
+
+    def test_mergecap_flow_address_5tuple(self, cmd_mergecap, capture_file, result_file, cmd_capinfos, test_env):
+        '''Merge only the packets of a flow given by its addresses, protocol and ports, in either direction.'''
+        testout_file = result_file(testout_pcap)
+        mergecap_proc = run_mergecap_flow(cmd_mergecap, '192.168.0.10,192.168.0.1,udp,68,67', testout_file,
+            (capture_file('dhcp.pcap'),), test_env)
+        check_mergecap(mergecap_proc, 'pcap', 'Ethernet', 2, 1, 2, cmd_capinfos, testout_file, test_env)
+
+        # The ports the wrong way around, or another protocol
+        for flow in ('192.168.0.10,192.168.0.1,udp,67,68', '192.168.0.10,*,tcp'):
+            mergecap_proc = run_mergecap_flow(cmd_mergecap, flow, testout_file,
+                (capture_file('dhcp.pcap'),), test_env)
+            assert mergecap_proc.returncode == 0
+            capinfos_stdout = subprocess.check_output((cmd_capinfos, '-c', testout_file), encoding='utf-8', env=test_env)
+            assert re.search(r'Number of packets:\s+0\b', capinfos_stdout)
+
+    def test_mergecap_flow_address_records(self, cmd_mergecap, capture_file, result_file, test_env):
+        '''Leave out a file whose Bloom filter has both addresses but whose flow records rule the flow out.'''
+        infile = result_file('in.pcap')
+        shutil.copyfile(capture_file('dhcp.pcap'), infile)
+        write_flow_index(infile + '.flowidx', [dhcp_discover_flow, dhcp_offer_flow])
+        mergecap_proc = run_mergecap_flow(cmd_mergecap, '192.168.0.1,192.168.0.10,tcp',
+            result_file(testout_pcap), (infile,), test_env)
+        assert mergecap_proc.returncode != 0
+        assert grep_output(mergecap_proc.stderr, 'skipping .*in.pcap')
+        assert grep_output(mergecap_proc.stderr, 'None of the input files have packets in the flow')
+
+    def test_mergecap_flow_address_span(self, cmd_mergecap, capture_file, result_file, cmd_capinfos, test_env):
+        '''Leave out the packets outside the span the flow index gives for the flow.'''
+        infile = result_file('in.pcap')
+        shutil.copyfile(capture_file('dhcp.pcap'), infile)
+        # Says the flow is only in packet 2, so that we can tell that packet
+        # 4 was left out because of the index.
+        write_flow_index(infile + '.flowidx', [dhcp_discover_flow,
+            (('192.168.0.1', 67), ('192.168.0.10', 68), 2, 2, dhcp_ts[1], dhcp_ts[1])])
+        testout_file = result_file(testout_pcap)
+        mergecap_proc = run_mergecap_flow(cmd_mergecap, '192.168.0.1', testout_file, (infile,), test_env)
+        assert grep_output(mergecap_proc.stderr, 'reading packets 2 to 2 of .*in.pcap')
+        check_mergecap(mergecap_proc, 'pcap', 'Ethernet', 1, 1, 1, cmd_capinfos, testout_file, test_env)
+
+    def test_mergecap_flow_address_none(self, cmd_mergecap, capture_file, result_file, test_env):
+        '''Fail if every input file's index rules the address out.'''
+        infile = result_file('in.pcap')
+        shutil.copyfile(capture_file('dhcp.pcap'), infile)
+        write_flow_index(infile + '.flowidx', [dhcp_offer_flow])
+        mergecap_proc = subprocess.run((cmd_mergecap,
+            '--flow-address', '192.0.2.1',
+            '-w', result_file(testout_pcap),
+            infile,
+        ), capture_output=True, encoding='utf-8', env=test_env, check=False)
+        assert mergecap_proc.returncode != 0
+        assert grep_output(mergecap_proc.stderr, 'None of the input files have packets in the flow')
@@ -106,3 +106,20 @@ class TestNameResolution:
                 ), encoding='utf-8', env=base_env)
         assert '174.137.42.65\twww.wireshark.org' not in stdout
         assert 'fe80::6233:4bff:fe13:c558\tCrunch.local' in stdout
+
+    def test_dns_cache(self, cmd_tshark, capture_file, result_file, base_env):
+        '''Names are read from and written back to the DNS cache file.'''
+        cache_path = result_file('dns_cache')
+        with open(cache_path, 'w') as cache_file:
+            cache_file.write('# A comment\n8.8.8.8 cached-8-8-8-8\n192.0.2.1\n')
+        stdout = subprocess.check_output((cmd_tshark,
+                '-r', capture_file('dns+icmp.pcapng.gz'),
+                '-o', 'nameres.network_name: TRUE',
+                '-o', 'nameres.use_external_name_resolver: FALSE',
+                '--dns-cache', cache_path,
+                ), encoding='utf-8', env=base_env)
+        assert 'cached-8-8-8-8' in stdout
+        with open(cache_path) as cache_file:
+            cache = cache_file.read()
+        assert '8.8.8.8 cached-8-8-8-8\n' in cache
+        assert '192.0.2.1\n' in cache
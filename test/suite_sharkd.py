@@ -73,6 +73,24 @@ class TestSharkd:
             {"jsonrpc":"2.0","id":1,"result":{"status":"Less data was read than was expected","err":-12}},
         ))
 
+    def test_sharkd_req_load_bad_cfilter_keeps_file(self, check_sharkd_session, capture_file, features):
+        if not features.have_pcap:
+            pytest.skip('Test requires libpcap at runtime.')
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('sip-rtp.pcapng')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap'), "cfilter": "udp port"}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"analyse"},
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"error":{"code":-2002,"message":MatchAny(str)}},
+            {"jsonrpc":"2.0","id":3,"result":{"frames": 562, "protocols": ["frame", "eth", "ethertype", "ip", "udp",
+                                        "sip", "sdp", "rtp"], "first":1105725482.965944, "last": 1105725515.56937}},
+        ))
+
     def test_sharkd_req_load_with_no_limits(self, check_sharkd_session, capture_file):
         check_sharkd_session((
             {"jsonrpc":"2.0", "id": 1, "method":"load",
@@ -18,6 +18,14 @@ class TestUnitTests:
         '''exntest'''
         subprocess.check_call(program('exntest'), env=base_env)
 
+    def test_unit_flow_index_test(self, program, base_env):
+        '''flow_index_test'''
+        subprocess.check_call(program('flow_index_test'), env=base_env)
+
+    def test_unit_maxmind_db_test(self, program, base_env):
+        '''maxmind_db_test'''
+        subprocess.check_call(program('maxmind_db_test'), env=base_env)
+
     def test_unit_oids_test(self, program, base_env):
         '''oids_test'''
         subprocess.check_call(program('oids_test'), env=base_env)
@@ -85,6 +85,7 @@
 #include "ui/dissect_opts.h"
 #include "ui/failure_message.h"
 #include "ui/capture_opts.h"
+#include "tshark_zygote.h"
 #if defined(HAVE_LIBSMI)
 #include "epan/oids.h"
 #endif
@@ -100,6 +101,7 @@
 #include <epan/secrets.h>
 
 #include "capture/capture-pcap-util.h"
+#include "capture/capture_file_filter.h"
 
 #ifdef HAVE_LIBPCAP
 #include "capture/capture_ifinfo.h"
@@ -144,6 +146,11 @@
 #define LONGOPT_GLOBAL_PROFILE          LONGOPT_BASE_APPLICATION+10
 #define LONGOPT_COMPRESS                LONGOPT_BASE_APPLICATION+11
 #define LONGOPT_JSON_COMPACT            LONGOPT_BASE_APPLICATION+12
+#define LONGOPT_PRUNE_DISSECTION        LONGOPT_BASE_APPLICATION+13
+#define LONGOPT_PREFILTER_FRAMES        LONGOPT_BASE_APPLICATION+14
+#define LONGOPT_HEURISTIC_STATS         LONGOPT_BASE_APPLICATION+15
+#define LONGOPT_DNS_CACHE               LONGOPT_BASE_APPLICATION+16
+#define LONGOPT_ZYGOTE                  LONGOPT_BASE_APPLICATION+17
 
 capture_file cfile;
 
@@ -196,6 +203,13 @@ static output_fields_t* output_fields;
 
 static bool no_duplicate_keys;
 static bool json_compact;
+static bool prune_dissection;
+static bool prefilter_frames;
+static bool heuristic_stats;
+static char *dns_cache_file;
+static bool have_prefilter_range;
+static dfilter_frame_range_t prefilter_range;
+static capture_file_filter *read_cfilter;
 static proto_node_children_grouper_func node_children_grouper = proto_node_group_children_by_unique;
 
 static json_dumper jdumper;
@@ -299,6 +313,8 @@ print_elapsed_json(const char *cf_name, const char *dfilter)
         .output_file = stderr,
         .flags = JSON_DUMPER_FLAGS_PRETTY_PRINT,
     };
+    const epan_startup_times *startup = epan_get_startup_times();
+    const addr_resolv_init_times *addr_resolv_times = addr_resolv_get_init_times();
 
     if (tshark_elapsed.elapsed_first_pass == 0) {
         // Should not happen
@@ -327,6 +343,30 @@ print_elapsed_json(const char *cf_name, const char *dfilter)
                         tshark_elapsed.elapsed_second_pass);
     DUMP("dfilter_expand", tshark_elapsed.dfilter_expand);
     DUMP("dfilter_compile", tshark_elapsed.dfilter_compile);
+    json_dumper_set_member_name(&dumper, "startup");
+    json_dumper_begin_object(&dumper);
+    DUMP("epan_init", startup->init);
+    DUMP("addr_resolv", startup->addr_resolv);
+    json_dumper_set_member_name(&dumper, "addr_resolv_tables");
+    json_dumper_begin_object(&dumper);
+    DUMP("services", addr_resolv_times->services);
+    DUMP("ethers", addr_resolv_times->ethers);
+    DUMP("ipxnets", addr_resolv_times->ipxnets);
+    DUMP("vlans", addr_resolv_times->vlans);
+    DUMP("enterprises", addr_resolv_times->enterprises);
+    DUMP("hosts", addr_resolv_times->hosts);
+    DUMP("tacs", addr_resolv_times->tacs);
+    json_dumper_end_object(&dumper);
+    DUMP("plugins", startup->plugins);
+    DUMP("register_protocols", startup->register_protocols);
+    DUMP("dfilter", startup->dfilter);
+    DUMP("lua", startup->lua);
+    DUMP("uats", startup->uats);
+    DUMP("load_settings", startup->load_settings);
+    DUMP("decode_as", startup->decode_as);
+    DUMP("prefs", startup->prefs);
+    DUMP("enabled_protos", startup->enabled_protos);
+    json_dumper_end_object(&dumper);
     json_dumper_begin_array(&dumper);
     json_dumper_begin_object(&dumper);
     DUMP("elapsed", tshark_elapsed.elapsed_first_pass);
@@ -511,6 +551,8 @@ print_usage(FILE *output)
     fprintf(output, "                           Example: tcp.port==8888,http\n");
     fprintf(output, "  -H <hosts file>          read a list of entries from a hosts file, which will\n");
     fprintf(output, "                           then be written to a capture file. (Implies -W n)\n");
+    fprintf(output, "  --dns-cache <file>       reuse and update reverse DNS lookup results kept\n");
+    fprintf(output, "                           in this file\n");
     fprintf(output, "  --enable-protocol <proto_name>\n");
     fprintf(output, "                           enable dissection of proto_name\n");
     fprintf(output, "  --disable-protocol <proto_name>\n");
@@ -596,11 +638,21 @@ print_usage(FILE *output)
     fprintf(output, "                           values\n");
     fprintf(output, "  --json-compact           If -T json is specified, output compact one-line JSON\n");
     fprintf(output, "                           without indentation (significantly faster)\n");
+    fprintf(output, "  --prune-dissection       If -T fields is specified, don't dissect protocols\n");
+    fprintf(output, "                           that can't produce any of the requested fields\n");
+    fprintf(output, "  --prefilter-frames       skip frames that the display filter's conditions on\n");
+    fprintf(output, "                           frame.number, frame.time and frame.len rule out,\n");
+    fprintf(output, "                           without dissecting them\n");
+    fprintf(output, "  --heuristic-stats        when finished, print to stderr how often each heuristic\n");
+    fprintf(output, "                           dissector was tried, how often it matched and the\n");
+    fprintf(output, "                           time spent in it\n");
     fprintf(output, "  --elastic-mapping-filter <protocols> If -G elastic-mapping is specified, put only the\n");
     fprintf(output, "                           specified protocols within the mapping file\n");
     fprintf(output, "  --temp-dir <directory>   write temporary files to this directory\n");
     fprintf(output, "                           (default: %s)\n", g_get_tmp_dir());
     fprintf(output, "  --compress <type>        compress the output file using the type compression format\n");
+    fprintf(output, "  --zygote <socket>        start up once, then listen on this Unix domain socket\n");
+    fprintf(output, "                           and fork a process for each job sent to it\n");
     fprintf(output, "\n");
 
     ws_log_print_usage(output);
@@ -995,6 +1047,44 @@ dump_glossary(const char* glossary, const char* elastic_mapping_filter)
     return exit_status;
 }
 
+/*
+ * Handle the options that say what to read and what to print, which
+ * the first pass over the command line has to see; used for our own
+ * command line and for that of a zygote job.
+ */
+static void
+process_early_output_option(int opt, const char *arg, char *volatile *cf_namep,
+        char **output_onlyp)
+{
+    switch (opt) {
+        case 'P':        /* Print packet summary info even when writing to a file */
+            print_packet_info = true;
+            print_summary = true;
+            break;
+        case 'r':        /* Read capture file x */
+            g_free(*cf_namep);
+            *cf_namep = g_strdup(arg);
+            break;
+        case 'O':        /* Only output these protocols */
+            g_free(*output_onlyp);
+            *output_onlyp = g_strdup(arg);
+            /* FALLTHROUGH */
+        case 'V':        /* Verbose */
+            print_details = true;
+            print_packet_info = true;
+            break;
+        case 'x':        /* Print packet data in hex (and ASCII) */
+            print_hex = true;
+            /*  The user asked for hex output, so let's ensure they get it,
+             *  even if they're writing to a file.
+             */
+            print_packet_info = true;
+            break;
+        default:
+            break;
+    }
+}
+
 static bool
 must_do_dissection(dfilter_t *rfcode, dfilter_t *dfcode,
         char *volatile pdu_export_arg)
@@ -1087,6 +1177,11 @@ main(int argc, char *argv[])
         {"global-profile", ws_no_argument, NULL, LONGOPT_GLOBAL_PROFILE},
         {"compress", ws_required_argument, NULL, LONGOPT_COMPRESS},
         {"json-compact", ws_no_argument, NULL, LONGOPT_JSON_COMPACT},
+        {"prune-dissection", ws_no_argument, NULL, LONGOPT_PRUNE_DISSECTION},
+        {"prefilter-frames", ws_no_argument, NULL, LONGOPT_PREFILTER_FRAMES},
+        {"heuristic-stats", ws_no_argument, NULL, LONGOPT_HEURISTIC_STATS},
+        {"dns-cache", ws_required_argument, NULL, LONGOPT_DNS_CACHE},
+        {"zygote", ws_required_argument, NULL, LONGOPT_ZYGOTE},
         {0, 0, 0, 0}
     };
     bool                 arg_error = false;
@@ -1125,6 +1220,7 @@ main(int argc, char *argv[])
     exp_pdu_t             exp_pdu_tap_data;
     const char*           glossary = NULL;
     const char*           elastic_mapping_filter = NULL;
+    const char*           zygote_path = NULL;
     ws_compression_type   volatile compression_type = WS_FILE_UNKNOWN_COMPRESSION;
     const struct file_extension_info* file_extensions;
     unsigned num_extensions;
@@ -1286,27 +1382,9 @@ main(int argc, char *argv[])
                     has_extcap_options = true;
                 }
                 break;
-            case 'P':        /* Print packet summary info even when writing to a file */
-                print_packet_info = true;
-                print_summary = true;
-                break;
             case 'r':        /* Read capture file x */
-                cf_name = g_strdup(ws_optarg);
                 is_capturing = false;
-                break;
-            case 'O':        /* Only output these protocols */
-                output_only = g_strdup(ws_optarg);
-                /* FALLTHROUGH */
-            case 'V':        /* Verbose */
-                print_details = true;
-                print_packet_info = true;
-                break;
-            case 'x':        /* Print packet data in hex (and ASCII) */
-                print_hex = true;
-                /*  The user asked for hex output, so let's ensure they get it,
-                 *  even if they're writing to a file.
-                 */
-                print_packet_info = true;
+                process_early_output_option(opt, ws_optarg, &cf_name, &output_only);
                 break;
             case 'X':
                 ex_opt_add(ws_optarg);
@@ -1315,7 +1393,12 @@ main(int argc, char *argv[])
             case 'v':
                 is_capturing = false;
                 break;
+            case LONGOPT_ZYGOTE:
+                zygote_path = ws_optarg;
+                is_capturing = false;
+                break;
             default:
+                process_early_output_option(opt, ws_optarg, &cf_name, &output_only);
                 break;
         }
     }
@@ -1408,6 +1491,68 @@ main(int argc, char *argv[])
     prefs_p = epan_load_settings();
     prefs_loaded = true;
 
+    if (zygote_path != NULL) {
+        /*
+         * Everything up to here is the same for every job, so do it once,
+         * then fork a process for each job that carries on from here with
+         * the job's command line instead of ours.
+         */
+        ws_optreset = 1;
+        ws_optind = 1;
+        while ((opt = ws_getopt_long(argc, argv, optstring, long_options, NULL)) != -1) {
+            switch (opt) {
+                case 'C':
+                case LONGOPT_GLOBAL_PROFILE:
+                case 'X':
+                case LONGOPT_ZYGOTE:
+                    break;
+                default:
+                    /* wslog arguments are okay */
+                    if (ws_log_is_wslog_arg(opt))
+                        break;
+                    cmdarg_err("Only -C, --global-profile, -X and the log options can be used with --zygote;"
+                            " give the other options with each job.");
+                    exit_status = WS_EXIT_INVALID_OPTION;
+                    goto clean_exit;
+            }
+        }
+
+        if (!zygote_serve(zygote_path, &argc, &argv)) {
+            exit_status = WS_EXIT_INIT_FAILED;
+            goto clean_exit;
+        }
+
+        /*
+         * We're a job. Do what the log initialization and the first pass
+         * over the options do for a normal run.
+         */
+        ws_log_parse_args(&argc, argv, optstring, long_options, vcmdarg_err, WS_EXIT_INVALID_OPTION);
+        ws_optreset = 1;
+        ws_optind = 1;
+        while ((opt = ws_getopt_long(argc, argv, optstring, long_options, NULL)) != -1) {
+            switch (opt) {
+                case 'C':
+                case LONGOPT_GLOBAL_PROFILE:
+                case 'G':
+                case 'X':
+                case 'h':
+                case 'v':
+                case LONGOPT_ZYGOTE:
+                    cmdarg_err("-C, --global-profile, -G, -X, -h, -v and --zygote can't be used in a zygote job.");
+                    exit_status = WS_EXIT_INVALID_OPTION;
+                    goto clean_exit;
+                default:
+                    process_early_output_option(opt, ws_optarg, &cf_name, &output_only);
+                    break;
+            }
+        }
+        if (cf_name == NULL) {
+            cmdarg_err("A zygote job must read a capture file with -r.");
+            exit_status = WS_EXIT_INVALID_OPTION;
+            goto clean_exit;
+        }
+    }
+
     cap_file_init(&cfile);
 
     /* Print format defaults to this. */
@@ -1499,6 +1644,7 @@ main(int argc, char *argv[])
                 break;
             case 'C':
             case LONGOPT_GLOBAL_PROFILE:
+            case LONGOPT_ZYGOTE:
                 /* already processed; just ignore it now */
                 break;
             case 'D':        /* Print a list of capture devices and exit */
@@ -1955,6 +2101,21 @@ main(int argc, char *argv[])
             case LONGOPT_JSON_COMPACT:
                 json_compact = true;
                 break;
+            case LONGOPT_PRUNE_DISSECTION:
+                prune_dissection = true;
+                break;
+            case LONGOPT_PREFILTER_FRAMES:
+                prefilter_frames = true;
+                break;
+            case LONGOPT_HEURISTIC_STATS:
+                heuristic_stats = true;
+                heur_dissector_set_timing(true);
+                break;
+            case LONGOPT_DNS_CACHE:
+                g_free(dns_cache_file);
+                dns_cache_file = g_strdup(ws_optarg);
+                set_dns_cache_file(dns_cache_file);
+                break;
             case '?':        /* Bad flag - print usage message */
             default:
                 /* wslog arguments are okay */
@@ -2010,6 +2171,18 @@ main(int argc, char *argv[])
         goto clean_exit;
     }
 
+    if (prune_dissection && output_action != WRITE_FIELDS) {
+        cmdarg_err("--prune-dissection can only be used with \"-T fields\"");
+        exit_status = WS_EXIT_INVALID_OPTION;
+        goto clean_exit;
+    }
+
+    if (prefilter_frames && perform_two_pass_analysis) {
+        cmdarg_err("--prefilter-frames can't be used with -2");
+        exit_status = WS_EXIT_INVALID_OPTION;
+        goto clean_exit;
+    }
+
     /* If we specified output fields, but not the output field type... */
     /* XXX: If we specified both output fields with -e *and* protocol filters
      * with -j/-J, only the former are used. Should we warn or abort?
@@ -2210,15 +2383,9 @@ main(int argc, char *argv[])
              * Capture options don't apply here.
              */
 
-            /* We don't support capture filters when reading from a capture file
-               (the BPF compiler doesn't support all link-layer types that we
-               support in capture files we read). */
-            if (global_capture_opts.default_options.cfilter) {
-                cmdarg_err("Only read filters, not capture filters, "
-                        "can be specified when reading a capture file.");
-                exit_status = WS_EXIT_INVALID_OPTION;
-                goto clean_exit;
-            }
+            /* A capture filter is applied to the packets as they're read,
+               before they're dissected; packets of link-layer types that
+               the BPF compiler doesn't support don't pass it. */
             if (global_capture_opts.multi_files_on) {
                 cmdarg_err("Multiple capture files requested, but "
                         "a capture isn't being done.");
@@ -2613,6 +2780,29 @@ main(int argc, char *argv[])
             goto clean_exit;
         }
 
+#ifdef HAVE_LIBPCAP
+        if (global_capture_opts.default_options.cfilter) {
+            char *err_msg = NULL;
+            int file_encap = wtap_file_encap(cfile.provider.wth);
+
+            /* Compile the capture filter now for the file's link-layer
+               type, if it has just one, so that errors are reported
+               before any packets are read. */
+            read_cfilter = capture_file_filter_new(global_capture_opts.default_options.cfilter,
+                    global_capture_opts.default_options.optimize != 0, &err_msg);
+            if (read_cfilter != NULL && file_encap != WTAP_ENCAP_PER_PACKET &&
+                    file_encap != WTAP_ENCAP_UNKNOWN) {
+                capture_file_filter_compile(read_cfilter, file_encap, &err_msg);
+            }
+            if (err_msg != NULL) {
+                cmdarg_err("%s", err_msg);
+                g_free(err_msg);
+                exit_status = WS_EXIT_INVALID_FILTER;
+                goto clean_exit;
+            }
+        }
+#endif
+
         /* Start statistics taps; we do so after successfully opening the
            capture file, so we know we have something to compute stats
            on, and after registering all dissectors, so that MATE will
@@ -2950,6 +3140,14 @@ main(int argc, char *argv[])
         }
     }
 
+    if (heuristic_stats) {
+        heur_dissector_dump_stats(stderr);
+    }
+
+    if (dns_cache_file && !write_dns_cache_file()) {
+        cmdarg_err("Can't write the DNS cache \"%s\": %s", dns_cache_file, g_strerror(errno));
+    }
+
     /* Memory cleanup */
     reset_tap_listeners();
     funnel_dump_all_text_windows();
@@ -2965,6 +3163,7 @@ clean_exit:
     g_free(cf_name);
     destroy_print_stream(print_stream);
     g_free(output_file_name);
+    g_free(dns_cache_file);
 #ifdef HAVE_LIBPCAP
     capture_opts_cleanup(&global_capture_opts);
     if (cached_if_list) {
@@ -2975,6 +3174,7 @@ clean_exit:
     wtap_cleanup();
     free_progdirs();
     dfilter_free(dfcode);
+    capture_file_filter_free(read_cfilter);
     g_free(dfilter);
     g_free(profile_name);
     return exit_status;
@@ -3503,6 +3703,11 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
     bool           passed;
     int64_t        elapsed_start;
 
+    /* Packets that don't pass the capture filter are dropped before
+       they're numbered, as if they weren't in the file. */
+    if (read_cfilter != NULL && !capture_file_filter_apply(read_cfilter, rec))
+        return false;
+
     /* The frame number of this packet is one more than the count of
        frames in this packet. */
     framenum = cf->count + 1;
@@ -3570,6 +3775,14 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
             passed = dfilter_apply_edt(cf->rfcode, edt);
             tshark_elapsed.first_pass.dfilter_read += g_get_monotonic_time() - elapsed_start;
         }
+
+        /* Queue lookups of this packet's addresses now, so that the whole
+         * capture's addresses are resolved concurrently during this pass,
+         * rather than one at a time as the second pass needs them. */
+        if (passed && gbl_resolv_flags.network_name) {
+            prefetch_hostname(&edt->pi.net_src);
+            prefetch_hostname(&edt->pi.net_dst);
+        }
     }
 
     if (passed) {
@@ -4092,7 +4305,21 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
 
     *err = 0;
     got_printing_error = false;
-    while (wtap_read(cf->provider.wth, &rec, err, err_info, &data_offset) &&
+    if (have_prefilter_range && !nstime_is_unset(&prefilter_range.time_min)) {
+        uint64_t skipped;
+
+        /* No frame before the display filter's start time can pass it,
+           so skip as many of them as the file's time index lets us;
+           they still count towards the frame numbers. */
+        if (wtap_seek_to_time(cf->provider.wth, &prefilter_range.time_min,
+                              &skipped, err, err_info)) {
+            ws_debug("tshark: skipped %" PRIu64 " frames before the display filter's start time", skipped);
+            cf->count += (uint32_t)skipped;
+            framenum += (int)skipped;
+        }
+    }
+    while (*err == 0 &&
+           wtap_read(cf->provider.wth, &rec, err, err_info, &data_offset) &&
            !got_printing_error) {
         if (read_interrupted) {
             status = PASS_INTERRUPTED;
@@ -4163,6 +4390,12 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
             *err = 0; /* This is not a read error */
             break;
         }
+        if (have_prefilter_range && cf->count >= prefilter_range.number_max) {
+            ws_info("No frame after #%u can pass the display filter; stopping",
+                    prefilter_range.number_max);
+            *err = 0; /* This is not a read error */
+            break;
+        }
         /* Stop reading if we got an error processing the packet. */
         if (got_printing_error) {
             *err = 0; /* This is not a read error */
@@ -4200,6 +4433,38 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
     return status;
 }
 
+/*
+ * With --prune-dissection, restrict dissection to the protocols that can
+ * produce the fields we print or the fields the read and display filters
+ * test. Anything that needs the complete dissection (the protocol tree,
+ * columns, taps, coloring) turns it off again.
+ */
+static void
+setup_dissection_pruning(capture_file *cf)
+{
+    epan_dissect_t *edt;
+
+    if (print_details || print_hex || dissect_color ||
+            output_fields_has_cols(output_fields) ||
+            dfilter_requires_columns(cf->rfcode) ||
+            dfilter_requires_columns(cf->dfcode) ||
+            tap_listeners_require_dissection()) {
+        ws_message("Ignoring option --prune-dissection because full dissection is required");
+        return;
+    }
+
+    edt = epan_dissect_new(cf->epan, true, false);
+    if (cf->rfcode)
+        epan_dissect_prime_with_dfilter(edt, cf->rfcode);
+    if (cf->dfcode)
+        epan_dissect_prime_with_dfilter(edt, cf->dfcode);
+    output_fields_prime_edt(edt, output_fields);
+    if (!epan_dissect_prune_to_primed_fields(edt)) {
+        ws_message("Ignoring option --prune-dissection because the requested fields can come from any protocol");
+    }
+    epan_dissect_free(edt);
+}
+
 static process_file_status_t
 process_cap_file(capture_file *cf, char *save_file, int out_file_type,
         bool out_file_name_res, int max_packet_count, int64_t max_byte_count,
@@ -4294,6 +4559,14 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
         sigaction(SIGHUP, &action, NULL);
 #endif /* _WIN32 */
 
+    if (prune_dissection && do_dissection) {
+        setup_dissection_pruning(cf);
+    }
+
+    if (prefilter_frames && do_dissection) {
+        have_prefilter_range = dfilter_get_frame_range(cf->dfcode, &prefilter_range);
+    }
+
     if (perform_two_pass_analysis) {
         ws_debug("tshark: perform_two_pass_analysis, do_dissection=%s", do_dissection ? "TRUE" : "FALSE");
 
@@ -4318,6 +4591,10 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
              * we report any second-pass errors), so all the errors show up
              * at the end.
              */
+            if (heuristic_stats) {
+                /* Report what the pass the output comes from did. */
+                heur_dissector_reset_stats();
+            }
             elapsed_start = g_get_monotonic_time();
             second_pass_status = process_cap_file_second_pass(cf, pdh, &err, &err_info,
                     &err_framenum,
@@ -4507,6 +4784,11 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, int64_t offset
     wtap_block_t    block = NULL;
     int64_t         elapsed_start;
 
+    /* Packets that don't pass the capture filter are dropped before
+       they're numbered, as if they weren't in the file. */
+    if (read_cfilter != NULL && !capture_file_filter_apply(read_cfilter, rec))
+        return PROCESS_PACKET_DIDNT_PASS;
+
     /* Count this packet. */
     cf->count++;
 
@@ -4517,6 +4799,16 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, int64_t offset
 
     frame_data_init(&fdata, cf->count, rec, offset, cum_bytes);
 
+    /* With --prefilter-frames, don't dissect frames that the display
+       filter can't match. */
+    if (have_prefilter_range &&
+            !dfilter_frame_range_contains(&prefilter_range, fdata.num,
+                fdata.has_ts ? &fdata.abs_ts : NULL, fdata.pkt_len)) {
+        prev_cap_frame = fdata;
+        cf->provider.prev_cap = &prev_cap_frame;
+        return PROCESS_PACKET_DIDNT_PASS;
+    }
+
     /* If we're going to print packet information, or we're going to
        run a read filter, or we're going to process taps, set up to
        do a dissection and do so.  (This is the one and only pass
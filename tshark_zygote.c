@@ -0,0 +1,305 @@
+/* tshark_zygote.c
+ * Fork-per-job server mode for TShark
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#define WS_LOG_DOMAIN LOG_DOMAIN_MAIN
+
+#include <glib.h>
+
+#include <stdio.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ws_attributes.h>
+#include <ws_exit_codes.h>
+#include <wsutil/socket.h>
+#include <wsutil/wsjson.h>
+#include <wsutil/wslog.h>
+#include <wsutil/cmdarg_err.h>
+
+#if defined(HAVE_AF_UNIX) && !defined(_WIN32)
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+# define ZYGOTE_SUPPORT
+#endif
+
+#include "tshark_zygote.h"
+
+/* The longest job line we accept, including the newline. */
+#define ZYGOTE_MAX_JOB_LEN  (64 * 1024)
+
+#ifdef ZYGOTE_SUPPORT
+
+static bool abstract_socket;
+
+static int
+zygote_socket_init(const char *path)
+{
+    struct sockaddr_un s_un;
+    socklen_t s_un_len;
+    mode_t old_mask;
+    char *err_msg;
+    int fd, bind_ret, bind_errno;
+
+    err_msg = ws_init_sockets();
+    if (err_msg != NULL) {
+        cmdarg_err("%s", err_msg);
+        g_free(err_msg);
+        return -1;
+    }
+
+    if (strlen(path) + 1 > sizeof(s_un.sun_path)) {
+        cmdarg_err("Zygote socket path \"%s\" is too long.", path);
+        return -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        cmdarg_err("Failed to create zygote socket: %s", g_strerror(errno));
+        return -1;
+    }
+
+    memset(&s_un, 0, sizeof(s_un));
+    s_un.sun_family = AF_UNIX;
+    (void) g_strlcpy(s_un.sun_path, path, sizeof(s_un.sun_path));
+
+    s_un_len = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + strlen(s_un.sun_path));
+
+    if (s_un.sun_path[0] == '@') {
+        // Linux-only, but just let bind fail on other OSes.
+        s_un.sun_path[0] = '\0';
+        abstract_socket = true;
+    }
+
+    /*
+     * A job runs with our privileges and can read and write any file we
+     * can, so only our user may connect. Abstract sockets have no
+     * permissions, and the peer's credentials are checked instead.
+     */
+    old_mask = umask(S_IRWXG | S_IRWXO | S_IXUSR);
+    bind_ret = bind(fd, (struct sockaddr *) &s_un, s_un_len);
+    bind_errno = errno;
+    umask(old_mask);
+    if (bind_ret) {
+        cmdarg_err("Failed to bind zygote socket \"%s\": %s", path, g_strerror(bind_errno));
+        close(fd);
+        return -1;
+    }
+
+    if (listen(fd, SOMAXCONN)) {
+        cmdarg_err("Failed to listen on zygote socket \"%s\": %s", path, g_strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/* Reap finished jobs as they exit, so that they don't linger as zombies
+ * while no new connection comes in. */
+static void
+zygote_reap_jobs(int sig _U_)
+{
+    int saved_errno = errno;
+
+    while (waitpid(-1, NULL, WNOHANG) > 0)
+        ;
+    errno = saved_errno;
+}
+
+/*
+ * Read the job line a byte at a time, so that anything after it is left
+ * for the job to read from standard input.
+ */
+static char *
+zygote_read_job(int fd)
+{
+    GString *line = g_string_new(NULL);
+    char c;
+    ssize_t n;
+
+    while ((n = read(fd, &c, 1)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            cmdarg_err("Failed to read the job: %s", g_strerror(errno));
+            g_string_free(line, TRUE);
+            return NULL;
+        }
+        if (c == '\n') {
+            break;
+        }
+        if (line->len + 1 >= ZYGOTE_MAX_JOB_LEN) {
+            cmdarg_err("The job is longer than %u bytes.", ZYGOTE_MAX_JOB_LEN);
+            g_string_free(line, TRUE);
+            return NULL;
+        }
+        g_string_append_c(line, c);
+    }
+    return g_string_free(line, FALSE);
+}
+
+/* Turn a JSON array of strings into an argument vector after argv0. */
+static bool
+zygote_parse_job(char *job, const char *argv0, int *argcp, char ***argvp)
+{
+    jsmntok_t *tokens;
+    int num_tokens;
+    char **argv;
+
+    if (!json_validate((const uint8_t *)job, strlen(job))) {
+        cmdarg_err("The job isn't valid JSON.");
+        return false;
+    }
+
+    num_tokens = json_parse(job, NULL, 0);
+    if (num_tokens <= 0) {
+        cmdarg_err("The job isn't valid JSON.");
+        return false;
+    }
+    tokens = g_new(jsmntok_t, num_tokens);
+    json_parse(job, tokens, num_tokens);
+
+    /* An array of strings has no tokens but its elements. */
+    if (tokens[0].type != JSMN_ARRAY || tokens[0].size != num_tokens - 1) {
+        cmdarg_err("The job must be a JSON array of strings.");
+        g_free(tokens);
+        return false;
+    }
+
+    argv = g_new0(char *, num_tokens + 1);
+    argv[0] = g_strdup(argv0);
+    for (int i = 1; i < num_tokens; i++) {
+        if (tokens[i].type != JSMN_STRING) {
+            cmdarg_err("The job must be a JSON array of strings.");
+            g_strfreev(argv);
+            g_free(tokens);
+            return false;
+        }
+        job[tokens[i].end] = '\0';
+        if (!json_decode_string_inplace(&job[tokens[i].start])) {
+            cmdarg_err("Argument %d of the job isn't a valid string.", i);
+            g_strfreev(argv);
+            g_free(tokens);
+            return false;
+        }
+        argv[i] = g_strdup(&job[tokens[i].start]);
+    }
+    g_free(tokens);
+
+    *argcp = num_tokens;
+    *argvp = argv;
+    return true;
+}
+
+/* Runs in the child: read the job and connect it to the client. */
+static bool
+zygote_start_job(int fd, int *argcp, char ***argvp)
+{
+    char *job;
+    bool ok;
+
+    /* Errors about the job go to the client. */
+    dup2(fd, 0);
+    dup2(fd, 1);
+    dup2(fd, 2);
+    close(fd);
+
+    job = zygote_read_job(0);
+    if (job == NULL) {
+        return false;
+    }
+    ok = zygote_parse_job(job, (*argvp)[0], argcp, argvp);
+    g_free(job);
+    return ok;
+}
+
+bool
+zygote_serve(const char *path, int *argcp, char ***argvp)
+{
+    struct sigaction action, old_action;
+    int server_fd;
+
+    server_fd = zygote_socket_init(path);
+    if (server_fd == -1) {
+        return false;
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = zygote_reap_jobs;
+    action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, &old_action);
+    ws_message("TShark zygote listening on %s", path);
+
+    while (1) {
+        pid_t pid;
+        int fd;
+
+        fd = accept(server_fd, NULL, NULL);
+        if (fd == -1) {
+            if (errno != EINTR) {
+                ws_warning("Failed to accept a zygote connection: %s", g_strerror(errno));
+            }
+            continue;
+        }
+
+        if (abstract_socket && !ws_verify_peercred(fd)) {
+            ws_warning("Unauthorized zygote connection. Terminating connection.");
+            close(fd);
+            continue;
+        }
+
+        pid = fork();
+        if (pid == 0) {
+            /* The job waits for its own children, e.g. dumpcap. */
+            sigaction(SIGCHLD, &old_action, NULL);
+            close(server_fd);
+            if (!zygote_start_job(fd, argcp, argvp)) {
+                exit(WS_EXIT_INVALID_OPTION);
+            }
+            return true;
+        }
+        if (pid == -1) {
+            ws_warning("Failed to fork a zygote job: %s", g_strerror(errno));
+        }
+        close(fd);
+    }
+}
+
+#else /* ZYGOTE_SUPPORT */
+
+bool
+zygote_serve(const char *path _U_, int *argcp _U_, char ***argvp _U_)
+{
+    cmdarg_err("Zygote mode isn't supported on this platform.");
+    return false;
+}
+
+#endif /* ZYGOTE_SUPPORT */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
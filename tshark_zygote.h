@@ -0,0 +1,55 @@
+/** @file
+ *
+ * Fork-per-job server mode for TShark
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __TSHARK_ZYGOTE_H__
+#define __TSHARK_ZYGOTE_H__
+
+#include <stdbool.h>
+
+/**
+ * @brief Serve jobs on a Unix domain socket, forking a process for each.
+ *
+ * Each client sends one line holding a JSON array of strings, the
+ * command-line arguments for the job, without the program name. The
+ * server forks, and the child reads the job and returns from this
+ * function with *argcp and *argvp set to the job's command line, and its
+ * standard input, output and error connected to the client. Anything
+ * the client sends after the job line can be read from standard input,
+ * e.g. with "-r -". The connection is closed when the job exits.
+ *
+ * The parent process never returns, unless setting up the socket fails.
+ * A child that can't read its job reports the error to the client and
+ * exits.
+ *
+ * @param path The path of the socket, or, on Linux, "@" followed by the
+ * name of an abstract socket.
+ * @param[in,out] argcp The argument count; replaced in the child.
+ * @param[in,out] argvp The argument vector; replaced in the child. The
+ * program name is kept.
+ * @return true in a child process that should run the job, false if the
+ * server couldn't be started.
+ */
+bool zygote_serve(const char *path, int *argcp, char ***argvp);
+
+#endif /* __TSHARK_ZYGOTE_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -52,6 +52,11 @@ InterfaceListManager::InterfaceListManager(QObject *parent) :
     // live in MainApplication::setConfigurationProfile.
     connect(mainApp, &MainApplication::preferencesChanged,
             this, &InterfaceListManager::onPreferencesChanged);
+
+    // The statistics process keeps the capabilities of each interface; show
+    // its latest ones without waiting for a rescan.
+    connect(interface_stats_, &InterfaceStatistics::interfaceListUpdated,
+            this, &InterfaceListManager::refreshCapabilities);
 }
 
 void InterfaceListManager::onPreferencesChanged()
@@ -644,6 +649,62 @@ update_local_interfaces(capture_options* capture_opts)
         fill_from_ifaces(capture_opts, device);
     }
 }
+
+/*
+ * Bring the link-layer types and monitor mode support of the existing local
+ * interfaces up to date with the capabilities the interface statistics
+ * process last sent. No dumpcap enumeration. Interfaces in monitor mode are
+ * left alone, as those capabilities are for when not in monitor mode.
+ * Returns true if any interface was updated.
+ */
+static bool
+update_local_interface_capabilities(capture_options* capture_opts)
+{
+    interface_t *device;
+    if_capabilities_t *caps;
+    data_link_info_t *data_link_info;
+    link_row *link;
+    bool updated = false;
+
+    for (unsigned i = 0; i < capture_opts->all_ifaces->len; i++) {
+        device = &g_array_index(capture_opts->all_ifaces, interface_t, i);
+        if (!device->local || device->monitor_mode_enabled)
+            continue;
+        caps = capture_get_service_if_capabilities(device->name);
+        if (caps == NULL)
+            continue;
+
+        g_list_free_full(device->links, capture_opts_free_link_row);
+        device->links = NULL;
+        bool found_active_dlt = false;
+        for (GList *lt_entry = caps->data_link_types; lt_entry != NULL; lt_entry = g_list_next(lt_entry)) {
+            data_link_info = (data_link_info_t *)lt_entry->data;
+            link = g_new(link_row, 1);
+            if (data_link_info->description != NULL) {
+                link->dlt = data_link_info->dlt;
+                link->name = g_strdup(data_link_info->description);
+            } else {
+                link->dlt = -1;
+                link->name = ws_strdup_printf("%s (not supported)", data_link_info->name);
+            }
+            if (link->dlt != -1 && link->dlt == device->active_dlt) {
+                found_active_dlt = true;
+            }
+            device->links = g_list_append(device->links, link);
+        }
+        if (!found_active_dlt) {
+            set_active_dlt(device, capture_opts->default_options.linktype);
+        }
+        device->monitor_mode_supported = caps->can_set_rfmon;
+
+        if (device->if_info.caps != NULL) {
+            free_if_capabilities(device->if_info.caps);
+        }
+        device->if_info.caps = caps;
+        updated = true;
+    }
+    return updated;
+}
 #endif // HAVE_LIBPCAP
 
 void InterfaceListManager::requestRefresh(bool userInitiated)
@@ -667,6 +728,20 @@ void InterfaceListManager::notifyListChanged()
     emit interfaceListChanged();
 }
 
+void InterfaceListManager::refreshCapabilities()
+{
+    // A pending or running scan picks the new capabilities up anyway, and
+    // all_ifaces isn't touched while a capture is using it.
+    if (scanning_ || refreshPending_ || captureActive_)
+        return;
+
+#ifdef HAVE_LIBPCAP
+    if (global_capture_opts.all_ifaces != nullptr &&
+            update_local_interface_capabilities(&global_capture_opts))
+        emit interfaceListChanged();
+#endif
+}
+
 void InterfaceListManager::setCaptureActive(bool active)
 {
     if (captureActive_ == active)
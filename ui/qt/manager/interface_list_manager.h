@@ -179,6 +179,13 @@ private slots:
      */
     void onPreferencesChanged();
 
+    /**
+     * @brief Updates the link-layer types and monitor mode support of the
+     *        existing interfaces from the statistics process's latest
+     *        interface list, without re-enumerating.
+     */
+    void refreshCapabilities();
+
 private:
     /** @brief Posts a single performScan() if one is warranted and not pending. */
     void maybeSchedule();
@@ -67,6 +67,7 @@ InterfaceStatistics::InterfaceStatistics(QObject *parent) :
     // Worker -> facade.
     connect(worker_, &InterfaceStatsWorker::sampled, this, &InterfaceStatistics::onSampled);
     connect(worker_, &InterfaceStatsWorker::failed, this, &InterfaceStatistics::onWorkerFailed);
+    connect(worker_, &InterfaceStatsWorker::interfaceListUpdated, this, &InterfaceStatistics::interfaceListUpdated);
 
     workerThread_.setObjectName(QStringLiteral("InterfaceStats"));
     workerThread_.start();
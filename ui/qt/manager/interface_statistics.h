@@ -186,6 +186,12 @@ signals:
      */
     void activityChanged();
 
+    /**
+     * @brief Emitted when the statistics process has sent a new interface
+     *        list, with the capabilities of each interface.
+     */
+    void interfaceListUpdated();
+
     /// @cond INTERNAL
     /* Bridge signals to the worker (queued across the thread boundary). */
     void startWorker();
@@ -161,6 +161,11 @@ void InterfaceStatsWorker::poll()
 #ifdef HAVE_LIBPCAP
     char line[kMaxStatLineLen];
 
+    // Pick up any interface list updates too, so dumpcap never blocks
+    // on a full sync pipe; capture_sync keeps the latest list.
+    if (sync_interface_service_drain())
+        emit interfaceListUpdated();
+
     // Drain every line dumpcap has buffered this cycle. Each call returns a
     // single NUL-terminated line (>0), 0 when nothing more is available, or
     // -1 if the pipe has broken.
@@ -199,12 +204,17 @@ bool InterfaceStatsWorker::openStream()
 {
 #ifdef HAVE_LIBPCAP
     char *msg = nullptr;
+    char *if_list = nullptr;
     int stat_fd = -1;
     ws_process_id fork_child = WS_INVALID_PID;
 
-    int ret = sync_interface_stats_open(&stat_fd, &fork_child,
-                                        nullptr /* no -D -L; stats only */,
+    // Asking for the interface list as well makes dumpcap keep it, and the
+    // interfaces' capabilities, up to date for as long as the stream runs,
+    // so rescans and capability lookups don't each have to run dumpcap.
+    // capture_sync keeps its own copy of the list.
+    int ret = sync_interface_stats_open(&stat_fd, &fork_child, &if_list,
                                         &msg, nullptr /* no GUI update callback */);
+    g_free(if_list);
     if (ret != 0) {
         QString err = (msg != nullptr)
                 ? QString::fromUtf8(msg)
@@ -171,6 +171,12 @@ signals:
      */
     void sampled(const InterfaceStatsSnapshot &snapshot);
 
+    /**
+     * @brief Emitted when dumpcap has sent a new interface list, with the
+     *        capabilities of each interface.
+     */
+    void interfaceListUpdated();
+
 private slots:
     /** @brief Timer-driven: drain the pipe and emit a snapshot if data arrived. */
     void poll();
@@ -17,6 +17,7 @@
 #include "pcap-common.h"
 #include "pcap-encap.h"
 #include "erf-common.h"
+#include "time_index.h"
 #include <wsutil/ws_assert.h>
 
 /*
@@ -716,6 +717,14 @@ wtap_open_return_val libpcap_open(wtap *wth, int *err, char **err_info)
 		 * and time stamp resolution.
 		 */
 		wtap_add_generated_idb(wth);
+
+		/*
+		 * Records are self-contained, so sequential reading
+		 * can skip ahead to any of them. (Not so for ERF,
+		 * where interfaces are found as the records are read.)
+		 */
+		if (!wth->ispipe)
+			wth->time_index = wtap_time_index_new();
 	}
 
 	return WTAP_OPEN_MINE;
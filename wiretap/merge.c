@@ -467,6 +467,9 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
         return NULL;
     }
 
+    /* Count this packet. */
+    in_files[i].packet_num++;
+
     /*
      * Return a pointer to the merge_in_file_t of the file from which the
      * packet was read.
@@ -1095,6 +1098,12 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
             break;
         }
 
+        if (cb && cb->record_filter &&
+            !cb->record_filter(in_file, cb->data)) {
+            wtap_rec_reset(&in_file->rec);
+            continue;
+        }
+
         if (wtap_file_type_subtype_supports_block(file_type,
                                                   WTAP_BLOCK_IF_ID_AND_INFO) != BLOCK_NOT_SUPPORTED) {
             if (!process_new_idbs(pdh, in_files, in_file_count, mode, idb_inf, err, err_info)) {
@@ -108,12 +108,15 @@ merge_idb_merge_mode_to_string(const int mode);
  * of the created merge info, in_file_count is the size of the array, data is
  * whatever was passed in the data member of this struct. The callback_func
  * routine's return value should be true if merging should be aborted.
+ * If record_filter isn't NULL, it's called with each record read, before
+ * it's written, and the records for which it returns false are left out.
  */
 typedef struct {
     bool (*callback_func)(merge_event event, int num,
                               const merge_in_file_t in_files[], const unsigned in_file_count,
                               void *data);
     void *data; /**< private data to use for passing through to the callback function */
+    bool (*record_filter)(const merge_in_file_t *in_file, void *data); /**< if not NULL, records it returns false for aren't written */
 } merge_progress_callback_t;
 
 
@@ -34,7 +34,7 @@ WS_DLL_PUBLIC int wtap_pcap_encap_to_wtap_encap(int encap);
  * @param encap The Wireshark encapsulation type.
  * @return int The corresponding PCAP encapsulation type, or -1 if not found.
  */
-int wtap_wtap_encap_to_pcap_encap(int encap);
+WS_DLL_PUBLIC int wtap_wtap_encap_to_pcap_encap(int encap);
 
 /**
  * @brief Checks if a given encapsulation type requires a pseudo-header.
@@ -41,6 +41,7 @@
 #include "pcapng_module.h"
 #include "secrets-types.h"
 #include "pcapng-darwin-custom.h"
+#include "time_index.h"
 
 #define NS_PER_S 1000000000U
 
@@ -3778,6 +3779,14 @@ pcapng_open(wtap *wth, int *err, char **err_info)
         ws_debug("Read IDB number_of_interfaces %u, wtap_encap %i",
                  wth->interface_data->len, wth->file_encap);
     }
+
+    /*
+     * Sequential reading can skip ahead to any record up to the next
+     * block we process internally; see pcapng_read().
+     */
+    if (!wth->ispipe)
+        wth->time_index = wtap_time_index_new();
+
     return WTAP_OPEN_MINE;
 }
 
@@ -3827,6 +3836,14 @@ pcapng_read(wtap *wth, wtap_rec *rec, int *err, char **err_info,
          * returning it for the caller to process.
          */
         pcapng_process_internal_block(wth, pcapng, current_section, new_section, &wblock, data_offset);
+
+        /*
+         * Skipping past this block would lose what it tells us (a new
+         * section, interface, name resolution, secrets, ...), so the
+         * time index can't have entries after it.
+         */
+        if (wth->time_index != NULL)
+            wtap_time_index_stop(wth->time_index);
     }
 
     /*ws_debug("Read length: %u Packet length: %u", bytes_read, rec->rec_header.packet_header.caplen);*/
@@ -0,0 +1,331 @@
+/* time_index.c
+ *
+ * Time stamp seek tables for capture files.
+ *
+ * Wiretap Library
+ * Copyright (c) 1998 by Gilbert Ramirez <gram@alumni.rice.edu>
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#define WS_LOG_DOMAIN LOG_DOMAIN_WIRETAP
+
+#include "time_index.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "wtap.h"
+
+#include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+#include <wsutil/wslog.h>
+
+/*
+ * Saved tables are little-endian:
+ *
+ *    magic "WSTI", version, number of entries, reserved (all 32 bits),
+ *    size of the capture file (64 bits),
+ *
+ * followed by the entries, each:
+ *
+ *    offset (64 bits), seconds (64 bits, signed), nanoseconds (32 bits,
+ *    signed), reserved (32 bits), number of records (64 bits)
+ *
+ * where the time is the latest time stamp of the records before the offset
+ * and the number is how many records there are before it; the first entry,
+ * at the first record, has an unset time.
+ */
+#define TIME_INDEX_MAGIC        "WSTI"
+#define TIME_INDEX_VERSION      1
+#define TIME_INDEX_HEADER_LEN   24
+#define TIME_INDEX_ENTRY_LEN    32
+
+/* Entries are at least this far apart in time... */
+#define TIME_INDEX_DEFAULT_INTERVAL_SECS    1
+
+/* ...and in the file, so that a busy capture doesn't get a huge table;
+   reading this much to get to a given time costs next to nothing. */
+#define TIME_INDEX_MIN_SPACING  (1024 * 1024)
+
+typedef struct {
+    int64_t  offset;
+    nstime_t max_ts;            /**< Latest time stamp before offset */
+    uint64_t records;           /**< Number of records before offset */
+} time_index_entry;
+
+struct wtap_time_index {
+    GArray   *entries;          /**< time_index_entry, by offset */
+    nstime_t  interval;
+    nstime_t  next_ts;          /**< Add no entry for records before this */
+    nstime_t  max_ts;           /**< Latest time stamp read so far */
+    uint64_t  records;          /**< Number of records read or skipped so far */
+    bool      building;         /**< Still adding entries */
+    bool      skipped;          /**< Sequential reading skipped ahead */
+    bool      load_tried;
+    bool      loaded;           /**< Entries came from a saved table */
+};
+
+wtap_time_index *
+wtap_time_index_new(void)
+{
+    wtap_time_index *ti = g_new0(wtap_time_index, 1);
+
+    ti->entries = g_array_new(false, false, sizeof(time_index_entry));
+    nstime_set_zero(&ti->interval);
+    ti->interval.secs = TIME_INDEX_DEFAULT_INTERVAL_SECS;
+    nstime_set_unset(&ti->max_ts);
+    ti->building = true;
+    return ti;
+}
+
+void
+wtap_time_index_set_interval(wtap_time_index *ti, const nstime_t *interval)
+{
+    ti->interval = *interval;
+}
+
+void
+wtap_time_index_add(wtap_time_index *ti, int64_t offset, const nstime_t *ts)
+{
+    if (ti->building) {
+        if (ti->entries->len == 0) {
+            time_index_entry entry = { offset, ti->max_ts, ti->records };
+
+            g_array_append_val(ti->entries, entry);
+            if (ts != NULL) {
+                nstime_sum(&ti->next_ts, ts, &ti->interval);
+            }
+        } else if (ts != NULL && nstime_cmp(ts, &ti->next_ts) >= 0) {
+            const time_index_entry *last = &g_array_index(ti->entries, time_index_entry,
+                                                          ti->entries->len - 1);
+
+            if (offset - last->offset >= TIME_INDEX_MIN_SPACING) {
+                time_index_entry entry = { offset, ti->max_ts, ti->records };
+
+                g_array_append_val(ti->entries, entry);
+                nstime_sum(&ti->next_ts, ts, &ti->interval);
+            }
+        }
+
+        if (ts != NULL &&
+            (nstime_is_unset(&ti->max_ts) || nstime_cmp(ts, &ti->max_ts) > 0)) {
+            ti->max_ts = *ts;
+        }
+    }
+    ti->records++;
+}
+
+void
+wtap_time_index_stop(wtap_time_index *ti)
+{
+    ti->building = false;
+}
+
+uint64_t
+wtap_time_index_skipped(wtap_time_index *ti, uint64_t records)
+{
+    uint64_t skipped = records > ti->records ? records - ti->records : 0;
+
+    ti->building = false;
+    ti->skipped = true;
+    ti->records = records;
+    return skipped;
+}
+
+bool
+wtap_time_index_lookup(const wtap_time_index *ti, const nstime_t *ts,
+                       int64_t *offset, uint64_t *records)
+{
+    unsigned lo = 0, hi = ti->entries->len;
+
+    if (hi == 0) {
+        return false;
+    }
+
+    /*
+     * The latest time stamps only ever go up, and the first one is unset,
+     * so find the last entry whose records before it are all earlier
+     * than ts; there's always at least the first one.
+     */
+    while (hi - lo > 1) {
+        unsigned mid = lo + (hi - lo) / 2;
+        const time_index_entry *entry = &g_array_index(ti->entries, time_index_entry, mid);
+
+        if (nstime_cmp(&entry->max_ts, ts) < 0) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    *offset = g_array_index(ti->entries, time_index_entry, lo).offset;
+    *records = g_array_index(ti->entries, time_index_entry, lo).records;
+    return true;
+}
+
+static char *
+time_index_filename(const char *capture_filename)
+{
+    return g_strconcat(capture_filename, WTAP_TIME_INDEX_EXTENSION, NULL);
+}
+
+void
+wtap_time_index_load(wtap_time_index *ti, const char *capture_filename)
+{
+    char       *filename;
+    ws_statb64  capture_statb, index_statb;
+    char       *contents = NULL;
+    size_t      length;
+    uint32_t    count;
+    GArray     *entries;
+    int64_t     prev_offset = -1;
+
+    if (ti->load_tried) {
+        return;
+    }
+    ti->load_tried = true;
+
+    if (capture_filename == NULL || strcmp(capture_filename, "-") == 0) {
+        return;
+    }
+    filename = time_index_filename(capture_filename);
+    if (ws_stat64(capture_filename, &capture_statb) != 0 ||
+        ws_stat64(filename, &index_statb) != 0 ||
+        index_statb.st_mtime < capture_statb.st_mtime ||
+        !g_file_get_contents(filename, &contents, &length, NULL)) {
+        /* No saved table, or the capture file has changed since. */
+        g_free(filename);
+        return;
+    }
+
+    if (length < TIME_INDEX_HEADER_LEN ||
+        memcmp(contents, TIME_INDEX_MAGIC, 4) != 0 ||
+        pletohu32(contents + 4) != TIME_INDEX_VERSION ||
+        pletohu64(contents + 16) != (uint64_t)capture_statb.st_size) {
+        ws_debug("%s isn't a time index for %s", filename, capture_filename);
+        g_free(contents);
+        g_free(filename);
+        return;
+    }
+    count = pletohu32(contents + 8);
+    if (count == 0 ||
+        (length - TIME_INDEX_HEADER_LEN) / TIME_INDEX_ENTRY_LEN < count) {
+        ws_debug("%s is truncated", filename);
+        g_free(contents);
+        g_free(filename);
+        return;
+    }
+
+    entries = g_array_sized_new(false, false, sizeof(time_index_entry), count);
+    for (uint32_t i = 0; i < count; i++) {
+        const char      *p = contents + TIME_INDEX_HEADER_LEN + (size_t)i * TIME_INDEX_ENTRY_LEN;
+        time_index_entry entry;
+
+        entry.offset = (int64_t)pletohu64(p);
+        entry.max_ts.secs = (time_t)(int64_t)pletohu64(p + 8);
+        entry.max_ts.nsecs = (int)pletohu32(p + 16);
+        entry.records = pletohu64(p + 24);
+        if (entry.offset <= prev_offset) {
+            ws_debug("%s has entries out of order", filename);
+            g_array_free(entries, true);
+            g_free(contents);
+            g_free(filename);
+            return;
+        }
+        prev_offset = entry.offset;
+        g_array_append_val(entries, entry);
+    }
+    g_free(contents);
+    g_free(filename);
+
+    g_array_free(ti->entries, true);
+    ti->entries = entries;
+    ti->building = false;
+    ti->loaded = true;
+}
+
+bool
+wtap_time_index_save(const wtap_time_index *ti, const char *capture_filename, int *err)
+{
+    char       *filename;
+    ws_statb64  statb;
+    FILE       *fh;
+    uint8_t     hdr[TIME_INDEX_HEADER_LEN];
+    uint8_t     rec[TIME_INDEX_ENTRY_LEN];
+    bool        ok = true;
+
+    *err = 0;
+    if (ti->entries->len == 0 || ti->skipped || ti->loaded ||
+        capture_filename == NULL || strcmp(capture_filename, "-") == 0) {
+        return false;
+    }
+    if (ws_stat64(capture_filename, &statb) != 0) {
+        *err = errno;
+        return false;
+    }
+
+    filename = time_index_filename(capture_filename);
+    fh = ws_fopen(filename, "wb");
+    if (fh == NULL) {
+        *err = errno;
+        g_free(filename);
+        return false;
+    }
+
+    memset(hdr, 0, sizeof hdr);
+    memcpy(hdr, TIME_INDEX_MAGIC, 4);
+    phtoleu32(hdr + 4, TIME_INDEX_VERSION);
+    phtoleu32(hdr + 8, ti->entries->len);
+    phtoleu64(hdr + 16, (uint64_t)statb.st_size);
+    if (fwrite(hdr, sizeof hdr, 1, fh) != 1) {
+        ok = false;
+    }
+    for (unsigned i = 0; ok && i < ti->entries->len; i++) {
+        const time_index_entry *entry = &g_array_index(ti->entries, time_index_entry, i);
+
+        memset(rec, 0, sizeof rec);
+        phtoleu64(rec, (uint64_t)entry->offset);
+        phtoleu64(rec + 8, (uint64_t)(int64_t)entry->max_ts.secs);
+        phtoleu32(rec + 16, (uint32_t)entry->max_ts.nsecs);
+        phtoleu64(rec + 24, entry->records);
+        if (fwrite(rec, sizeof rec, 1, fh) != 1) {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        *err = errno;
+        fclose(fh);
+    } else if (fclose(fh) == EOF) {
+        *err = errno;
+        ok = false;
+    }
+    if (!ok) {
+        ws_unlink(filename);
+    }
+    g_free(filename);
+    return ok;
+}
+
+void
+wtap_time_index_free(wtap_time_index *ti)
+{
+    if (ti == NULL) {
+        return;
+    }
+    g_array_free(ti->entries, true);
+    g_free(ti);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
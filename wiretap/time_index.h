@@ -0,0 +1,110 @@
+/** @file
+ *
+ * Time stamp seek tables for capture files.
+ *
+ * A seek table is a sparse list of places in a capture file at which
+ * sequential reading can start again, each with the latest time stamp of
+ * the records before it. It's built as the file is read sequentially,
+ * by file types whose readers can skip ahead without losing state, and
+ * can be saved next to the capture file so that later reads can go
+ * straight to a given time.
+ *
+ * Wiretap Library
+ * Copyright (c) 1998 by Gilbert Ramirez <gram@alumni.rice.edu>
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __TIME_INDEX_H__
+#define __TIME_INDEX_H__
+
+#include <wsutil/nstime.h>
+
+typedef struct wtap_time_index wtap_time_index;
+
+/**
+ * @brief Creates an empty seek table, to be filled in as the file is read.
+ * @return The new table.
+ */
+wtap_time_index *wtap_time_index_new(void);
+
+/**
+ * @brief Sets the minimum time between entries in a seek table.
+ *
+ * @param ti The table.
+ * @param interval The minimum time between entries.
+ */
+void wtap_time_index_set_interval(wtap_time_index *ti, const nstime_t *interval);
+
+/**
+ * @brief Notes a record read sequentially, adding an entry for it if
+ * it's far enough from the last one.
+ *
+ * @param ti The table.
+ * @param offset The offset of the record, as returned by wtap_read().
+ * @param ts The record's time stamp, or NULL if it doesn't have one.
+ */
+void wtap_time_index_add(wtap_time_index *ti, int64_t offset, const nstime_t *ts);
+
+/**
+ * @brief Stops adding entries to a seek table, because reading can't
+ * start again after this point without losing state; for example, a
+ * pcapng file has a new section or interface.
+ *
+ * @param ti The table.
+ */
+void wtap_time_index_stop(wtap_time_index *ti);
+
+/**
+ * @brief Notes that sequential reading skipped ahead; the table no longer
+ * describes the whole of the file read so far, so no more entries are
+ * added and it isn't written out.
+ *
+ * @param ti The table.
+ * @param records The number of records before the place skipped to, as
+ * returned by wtap_time_index_lookup().
+ * @return The number of records skipped.
+ */
+uint64_t wtap_time_index_skipped(wtap_time_index *ti, uint64_t records);
+
+/**
+ * @brief Finds the last place in the file before which all records have
+ * time stamps earlier than a given time.
+ *
+ * @param ti The table.
+ * @param ts The time.
+ * @param offset Set to the offset at which to start reading.
+ * @param records Set to the number of records before that offset.
+ * @return true if an entry was found, false if the table is empty.
+ */
+bool wtap_time_index_lookup(const wtap_time_index *ti, const nstime_t *ts,
+                            int64_t *offset, uint64_t *records);
+
+/**
+ * @brief Replaces the entries of a seek table with those saved for a
+ * capture file, if there's a saved table and it's no older than the file.
+ * Only tried once per table.
+ *
+ * @param ti The table.
+ * @param capture_filename The name of the capture file.
+ */
+void wtap_time_index_load(wtap_time_index *ti, const char *capture_filename);
+
+/**
+ * @brief Saves a seek table next to its capture file.
+ *
+ * @param ti The table.
+ * @param capture_filename The name of the capture file.
+ * @param err Set to an errno value on failure; 0 if the table is empty,
+ * incomplete, or was itself loaded from a file.
+ * @return true on success, false on failure.
+ */
+bool wtap_time_index_save(const wtap_time_index *ti, const char *capture_filename, int *err);
+
+/**
+ * @brief Frees a seek table.
+ * @param ti The table.
+ */
+void wtap_time_index_free(wtap_time_index *ti);
+
+#endif /* __TIME_INDEX_H__ */
@@ -19,6 +19,7 @@
 #include "wtap_opttypes.h"
 #include "file_wrappers.h"
 #include "wtap_module.h"
+#include "time_index.h"
 
 #include <wsutil/array.h>
 #include <wsutil/file_util.h>
@@ -27,6 +28,7 @@
 #include <wsutil/exported_pdu_tlvs.h>
 #include <wsutil/pint.h>
 #include <wsutil/please_report_bug.h>
+#include <wsutil/wslog.h>
 #ifdef HAVE_PLUGINS
 #include <wsutil/plugins.h>
 #endif
@@ -1631,6 +1633,8 @@ wtap_close(wtap *wth)
 
 	g_free(wth->pathname);
 
+	wtap_time_index_free(wth->time_index);
+
 	if (wth->fast_seek != NULL) {
 		g_ptr_array_foreach(wth->fast_seek, g_fast_seek_item_free, NULL);
 		g_ptr_array_free(wth->fast_seek, true);
@@ -1949,9 +1953,59 @@ wtap_read(wtap *wth, wtap_rec *rec, int *err, char **err_info, int64_t *offset)
 		ws_buffer_assure_space((Buffer *)&rec->data, cap_len - ws_buffer_length(&rec->data));
 	}
 
+	if (wth->time_index != NULL)
+		wtap_time_index_add(wth->time_index, *offset,
+		    (rec->presence_flags & WTAP_HAS_TS) ? &rec->ts : NULL);
+
 	return true;	/* success */
 }
 
+bool
+wtap_seek_to_time(wtap *wth, const nstime_t *ts, uint64_t *records_skipped,
+    int *err, char **err_info)
+{
+	int64_t offset;
+	uint64_t records;
+	uint64_t skipped;
+
+	*err = 0;
+	*err_info = NULL;
+	if (records_skipped != NULL)
+		*records_skipped = 0;
+	if (wth->time_index == NULL || wth->fh == NULL)
+		return true;
+
+	wtap_time_index_load(wth->time_index, wth->pathname);
+	if (!wtap_time_index_lookup(wth->time_index, ts, &offset, &records))
+		return true;
+	if (offset <= file_tell(wth->fh))
+		return true;	/* already there or past it */
+
+	if (file_seek(wth->fh, offset, SEEK_SET, err) == -1)
+		return false;
+	skipped = wtap_time_index_skipped(wth->time_index, records);
+	ws_info("Time index: skipped %" PRIu64 " records to offset %" PRId64, skipped, offset);
+	if (records_skipped != NULL)
+		*records_skipped = skipped;
+	return true;
+}
+
+void
+wtap_set_time_index_interval(wtap *wth, const nstime_t *interval)
+{
+	if (wth->time_index != NULL)
+		wtap_time_index_set_interval(wth->time_index, interval);
+}
+
+bool
+wtap_write_time_index(wtap *wth, int *err)
+{
+	*err = 0;
+	if (wth->time_index == NULL)
+		return false;
+	return wtap_time_index_save(wth->time_index, wth->pathname, err);
+}
+
 /*
  * Read a given number of bytes from a file into a buffer or, if
  * buf is NULL, just discard them.
@@ -2254,6 +2254,61 @@ WS_DLL_PUBLIC
 bool wtap_seek_read(wtap *wth, int64_t seek_off, wtap_rec *rec,
     int *err, char **err_info);
 
+/** Extension appended to a capture file's name to get the name of its
+ *  saved time index. */
+#define WTAP_TIME_INDEX_EXTENSION ".timeidx"
+
+/**
+ * @brief Skip ahead in sequential reading towards a given time.
+ *
+ * For file types whose readers can do so (currently pcap and pcapng),
+ * sequential reads are moved forward to the last place in the file before
+ * which every record has a time stamp earlier than ts, using the time index
+ * saved next to the file by wtap_write_time_index(), if there is one and
+ * the file hasn't changed since. Otherwise, or if reading is already past
+ * that place, nothing is done.
+ *
+ * Records before ts may still be read afterwards, so callers must still
+ * check time stamps.
+ *
+ * @param wth Wiretap file handle, opened for sequential reading.
+ * @param ts The time.
+ * @param records_skipped If not NULL, set to the number of records skipped,
+ * for callers that number the records they read.
+ * @param err Set to an error code on failure.
+ * @param err_info For some errors, set to a string giving details.
+ * @return true on success, even if nothing was skipped; false on failure.
+ */
+WS_DLL_PUBLIC
+bool wtap_seek_to_time(wtap *wth, const nstime_t *ts,
+    uint64_t *records_skipped, int *err, char **err_info);
+
+/**
+ * @brief Set the minimum time between entries of the time index built
+ * while a file is read sequentially. The default is 1 second.
+ *
+ * @param wth Wiretap file handle.
+ * @param interval The minimum time between entries.
+ */
+WS_DLL_PUBLIC
+void wtap_set_time_index_interval(wtap *wth, const nstime_t *interval);
+
+/**
+ * @brief Save the time index built while reading a file sequentially,
+ * next to the file, for later use by wtap_seek_to_time().
+ *
+ * The index covers the part of the file read so far, so this is best
+ * called after reading to the end of the file.
+ *
+ * @param wth Wiretap file handle.
+ * @param err Set to an errno value on failure; set to 0 if there's no
+ * index to save, because the file type doesn't support one, the file is
+ * a pipe, or sequential reading skipped ahead.
+ * @return true on success, false on failure.
+ */
+WS_DLL_PUBLIC
+bool wtap_write_time_index(wtap *wth, int *err);
+
 /**
  * @brief Initialize a wtap_rec structure.
  *
@@ -112,6 +112,9 @@ struct wtap {
     wtap_new_ipv6_callback_t    add_new_ipv6;    /**< Callback for new IPv6 addresses. */
     wtap_new_secrets_callback_t add_new_secrets; /**< Callback for new secrets. */
     GPtrArray                   *fast_seek;      /**< Fast seek index. */
+    struct wtap_time_index      *time_index;     /**< Time stamp seek table, or NULL
+                                                  * if the file type's reader
+                                                  * can't skip ahead */
 };
 
 /**
@@ -0,0 +1,819 @@
+/* flow_index.c
+ * Flow indexes for capture files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/file_util.h>
+#include <wsutil/inet_addr.h>
+#include <wsutil/pint.h>
+#include <wsutil/strtoi.h>
+
+#include "flow_index.h"
+
+/*
+ * Index file format; all values are little-endian.
+ *
+ * Header:
+ *    0  magic "WSFI"
+ *    4  version
+ *    8  flags (FLOW_INDEX_FLAG_*)
+ *   12  size of the Bloom filter, in bytes
+ *   16  number of flow records
+ *   20  reserved
+ *   24  time stamp of the first packet, in ns since the Epoch
+ *   32  time stamp of the last packet
+ *   40  number of packets
+ *   48  number of packets that weren't IPv4 or IPv6
+ *
+ * followed by the Bloom filter, and then the flow records:
+ *
+ *    0  IP version
+ *    1  IP protocol
+ *    2  reserved
+ *    4  address A
+ *   20  address B
+ *   36  port A
+ *   38  port B
+ *   40  time stamp of the first packet
+ *   48  time stamp of the last packet
+ *   56  number of packets
+ *   64  number of bytes, by original length
+ *   72  number of the first packet in the capture file
+ *   76  number of the last packet
+ *
+ * A flow's endpoints are in order, so that both directions of a
+ * conversation are one flow. Ports are 0 for protocols without them
+ * and for fragments other than the first.
+ */
+#define FLOW_INDEX_MAGIC            "WSFI"
+#define FLOW_INDEX_VERSION          1
+#define FLOW_INDEX_HEADER_LEN       56
+#define FLOW_INDEX_RECORD_LEN       80
+
+#define FLOW_INDEX_FLAG_TRUNCATED   0x00000001  /* Not all flows are in the index */
+
+/* 1 Mbit, with 4 hashes, gives a false positive rate of about 1% with
+   100,000 addresses. */
+#define FLOW_INDEX_BLOOM_BYTES      (128 * 1024)
+#define FLOW_INDEX_BLOOM_HASHES     4
+
+/* The largest Bloom filter we'll read; its bit numbers must fit in 32 bits. */
+#define FLOW_INDEX_MAX_BLOOM_BYTES  (64 * 1024 * 1024)
+
+/* The LINKTYPE_ values we know how to parse. */
+#define LINKTYPE_NULL               0
+#define LINKTYPE_ETHERNET           1
+#define LINKTYPE_RAW                101
+#define LINKTYPE_LOOP               108
+#define LINKTYPE_LINUX_SLL          113
+#define LINKTYPE_IPV4               228
+#define LINKTYPE_IPV6               229
+#define LINKTYPE_LINUX_SLL2         276
+
+#define ETHERTYPE_IPV4              0x0800
+#define ETHERTYPE_VLAN              0x8100
+#define ETHERTYPE_IPV6              0x86DD
+#define ETHERTYPE_QINQ              0x88A8
+#define ETHERTYPE_QINQ_OLD          0x9100
+
+#define IP_PROTO_HOPOPTS            0
+#define IP_PROTO_TCP                6
+#define IP_PROTO_UDP                17
+#define IP_PROTO_ROUTING            43
+#define IP_PROTO_FRAGMENT           44
+#define IP_PROTO_AH                 51
+#define IP_PROTO_DSTOPTS            60
+#define IP_PROTO_SCTP               132
+#define IP_PROTO_UDPLITE            136
+
+/* Compared and hashed as bytes, so there must be no padding. */
+typedef struct {
+    uint8_t  version;
+    uint8_t  proto;
+    uint16_t port_a;
+    uint16_t port_b;
+    uint8_t  addr_a[16];
+    uint8_t  addr_b[16];
+    uint8_t  pad[2];
+} flow_key;
+
+typedef struct {
+    flow_key key;
+    uint64_t first_ts;
+    uint64_t last_ts;
+    uint64_t packets;
+    uint64_t bytes;
+    uint32_t first_packet;
+    uint32_t last_packet;
+} flow_entry;
+
+struct flow_index {
+    GHashTable *flows;          /* flow_entry, keyed by its key */
+    uint8_t    *bloom;
+    bool        truncated;
+    uint64_t    first_ts;
+    uint64_t    last_ts;
+    uint64_t    packets;
+    uint64_t    unparsed;
+};
+
+struct flow_index_file {
+    uint32_t    flags;
+    uint8_t    *bloom;
+    uint32_t    bloom_bytes;
+    flow_entry *flows;
+    uint32_t    flow_count;
+    uint64_t    first_ts;
+    uint64_t    last_ts;
+    uint64_t    packets;
+};
+
+/* FNV-1a; the Bloom filter is read back by other builds, so this mustn't
+   depend on anything that can vary between them. */
+static uint64_t
+flow_index_hash_bytes(const uint8_t *p, size_t len)
+{
+    uint64_t h = UINT64_C(0xcbf29ce484222325);
+
+    while (len-- > 0) {
+        h ^= *p++;
+        h *= UINT64_C(0x100000001b3);
+    }
+    return h;
+}
+
+static unsigned
+flow_key_hash(const void *v)
+{
+    uint64_t h = flow_index_hash_bytes((const uint8_t *)v, sizeof(flow_key));
+
+    return (unsigned)(h ^ (h >> 32));
+}
+
+static gboolean
+flow_key_equal(const void *v1, const void *v2)
+{
+    return memcmp(v1, v2, sizeof(flow_key)) == 0;
+}
+
+/* Bit numbers in the Bloom filter for an address, by double hashing. */
+static void
+flow_index_bloom_bits(uint8_t version, const uint8_t *addr, uint32_t bloom_bytes,
+                      uint32_t bits[FLOW_INDEX_BLOOM_HASHES])
+{
+    uint8_t  buf[17];
+    uint64_t h;
+    uint32_t h1, h2;
+
+    buf[0] = version;
+    memcpy(&buf[1], addr, 16);
+    h = flow_index_hash_bytes(buf, sizeof buf);
+    h1 = (uint32_t)h;
+    h2 = (uint32_t)(h >> 32) | 1;
+    for (unsigned i = 0; i < FLOW_INDEX_BLOOM_HASHES; i++) {
+        bits[i] = (h1 + i * h2) % (bloom_bytes * 8);
+    }
+}
+
+static void
+flow_index_bloom_add(flow_index *fi, uint8_t version, const uint8_t *addr)
+{
+    uint32_t bits[FLOW_INDEX_BLOOM_HASHES];
+
+    flow_index_bloom_bits(version, addr, FLOW_INDEX_BLOOM_BYTES, bits);
+    for (unsigned i = 0; i < FLOW_INDEX_BLOOM_HASHES; i++) {
+        fi->bloom[bits[i] / 8] |= 1 << (bits[i] % 8);
+    }
+}
+
+flow_index *
+flow_index_new(void)
+{
+    flow_index *fi = g_new0(flow_index, 1);
+
+    fi->flows = g_hash_table_new_full(flow_key_hash, flow_key_equal, g_free, NULL);
+    fi->bloom = (uint8_t *)g_malloc0(FLOW_INDEX_BLOOM_BYTES);
+    return fi;
+}
+
+static void
+flow_index_reset(flow_index *fi)
+{
+    g_hash_table_remove_all(fi->flows);
+    memset(fi->bloom, 0, FLOW_INDEX_BLOOM_BYTES);
+    fi->truncated = false;
+    fi->first_ts = 0;
+    fi->last_ts = 0;
+    fi->packets = 0;
+    fi->unparsed = 0;
+}
+
+void
+flow_index_free(flow_index *fi)
+{
+    if (fi == NULL) {
+        return;
+    }
+    g_hash_table_destroy(fi->flows);
+    g_free(fi->bloom);
+    g_free(fi);
+}
+
+/* Get the ports at the start of a transport-layer header, if it has them. */
+static void
+flow_index_parse_ports(uint8_t proto, const uint8_t *pd, uint32_t caplen,
+                       uint32_t offset, uint16_t *sport, uint16_t *dport)
+{
+    switch (proto) {
+
+    case IP_PROTO_TCP:
+    case IP_PROTO_UDP:
+    case IP_PROTO_SCTP:
+    case IP_PROTO_UDPLITE:
+        if (caplen >= offset + 4) {
+            *sport = pntohu16(pd + offset);
+            *dport = pntohu16(pd + offset + 2);
+        }
+        break;
+    }
+}
+
+/*
+ * Get the flow of a packet, and its source and destination addresses.
+ * This only needs to be good enough to find the flows of common traffic;
+ * anything unusual is just counted as unparsed.
+ */
+static bool
+flow_index_parse(int linktype, const uint8_t *pd, uint32_t caplen,
+                 uint8_t *version, uint8_t *proto,
+                 uint8_t src[16], uint8_t dst[16],
+                 uint16_t *sport, uint16_t *dport)
+{
+    uint32_t offset;
+    uint16_t ethertype = 0;
+
+    switch (linktype) {
+
+    case LINKTYPE_ETHERNET:
+        if (caplen < 14) {
+            return false;
+        }
+        ethertype = pntohu16(pd + 12);
+        offset = 14;
+        /* Up to two VLAN tags */
+        for (int tags = 0; tags < 2; tags++) {
+            if (ethertype != ETHERTYPE_VLAN && ethertype != ETHERTYPE_QINQ &&
+                ethertype != ETHERTYPE_QINQ_OLD) {
+                break;
+            }
+            if (caplen < offset + 4) {
+                return false;
+            }
+            ethertype = pntohu16(pd + offset + 2);
+            offset += 4;
+        }
+        break;
+
+    case LINKTYPE_LINUX_SLL:
+        if (caplen < 16) {
+            return false;
+        }
+        ethertype = pntohu16(pd + 14);
+        offset = 16;
+        break;
+
+    case LINKTYPE_LINUX_SLL2:
+        if (caplen < 20) {
+            return false;
+        }
+        ethertype = pntohu16(pd);
+        offset = 20;
+        break;
+
+    case LINKTYPE_NULL:
+    case LINKTYPE_LOOP:
+        /* The address family's value and byte order vary between
+           OSes; look at the IP version instead. */
+        offset = 4;
+        break;
+
+    case LINKTYPE_RAW:
+    case LINKTYPE_IPV4:
+    case LINKTYPE_IPV6:
+        offset = 0;
+        break;
+
+    default:
+        return false;
+    }
+
+    if (ethertype == 0) {
+        if (caplen < offset + 1) {
+            return false;
+        }
+        switch (pd[offset] >> 4) {
+        case 4:
+            ethertype = ETHERTYPE_IPV4;
+            break;
+        case 6:
+            ethertype = ETHERTYPE_IPV6;
+            break;
+        default:
+            return false;
+        }
+    }
+
+    *sport = *dport = 0;
+    memset(src, 0, 16);
+    memset(dst, 0, 16);
+
+    if (ethertype == ETHERTYPE_IPV4) {
+        uint32_t ihl;
+
+        if (caplen < offset + 20 || (pd[offset] >> 4) != 4) {
+            return false;
+        }
+        ihl = (pd[offset] & 0x0F) * 4;
+        if (ihl < 20) {
+            return false;
+        }
+        *version = 4;
+        *proto = pd[offset + 9];
+        memcpy(src, pd + offset + 12, 4);
+        memcpy(dst, pd + offset + 16, 4);
+        /* Only the first fragment has the ports. */
+        if ((pntohu16(pd + offset + 6) & 0x1FFF) == 0) {
+            flow_index_parse_ports(*proto, pd, caplen, offset + ihl, sport, dport);
+        }
+        return true;
+    }
+
+    if (ethertype == ETHERTYPE_IPV6) {
+        uint8_t nxt;
+
+        if (caplen < offset + 40 || (pd[offset] >> 4) != 6) {
+            return false;
+        }
+        *version = 6;
+        nxt = pd[offset + 6];
+        memcpy(src, pd + offset + 8, 16);
+        memcpy(dst, pd + offset + 24, 16);
+        offset += 40;
+        /* Skip the extension headers in front of the transport header. */
+        for (int hdrs = 0; hdrs < 8; hdrs++) {
+            if (nxt == IP_PROTO_HOPOPTS || nxt == IP_PROTO_ROUTING ||
+                nxt == IP_PROTO_DSTOPTS) {
+                if (caplen < offset + 2) {
+                    break;
+                }
+                nxt = pd[offset];
+                offset += (pd[offset + 1] + 1) * 8;
+            } else if (nxt == IP_PROTO_AH) {
+                if (caplen < offset + 2) {
+                    break;
+                }
+                nxt = pd[offset];
+                offset += (pd[offset + 1] + 2) * 4;
+            } else if (nxt == IP_PROTO_FRAGMENT) {
+                if (caplen < offset + 8) {
+                    break;
+                }
+                nxt = pd[offset];
+                if ((pntohu16(pd + offset + 2) & 0xFFF8) != 0) {
+                    /* Not the first fragment; no ports. */
+                    *proto = nxt;
+                    return true;
+                }
+                offset += 8;
+            } else {
+                break;
+            }
+        }
+        *proto = nxt;
+        flow_index_parse_ports(*proto, pd, caplen, offset, sport, dport);
+        return true;
+    }
+
+    return false;
+}
+
+void
+flow_index_add_packet(flow_index *fi, int linktype, uint64_t ts,
+                      uint32_t caplen, uint32_t len, const uint8_t *pd,
+                      uint32_t packet_num)
+{
+    flow_key    key;
+    flow_entry *entry;
+    uint8_t     src[16], dst[16];
+    uint16_t    sport, dport;
+    int         order;
+
+    if (fi->packets == 0 || ts < fi->first_ts) {
+        fi->first_ts = ts;
+    }
+    if (ts > fi->last_ts) {
+        fi->last_ts = ts;
+    }
+    fi->packets++;
+
+    memset(&key, 0, sizeof key);
+    if (!flow_index_parse(linktype, pd, caplen, &key.version, &key.proto,
+                          src, dst, &sport, &dport)) {
+        fi->unparsed++;
+        return;
+    }
+    flow_index_bloom_add(fi, key.version, src);
+    flow_index_bloom_add(fi, key.version, dst);
+
+    /* Put the endpoints in order, so both directions are one flow. */
+    order = memcmp(src, dst, 16);
+    if (order < 0 || (order == 0 && sport <= dport)) {
+        memcpy(key.addr_a, src, 16);
+        memcpy(key.addr_b, dst, 16);
+        key.port_a = sport;
+        key.port_b = dport;
+    } else {
+        memcpy(key.addr_a, dst, 16);
+        memcpy(key.addr_b, src, 16);
+        key.port_a = dport;
+        key.port_b = sport;
+    }
+
+    entry = (flow_entry *)g_hash_table_lookup(fi->flows, &key);
+    if (entry == NULL) {
+        if (g_hash_table_size(fi->flows) >= FLOW_INDEX_MAX_FLOWS) {
+            fi->truncated = true;
+            return;
+        }
+        entry = g_new0(flow_entry, 1);
+        entry->key = key;
+        entry->first_ts = ts;
+        entry->first_packet = packet_num;
+        g_hash_table_insert(fi->flows, &entry->key, entry);
+    }
+    if (ts < entry->first_ts) {
+        entry->first_ts = ts;
+    }
+    if (ts > entry->last_ts) {
+        entry->last_ts = ts;
+    }
+    entry->last_packet = packet_num;
+    entry->packets++;
+    entry->bytes += len;
+}
+
+bool
+flow_index_write(flow_index *fi, const char *filename, int *err)
+{
+    FILE           *fh;
+    uint8_t         hdr[FLOW_INDEX_HEADER_LEN];
+    uint8_t         rec[FLOW_INDEX_RECORD_LEN];
+    GHashTableIter  iter;
+    void           *value;
+    bool            ok = true;
+
+    fh = ws_fopen(filename, "wb");
+    if (fh == NULL) {
+        *err = errno;
+        flow_index_reset(fi);
+        return false;
+    }
+
+    memset(hdr, 0, sizeof hdr);
+    memcpy(hdr, FLOW_INDEX_MAGIC, 4);
+    phtoleu32(hdr + 4, FLOW_INDEX_VERSION);
+    phtoleu32(hdr + 8, fi->truncated ? FLOW_INDEX_FLAG_TRUNCATED : 0);
+    phtoleu32(hdr + 12, FLOW_INDEX_BLOOM_BYTES);
+    phtoleu32(hdr + 16, g_hash_table_size(fi->flows));
+    phtoleu64(hdr + 24, fi->first_ts);
+    phtoleu64(hdr + 32, fi->last_ts);
+    phtoleu64(hdr + 40, fi->packets);
+    phtoleu64(hdr + 48, fi->unparsed);
+    if (fwrite(hdr, sizeof hdr, 1, fh) != 1 ||
+        fwrite(fi->bloom, FLOW_INDEX_BLOOM_BYTES, 1, fh) != 1) {
+        ok = false;
+    }
+
+    g_hash_table_iter_init(&iter, fi->flows);
+    while (ok && g_hash_table_iter_next(&iter, NULL, &value)) {
+        const flow_entry *entry = (const flow_entry *)value;
+
+        memset(rec, 0, sizeof rec);
+        rec[0] = entry->key.version;
+        rec[1] = entry->key.proto;
+        memcpy(rec + 4, entry->key.addr_a, 16);
+        memcpy(rec + 20, entry->key.addr_b, 16);
+        phtoleu16(rec + 36, entry->key.port_a);
+        phtoleu16(rec + 38, entry->key.port_b);
+        phtoleu64(rec + 40, entry->first_ts);
+        phtoleu64(rec + 48, entry->last_ts);
+        phtoleu64(rec + 56, entry->packets);
+        phtoleu64(rec + 64, entry->bytes);
+        phtoleu32(rec + 72, entry->first_packet);
+        phtoleu32(rec + 76, entry->last_packet);
+        if (fwrite(rec, sizeof rec, 1, fh) != 1) {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        *err = errno;
+        fclose(fh);
+    } else if (fclose(fh) == EOF) {
+        *err = errno;
+        ok = false;
+    }
+
+    flow_index_reset(fi);
+    return ok;
+}
+
+char *
+flow_index_filename(const char *capture_filename)
+{
+    return g_strconcat(capture_filename, FLOW_INDEX_EXTENSION, NULL);
+}
+
+flow_index_file *
+flow_index_file_read(const char *filename, int *err)
+{
+    char            *contents;
+    size_t           length;
+    const uint8_t   *p;
+    flow_index_file *fif;
+    GError          *gerr = NULL;
+
+    if (!g_file_get_contents(filename, &contents, &length, &gerr)) {
+        *err = (gerr->code == G_FILE_ERROR_NOENT) ? ENOENT : EIO;
+        g_error_free(gerr);
+        return NULL;
+    }
+    p = (const uint8_t *)contents;
+    if (length < FLOW_INDEX_HEADER_LEN || memcmp(p, FLOW_INDEX_MAGIC, 4) != 0 ||
+        pletohu32(p + 4) != FLOW_INDEX_VERSION) {
+        g_free(contents);
+        *err = EINVAL;
+        return NULL;
+    }
+
+    fif = g_new0(flow_index_file, 1);
+    fif->flags = pletohu32(p + 8);
+    fif->bloom_bytes = pletohu32(p + 12);
+    fif->flow_count = pletohu32(p + 16);
+    fif->first_ts = pletohu64(p + 24);
+    fif->last_ts = pletohu64(p + 32);
+    fif->packets = pletohu64(p + 40);
+    if (fif->bloom_bytes == 0 || fif->bloom_bytes > FLOW_INDEX_MAX_BLOOM_BYTES ||
+        fif->flow_count > FLOW_INDEX_MAX_FLOWS ||
+        length != FLOW_INDEX_HEADER_LEN + (size_t)fif->bloom_bytes +
+                  (size_t)fif->flow_count * FLOW_INDEX_RECORD_LEN) {
+        g_free(fif);
+        g_free(contents);
+        *err = EINVAL;
+        return NULL;
+    }
+    p += FLOW_INDEX_HEADER_LEN;
+    fif->bloom = (uint8_t *)g_memdup2(p, fif->bloom_bytes);
+    p += fif->bloom_bytes;
+
+    fif->flows = g_new0(flow_entry, fif->flow_count);
+    for (uint32_t i = 0; i < fif->flow_count; i++) {
+        flow_entry *entry = &fif->flows[i];
+
+        entry->key.version = p[0];
+        entry->key.proto = p[1];
+        memcpy(entry->key.addr_a, p + 4, 16);
+        memcpy(entry->key.addr_b, p + 20, 16);
+        entry->key.port_a = pletohu16(p + 36);
+        entry->key.port_b = pletohu16(p + 38);
+        entry->first_ts = pletohu64(p + 40);
+        entry->last_ts = pletohu64(p + 48);
+        entry->packets = pletohu64(p + 56);
+        entry->bytes = pletohu64(p + 64);
+        entry->first_packet = pletohu32(p + 72);
+        entry->last_packet = pletohu32(p + 76);
+        p += FLOW_INDEX_RECORD_LEN;
+    }
+    g_free(contents);
+    return fif;
+}
+
+bool
+flow_index_parse_address(const char *str, flow_index_address *addr)
+{
+    ws_in4_addr  addr4;
+    ws_in6_addr  addr6;
+
+    memset(addr, 0, sizeof *addr);
+    if (ws_inet_pton4(str, &addr4)) {
+        addr->version = 4;
+        memcpy(addr->addr, &addr4, 4);
+        return true;
+    }
+    if (ws_inet_pton6(str, &addr6)) {
+        addr->version = 6;
+        memcpy(addr->addr, &addr6, 16);
+        return true;
+    }
+    return false;
+}
+
+bool
+flow_index_parse_flow(const char *str, flow_index_flow *flow)
+{
+    char   **fields = g_strsplit(str, ",", -1);
+    unsigned count = g_strv_length(fields);
+    uint8_t  proto;
+    uint16_t port;
+    bool     ok;
+
+    memset(flow, 0, sizeof *flow);
+    flow->proto = -1;
+    flow->port_a = -1;
+    flow->port_b = -1;
+    ok = count >= 1 && count <= 5 && flow_index_parse_address(fields[0], &flow->addr_a);
+    if (ok && count >= 2 && strcmp(fields[1], "*") != 0) {
+        ok = flow_index_parse_address(fields[1], &flow->addr_b) &&
+             flow->addr_b.version == flow->addr_a.version;
+    }
+    if (ok && count >= 3 && strcmp(fields[2], "*") != 0) {
+        if (g_ascii_strcasecmp(fields[2], "tcp") == 0) {
+            flow->proto = IP_PROTO_TCP;
+        } else if (g_ascii_strcasecmp(fields[2], "udp") == 0) {
+            flow->proto = IP_PROTO_UDP;
+        } else if (g_ascii_strcasecmp(fields[2], "sctp") == 0) {
+            flow->proto = IP_PROTO_SCTP;
+        } else if (g_ascii_strcasecmp(fields[2], "udplite") == 0) {
+            flow->proto = IP_PROTO_UDPLITE;
+        } else if ((ok = ws_strtou8(fields[2], NULL, &proto))) {
+            flow->proto = proto;
+        }
+    }
+    if (ok && count >= 4 && strcmp(fields[3], "*") != 0) {
+        if ((ok = ws_strtou16(fields[3], NULL, &port))) {
+            flow->port_a = port;
+        }
+    }
+    if (ok && count >= 5 && strcmp(fields[4], "*") != 0) {
+        if ((ok = ws_strtou16(fields[4], NULL, &port))) {
+            flow->port_b = port;
+        }
+    }
+    g_strfreev(fields);
+    return ok;
+}
+
+/* Whether an address and port match those of one end of a flow; an
+   address of version 0 or a port of -1 matches anything. */
+static bool
+flow_index_endpoint_matches(const flow_index_address *addr, int port,
+                            const uint8_t key_addr[16], uint16_t key_port)
+{
+    if (addr->version != 0 && memcmp(addr->addr, key_addr, 16) != 0) {
+        return false;
+    }
+    return port == -1 || port == key_port;
+}
+
+/* Whether a flow, in either direction, is one of those asked for. */
+static bool
+flow_index_key_matches(const flow_index_flow *flow, const flow_key *key)
+{
+    if (key->version != flow->addr_a.version ||
+        (flow->proto != -1 && key->proto != flow->proto)) {
+        return false;
+    }
+    return (flow_index_endpoint_matches(&flow->addr_a, flow->port_a, key->addr_a, key->port_a) &&
+            flow_index_endpoint_matches(&flow->addr_b, flow->port_b, key->addr_b, key->port_b)) ||
+           (flow_index_endpoint_matches(&flow->addr_a, flow->port_a, key->addr_b, key->port_b) &&
+            flow_index_endpoint_matches(&flow->addr_b, flow->port_b, key->addr_a, key->port_a));
+}
+
+bool
+flow_index_packet_in_flow(const flow_index_flow *flow, int linktype,
+                          const uint8_t *pd, uint32_t caplen)
+{
+    flow_key key;
+
+    memset(&key, 0, sizeof key);
+    if (!flow_index_parse(linktype, pd, caplen, &key.version, &key.proto,
+                          key.addr_a, key.addr_b, &key.port_a, &key.port_b)) {
+        return false;
+    }
+    return flow_index_key_matches(flow, &key);
+}
+
+/* Whether the Bloom filter of an index may have an address. */
+static bool
+flow_index_bloom_has(const flow_index_file *fif, const flow_index_address *addr)
+{
+    uint32_t bits[FLOW_INDEX_BLOOM_HASHES];
+
+    flow_index_bloom_bits(addr->version, addr->addr, fif->bloom_bytes, bits);
+    for (unsigned i = 0; i < FLOW_INDEX_BLOOM_HASHES; i++) {
+        if (!(fif->bloom[bits[i] / 8] & (1 << (bits[i] % 8)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+flow_index_file_has_address(const flow_index_file *fif,
+                            const flow_index_address *addr)
+{
+    if (!flow_index_bloom_has(fif, addr)) {
+        return false;
+    }
+    if (fif->flags & FLOW_INDEX_FLAG_TRUNCATED) {
+        return true;
+    }
+
+    /* Rule out a false positive from the Bloom filter. */
+    for (uint32_t i = 0; i < fif->flow_count; i++) {
+        const flow_key *key = &fif->flows[i].key;
+
+        if (key->version == addr->version &&
+            (memcmp(key->addr_a, addr->addr, 16) == 0 ||
+             memcmp(key->addr_b, addr->addr, 16) == 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+flow_index_file_find_flow(const flow_index_file *fif,
+                          const flow_index_flow *flow, flow_index_span *span)
+{
+    bool found = false;
+
+    if (fif->packets == 0 || !flow_index_bloom_has(fif, &flow->addr_a) ||
+        (flow->addr_b.version != 0 && !flow_index_bloom_has(fif, &flow->addr_b))) {
+        return false;
+    }
+    if (fif->flags & FLOW_INDEX_FLAG_TRUNCATED) {
+        /* The flow may be one that isn't recorded. */
+        span->first_packet = 1;
+        span->last_packet = UINT32_MAX;
+        span->first_ts = fif->first_ts;
+        span->last_ts = fif->last_ts;
+        return true;
+    }
+
+    for (uint32_t i = 0; i < fif->flow_count; i++) {
+        const flow_entry *entry = &fif->flows[i];
+
+        if (!flow_index_key_matches(flow, &entry->key)) {
+            continue;
+        }
+        if (!found) {
+            span->first_packet = entry->first_packet;
+            span->last_packet = entry->last_packet;
+            span->first_ts = entry->first_ts;
+            span->last_ts = entry->last_ts;
+            found = true;
+            continue;
+        }
+        span->first_packet = MIN(span->first_packet, entry->first_packet);
+        span->last_packet = MAX(span->last_packet, entry->last_packet);
+        span->first_ts = MIN(span->first_ts, entry->first_ts);
+        span->last_ts = MAX(span->last_ts, entry->last_ts);
+    }
+    return found;
+}
+
+bool
+flow_index_file_time_range(const flow_index_file *fif,
+                           uint64_t *first_ts, uint64_t *last_ts)
+{
+    if (fif->packets == 0) {
+        return false;
+    }
+    *first_ts = fif->first_ts;
+    *last_ts = fif->last_ts;
+    return true;
+}
+
+void
+flow_index_file_free(flow_index_file *fif)
+{
+    if (fif == NULL) {
+        return;
+    }
+    g_free(fif->bloom);
+    g_free(fif->flows);
+    g_free(fif);
+}
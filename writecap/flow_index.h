@@ -0,0 +1,213 @@
+/** @file
+ *
+ * Flow indexes for capture files.
+ *
+ * A flow index is a small file written next to a capture file, listing
+ * the flows (IP addresses, protocol, and ports) of the packets in it,
+ * with the time, packet number, and number of packets and bytes of each,
+ * and a Bloom filter of the addresses. It's built by dumpcap as the
+ * packets are written, with a minimal parser for the link-layer, IP, and
+ * transport headers, so that the files of a long ring buffer capture
+ * that hold a given flow or address can be found without reading them.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Extension appended to a capture file's name to get its index's name. */
+#define FLOW_INDEX_EXTENSION    ".flowidx"
+
+/** Most flows recorded for one capture file; the addresses of packets
+ *  in other flows only go into the Bloom filter. */
+#define FLOW_INDEX_MAX_FLOWS    (1U << 20)
+
+/** An IPv4 or IPv6 address, for querying an index. */
+typedef struct {
+    uint8_t version;            /**< 4 or 6 */
+    uint8_t addr[16];           /**< IPv4 addresses use the first 4 bytes */
+} flow_index_address;
+
+/** The flows to look for in an index: those between two addresses, or
+ *  to or from one, optionally with a given protocol and ports. */
+typedef struct {
+    flow_index_address addr_a;
+    flow_index_address addr_b; /**< version 0 for any address */
+    int                proto;  /**< -1 for any protocol */
+    int                port_a; /**< Port at addr_a, -1 for any */
+    int                port_b; /**< Port at addr_b, -1 for any */
+} flow_index_flow;
+
+/** Where the packets of a flow are in a capture file. */
+typedef struct {
+    uint32_t first_packet;      /**< Number of the first packet, from 1 */
+    uint32_t last_packet;       /**< Number of the last packet */
+    uint64_t first_ts;          /**< Time stamp of the first packet, in ns since the Epoch */
+    uint64_t last_ts;           /**< Time stamp of the last packet */
+} flow_index_span;
+
+/* Building an index */
+
+typedef struct flow_index flow_index;
+
+/**
+ * @brief Creates an empty flow index.
+ * @return The new index.
+ */
+extern flow_index *
+flow_index_new(void);
+
+/**
+ * @brief Adds a packet to a flow index.
+ *
+ * Packets that aren't IPv4 or IPv6, or whose link-layer type isn't
+ * one the index's parser handles, are only counted.
+ *
+ * @param fi The index.
+ * @param linktype The LINKTYPE_ value of the packet's interface.
+ * @param ts The packet's time stamp, in nanoseconds since the Epoch.
+ * @param caplen The captured length of the packet.
+ * @param len The original length of the packet.
+ * @param pd The packet's data.
+ * @param packet_num The number of the packet in the capture file, from 1.
+ */
+extern void
+flow_index_add_packet(flow_index *fi, int linktype, uint64_t ts,
+                      uint32_t caplen, uint32_t len, const uint8_t *pd,
+                      uint32_t packet_num);
+
+/**
+ * @brief Writes a flow index to a file, and empties it for the next
+ * capture file.
+ *
+ * @param fi The index.
+ * @param filename The name of the index file.
+ * @param err Set to an error code on failure.
+ * @return true on success, false on failure.
+ */
+extern bool
+flow_index_write(flow_index *fi, const char *filename, int *err);
+
+/**
+ * @brief Frees a flow index.
+ * @param fi The index.
+ */
+extern void
+flow_index_free(flow_index *fi);
+
+/* Reading an index */
+
+typedef struct flow_index_file flow_index_file;
+
+/**
+ * @brief Gets the name of the index of a capture file.
+ * @param capture_filename The name of the capture file.
+ * @return The name of the index file, to be g_free()d.
+ */
+extern char *
+flow_index_filename(const char *capture_filename);
+
+/**
+ * @brief Reads a flow index file.
+ * @param filename The name of the index file.
+ * @param err Set to an errno value on failure; EINVAL if the file isn't
+ * a flow index.
+ * @return The index, or NULL on failure.
+ */
+extern flow_index_file *
+flow_index_file_read(const char *filename, int *err);
+
+/**
+ * @brief Parses an IPv4 or IPv6 address for querying an index.
+ * @param str The address.
+ * @param addr Set to the address.
+ * @return true if str is a valid address, false otherwise.
+ */
+extern bool
+flow_index_parse_address(const char *str, flow_index_address *addr);
+
+/**
+ * @brief Parses a flow for querying an index:
+ * "<address>[,<address>[,<protocol>[,<port>[,<port>]]]]", where the
+ * protocol is "tcp", "udp", "sctp", "udplite" or a number, each port is
+ * that of the address in the same place, and "*" in any place after the
+ * first matches anything.
+ * @param str The flow.
+ * @param flow Set to the flow.
+ * @return true if str is a valid flow, false otherwise.
+ */
+extern bool
+flow_index_parse_flow(const char *str, flow_index_flow *flow);
+
+/**
+ * @brief Checks whether a packet is in a flow.
+ *
+ * @param flow The flow.
+ * @param linktype The LINKTYPE_ value of the packet's interface.
+ * @param pd The packet's data.
+ * @param caplen The captured length of the packet.
+ * @return true if it is, false if it isn't or can't be parsed.
+ */
+extern bool
+flow_index_packet_in_flow(const flow_index_flow *flow, int linktype,
+                          const uint8_t *pd, uint32_t caplen);
+
+/**
+ * @brief Checks whether the capture file of an index may have packets to
+ * or from an address.
+ *
+ * @param fif The index.
+ * @param addr The address.
+ * @return false if the capture file has no such packets; true if it
+ * does, or, if the Bloom filter can't rule it out and not all of the
+ * file's flows are in the index, if it might.
+ */
+extern bool
+flow_index_file_has_address(const flow_index_file *fif,
+                            const flow_index_address *addr);
+
+/**
+ * @brief Finds where the packets of a flow are in the capture file of an
+ * index.
+ *
+ * The Bloom filter rules out files without the addresses, and the flow
+ * records then rule out its false positives and give the span of the
+ * flow's packets. If not all of the file's flows are in the index, a
+ * file that may have the flow spans all of its packets.
+ *
+ * @param fif The index.
+ * @param flow The flow.
+ * @param span Set to the span of the flow's packets, if any.
+ * @return false if the capture file has no packets in the flow, true
+ * otherwise.
+ */
+extern bool
+flow_index_file_find_flow(const flow_index_file *fif,
+                          const flow_index_flow *flow, flow_index_span *span);
+
+/**
+ * @brief Gets the time stamps of the first and last packets in the
+ * capture file of an index.
+ *
+ * @param fif The index.
+ * @param first_ts Set to the first time stamp, in nanoseconds since the Epoch.
+ * @param last_ts Set to the last time stamp, in nanoseconds since the Epoch.
+ * @return false if the capture file has no packets, true otherwise.
+ */
+extern bool
+flow_index_file_time_range(const flow_index_file *fif,
+                           uint64_t *first_ts, uint64_t *last_ts);
+
+/**
+ * @brief Frees an index read with flow_index_file_read().
+ * @param fif The index.
+ */
+extern void
+flow_index_file_free(flow_index_file *fif);
@@ -0,0 +1,425 @@
+/* flow_index_test.c
+ * Flow index tests
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#undef G_DISABLE_ASSERT
+
+#include <errno.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+
+#include "flow_index.h"
+
+#define LINKTYPE_RAW    101
+
+/* The size of the header and of the Bloom filter flow_index_write() writes. */
+#define TEST_HEADER_LEN     56
+#define TEST_BLOOM_BYTES    (128 * 1024)
+
+/* A minimal IPv4 UDP packet, with the transport header right after the
+   IP one; the addresses and ports are filled in by make_udp4(). */
+static void
+make_udp4(uint8_t pkt[28], const char *src, const char *dst,
+          uint16_t sport, uint16_t dport)
+{
+    flow_index_address addr;
+
+    memset(pkt, 0, 28);
+    pkt[0] = 0x45;
+    phtonu16(pkt + 2, 28);
+    pkt[8] = 64;
+    pkt[9] = 17;
+    g_assert_true(flow_index_parse_address(src, &addr));
+    memcpy(pkt + 12, addr.addr, 4);
+    g_assert_true(flow_index_parse_address(dst, &addr));
+    memcpy(pkt + 16, addr.addr, 4);
+    phtonu16(pkt + 20, sport);
+    phtonu16(pkt + 22, dport);
+    phtonu16(pkt + 24, 8);
+}
+
+/* A minimal IPv6 TCP packet. */
+static void
+make_tcp6(uint8_t pkt[60], const char *src, const char *dst,
+          uint16_t sport, uint16_t dport)
+{
+    flow_index_address addr;
+
+    memset(pkt, 0, 60);
+    pkt[0] = 0x60;
+    phtonu16(pkt + 4, 20);
+    pkt[6] = 6;
+    pkt[7] = 64;
+    g_assert_true(flow_index_parse_address(src, &addr));
+    memcpy(pkt + 8, addr.addr, 16);
+    g_assert_true(flow_index_parse_address(dst, &addr));
+    memcpy(pkt + 24, addr.addr, 16);
+    phtonu16(pkt + 40, sport);
+    phtonu16(pkt + 42, dport);
+    pkt[52] = 0x50;
+}
+
+static bool
+has_address(const flow_index_file *fif, const char *str)
+{
+    flow_index_address addr;
+
+    g_assert_true(flow_index_parse_address(str, &addr));
+    return flow_index_file_has_address(fif, &addr);
+}
+
+static bool
+find_flow(const flow_index_file *fif, const char *str, flow_index_span *span)
+{
+    flow_index_flow flow;
+
+    g_assert_true(flow_index_parse_flow(str, &flow));
+    return flow_index_file_find_flow(fif, &flow, span);
+}
+
+static char *
+tmp_index_name(void)
+{
+    char   *filename;
+    GError *gerr = NULL;
+    int     fd;
+
+    fd = g_file_open_tmp("flow_index_test_XXXXXX.flowidx", &filename, &gerr);
+    g_assert_no_error(gerr);
+    ws_close(fd);
+    return filename;
+}
+
+/* Write an index of a few packets, and return the name of its file. */
+static char *
+write_test_index(void)
+{
+    flow_index *fi = flow_index_new();
+    char       *filename = tmp_index_name();
+    uint8_t     udp4[28], tcp6[60];
+    uint8_t     arp[8] = { 0 };
+    int         err = 0;
+
+    make_udp4(udp4, "192.0.2.1", "198.51.100.7", 1234, 53);
+    flow_index_add_packet(fi, LINKTYPE_RAW, UINT64_C(1000000000), sizeof udp4, sizeof udp4, udp4, 1);
+    make_udp4(udp4, "198.51.100.7", "192.0.2.1", 53, 1234);
+    flow_index_add_packet(fi, LINKTYPE_RAW, UINT64_C(3000000000), sizeof udp4, sizeof udp4, udp4, 2);
+    make_tcp6(tcp6, "2001:db8::1", "2001:db8::2", 40000, 443);
+    flow_index_add_packet(fi, LINKTYPE_RAW, UINT64_C(2000000000), sizeof tcp6, sizeof tcp6, tcp6, 3);
+    /* Not IP; counted, but not indexed. */
+    flow_index_add_packet(fi, LINKTYPE_RAW, UINT64_C(4000000000), sizeof arp, sizeof arp, arp, 4);
+
+    g_assert_true(flow_index_write(fi, filename, &err));
+    g_assert_cmpint(err, ==, 0);
+    flow_index_free(fi);
+    return filename;
+}
+
+static void
+flow_index_test_round_trip(void)
+{
+    char            *filename = write_test_index();
+    flow_index_file *fif;
+    uint64_t         first_ts, last_ts;
+    int              err = 0;
+
+    fif = flow_index_file_read(filename, &err);
+    g_assert_nonnull(fif);
+
+    /* Both endpoints of both flows, in either direction. */
+    g_assert_true(has_address(fif, "192.0.2.1"));
+    g_assert_true(has_address(fif, "198.51.100.7"));
+    g_assert_true(has_address(fif, "2001:db8::1"));
+    g_assert_true(has_address(fif, "2001:db8::2"));
+
+    g_assert_true(flow_index_file_time_range(fif, &first_ts, &last_ts));
+    g_assert_cmpuint(first_ts, ==, UINT64_C(1000000000));
+    g_assert_cmpuint(last_ts, ==, UINT64_C(4000000000));
+
+    flow_index_file_free(fif);
+    ws_unlink(filename);
+    g_free(filename);
+}
+
+static void
+flow_index_test_miss(void)
+{
+    char            *filename = write_test_index();
+    flow_index_file *fif;
+    int              err = 0;
+
+    fif = flow_index_file_read(filename, &err);
+    g_assert_nonnull(fif);
+
+    /* The flow records rule out any Bloom filter false positive. */
+    g_assert_false(has_address(fif, "192.0.2.2"));
+    g_assert_false(has_address(fif, "203.0.113.1"));
+    g_assert_false(has_address(fif, "2001:db8::3"));
+    /* The same bytes as an indexed IPv4 address, but IPv6. */
+    g_assert_false(has_address(fif, "c000:201::"));
+
+    flow_index_file_free(fif);
+    ws_unlink(filename);
+    g_free(filename);
+}
+
+static void
+flow_index_test_empty(void)
+{
+    flow_index      *fi = flow_index_new();
+    char            *filename = tmp_index_name();
+    flow_index_file *fif;
+    uint64_t         first_ts, last_ts;
+    int              err = 0;
+
+    g_assert_true(flow_index_write(fi, filename, &err));
+    flow_index_free(fi);
+
+    fif = flow_index_file_read(filename, &err);
+    g_assert_nonnull(fif);
+    g_assert_false(has_address(fif, "192.0.2.1"));
+    g_assert_false(flow_index_file_time_range(fif, &first_ts, &last_ts));
+
+    flow_index_file_free(fif);
+    ws_unlink(filename);
+    g_free(filename);
+}
+
+/* Read an index after changing it; it should be rejected. */
+static void
+check_corrupt(const uint8_t *contents, size_t length)
+{
+    char            *filename = tmp_index_name();
+    flow_index_file *fif;
+    GError          *gerr = NULL;
+    int              err = 0;
+
+    g_file_set_contents(filename, (const char *)contents, length, &gerr);
+    g_assert_no_error(gerr);
+    fif = flow_index_file_read(filename, &err);
+    g_assert_null(fif);
+    g_assert_cmpint(err, ==, EINVAL);
+
+    ws_unlink(filename);
+    g_free(filename);
+}
+
+static void
+flow_index_test_corrupt(void)
+{
+    char            *filename = write_test_index();
+    char            *contents;
+    uint8_t         *p;
+    size_t           length;
+    flow_index_file *fif;
+    GError          *gerr = NULL;
+    int              err = 0;
+
+    g_file_get_contents(filename, &contents, &length, &gerr);
+    g_assert_no_error(gerr);
+    ws_unlink(filename);
+    g_free(filename);
+    p = (uint8_t *)contents;
+    g_assert_cmpuint(length, ==, TEST_HEADER_LEN + TEST_BLOOM_BYTES + 2 * 80);
+
+    /* Truncated header, truncated flow records, and trailing data */
+    check_corrupt(p, TEST_HEADER_LEN - 1);
+    check_corrupt(p, length - 1);
+    contents = g_realloc(contents, length + 1);
+    p = (uint8_t *)contents;
+    p[length] = 0;
+    check_corrupt(p, length + 1);
+
+    /* Bad magic */
+    p[0] ^= 0xff;
+    check_corrupt(p, length);
+    p[0] ^= 0xff;
+
+    /* Unknown version */
+    phtoleu32(p + 4, 2);
+    check_corrupt(p, length);
+    phtoleu32(p + 4, 1);
+
+    /* No Bloom filter */
+    phtoleu32(p + 12, 0);
+    check_corrupt(p, length);
+
+    /* A Bloom filter too big for its bit numbers to fit in 32 bits */
+    phtoleu32(p + 12, 0x20000000);
+    check_corrupt(p, length);
+
+    /* Too many flows */
+    phtoleu32(p + 12, TEST_BLOOM_BYTES);
+    phtoleu32(p + 16, FLOW_INDEX_MAX_FLOWS + 1);
+    check_corrupt(p, length);
+
+    /* Still readable once put back. */
+    phtoleu32(p + 16, 2);
+    filename = tmp_index_name();
+    g_file_set_contents(filename, contents, length, &gerr);
+    g_assert_no_error(gerr);
+    fif = flow_index_file_read(filename, &err);
+    g_assert_nonnull(fif);
+    flow_index_file_free(fif);
+    ws_unlink(filename);
+    g_free(filename);
+
+    /* Not there at all */
+    g_assert_null(flow_index_file_read("nonexistent" FLOW_INDEX_EXTENSION, &err));
+    g_assert_cmpint(err, ==, ENOENT);
+
+    g_free(contents);
+}
+
+static void
+flow_index_test_parse_address(void)
+{
+    flow_index_address addr;
+
+    g_assert_true(flow_index_parse_address("192.0.2.1", &addr));
+    g_assert_cmpuint(addr.version, ==, 4);
+    g_assert_true(flow_index_parse_address("2001:db8::1", &addr));
+    g_assert_cmpuint(addr.version, ==, 6);
+    g_assert_false(flow_index_parse_address("192.0.2", &addr));
+    g_assert_false(flow_index_parse_address("example.com", &addr));
+}
+
+static void
+flow_index_test_find_flow(void)
+{
+    char            *filename = write_test_index();
+    flow_index_file *fif;
+    flow_index_span  span;
+    int              err = 0;
+
+    fif = flow_index_file_read(filename, &err);
+    g_assert_nonnull(fif);
+
+    /* Either address alone, both, and the full 5-tuple either way round */
+    g_assert_true(find_flow(fif, "198.51.100.7", &span));
+    g_assert_cmpuint(span.first_packet, ==, 1);
+    g_assert_cmpuint(span.last_packet, ==, 2);
+    g_assert_cmpuint(span.first_ts, ==, UINT64_C(1000000000));
+    g_assert_cmpuint(span.last_ts, ==, UINT64_C(3000000000));
+    g_assert_true(find_flow(fif, "192.0.2.1,198.51.100.7", &span));
+    g_assert_true(find_flow(fif, "192.0.2.1,198.51.100.7,udp,1234,53", &span));
+    g_assert_true(find_flow(fif, "198.51.100.7,192.0.2.1,17,53,1234", &span));
+    g_assert_true(find_flow(fif, "198.51.100.7,*,*,53", &span));
+    g_assert_true(find_flow(fif, "2001:db8::2,2001:db8::1,tcp,443,40000", &span));
+    g_assert_cmpuint(span.first_packet, ==, 3);
+    g_assert_cmpuint(span.last_packet, ==, 3);
+    g_assert_cmpuint(span.first_ts, ==, UINT64_C(2000000000));
+    g_assert_cmpuint(span.last_ts, ==, UINT64_C(2000000000));
+
+    /* Both addresses are in the Bloom filter, but not in the same flow,
+       or not with that protocol or those ports. */
+    g_assert_false(find_flow(fif, "192.0.2.1,2001:db8::1", &span));
+    g_assert_false(find_flow(fif, "192.0.2.1,198.51.100.7,tcp", &span));
+    g_assert_false(find_flow(fif, "192.0.2.1,198.51.100.7,udp,53,1234", &span));
+    g_assert_false(find_flow(fif, "192.0.2.1,*,*,53", &span));
+    g_assert_false(find_flow(fif, "203.0.113.1", &span));
+
+    flow_index_file_free(fif);
+    ws_unlink(filename);
+    g_free(filename);
+}
+
+static void
+flow_index_test_packet_in_flow(void)
+{
+    flow_index_flow flow;
+    uint8_t         udp4[28], tcp6[60];
+    uint8_t         arp[8] = { 0 };
+
+    make_udp4(udp4, "198.51.100.7", "192.0.2.1", 53, 1234);
+    make_tcp6(tcp6, "2001:db8::1", "2001:db8::2", 40000, 443);
+
+    g_assert_true(flow_index_parse_flow("192.0.2.1,198.51.100.7,udp,1234,53", &flow));
+    g_assert_true(flow_index_packet_in_flow(&flow, LINKTYPE_RAW, udp4, sizeof udp4));
+    g_assert_false(flow_index_packet_in_flow(&flow, LINKTYPE_RAW, tcp6, sizeof tcp6));
+    g_assert_false(flow_index_packet_in_flow(&flow, LINKTYPE_RAW, arp, sizeof arp));
+
+    g_assert_true(flow_index_parse_flow("192.0.2.1,198.51.100.7,udp,53,1234", &flow));
+    g_assert_false(flow_index_packet_in_flow(&flow, LINKTYPE_RAW, udp4, sizeof udp4));
+
+    g_assert_true(flow_index_parse_flow("2001:db8::2", &flow));
+    g_assert_true(flow_index_packet_in_flow(&flow, LINKTYPE_RAW, tcp6, sizeof tcp6));
+    g_assert_false(flow_index_packet_in_flow(&flow, LINKTYPE_RAW, udp4, sizeof udp4));
+}
+
+static void
+flow_index_test_parse_flow(void)
+{
+    flow_index_flow flow;
+
+    g_assert_true(flow_index_parse_flow("192.0.2.1", &flow));
+    g_assert_cmpuint(flow.addr_a.version, ==, 4);
+    g_assert_cmpuint(flow.addr_b.version, ==, 0);
+    g_assert_cmpint(flow.proto, ==, -1);
+    g_assert_cmpint(flow.port_a, ==, -1);
+    g_assert_cmpint(flow.port_b, ==, -1);
+
+    g_assert_true(flow_index_parse_flow("2001:db8::1,*,TCP,*,443", &flow));
+    g_assert_cmpuint(flow.addr_a.version, ==, 6);
+    g_assert_cmpuint(flow.addr_b.version, ==, 0);
+    g_assert_cmpint(flow.proto, ==, 6);
+    g_assert_cmpint(flow.port_a, ==, -1);
+    g_assert_cmpint(flow.port_b, ==, 443);
+
+    g_assert_true(flow_index_parse_flow("192.0.2.1,198.51.100.7,132,0,65535", &flow));
+    g_assert_cmpuint(flow.addr_b.version, ==, 4);
+    g_assert_cmpint(flow.proto, ==, 132);
+    g_assert_cmpint(flow.port_a, ==, 0);
+    g_assert_cmpint(flow.port_b, ==, 65535);
+
+    /* No first address, mixed versions, unknown protocol, bad ports,
+       and too many fields */
+    g_assert_false(flow_index_parse_flow("*", &flow));
+    g_assert_false(flow_index_parse_flow("192.0.2.1,2001:db8::1", &flow));
+    g_assert_false(flow_index_parse_flow("192.0.2.1,*,icmp", &flow));
+    g_assert_false(flow_index_parse_flow("192.0.2.1,*,256", &flow));
+    g_assert_false(flow_index_parse_flow("192.0.2.1,*,udp,65536", &flow));
+    g_assert_false(flow_index_parse_flow("192.0.2.1,*,udp,53,http", &flow));
+    g_assert_false(flow_index_parse_flow("192.0.2.1,*,udp,53,53,53", &flow));
+}
+
+int
+main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/flow_index/round_trip", flow_index_test_round_trip);
+    g_test_add_func("/flow_index/miss", flow_index_test_miss);
+    g_test_add_func("/flow_index/empty", flow_index_test_empty);
+    g_test_add_func("/flow_index/corrupt", flow_index_test_corrupt);
+    g_test_add_func("/flow_index/parse_address", flow_index_test_parse_address);
+    g_test_add_func("/flow_index/find_flow", flow_index_test_find_flow);
+    g_test_add_func("/flow_index/packet_in_flow", flow_index_test_packet_in_flow);
+    g_test_add_func("/flow_index/parse_flow", flow_index_test_parse_flow);
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
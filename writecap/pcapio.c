@@ -46,6 +46,7 @@
 #include <wsutil/epochs.h>
 #include <wsutil/file_util.h>
 #include <wsutil/file_compressed.h>
+#include <wsutil/ws_assert.h>
 #include <wsutil/ws_padding_to.h>
 
 #include "pcapio.h"
@@ -205,11 +206,24 @@ libpcap_write_packet(ws_cwstream* pfile,
                      uint64_t *bytes_written, int *err)
 {
     struct pcaprec_hdr rec_hdr;
+    uint8_t *buf;
 
     rec_hdr.ts_sec = (uint32_t)sec; /* Y2.038K issue in pcap format.... */
     rec_hdr.ts_usec = usec;
     rec_hdr.incl_len = caplen;
     rec_hdr.orig_len = len;
+
+    /* Put the whole record in the stream's buffer, if we can. */
+    buf = ws_cwstream_reserve(pfile, sizeof(rec_hdr) + caplen, err);
+    if (buf != NULL) {
+        memcpy(buf, &rec_hdr, sizeof(rec_hdr));
+        memcpy(buf + sizeof(rec_hdr), pd, caplen);
+        ws_cwstream_commit(pfile, sizeof(rec_hdr) + caplen, bytes_written);
+        return true;
+    }
+    if (*err != 0)
+        return false;
+
     if (!ws_cwstream_write(pfile, (const uint8_t*)&rec_hdr, sizeof(rec_hdr), bytes_written, err))
         return false;
 
@@ -262,6 +276,32 @@ pcapng_write_string_option(ws_cwstream* pfile,
     return true;
 }
 
+/* Like pcapng_write_string_option(), but put the option at p, with room
+   for pcapng_count_string_option() bytes; returns the end of it. */
+static uint8_t *
+pcapng_fill_string_option(uint8_t *p, uint16_t option_type, const char *option_value)
+{
+    size_t option_value_length;
+    struct ws_option_tlv option;
+    unsigned option_padding_length;
+
+    if (option_value == NULL)
+        return p; /* nothing to write */
+    option_value_length = strlen(option_value);
+    if ((option_value_length > 0) && (option_value_length < UINT16_MAX)) {
+        option.type = option_type;
+        option.value_length = (uint16_t)option_value_length;
+        memcpy(p, &option, sizeof(struct ws_option_tlv));
+        p += sizeof(struct ws_option_tlv);
+        memcpy(p, option_value, option_value_length);
+        p += option_value_length;
+        option_padding_length = WS_PADDING_TO_4(option_value_length);
+        memset(p, 0, option_padding_length);
+        p += option_padding_length;
+    }
+    return p;
+}
+
 /* Write a pre-formatted pcapng block directly to the output file */
 bool
 pcapng_write_block(ws_cwstream* pfile,
@@ -547,6 +587,7 @@ pcapng_write_enhanced_packet_block(ws_cwstream* pfile,
     uint8_t buff[8];
     uint8_t i;
     uint8_t pad_len;
+    uint8_t *buf;
 
     block_total_length = (uint32_t)(sizeof(struct epb) +
                                     ADD_PADDING(caplen) +
@@ -570,6 +611,47 @@ pcapng_write_enhanced_packet_block(ws_cwstream* pfile,
     epb.timestamp_low = (uint32_t)(timestamp & 0xffffffff);
     epb.captured_len = caplen;
     epb.packet_len = len;
+
+    /*
+     * Assemble the whole block in the stream's buffer, if we can, rather
+     * than writing the header, data, padding, options, and trailer one
+     * at a time.
+     */
+    buf = ws_cwstream_reserve(pfile, block_total_length, err);
+    if (buf != NULL) {
+        uint8_t *p = buf;
+
+        memcpy(p, &epb, sizeof(struct epb));
+        p += sizeof(struct epb);
+        memcpy(p, pd, caplen);
+        p += caplen;
+        pad_len = WS_PADDING_TO_4(caplen);
+        memset(p, 0, pad_len);
+        p += pad_len;
+        p = pcapng_fill_string_option(p, OPT_COMMENT, comment);
+        if (flags != 0) {
+            option.type = EPB_FLAGS;
+            option.value_length = sizeof(uint32_t);
+            memcpy(p, &option, sizeof(struct ws_option_tlv));
+            p += sizeof(struct ws_option_tlv);
+            memcpy(p, &flags, sizeof(uint32_t));
+            p += sizeof(uint32_t);
+        }
+        if (options_length != 0) {
+            option.type = OPT_ENDOFOPT;
+            option.value_length = 0;
+            memcpy(p, &option, sizeof(struct ws_option_tlv));
+            p += sizeof(struct ws_option_tlv);
+        }
+        memcpy(p, &block_total_length, sizeof(uint32_t));
+        p += sizeof(uint32_t);
+        ws_assert((uint32_t)(p - buf) == block_total_length);
+        ws_cwstream_commit(pfile, block_total_length, bytes_written);
+        return true;
+    }
+    if (*err != 0)
+        return false;
+
     if (!ws_cwstream_write(pfile, (const uint8_t*)&epb, sizeof(struct epb), bytes_written, err))
         return false;
     if (!ws_cwstream_write(pfile, pd, caplen, bytes_written, err))
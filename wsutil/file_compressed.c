@@ -14,8 +14,10 @@
 #include <config.h>
 
 #include <errno.h>
+#include <string.h>
 
 #include <wsutil/file_util.h>
+#include <wsutil/ws_assert.h>
 #include <wsutil/zlib_compat.h>
 
 #ifdef HAVE_LZ4FRAME_H
@@ -151,8 +153,51 @@ struct ws_cwstream {
     WFILE_T fh;
     char* io_buffer;
     ws_compression_type ctype;
+    size_t io_buffer_size;      /* Size of io_buffer; 0 if compressing */
+    size_t io_buffer_len;       /* Bytes in io_buffer not yet written */
 };
 
+/*
+ * Uncompressed output is collected in our own buffer, rather than in
+ * the stdio buffer, so that callers can assemble data in place with
+ * ws_cwstream_reserve(); the stream is unbuffered, so each flush of our
+ * buffer is a single write.
+ */
+static void
+writecap_file_set_buffer(ws_cwstream* pfile, FILE *fh, size_t buffsize)
+{
+    pfile->io_buffer = (char *)g_malloc(buffsize);
+    pfile->io_buffer_size = buffsize;
+    pfile->io_buffer_len = 0;
+    setvbuf(fh, NULL, _IONBF, 0);
+}
+
+static bool
+writecap_file_fwrite(FILE *fh, const uint8_t* data, size_t data_length, int *err)
+{
+    if (fwrite(data, data_length, 1, fh) != 1) {
+        if (ferror(fh)) {
+            *err = errno;
+        } else {
+            *err = FILE_ERR_SHORT_WRITE;
+        }
+        return false;
+    }
+    return true;
+}
+
+static bool
+writecap_file_write_buffer(ws_cwstream* pfile, int *err)
+{
+    size_t len = pfile->io_buffer_len;
+
+    if (len == 0) {
+        return true;
+    }
+    pfile->io_buffer_len = 0;
+    return writecap_file_fwrite((FILE *)pfile->fh, (const uint8_t *)pfile->io_buffer, len, err);
+}
+
 static WFILE_T
 writecap_file_open(ws_cwstream* pfile, const char *filename)
 {
@@ -182,8 +227,7 @@ writecap_file_open(ws_cwstream* pfile, const char *filename)
                     }
                 }
 #endif
-                pfile->io_buffer = (char *)g_malloc(buffsize);
-                setvbuf(fh, pfile->io_buffer, _IOFBF, buffsize);
+                writecap_file_set_buffer(pfile, fh, buffsize);
                 //ws_debug("buffsize %zu", buffsize);
             }
             return fh;
@@ -219,8 +263,7 @@ writecap_file_fdopen(ws_cwstream* pfile, int fd)
                     }
                 }
 #endif
-                pfile->io_buffer = (char *)g_malloc(buffsize);
-                setvbuf(fh, pfile->io_buffer, _IOFBF, buffsize);
+                writecap_file_set_buffer(pfile, fh, buffsize);
                 //ws_debug("buffsize %zu", buffsize);
             }
             return fh;
@@ -317,7 +360,9 @@ bool
 ws_cwstream_write(ws_cwstream* pfile, const uint8_t* data, size_t data_length,
                   uint64_t *bytes_written, int *err)
 {
+#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_LZ4FRAME_H)
     size_t nwritten;
+#endif
 
     switch (pfile->ctype) {
 #if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
@@ -345,14 +390,19 @@ ws_cwstream_write(ws_cwstream* pfile, const uint8_t* data, size_t data_length,
             break;
 #endif /* HAVE_LZ4FRAME_H */
         default:
-            nwritten = fwrite(data, data_length, 1, pfile->fh);
-            if (nwritten != 1) {
-                if (ferror((FILE *)pfile->fh)) {
-                    *err = errno;
-                } else {
-                    *err = FILE_ERR_SHORT_WRITE;
+            if (pfile->io_buffer_len + data_length > pfile->io_buffer_size) {
+                if (!writecap_file_write_buffer(pfile, err)) {
+                    return false;
                 }
-                return false;
+            }
+            if (data_length >= pfile->io_buffer_size) {
+                /* Too big to be worth copying. */
+                if (!writecap_file_fwrite((FILE *)pfile->fh, data, data_length, err)) {
+                    return false;
+                }
+            } else {
+                memcpy(pfile->io_buffer + pfile->io_buffer_len, data, data_length);
+                pfile->io_buffer_len += data_length;
             }
             break;
     }
@@ -361,9 +411,51 @@ ws_cwstream_write(ws_cwstream* pfile, const uint8_t* data, size_t data_length,
     return true;
 }
 
+uint8_t *
+ws_cwstream_reserve(ws_cwstream* pfile, size_t length, int *err)
+{
+    *err = 0;
+    if (length > pfile->io_buffer_size) {
+        /* Compressing, or too big for the buffer. */
+        return NULL;
+    }
+    if (pfile->io_buffer_len + length > pfile->io_buffer_size) {
+        if (!writecap_file_write_buffer(pfile, err)) {
+            return NULL;
+        }
+    }
+    return (uint8_t *)pfile->io_buffer + pfile->io_buffer_len;
+}
+
+void
+ws_cwstream_commit(ws_cwstream* pfile, size_t length, uint64_t *bytes_written)
+{
+    ws_assert(pfile->io_buffer_len + length <= pfile->io_buffer_size);
+    pfile->io_buffer_len += length;
+    (*bytes_written) += length;
+}
+
+bool
+ws_cwstream_set_buffer_size(ws_cwstream* pfile, size_t size, int *err)
+{
+    *err = 0;
+    if (pfile->io_buffer_size == 0 || size <= pfile->io_buffer_size) {
+        return true;
+    }
+    if (!writecap_file_write_buffer(pfile, err)) {
+        return false;
+    }
+    g_free(pfile->io_buffer);
+    pfile->io_buffer = (char *)g_malloc(size);
+    pfile->io_buffer_size = size;
+    return true;
+}
+
 bool
 ws_cwstream_flush(ws_cwstream* pfile, int *err)
 {
+    int write_err;
+
     switch (pfile->ctype) {
 #if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
         case WS_FILE_GZIP_COMPRESSED:
@@ -386,6 +478,12 @@ ws_cwstream_flush(ws_cwstream* pfile, int *err)
             break;
 #endif /* HAVE_LZ4FRAME_H */
         default:
+            if (!writecap_file_write_buffer(pfile, &write_err)) {
+                if (err) {
+                    *err = write_err;
+                }
+                return false;
+            }
             if (fflush((FILE*)pfile->fh) == EOF) {
                 if (err) {
                     *err = errno;
@@ -414,7 +512,8 @@ ws_cwstream_close(ws_cwstream* pfile, int *errp)
             break;
 #endif /* HAVE_LZ4FRAME_H */
         default:
-            if (fclose(pfile->fh) == EOF) {
+            writecap_file_write_buffer(pfile, &err);
+            if (fclose(pfile->fh) == EOF && err == 0) {
                 err = errno;
             }
             break;
@@ -165,6 +165,50 @@ WS_DLL_PUBLIC bool
 ws_cwstream_write(ws_cwstream* pfile, const uint8_t* data, size_t data_length,
                   uint64_t *bytes_written, int *err);
 
+/**
+ * @brief Gets room to assemble data in place in the stream's write buffer.
+ *
+ * This lets a caller build a record from several pieces contiguously and
+ * add it with one ws_cwstream_commit(), rather than with one
+ * ws_cwstream_write() call per piece. Only uncompressed streams have a
+ * buffer of their own; compressed streams use the compressor's buffer.
+ *
+ * @param pfile Pointer to the writable stream.
+ * @param length Number of bytes needed.
+ * @param err Set to 0 if there's no room because the stream has no
+ * buffer or length is larger than the buffer, or to an error code if
+ * writing out the buffer to make room failed.
+ * @return Where to put the data, or NULL if there's no room; the caller
+ * should then use ws_cwstream_write(), if err is 0.
+ */
+WS_DLL_PUBLIC uint8_t*
+ws_cwstream_reserve(ws_cwstream* pfile, size_t length, int *err);
+
+/**
+ * @brief Adds data assembled in the space returned by ws_cwstream_reserve().
+ *
+ * @param pfile Pointer to the writable stream.
+ * @param length Number of bytes to add; no more than were reserved.
+ * @param bytes_written Incremented by length.
+ */
+WS_DLL_PUBLIC void
+ws_cwstream_commit(ws_cwstream* pfile, size_t length, uint64_t *bytes_written);
+
+/**
+ * @brief Enlarges the write buffer of an uncompressed stream.
+ *
+ * Data is written to the file when the buffer fills up or the stream is
+ * flushed, so a larger buffer means fewer, larger writes. Does nothing
+ * for a compressed stream, or if the buffer is already at least that big.
+ *
+ * @param pfile Pointer to the writable stream.
+ * @param size The new size of the buffer, in bytes.
+ * @param err Set to an error code if writing out the buffer failed.
+ * @return true on success, false and sets err on failure.
+ */
+WS_DLL_PUBLIC bool
+ws_cwstream_set_buffer_size(ws_cwstream* pfile, size_t size, int *err);
+
 /**
  * @brief Flushes the compressed writable stream.
  *
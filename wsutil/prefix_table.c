@@ -0,0 +1,348 @@
+/* prefix_table.c
+ * Longest-prefix-match tables for IPv4 and IPv6 addresses
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#include "prefix_table.h"
+
+/*
+ * Addresses of either length are handled as 128-bit keys, with IPv4
+ * addresses in the top 32 bits.
+ */
+typedef struct {
+    uint64_t hi;
+    uint64_t lo;
+} pt_key;
+
+/* A prefix as inserted. */
+typedef struct {
+    pt_key    start;        /* first address the prefix covers */
+    pt_key    end;          /* last address it covers */
+    unsigned  prefix_len;
+    unsigned  order;        /* insertion order, so that the first duplicate wins */
+    void     *value;
+} pt_prefix;
+
+/* A range of addresses that all match the same prefix, or none. */
+typedef struct {
+    pt_key    start;        /* the range runs up to the next range's start */
+    void     *value;        /* NULL if no prefix covers the range */
+    unsigned  prefix_len;
+} pt_range;
+
+/* Tables with more ranges than this get an index by the top 16 bits. */
+#define PT_INDEX_MIN_RANGES 64
+#define PT_INDEX_BUCKETS    65536
+
+struct _ws_prefix_table {
+    unsigned   addr_len;
+    GArray    *prefixes;        /* pt_prefix, in insertion order */
+    bool       built;
+    unsigned   num_prefixes;    /* distinct prefixes, once built */
+    pt_range  *ranges;
+    unsigned   num_ranges;
+    uint32_t  *index;           /* first range in each bucket, PT_INDEX_BUCKETS + 1 entries */
+};
+
+static inline pt_key
+pt_key_from_addr(const ws_prefix_table *table, const uint8_t *addr)
+{
+    pt_key key = { 0, 0 };
+
+    for (unsigned i = 0; i < table->addr_len; i++) {
+        if (i < 8) {
+            key.hi |= (uint64_t)addr[i] << (56 - 8 * i);
+        } else {
+            key.lo |= (uint64_t)addr[i] << (56 - 8 * (i - 8));
+        }
+    }
+    return key;
+}
+
+static inline int
+pt_key_cmp(const pt_key *a, const pt_key *b)
+{
+    if (a->hi != b->hi) {
+        return a->hi < b->hi ? -1 : 1;
+    }
+    if (a->lo != b->lo) {
+        return a->lo < b->lo ? -1 : 1;
+    }
+    return 0;
+}
+
+static inline bool
+pt_key_is_max(const pt_key *key)
+{
+    return key->hi == UINT64_MAX && key->lo == UINT64_MAX;
+}
+
+static inline pt_key
+pt_key_next(pt_key key)
+{
+    key.lo++;
+    if (key.lo == 0) {
+        key.hi++;
+    }
+    return key;
+}
+
+ws_prefix_table *
+ws_prefix_table_new(unsigned addr_len)
+{
+    ws_prefix_table *table;
+
+    ws_assert(addr_len == 4 || addr_len == 16);
+    table = g_new0(ws_prefix_table, 1);
+    table->addr_len = addr_len;
+    table->prefixes = g_array_new(false, false, sizeof(pt_prefix));
+    return table;
+}
+
+static void
+pt_clear_ranges(ws_prefix_table *table)
+{
+    g_free(table->ranges);
+    table->ranges = NULL;
+    table->num_ranges = 0;
+    g_free(table->index);
+    table->index = NULL;
+    table->built = false;
+}
+
+void
+ws_prefix_table_free(ws_prefix_table *table)
+{
+    if (table == NULL) {
+        return;
+    }
+    pt_clear_ranges(table);
+    g_array_free(table->prefixes, true);
+    g_free(table);
+}
+
+void
+ws_prefix_table_insert(ws_prefix_table *table, const uint8_t *addr,
+                       unsigned prefix_len, void *value)
+{
+    pt_prefix prefix;
+    pt_key mask;
+
+    ws_assert(prefix_len <= table->addr_len * 8);
+    ws_assert(value != NULL);
+
+    mask.hi = prefix_len == 0 ? 0 : prefix_len >= 64 ? UINT64_MAX : UINT64_MAX << (64 - prefix_len);
+    mask.lo = prefix_len <= 64 ? 0 : prefix_len >= 128 ? UINT64_MAX : UINT64_MAX << (128 - prefix_len);
+
+    prefix.start = pt_key_from_addr(table, addr);
+    prefix.start.hi &= mask.hi;
+    prefix.start.lo &= mask.lo;
+    prefix.end.hi = prefix.start.hi | ~mask.hi;
+    prefix.end.lo = prefix.start.lo | ~mask.lo;
+    prefix.prefix_len = prefix_len;
+    prefix.order = table->prefixes->len;
+    prefix.value = value;
+    g_array_append_val(table->prefixes, prefix);
+
+    pt_clear_ranges(table);
+}
+
+/* Outer prefixes sort before the prefixes nested in them. */
+static int
+pt_prefix_cmp(const void *a, const void *b)
+{
+    const pt_prefix *prefix_a = (const pt_prefix *)a;
+    const pt_prefix *prefix_b = (const pt_prefix *)b;
+    int ret;
+
+    ret = pt_key_cmp(&prefix_a->start, &prefix_b->start);
+    if (ret != 0) {
+        return ret;
+    }
+    if (prefix_a->prefix_len != prefix_b->prefix_len) {
+        return prefix_a->prefix_len < prefix_b->prefix_len ? -1 : 1;
+    }
+    return prefix_a->order < prefix_b->order ? -1 : prefix_a->order > prefix_b->order;
+}
+
+/* Start a new range, or change the one that starts at the same address. */
+static void
+pt_emit(GArray *ranges, pt_key start, const pt_prefix *prefix)
+{
+    pt_range range;
+
+    range.start = start;
+    range.value = prefix ? prefix->value : NULL;
+    range.prefix_len = prefix ? prefix->prefix_len : 0;
+
+    if (ranges->len > 0) {
+        pt_range *last = &g_array_index(ranges, pt_range, ranges->len - 1);
+
+        if (pt_key_cmp(&last->start, &start) == 0) {
+            g_array_remove_index(ranges, ranges->len - 1);
+            if (ranges->len > 0) {
+                last = &g_array_index(ranges, pt_range, ranges->len - 1);
+            } else {
+                last = NULL;
+            }
+        }
+        /* Don't split a range that doesn't change. */
+        if (last != NULL && last->value == range.value && last->prefix_len == range.prefix_len) {
+            return;
+        }
+    }
+    g_array_append_val(ranges, range);
+}
+
+/*
+ * Flatten the prefixes into ranges. Two prefixes are either disjoint or
+ * one contains the other, so with the prefixes sorted, a stack of the
+ * ones containing the current address gives the longest match at each
+ * point where a prefix starts or ends.
+ */
+static void
+pt_build(ws_prefix_table *table)
+{
+    GArray *ranges;
+    GPtrArray *stack;
+    const pt_prefix *prev = NULL;
+    pt_key zero = { 0, 0 };
+
+    pt_clear_ranges(table);
+    g_array_sort(table->prefixes, pt_prefix_cmp);
+
+    ranges = g_array_new(false, false, sizeof(pt_range));
+    stack = g_ptr_array_new();
+    table->num_prefixes = 0;
+    pt_emit(ranges, zero, NULL);
+
+    for (unsigned i = 0; i < table->prefixes->len; i++) {
+        const pt_prefix *prefix = &g_array_index(table->prefixes, pt_prefix, i);
+
+        if (prev != NULL && prev->prefix_len == prefix->prefix_len &&
+                pt_key_cmp(&prev->start, &prefix->start) == 0) {
+            continue;   /* a duplicate */
+        }
+        prev = prefix;
+        table->num_prefixes++;
+
+        while (stack->len > 0) {
+            const pt_prefix *top = (const pt_prefix *)g_ptr_array_index(stack, stack->len - 1);
+
+            if (pt_key_cmp(&top->end, &prefix->start) >= 0) {
+                break;
+            }
+            g_ptr_array_set_size(stack, stack->len - 1);
+            pt_emit(ranges, pt_key_next(top->end),
+                    stack->len > 0 ? (const pt_prefix *)g_ptr_array_index(stack, stack->len - 1) : NULL);
+        }
+        pt_emit(ranges, prefix->start, prefix);
+        g_ptr_array_add(stack, (void *)prefix);
+    }
+    while (stack->len > 0) {
+        const pt_prefix *top = (const pt_prefix *)g_ptr_array_index(stack, stack->len - 1);
+
+        g_ptr_array_set_size(stack, stack->len - 1);
+        if (!pt_key_is_max(&top->end)) {
+            pt_emit(ranges, pt_key_next(top->end),
+                    stack->len > 0 ? (const pt_prefix *)g_ptr_array_index(stack, stack->len - 1) : NULL);
+        }
+    }
+    g_ptr_array_free(stack, true);
+
+    table->num_ranges = ranges->len;
+    table->ranges = (pt_range *)(void *)g_array_free(ranges, false);
+
+    if (table->num_ranges > PT_INDEX_MIN_RANGES) {
+        unsigned r = 0;
+
+        table->index = g_new(uint32_t, PT_INDEX_BUCKETS + 1);
+        for (unsigned bucket = 0; bucket <= PT_INDEX_BUCKETS; bucket++) {
+            while (r < table->num_ranges && (table->ranges[r].start.hi >> 48) < bucket) {
+                r++;
+            }
+            table->index[bucket] = r;
+        }
+    }
+    table->built = true;
+}
+
+void
+ws_prefix_table_build(ws_prefix_table *table)
+{
+    if (!table->built) {
+        pt_build(table);
+    }
+}
+
+void *
+ws_prefix_table_lookup(ws_prefix_table *table, const uint8_t *addr, unsigned *prefix_len)
+{
+    pt_key key;
+    unsigned lo, hi;
+    const pt_range *range;
+
+    if (!table->built) {
+        pt_build(table);
+    }
+
+    key = pt_key_from_addr(table, addr);
+    lo = 0;
+    hi = table->num_ranges;
+    if (table->index != NULL) {
+        unsigned bucket = (unsigned)(key.hi >> 48);
+
+        lo = table->index[bucket];
+        hi = table->index[bucket + 1];
+        /* The first range starts at 0, so it's in bucket 0. */
+        if (lo == hi || pt_key_cmp(&table->ranges[lo].start, &key) > 0) {
+            lo--;
+            hi = lo + 1;
+        }
+    }
+
+    /* Find the last range that starts at or before the address. */
+    while (hi - lo > 1) {
+        unsigned mid = lo + (hi - lo) / 2;
+
+        if (pt_key_cmp(&table->ranges[mid].start, &key) <= 0) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    range = &table->ranges[lo];
+    if (prefix_len != NULL) {
+        *prefix_len = range->prefix_len;
+    }
+    return range->value;
+}
+
+unsigned
+ws_prefix_table_count(ws_prefix_table *table)
+{
+    if (!table->built) {
+        pt_build(table);
+    }
+    return table->num_prefixes;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,99 @@
+/** @file
+ *
+ * Longest-prefix-match tables for IPv4 and IPv6 addresses.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_PREFIX_TABLE_H__
+#define __WS_PREFIX_TABLE_H__
+
+#include <wireshark.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** A table of address prefixes, each with a value, in which an address
+ * can be looked up to find the longest prefix that matches it.
+ *
+ * Prefixes are collected with ws_prefix_table_insert(). On the first
+ * lookup after that, the table is flattened into a sorted array of
+ * disjoint address ranges, each with the value of the longest prefix
+ * covering it, plus an index by the first 16 bits of the address. A
+ * lookup is then a binary search within one index bucket, in contiguous
+ * memory, whatever the number and lengths of the prefixes.
+ */
+typedef struct _ws_prefix_table ws_prefix_table;
+
+/**
+ * @brief Create an empty prefix table.
+ *
+ * @param addr_len The length of the addresses, in bytes: 4 for IPv4,
+ * 16 for IPv6.
+ * @return The table, to be freed with ws_prefix_table_free().
+ */
+WS_DLL_PUBLIC ws_prefix_table *ws_prefix_table_new(unsigned addr_len);
+
+/**
+ * @brief Free a prefix table.
+ *
+ * The values are not freed.
+ *
+ * @param table The table; may be NULL.
+ */
+WS_DLL_PUBLIC void ws_prefix_table_free(ws_prefix_table *table);
+
+/**
+ * @brief Add a prefix to a table.
+ *
+ * Bits of the address beyond the prefix length are ignored. If the
+ * same prefix is added more than once, the first value is kept.
+ *
+ * @param table The table.
+ * @param addr The address, in network byte order, addr_len bytes long.
+ * @param prefix_len The prefix length, from 0 to 8 * addr_len.
+ * @param value The value; must not be NULL.
+ */
+WS_DLL_PUBLIC void ws_prefix_table_insert(ws_prefix_table *table, const uint8_t *addr,
+                                          unsigned prefix_len, void *value);
+
+/**
+ * @brief Flatten a table for lookups now, rather than on the next lookup.
+ *
+ * Lookups don't change a built table, so they can then be made from
+ * several threads.
+ *
+ * @param table The table.
+ */
+WS_DLL_PUBLIC void ws_prefix_table_build(ws_prefix_table *table);
+
+/**
+ * @brief Find the longest prefix in a table that matches an address.
+ *
+ * @param table The table.
+ * @param addr The address, in network byte order, addr_len bytes long.
+ * @param[out] prefix_len If not NULL, set to the length of the prefix
+ * that matched, or 0 if none did.
+ * @return The value of the prefix that matched, or NULL if none did.
+ */
+WS_DLL_PUBLIC void *ws_prefix_table_lookup(ws_prefix_table *table, const uint8_t *addr,
+                                           unsigned *prefix_len);
+
+/**
+ * @brief Get the number of distinct prefixes in a table.
+ *
+ * @param table The table.
+ * @return The number of prefixes.
+ */
+WS_DLL_PUBLIC unsigned ws_prefix_table_count(ws_prefix_table *table);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_PREFIX_TABLE_H__ */
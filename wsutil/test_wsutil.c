@@ -1265,6 +1265,357 @@ static void test_ws_hexbuftoi64(void)
     test_int64(hexstr, 2, &hexstr[1], 16, true, 0, 0);
     test_int64(hexstr, 2, &hexstr[1], 0, true, 0, 0);
 }
+#include "ws_mempbrk.h"
+
+static const uint8_t *
+naive_mempbrk(const uint8_t *haystack, size_t haystacklen, const char *needles)
+{
+    for (size_t i = 0; i < haystacklen; i++) {
+        if (haystack[i] != '\0' && strchr(needles, haystack[i]))
+            return haystack + i;
+    }
+    return NULL;
+}
+
+static void test_mempbrk(void)
+{
+    static const char *needle_sets[] = { "\n", "\r\n", "\r\n\"", " \t\r\n", "<>&;\"=", "\x80\xff" };
+    ws_mempbrk_pattern pattern;
+    uint8_t buf[300];
+    const uint8_t *want, *have;
+    unsigned char found;
+
+    for (size_t n = 0; n < G_N_ELEMENTS(needle_sets); n++) {
+        ws_mempbrk_compile(&pattern, needle_sets[n]);
+
+        /* Mostly NULs and letters, so that we also cover the case that
+         * makes the SSE 4.2 scanner give up. */
+        for (int iter = 0; iter < 2000; iter++) {
+            size_t len = (size_t)g_test_rand_int_range(0, (int)sizeof buf);
+            size_t start = (size_t)g_test_rand_int_range(0, 33);
+
+            if (start > len)
+                start = len;
+            for (size_t i = 0; i < len; i++) {
+                int r = g_test_rand_int_range(0, 1000);
+                if (r < 3)
+                    buf[i] = (uint8_t)needle_sets[n][g_test_rand_int_range(0, (int)strlen(needle_sets[n]))];
+                else if (r < 500)
+                    buf[i] = '\0';
+                else
+                    buf[i] = (uint8_t)g_test_rand_int_range('a', 'z' + 1);
+            }
+
+            want = naive_mempbrk(buf + start, len - start, needle_sets[n]);
+            found = 0;
+            have = ws_mempbrk_exec(buf + start, len - start, &pattern, &found);
+            g_assert_true(have == want);
+            if (want)
+                g_assert_cmpint(found, ==, *want);
+        }
+    }
+}
+
+static void test_mempbrk_perf(void)
+{
+#define MEMPBRK_BUF_LEN (64 * 1024)
+#define MEMPBRK_LOOP_COUNT 20000
+    ws_mempbrk_pattern pattern;
+    uint8_t *buf;
+    const uint8_t *res;
+    int i;
+    double start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    /* A long header line with the terminator at the very end. */
+    buf = g_malloc(MEMPBRK_BUF_LEN);
+    memset(buf, 'x', MEMPBRK_BUF_LEN);
+    buf[MEMPBRK_BUF_LEN - 2] = '\r';
+    buf[MEMPBRK_BUF_LEN - 1] = '\n';
+    ws_mempbrk_compile(&pattern, "\r\n\"");
+
+    RESOURCE_USAGE_START;
+    for (i = 0; i < MEMPBRK_LOOP_COUNT; i++) {
+        res = ws_mempbrk_exec(buf, MEMPBRK_BUF_LEN, &pattern, NULL);
+        g_assert_true(res == buf + MEMPBRK_BUF_LEN - 2);
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "ws_mempbrk_exec(): u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    RESOURCE_USAGE_START;
+    for (i = 0; i < MEMPBRK_LOOP_COUNT; i++) {
+        res = naive_mempbrk(buf, MEMPBRK_BUF_LEN, "\r\n\"");
+        g_assert_true(res == buf + MEMPBRK_BUF_LEN - 2);
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "scalar scan: u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    g_free(buf);
+}
+
+#include "uint_index.h"
+
+/* Check every key up to max_key, and a few beyond, against the table. */
+static void check_uint_index(const ws_uint_index *idx, GHashTable *table, uint32_t max_key)
+{
+    for (uint32_t key = 0; key <= max_key; key++) {
+        g_assert_true(ws_uint_index_lookup(idx, key) == g_hash_table_lookup(table, GUINT_TO_POINTER(key)));
+    }
+    g_assert_true(ws_uint_index_lookup(idx, max_key + 1) == g_hash_table_lookup(table, GUINT_TO_POINTER(max_key + 1)));
+    g_assert_true(ws_uint_index_lookup(idx, UINT32_MAX) == g_hash_table_lookup(table, GUINT_TO_POINTER(UINT32_MAX)));
+}
+
+static void test_uint_index(void)
+{
+    ws_uint_index idx;
+    GHashTable *table;
+    int i;
+
+    table = g_hash_table_new(g_direct_hash, g_direct_equal);
+    ws_uint_index_init(&idx);
+    g_assert_null(ws_uint_index_lookup(&idx, 0));
+
+    /* Empty table. */
+    ws_uint_index_build(&idx, table);
+    g_assert_null(ws_uint_index_lookup(&idx, 0));
+    g_assert_null(ws_uint_index_lookup(&idx, UINT32_MAX));
+
+    /* Small keys, like IP protocol numbers, are indexed directly. */
+    for (i = 0; i < 256; i += 3) {
+        g_hash_table_insert(table, GUINT_TO_POINTER(i), GINT_TO_POINTER(i + 1));
+    }
+    ws_uint_index_build(&idx, table);
+    g_assert_nonnull(idx.direct);
+    g_assert_null(idx.slots);
+    check_uint_index(&idx, table, 65535);
+
+    /* Sparse keys, like port numbers, use open addressing. */
+    for (i = 0; i < 1500; i++) {
+        uint32_t key = (uint32_t)g_test_rand_int_range(0, 65536);
+        g_hash_table_insert(table, GUINT_TO_POINTER(key), GINT_TO_POINTER(i + 1));
+    }
+    g_hash_table_insert(table, GUINT_TO_POINTER(UINT32_MAX), GINT_TO_POINTER(1));
+    ws_uint_index_build(&idx, table);
+    g_assert_null(idx.direct);
+    g_assert_nonnull(idx.slots);
+    check_uint_index(&idx, table, 65535);
+
+    /* Rebuilding follows removals. */
+    g_hash_table_remove(table, GUINT_TO_POINTER(UINT32_MAX));
+    g_hash_table_remove(table, GUINT_TO_POINTER(0));
+    ws_uint_index_build(&idx, table);
+    check_uint_index(&idx, table, 65535);
+
+    ws_uint_index_clear(&idx);
+    g_assert_null(ws_uint_index_lookup(&idx, 3));
+    g_hash_table_destroy(table);
+}
+
+static void test_uint_index_perf(void)
+{
+#define UINT_INDEX_KEYS 1500
+#define UINT_INDEX_LOOKUPS 4096
+#define UINT_INDEX_LOOP_COUNT 2000
+    ws_uint_index idx;
+    GHashTable *table;
+    uint32_t *lookups;
+    unsigned found;
+    int i, j;
+    double start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    /* About as many keys as the tcp.port table has, looked up by source
+       and destination port, most of which aren't in the table. */
+    table = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (i = 0; i < UINT_INDEX_KEYS; i++) {
+        uint32_t key = (uint32_t)g_test_rand_int_range(0, 65536);
+        g_hash_table_insert(table, GUINT_TO_POINTER(key), GINT_TO_POINTER(i + 1));
+    }
+    lookups = g_new(uint32_t, UINT_INDEX_LOOKUPS);
+    for (i = 0; i < UINT_INDEX_LOOKUPS; i++) {
+        lookups[i] = (uint32_t)g_test_rand_int_range(0, 65536);
+    }
+    ws_uint_index_init(&idx);
+    ws_uint_index_build(&idx, table);
+
+    found = 0;
+    RESOURCE_USAGE_START;
+    for (i = 0; i < UINT_INDEX_LOOP_COUNT; i++) {
+        for (j = 0; j < UINT_INDEX_LOOKUPS; j++) {
+            found += (uintptr_t)ws_uint_index_lookup(&idx, lookups[j]);
+        }
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "ws_uint_index_lookup(): u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    RESOURCE_USAGE_START;
+    for (i = 0; i < UINT_INDEX_LOOP_COUNT; i++) {
+        for (j = 0; j < UINT_INDEX_LOOKUPS; j++) {
+            found -= (uintptr_t)g_hash_table_lookup(table, GUINT_TO_POINTER(lookups[j]));
+        }
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "g_hash_table_lookup(): u %.3f ms s %.3f ms", utime_ms, stime_ms);
+    g_assert_cmpuint(found, ==, 0);
+
+    ws_uint_index_clear(&idx);
+    g_free(lookups);
+    g_hash_table_destroy(table);
+}
+
+#include "prefix_table.h"
+
+typedef struct {
+    uint8_t  addr[16];
+    unsigned prefix_len;
+} test_prefix;
+
+static bool prefix_matches(const test_prefix *prefix, const uint8_t *addr)
+{
+    for (unsigned bit = 0; bit < prefix->prefix_len; bit++) {
+        unsigned mask = 0x80 >> (bit % 8);
+
+        if ((prefix->addr[bit / 8] & mask) != (addr[bit / 8] & mask))
+            return false;
+    }
+    return true;
+}
+
+/* Random prefixes in a few /16s, so that many of them nest. */
+static void random_prefix(test_prefix *prefix, unsigned addr_len)
+{
+    for (unsigned i = 0; i < addr_len; i++) {
+        prefix->addr[i] = (uint8_t)(i < 2 ? g_test_rand_int_range(0, 4) : g_test_rand_int_range(0, 256));
+    }
+    prefix->prefix_len = (unsigned)g_test_rand_int_range(1, addr_len * 8 + 1);
+}
+
+static void check_prefix_table(unsigned addr_len, int num_prefixes)
+{
+    ws_prefix_table *table;
+    test_prefix *prefixes;
+    int i, j;
+
+    table = ws_prefix_table_new(addr_len);
+    prefixes = g_new0(test_prefix, num_prefixes);
+    for (i = 0; i < num_prefixes; i++) {
+        random_prefix(&prefixes[i], addr_len);
+        ws_prefix_table_insert(table, prefixes[i].addr, prefixes[i].prefix_len, &prefixes[i]);
+    }
+
+    for (j = 0; j < 2000; j++) {
+        test_prefix addr;
+        const test_prefix *best = NULL;
+        const test_prefix *found;
+        unsigned prefix_len;
+
+        random_prefix(&addr, addr_len);
+        for (i = 0; i < num_prefixes; i++) {
+            if (prefix_matches(&prefixes[i], addr.addr) &&
+                    (best == NULL || prefixes[i].prefix_len > best->prefix_len))
+                best = &prefixes[i];
+        }
+        found = (const test_prefix *)ws_prefix_table_lookup(table, addr.addr, &prefix_len);
+        if (best == NULL) {
+            g_assert_null(found);
+            g_assert_cmpuint(prefix_len, ==, 0);
+        } else {
+            g_assert_nonnull(found);
+            g_assert_cmpuint(prefix_len, ==, best->prefix_len);
+            g_assert_true(prefix_matches(found, addr.addr));
+        }
+    }
+
+    ws_prefix_table_free(table);
+    g_free(prefixes);
+}
+
+static void test_prefix_table(void)
+{
+    ws_prefix_table *table;
+    uint8_t addr[4];
+    unsigned prefix_len;
+    int net, host, dup, all;
+
+    /* Nesting, duplicates and the ends of the address space. */
+    table = ws_prefix_table_new(4);
+    g_assert_null(ws_prefix_table_lookup(table, (const uint8_t *)"\x0a\x00\x00\x01", NULL));
+    ws_prefix_table_insert(table, (const uint8_t *)"\x0a\x01\x02\x03", 8, &net);
+    ws_prefix_table_insert(table, (const uint8_t *)"\x0a\x00\x00\x01", 32, &host);
+    ws_prefix_table_insert(table, (const uint8_t *)"\x0a\x00\x00\x00", 8, &dup);
+    ws_prefix_table_insert(table, (const uint8_t *)"\xff\xff\xff\xff", 32, &host);
+    g_assert_cmpuint(ws_prefix_table_count(table), ==, 3);
+    g_assert_true(ws_prefix_table_lookup(table, (const uint8_t *)"\x0a\x00\x00\x01", &prefix_len) == &host);
+    g_assert_cmpuint(prefix_len, ==, 32);
+    g_assert_true(ws_prefix_table_lookup(table, (const uint8_t *)"\x0a\x00\x00\x02", &prefix_len) == &net);
+    g_assert_cmpuint(prefix_len, ==, 8);
+    g_assert_true(ws_prefix_table_lookup(table, (const uint8_t *)"\x0a\xff\xff\xff", NULL) == &net);
+    g_assert_null(ws_prefix_table_lookup(table, (const uint8_t *)"\x0b\x00\x00\x00", NULL));
+    g_assert_null(ws_prefix_table_lookup(table, (const uint8_t *)"\x00\x00\x00\x00", NULL));
+    g_assert_true(ws_prefix_table_lookup(table, (const uint8_t *)"\xff\xff\xff\xff", NULL) == &host);
+    ws_prefix_table_insert(table, (const uint8_t *)"\x00\x00\x00\x00", 0, &all);
+    memcpy(addr, "\xff\xff\xff\xfe", 4);
+    g_assert_true(ws_prefix_table_lookup(table, addr, &prefix_len) == &all);
+    g_assert_cmpuint(prefix_len, ==, 0);
+    ws_prefix_table_free(table);
+
+    /* Small tables, and ones large enough to be indexed. */
+    check_prefix_table(4, 10);
+    check_prefix_table(4, 3000);
+    check_prefix_table(16, 10);
+    check_prefix_table(16, 3000);
+}
+
+static void test_prefix_table_perf(void)
+{
+#define PREFIX_TABLE_PREFIXES 200000
+#define PREFIX_TABLE_LOOKUPS (1000 * 1000)
+    ws_prefix_table *table;
+    uint8_t *prefixes;
+    uint8_t addr[4];
+    unsigned found;
+    int i;
+    double start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    /* A network's worth of /16 to /30 subnets of 10.0.0.0/8. */
+    prefixes = g_malloc(PREFIX_TABLE_PREFIXES * 4);
+    table = ws_prefix_table_new(4);
+    RESOURCE_USAGE_START;
+    for (i = 0; i < PREFIX_TABLE_PREFIXES; i++) {
+        uint8_t *prefix = &prefixes[i * 4];
+
+        prefix[0] = 10;
+        prefix[1] = (uint8_t)g_test_rand_int_range(0, 256);
+        prefix[2] = (uint8_t)g_test_rand_int_range(0, 256);
+        prefix[3] = (uint8_t)g_test_rand_int_range(0, 256);
+        ws_prefix_table_insert(table, prefix, (unsigned)g_test_rand_int_range(16, 31), prefix);
+    }
+    ws_prefix_table_build(table);
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "ws_prefix_table_build(): u %.3f ms s %.3f ms", utime_ms, stime_ms);
+
+    found = 0;
+    RESOURCE_USAGE_START;
+    for (i = 0; i < PREFIX_TABLE_LOOKUPS; i++) {
+        addr[0] = 10;
+        addr[1] = (uint8_t)(i >> 16);
+        addr[2] = (uint8_t)(i >> 8);
+        addr[3] = (uint8_t)(i * 7);
+        if (ws_prefix_table_lookup(table, addr, NULL) != NULL)
+            found++;
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "ws_prefix_table_lookup(): u %.3f ms s %.3f ms", utime_ms, stime_ms);
+    g_assert_cmpuint(found, !=, 0);
+
+    ws_prefix_table_free(table);
+    g_free(prefixes);
+}
+
 int main(int argc, char **argv)
 {
     int ret;
@@ -1326,6 +1677,21 @@ int main(int argc, char **argv)
     g_test_add_func("/strtoi/basebuftoi64_end", test_ws_basebuftoi64_end);
     g_test_add_func("/strtoi/hexbuftoi64", test_ws_hexbuftoi64);
 
+    g_test_add_func("/ws_mempbrk/exec", test_mempbrk);
+    if (g_test_perf()) {
+        g_test_add_func("/ws_mempbrk/exec_perf", test_mempbrk_perf);
+    }
+
+    g_test_add_func("/uint_index/lookup", test_uint_index);
+    if (g_test_perf()) {
+        g_test_add_func("/uint_index/lookup_perf", test_uint_index_perf);
+    }
+
+    g_test_add_func("/prefix_table/lookup", test_prefix_table);
+    if (g_test_perf()) {
+        g_test_add_func("/prefix_table/lookup_perf", test_prefix_table_perf);
+    }
+
     g_test_add_func("/sap_lzclzh_decompress", test_sap_lzclzh_decompress);
     g_test_add_func("/sap_lzclzh_decompress/errors", test_sap_lzclzh_decompress_errors);
 
@@ -98,6 +98,17 @@ void ws_tzset(void);
 WS_DLL_PUBLIC
 struct timespec *ws_clock_get_realtime(struct timespec *ts);
 
+/**
+ * @brief Retrieves the value of a monotonic clock, in nanoseconds.
+ *
+ * The value has no meaning on its own; subtract two of them to time
+ * an interval too short for g_get_monotonic_time().
+ *
+ * @return The clock value, in nanoseconds.
+ */
+WS_DLL_PUBLIC
+uint64_t ws_clock_get_monotonic_ns(void);
+
 /**
  * @brief Converts a time value to local time.
  *
@@ -0,0 +1,111 @@
+/* uint_index.c
+ * A read-only map from 32-bit unsigned integers to pointers
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#include "uint_index.h"
+
+/*
+ * Keys below this are always indexed directly; that's every possible key
+ * of an 8-bit table, in 2 KiB on a 64-bit platform.
+ */
+#define UINT_INDEX_DIRECT_MIN   256
+
+void
+ws_uint_index_init(ws_uint_index *idx)
+{
+    idx->direct = NULL;
+    idx->direct_len = 0;
+    idx->slots = NULL;
+    idx->mask = 0;
+    idx->shift = 32;
+}
+
+void
+ws_uint_index_clear(ws_uint_index *idx)
+{
+    g_free(idx->direct);
+    g_free(idx->slots);
+    ws_uint_index_init(idx);
+}
+
+void
+ws_uint_index_build(ws_uint_index *idx, GHashTable *table)
+{
+    GHashTableIter iter;
+    void *key, *value;
+    unsigned count;
+    uint32_t max_key = 0;
+    uint32_t num_slots;
+    unsigned log2_slots;
+
+    ws_uint_index_clear(idx);
+
+    count = g_hash_table_size(table);
+    if (count == 0) {
+        return;
+    }
+
+    g_hash_table_iter_init(&iter, table);
+    while (g_hash_table_iter_next(&iter, &key, NULL)) {
+        if (GPOINTER_TO_UINT(key) > max_key) {
+            max_key = GPOINTER_TO_UINT(key);
+        }
+    }
+
+    /* At most half full, and at least 8 slots. */
+    for (log2_slots = 3; ((uint64_t)1 << log2_slots) < (uint64_t)count * 2; log2_slots++)
+        ;
+    num_slots = (uint32_t)1 << log2_slots;
+
+    /*
+     * Index directly if the keys are dense enough that the array is no
+     * more than twice the size of the open-addressing table would be
+     * (a slot holds a key as well as a pointer, so that's four array
+     * elements per slot).
+     */
+    if (max_key < UINT_INDEX_DIRECT_MIN || (uint64_t)max_key + 1 <= (uint64_t)num_slots * 4) {
+        idx->direct_len = max_key + 1;
+        idx->direct = g_new0(void *, idx->direct_len);
+        g_hash_table_iter_init(&iter, table);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            idx->direct[GPOINTER_TO_UINT(key)] = value;
+        }
+        return;
+    }
+
+    idx->slots = g_new0(ws_uint_index_slot, num_slots);
+    idx->mask = num_slots - 1;
+    idx->shift = 32 - log2_slots;
+    g_hash_table_iter_init(&iter, table);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        uint32_t i;
+
+        ws_assert(value != NULL);
+        i = (GPOINTER_TO_UINT(key) * UINT32_C(0x9E3779B1)) >> idx->shift;
+        while (idx->slots[i].value != NULL) {
+            i = (i + 1) & idx->mask;
+        }
+        idx->slots[i].key = GPOINTER_TO_UINT(key);
+        idx->slots[i].value = value;
+    }
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
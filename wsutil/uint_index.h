@@ -0,0 +1,100 @@
+/** @file
+ *
+ * A read-only map from 32-bit unsigned integers to pointers, for lookups
+ * on hot paths.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_UINT_INDEX_H__
+#define __WS_UINT_INDEX_H__
+
+#include <wireshark.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** One slot of the open-addressing table; empty if value is NULL. */
+typedef struct {
+    uint32_t  key;
+    void     *value;
+} ws_uint_index_slot;
+
+/** A snapshot of a GHashTable whose keys are GUINT_TO_POINTER() values
+ * and whose values are never NULL.
+ *
+ * If the keys are dense enough, the values are stored in an array indexed
+ * by key; otherwise they are stored in an open-addressing table, at most
+ * half full, with linear probing. Either way a lookup touches one or two
+ * cache lines and follows no list pointers, unlike g_hash_table_lookup().
+ *
+ * The index doesn't follow changes to the hash table; rebuild it with
+ * ws_uint_index_build() after the set of keys, or any value, changes.
+ */
+typedef struct {
+    void              **direct;     /**< Values by key, if not NULL */
+    uint32_t            direct_len; /**< Number of elements of direct */
+    ws_uint_index_slot *slots;      /**< Open-addressing table, if not NULL */
+    uint32_t            mask;       /**< Number of slots - 1 */
+    unsigned            shift;      /**< 32 - log2(number of slots) */
+} ws_uint_index;
+
+/**
+ * @brief Initialize an empty index, in which every lookup fails.
+ *
+ * @param idx The index.
+ */
+WS_DLL_PUBLIC void ws_uint_index_init(ws_uint_index *idx);
+
+/**
+ * @brief Replace the contents of an index with those of a hash table.
+ *
+ * @param idx The index, initialized with ws_uint_index_init().
+ * @param table A hash table with GUINT_TO_POINTER() keys and non-NULL values.
+ */
+WS_DLL_PUBLIC void ws_uint_index_build(ws_uint_index *idx, GHashTable *table);
+
+/**
+ * @brief Free the memory used by an index, leaving it empty.
+ *
+ * @param idx The index.
+ */
+WS_DLL_PUBLIC void ws_uint_index_clear(ws_uint_index *idx);
+
+/**
+ * @brief Look up a key in an index.
+ *
+ * @param idx The index.
+ * @param key The key.
+ * @return The value for the key, or NULL if there isn't one.
+ */
+static inline void *
+ws_uint_index_lookup(const ws_uint_index *idx, uint32_t key)
+{
+    uint32_t i;
+
+    if (idx->slots == NULL) {
+        return key < idx->direct_len ? idx->direct[key] : NULL;
+    }
+
+    /* Fibonacci hashing: the top bits of key * 2^32/phi. */
+    for (i = (key * UINT32_C(0x9E3779B1)) >> idx->shift; ; i = (i + 1) & idx->mask) {
+        if (idx->slots[i].value == NULL) {
+            return NULL;
+        }
+        if (idx->slots[i].key == key) {
+            return idx->slots[i].value;
+        }
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_UINT_INDEX_H__ */
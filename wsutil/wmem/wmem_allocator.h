@@ -49,6 +49,8 @@ struct _wmem_allocator_t {
     void *private_data; /**< Allocator-specific internal state. */
     enum _wmem_allocator_type_t type; /**< Allocator type (e.g., scope, file-backed, slab). */
     bool in_scope; /**< Indicates whether the allocator is currently active in a scope. */
+    bool count_bytes; /**< Whether wmem_alloc() and wmem_realloc() add to bytes_allocated. */
+    uint64_t bytes_allocated; /**< The sizes requested while count_bytes was set. */
 };
 
 #ifdef __cplusplus
@@ -41,6 +41,10 @@ wmem_alloc(wmem_allocator_t *allocator, const size_t size)
         return NULL;
     }
 
+    if (allocator->count_bytes) {
+        allocator->bytes_allocated += size;
+    }
+
     return allocator->walloc(allocator->private_data, size);
 }
 
@@ -93,6 +97,10 @@ wmem_realloc(wmem_allocator_t *allocator, void *ptr, const size_t size)
 
     ws_assert(allocator->in_scope);
 
+    if (allocator->count_bytes) {
+        allocator->bytes_allocated += size;
+    }
+
     return allocator->wrealloc(allocator->private_data, ptr, size);
 }
 
@@ -142,6 +150,8 @@ wmem_allocator_new(const wmem_allocator_type_t type)
     allocator->type      = real_type;
     allocator->callbacks = NULL;
     allocator->in_scope  = true;
+    allocator->count_bytes = false;
+    allocator->bytes_allocated = 0;
 
     switch (real_type) {
         case WMEM_ALLOCATOR_SIMPLE:
@@ -164,6 +174,22 @@ wmem_allocator_new(const wmem_allocator_type_t type)
     return allocator;
 }
 
+void
+wmem_allocator_count_bytes(wmem_allocator_t *allocator, bool count)
+{
+    allocator->count_bytes = count;
+}
+
+uint64_t
+wmem_allocator_bytes_allocated(wmem_allocator_t *allocator)
+{
+    if (allocator == NULL) {
+        return 0;
+    }
+
+    return allocator->bytes_allocated;
+}
+
 void
 wmem_init(void)
 {
@@ -233,6 +233,35 @@ WS_DLL_PUBLIC
 wmem_allocator_t *
 wmem_allocator_new(const wmem_allocator_type_t type);
 
+/**
+ * @brief Start or stop counting the bytes allocated from an allocator.
+ *
+ * While counting, wmem_alloc() and wmem_realloc() add the sizes they are
+ * asked for to the allocator's total. Stopping keeps the total, and
+ * starting again adds to it.
+ *
+ * @param allocator The allocator to count.
+ * @param count true to count, false to stop.
+ */
+WS_DLL_PUBLIC
+void
+wmem_allocator_count_bytes(wmem_allocator_t *allocator, bool count);
+
+/**
+ * @brief Get the number of bytes allocated from an allocator.
+ *
+ * This is the total of the sizes requested while the allocator was being
+ * counted, including reallocations, and is not reduced when memory is
+ * freed, so the difference between two calls is the amount allocated in
+ * between.
+ *
+ * @param allocator The allocator.
+ * @return The number of bytes, or 0 if the allocator has never been counted.
+ */
+WS_DLL_PUBLIC
+uint64_t
+wmem_allocator_bytes_allocated(wmem_allocator_t *allocator);
+
 /**
  * @brief Initialize the wmem subsystem.
  *
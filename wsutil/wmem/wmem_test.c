@@ -43,6 +43,8 @@ wmem_allocator_force_new(const wmem_allocator_type_t type)
     allocator->type = type;
     allocator->callbacks = NULL;
     allocator->in_scope = true;
+    allocator->count_bytes = false;
+    allocator->bytes_allocated = 0;
 
     switch (type) {
         case WMEM_ALLOCATOR_SIMPLE:
@@ -194,6 +196,66 @@ wmem_test_allocator_callbacks(void)
     g_assert_true(cb_called_count == 3);
 }
 
+static void
+wmem_test_allocator_count_bytes(void)
+{
+    wmem_allocator_t *allocator;
+    void *ptr;
+
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_STRICT);
+
+    ptr = wmem_alloc(allocator, 8);
+    g_assert_true(wmem_allocator_bytes_allocated(allocator) == 0);
+
+    wmem_allocator_count_bytes(allocator, true);
+    wmem_allocator_count_bytes(allocator, true);
+    g_assert_true(wmem_allocator_bytes_allocated(allocator) == 0);
+
+    /* Memory allocated before counting started can still be used. */
+    ptr = wmem_realloc(allocator, ptr, 16);
+    g_assert_true(wmem_allocator_bytes_allocated(allocator) == 16);
+    wmem_free(allocator, ptr);
+
+    ptr = wmem_alloc0(allocator, 100);
+    g_assert_true(wmem_allocator_bytes_allocated(allocator) == 116);
+    wmem_free(allocator, ptr);
+    g_assert_true(wmem_allocator_bytes_allocated(allocator) == 116);
+
+    ptr = wmem_strdup(allocator, "four");
+    g_assert_true(wmem_allocator_bytes_allocated(allocator) == 121);
+
+    /* The allocator's own helpers still work while it's counted. */
+    wmem_strict_check_canaries(allocator);
+
+    wmem_free_all(allocator);
+    wmem_gc(allocator);
+    g_assert_true(wmem_allocator_bytes_allocated(allocator) == 121);
+
+    /* Stopping keeps the total, and starting again adds to it. */
+    wmem_allocator_count_bytes(allocator, false);
+    ptr = wmem_alloc(allocator, 10);
+    g_assert_true(wmem_allocator_bytes_allocated(allocator) == 121);
+    wmem_allocator_count_bytes(allocator, true);
+    ptr = wmem_realloc(allocator, ptr, 20);
+    g_assert_true(wmem_allocator_bytes_allocated(allocator) == 141);
+    wmem_strict_check_canaries(allocator);
+
+    wmem_destroy_allocator(allocator);
+
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_BLOCK);
+    wmem_allocator_count_bytes(allocator, true);
+    ptr = wmem_alloc(allocator, 64);
+    ptr = wmem_realloc(allocator, ptr, 128);
+    g_assert_true(wmem_allocator_bytes_allocated(allocator) == 192);
+    wmem_block_verify(allocator);
+    wmem_allocator_count_bytes(allocator, false);
+    wmem_free(allocator, ptr);
+    wmem_block_verify(allocator);
+    wmem_destroy_allocator(allocator);
+
+    g_assert_true(wmem_allocator_bytes_allocated(NULL) == 0);
+}
+
 static void
 wmem_test_allocator_det(wmem_allocator_t *allocator, wmem_verify_func verify,
         unsigned len)
@@ -1470,6 +1532,7 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/allocator/simple",    wmem_test_allocator_simple);
     g_test_add_func("/wmem/allocator/strict",    wmem_test_allocator_strict);
     g_test_add_func("/wmem/allocator/callbacks", wmem_test_allocator_callbacks);
+    g_test_add_func("/wmem/allocator/count",     wmem_test_allocator_count_bytes);
 
     g_test_add_func("/wmem/utils/misc",    wmem_test_miscutls);
     g_test_add_func("/wmem/utils/strings", wmem_test_strutls);
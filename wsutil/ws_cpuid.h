@@ -62,6 +62,8 @@
  * on Windows anyway, so the answer is probably "no".
  */
 #if defined(_M_IX86) || defined(_M_X64)
+#include <immintrin.h>	/* _xgetbv() */
+
 static bool
 ws_cpuid(uint32_t *CPUInfo, uint32_t selector)
 {
@@ -72,6 +74,19 @@ ws_cpuid(uint32_t *CPUInfo, uint32_t selector)
 	/* XXX, how to check if it's supported on MSVC? just in case clear all flags above */
 	return true;
 }
+
+/**
+ * @brief Read extended control register 0 (XCR0).
+ *
+ * Only call this if ws_cpuid() reports OSXSAVE support.
+ *
+ * @return The low 32 bits of XCR0.
+ */
+static inline uint32_t
+ws_xgetbv0(void)
+{
+	return (uint32_t)_xgetbv(0);
+}
 #else /* not x86 */
 static bool
 ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
@@ -79,6 +94,12 @@ ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
 	/* Not x86, so no cpuid instruction */
 	return false;
 }
+
+static inline uint32_t
+ws_xgetbv0(void)
+{
+	return 0;
+}
 #endif
 
 #elif defined(__GNUC__)  /* GCC/clang */
@@ -104,6 +125,25 @@ ws_cpuid(uint32_t *CPUInfo, int selector)
 							"c" (0));
 	return true;
 }
+
+/**
+ * @brief Read extended control register 0 (XCR0).
+ *
+ * Only call this if ws_cpuid() reports OSXSAVE support.
+ *
+ * @return The low 32 bits of XCR0.
+ */
+static inline uint32_t
+ws_xgetbv0(void)
+{
+	uint32_t eax, edx;
+
+	__asm__ __volatile__("xgetbv"
+						: "=a" (eax),
+							"=d" (edx)
+						: "c" (0));
+	return eax;
+}
 #elif defined(__i386__)
 
 /**
@@ -141,6 +181,12 @@ ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
 	 */
 	return false;
 }
+
+static inline uint32_t
+ws_xgetbv0(void)
+{
+	return 0;
+}
 #else /* not x86 */
 
 /**
@@ -156,6 +202,12 @@ ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
 	/* Not x86, so no cpuid instruction */
 	return false;
 }
+
+static inline uint32_t
+ws_xgetbv0(void)
+{
+	return 0;
+}
 #endif
 
 #else /* Other compilers */
@@ -172,6 +224,12 @@ ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
 {
 	return false;
 }
+
+static inline uint32_t
+ws_xgetbv0(void)
+{
+	return 0;
+}
 #endif
 
 /**
@@ -179,7 +237,7 @@ ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
  *
  * @return 1 if SSE4.2 is supported, otherwise returns 0.
  */
-static int
+static inline int
 ws_cpuid_sse42(void)
 {
 	uint32_t CPUInfo[4];
@@ -190,3 +248,35 @@ ws_cpuid_sse42(void)
 	/* in ECX bit 20 toggled on */
 	return (CPUInfo[2] & (1 << 20));
 }
+
+/**
+ * @brief Checks if the CPU supports the AVX2 instruction set and the OS
+ * saves the YMM registers across context switches.
+ *
+ * @return true if AVX2 can be used, otherwise false.
+ */
+static inline bool
+ws_cpuid_avx2(void)
+{
+	uint32_t CPUInfo[4];
+
+	if (!ws_cpuid(CPUInfo, 0) || CPUInfo[0] < 7)
+		return false;
+
+	if (!ws_cpuid(CPUInfo, 1))
+		return false;
+
+	/* in ECX bits 27 (OSXSAVE) and 28 (AVX) toggled on */
+	if ((CPUInfo[2] & (UINT32_C(3) << 27)) != (UINT32_C(3) << 27))
+		return false;
+
+	/* XMM and YMM state enabled in XCR0 */
+	if ((ws_xgetbv0() & 0x6) != 0x6)
+		return false;
+
+	if (!ws_cpuid(CPUInfo, 7))
+		return false;
+
+	/* in EBX bit 5 toggled on */
+	return (CPUInfo[1] & (1 << 5)) != 0;
+}
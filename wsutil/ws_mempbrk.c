@@ -27,16 +27,41 @@
 
 #include <string.h>
 
+#ifdef WS_MEMPBRK_HAVE_SSE2
+#include <emmintrin.h>
+#include "bits_ctz.h"
+#endif
+#ifdef HAVE_AVX2
+#include "ws_cpuid.h"
+#endif
+
 void
 ws_mempbrk_compile(ws_mempbrk_pattern* pattern, const char *needles)
 {
     const char *n = needles;
+    size_t length = strlen(needles);
+
     memset(pattern->patt, 0, 256);
     while (*n) {
-        pattern->patt[(int)*n] = 1;
+        pattern->patt[(uint8_t)*n] = 1;
         n++;
     }
 
+    memset(pattern->small_needles, 0, sizeof pattern->small_needles);
+    if (length > 0 && length <= WS_MEMPBRK_SMALL_NEEDLES) {
+        for (size_t i = 0; i < WS_MEMPBRK_SMALL_NEEDLES; i++)
+            pattern->small_needles[i] = (uint8_t)needles[i < length ? i : 0];
+        pattern->num_small_needles = (unsigned)length;
+    } else {
+        pattern->num_small_needles = 0;
+    }
+
+#ifdef HAVE_AVX2
+    pattern->use_avx2 = pattern->num_small_needles && ws_cpuid_avx2();
+#else
+    pattern->use_avx2 = false;
+#endif
+
 #ifdef HAVE_SSE4_2
     ws_mempbrk_sse42_compile(pattern, needles);
 #endif
@@ -61,9 +86,49 @@ ws_mempbrk_portable_exec(const uint8_t* haystack, size_t haystacklen, const ws_m
 }
 
 
+#ifdef WS_MEMPBRK_HAVE_SSE2
+const uint8_t *
+ws_mempbrk_sse2_exec(const uint8_t* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern, unsigned char *found_needle)
+{
+    const uint8_t *haystack_end = haystack + haystacklen;
+    const __m128i n0 = _mm_set1_epi8((char)pattern->small_needles[0]);
+    const __m128i n1 = _mm_set1_epi8((char)pattern->small_needles[1]);
+    const __m128i n2 = _mm_set1_epi8((char)pattern->small_needles[2]);
+    const __m128i n3 = _mm_set1_epi8((char)pattern->small_needles[3]);
+
+    while (haystack_end - haystack >= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(const void *)haystack);
+        __m128i match = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, n0), _mm_cmpeq_epi8(block, n1)),
+            _mm_or_si128(_mm_cmpeq_epi8(block, n2), _mm_cmpeq_epi8(block, n3)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(match);
+
+        if (mask) {
+            haystack += ws_ctz(mask);
+            if (found_needle)
+                *found_needle = *haystack;
+            return haystack;
+        }
+        haystack += 16;
+    }
+
+    return ws_mempbrk_portable_exec(haystack, (size_t)(haystack_end - haystack), pattern, found_needle);
+}
+#endif
+
 WS_DLL_PUBLIC const uint8_t *
 ws_mempbrk_exec(const uint8_t* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern, unsigned char *found_needle)
 {
+    if (haystacklen >= 16 && pattern->num_small_needles) {
+#ifdef HAVE_AVX2
+        if (pattern->use_avx2)
+            return ws_mempbrk_avx2_exec(haystack, haystacklen, pattern, found_needle);
+#endif
+#ifdef WS_MEMPBRK_HAVE_SSE2
+        return ws_mempbrk_sse2_exec(haystack, haystacklen, pattern, found_needle);
+#endif
+    }
+
 #ifdef HAVE_SSE4_2
     if (haystacklen >= 16 && pattern->use_sse42)
         return (const uint8_t*)ws_mempbrk_sse42_exec((const char*)haystack, haystacklen, pattern, found_needle);
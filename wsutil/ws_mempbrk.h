@@ -16,10 +16,23 @@
 #include <emmintrin.h>
 #endif
 
+/** Patterns with at most this many needles are scanned by comparing each
+ * block of the haystack against every needle (SSE2/AVX2), which is faster
+ * than a table lookup or PCMPISTRI for the handful of delimiters that text
+ * protocols search for.
+ */
+#define WS_MEMPBRK_SMALL_NEEDLES 4
+
 /** The pattern object used for ws_mempbrk_exec().
  */
 typedef struct {
     char patt[256];
+    /** The needles if there are at most WS_MEMPBRK_SMALL_NEEDLES of them;
+     * unused slots repeat the first needle. */
+    uint8_t small_needles[WS_MEMPBRK_SMALL_NEEDLES];
+    /** Number of needles, or 0 if there are too many for small_needles. */
+    unsigned num_small_needles;
+    bool use_avx2;
 #ifdef HAVE_SSE4_2
     bool use_sse42;
     __m128i mask;
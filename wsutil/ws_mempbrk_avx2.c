@@ -0,0 +1,76 @@
+/* ws_mempbrk_avx2.c
+ * Scan for a small set of bytes with AVX2 intrinsics
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#ifdef HAVE_AVX2
+
+#include <immintrin.h>
+
+#include "ws_mempbrk.h"
+#include "ws_mempbrk_int.h"
+#include "bits_ctz.h"
+
+/*
+ * Compare each 32-byte block of the haystack against every needle and
+ * OR the results; with the needle slots padded by repeating the first
+ * needle, this is branch-free for any number of needles up to
+ * WS_MEMPBRK_SMALL_NEEDLES. Unlike PCMPISTRI it doesn't stop at NUL
+ * bytes, so binary data is scanned at full speed too.
+ *
+ * This file is compiled with the AVX2 flag; only call it if
+ * ws_cpuid_avx2() said so (pattern->use_avx2).
+ */
+const uint8_t *
+ws_mempbrk_avx2_exec(const uint8_t* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern, unsigned char *found_needle)
+{
+    const uint8_t *haystack_end = haystack + haystacklen;
+    const __m256i n0 = _mm256_set1_epi8((char)pattern->small_needles[0]);
+    const __m256i n1 = _mm256_set1_epi8((char)pattern->small_needles[1]);
+    const __m256i n2 = _mm256_set1_epi8((char)pattern->small_needles[2]);
+    const __m256i n3 = _mm256_set1_epi8((char)pattern->small_needles[3]);
+
+    while (haystack_end - haystack >= 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(const void *)haystack);
+        __m256i match = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, n0), _mm256_cmpeq_epi8(block, n1)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, n2), _mm256_cmpeq_epi8(block, n3)));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(match);
+
+        if (mask) {
+            haystack += ws_ctz(mask);
+            if (found_needle)
+                *found_needle = *haystack;
+            return haystack;
+        }
+        haystack += 32;
+    }
+
+#ifdef WS_MEMPBRK_HAVE_SSE2
+    if (haystack_end - haystack >= 16)
+        return ws_mempbrk_sse2_exec(haystack, (size_t)(haystack_end - haystack), pattern, found_needle);
+#endif
+    return ws_mempbrk_portable_exec(haystack, (size_t)(haystack_end - haystack), pattern, found_needle);
+}
+
+#endif /* HAVE_AVX2 */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -26,6 +26,42 @@
  */
 const uint8_t *ws_mempbrk_portable_exec(const uint8_t* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern, unsigned char *found_needle);
 
+/*
+ * SSE2 is part of the x86-64 baseline, so it doesn't need a runtime check
+ * or a special compiler flag there.
+ */
+#if defined(__SSE2__) || defined(_M_X64)
+#define WS_MEMPBRK_HAVE_SSE2 1
+
+/**
+ * @brief Search for the first matching byte using SSE2 byte compares.
+ *
+ * Only usable for patterns with num_small_needles != 0.
+ *
+ * @param haystack       Pointer to the input buffer to search.
+ * @param haystacklen    Length of the input buffer in bytes.
+ * @param pattern        Precompiled pattern containing target bytes.
+ * @param found_needle   Optional output pointer to receive the matched byte.
+ * @return               Pointer to the first matching byte in `haystack`, or NULL if none found.
+ */
+const uint8_t *ws_mempbrk_sse2_exec(const uint8_t* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern, unsigned char *found_needle);
+#endif
+
+#ifdef HAVE_AVX2
+/**
+ * @brief Search for the first matching byte using AVX2 byte compares.
+ *
+ * Only usable for patterns with num_small_needles != 0 and use_avx2 set.
+ *
+ * @param haystack       Pointer to the input buffer to search.
+ * @param haystacklen    Length of the input buffer in bytes.
+ * @param pattern        Precompiled pattern containing target bytes.
+ * @param found_needle   Optional output pointer to receive the matched byte.
+ * @return               Pointer to the first matching byte in `haystack`, or NULL if none found.
+ */
+const uint8_t *ws_mempbrk_avx2_exec(const uint8_t* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern, unsigned char *found_needle);
+#endif
+
 #ifdef HAVE_SSE4_2
 
 /**